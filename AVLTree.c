@@ -8,6 +8,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "AVLTree.h"
+#include "MemPool.h"
 
 
 #define DEBUG_LOG 0
@@ -30,9 +31,11 @@ struct _avl_node
     avl_node_t *left_child;  // 左孩子
     avl_node_t *right_child; // 右孩子
     
-    void *element;  // 节点保存的元素
+    void *element;  // 节点保存的元素，内嵌模式下指向 data
     int depth;      // 当前节点的高度
     int key;        // 键值
+    int count;      // 以当前节点为根的子树的节点数
+    void *data[];   // 内嵌模式下保存元素，与节点在同一块内存中（声明为指针数组，按指针大小对齐）
 };
 
 struct _avl_tree_private
@@ -41,7 +44,9 @@ struct _avl_tree_private
     int m_element_size;
     int m_node_cnt;
     bool m_is_thread_safe;
-    pthread_mutex_t m_tree_mutex;
+    bool m_inline_element;  // 元素是否内嵌在节点中
+    pthread_rwlock_t m_tree_lock;   // 查询与遍历共享读锁，修改独占写锁
+    mem_pool_t *m_pool;     // 节点与元素的内存池，清除树时整体释放
 };
 
 #define MAX(a, b) (int)((a) > (b) ? (a) : (b))
@@ -49,10 +54,18 @@ struct _avl_tree_private
 // 获取节点高度
 #define HEIGHT(node) ((NULL == (node)) ? 0 : (MAX((NULL != node->left_child ? node->left_child->depth : 0), (NULL != node->right_child ? node->right_child->depth : 0) ) + 1))
 
+// 获取子树节点数
+#define COUNT(node) ((NULL == (node)) ? 0 : (node)->count)
+
+// 由孩子更新节点的高度与子树节点数
+#define UPDATE(node) do{ (node)->depth = HEIGHT(node); (node)->count = COUNT((node)->left_child) + COUNT((node)->right_child) + 1; }while(0)
+
 #define ABS(a) ( (a) > 0 ? (a) :  (- (a)))
 
 #define INIT_KEY (int)(-1)
 
+#define AVL_BATCH_GROUP 16  // 批量查找时交替查找的键值个数
+
 /*
 @func: 
     获取私有成员变量
@@ -73,7 +86,7 @@ static avl_tree_private_t* get_private_member(avl_tree_t* tree)
 
 /*
 @func: 
-    线程锁， 上锁/解锁
+    线程锁， 上写锁/上读锁/解锁
 
 @para: 
     tree ： 树指针
@@ -82,20 +95,27 @@ static avl_tree_private_t* get_private_member(avl_tree_t* tree)
     None
 
 @note: 
-    若用户代码结构不会造成冲突可不使用
+    若用户代码结构不会造成冲突可不使用；读锁之间不互斥，多个线程可以同时查询
 */
 static void avl_tree_lock(avl_tree_t* tree)
 {
     avl_tree_private_t* _this = get_private_member(tree);
     if(_this->m_is_thread_safe)
-        pthread_mutex_lock(&_this->m_tree_mutex);
+        pthread_rwlock_wrlock(&_this->m_tree_lock);
+}
+
+static void avl_tree_lock_shared(avl_tree_t* tree)
+{
+    avl_tree_private_t* _this = get_private_member(tree);
+    if(_this->m_is_thread_safe)
+        pthread_rwlock_rdlock(&_this->m_tree_lock);
 }
 
 static void avl_tree_unlock(avl_tree_t* tree)
 {
     avl_tree_private_t* _this = get_private_member(tree);
     if(_this->m_is_thread_safe)
-        pthread_mutex_unlock(&_this->m_tree_mutex);
+        pthread_rwlock_unlock(&_this->m_tree_lock);
 }
 
 /*
@@ -115,6 +135,7 @@ static void add_to_left(avl_node_t* node, avl_node_t* p)
     node->parent = p;
     node->left_child = node->right_child = NULL;
     node->depth = 1;
+    node->count = 1;
 }
 
 static void add_to_right(avl_node_t* node, avl_node_t* p)
@@ -123,6 +144,7 @@ static void add_to_right(avl_node_t* node, avl_node_t* p)
     node->parent = p;
     node->left_child = node->right_child = NULL;
     node->depth = 1;
+    node->count = 1;
 }
 
 
@@ -174,8 +196,8 @@ static avl_node_t* LL(avl_node_t* node)
     temp->right_child = node;
     node->parent = temp;
 
-    node->depth = HEIGHT(node);  // 顺序不能换
-    temp->depth = HEIGHT(temp);
+    UPDATE(node);  // 顺序不能换
+    UPDATE(temp);
     
     return temp;
 }
@@ -193,8 +215,8 @@ static avl_node_t* RR(avl_node_t* node)
     temp->left_child = node;
     node->parent = temp;
 
-    node->depth = HEIGHT(node);
-    temp->depth = HEIGHT(temp);
+    UPDATE(node);
+    UPDATE(temp);
 
     return temp;
 }
@@ -266,8 +288,20 @@ static avl_node_t* avl_tree_adjust(avl_node_t* node)
     int ： 0 成功， -1 失败
 
 @note:
-    None.
+    avl_tree_release_node 只把节点归还内存池，不调用 pf_free_element
 */
+static void avl_tree_release_node(avl_tree_private_t* _this, avl_node_t* node)
+{
+    if(_this->m_inline_element)
+    {
+        _this->m_pool->free(_this->m_pool, node, sizeof(avl_node_t) + _this->m_element_size);
+        return;
+    }
+
+    _this->m_pool->free(_this->m_pool, node->element, _this->m_element_size);
+    _this->m_pool->free(_this->m_pool, node, sizeof(avl_node_t));
+}
+
 static int avl_tree_free_node(avl_tree_t* tree, avl_node_t* node)
 {
     if(NULL == node || NULL == tree) return -1;
@@ -275,14 +309,7 @@ static int avl_tree_free_node(avl_tree_t* tree, avl_node_t* node)
     if(NULL != tree->pf_free_element)
         tree->pf_free_element(node->element);
 
-    if(NULL != node->element)
-    { 
-        free(node->element);
-        node->element = NULL;
-    }
-
-    free(node);
-    node = NULL;
+    avl_tree_release_node(get_private_member(tree), node);
 
     return 0;
 }
@@ -305,13 +332,32 @@ static avl_node_t* avl_tree_create_node(avl_tree_t* tree)
     if(NULL == tree) return NULL;
 
     avl_tree_private_t* _this = get_private_member(tree);
-    avl_node_t* node = (avl_node_t*)malloc(sizeof(avl_node_t));
+    if(_this->m_inline_element)
+    {
+        avl_node_t* node = (avl_node_t*)_this->m_pool->alloc(_this->m_pool, sizeof(avl_node_t) + _this->m_element_size);
+        if(NULL == node)
+        {
+            AVL_LOG_DEBUG("[ERROR]:node malloc");
+            return NULL;
+        }
+        node->element = node->data;
+        node->key = INIT_KEY;
+        return node;
+    }
+
+    avl_node_t* node = (avl_node_t*)_this->m_pool->alloc(_this->m_pool, sizeof(avl_node_t));
     if(NULL == node) 
     {
         AVL_LOG_DEBUG("[ERROR]:node malloc");
         return NULL;
     }
-    node->element = malloc(_this->m_element_size);
+    node->element = _this->m_pool->alloc(_this->m_pool, _this->m_element_size);
+    if(NULL == node->element)
+    {
+        AVL_LOG_DEBUG("[ERROR]:element malloc");
+        _this->m_pool->free(_this->m_pool, node, sizeof(avl_node_t));
+        return NULL;
+    }
 
     node->key = INIT_KEY;
 
@@ -320,25 +366,23 @@ static avl_node_t* avl_tree_create_node(avl_tree_t* tree)
 
 /*
 @func: 
-    增加节点
+    创建保存指定元素的节点
 
 @para: 
     tree : 树指针
-    node : 要增加的节点
+    ele : 节点保存的元素，会被拷贝到节点中
 
 @return:
-    int : -1 树指针为空， -2 创建节点失败， -3 重复插入
+    avl_node_t* ： NULL 失败，other 创建的节点
 
 @note:
     None.
 */
-static int avl_tree_add(avl_tree_t *tree, void *ele)
+static avl_node_t* avl_tree_create_element_node(avl_tree_t *tree, void *ele)
 {
-    if(tree == NULL) return -1;
-
     avl_node_t* node = avl_tree_create_node(tree);
 
-    if(NULL == node) return -2;
+    if(NULL == node) return NULL;
 
     avl_tree_private_t* _this = get_private_member(tree);
 
@@ -350,16 +394,36 @@ static int avl_tree_add(avl_tree_t *tree, void *ele)
     
     if(INIT_KEY == node->key)
         node->key = key;
-    
-    avl_tree_lock(tree);
+
+    return node;
+}
+
+/*
+@func: 
+    把节点插入树中并调整平衡
+
+@para: 
+    tree : 树指针
+    node : 要插入的节点
+
+@return:
+    int : 0 成功， -3 重复插入（节点会被释放）
+
+@note:
+    调用者需持有树的锁
+*/
+static int avl_tree_insert_node(avl_tree_t *tree, avl_node_t *node)
+{
+    avl_tree_private_t* _this = get_private_member(tree);
+    int key = node->key;
 
     if(NULL == _this->m_root) // 添加第一个节点
     {
         node->depth = 1;
+        node->count = 1;
         node->left_child = node->right_child = node->parent = NULL;
         _this->m_root = node;
         _this->m_node_cnt = 1;
-        avl_tree_unlock(tree);
         return 0;
     }
     avl_node_t* p = _this->m_root;
@@ -397,14 +461,13 @@ static int avl_tree_add(avl_tree_t *tree, void *ele)
         {
             AVL_LOG_DEBUG("Element repetition");
             avl_tree_free_node(tree, node);
-            avl_tree_unlock(tree);
             return -3; // 重复
          }
     }
    
     while(NULL != p)
     {
-        p->depth = HEIGHT(p);
+        UPDATE(p);
         if(NULL == p->parent) // 调整到根节点
         {
             _this->m_root = avl_tree_adjust(p);
@@ -427,10 +490,178 @@ static int avl_tree_add(avl_tree_t *tree, void *ele)
     }
 
     _this->m_node_cnt++;
-    avl_tree_unlock(tree);
     return 0;
 }
 
+/*
+@func: 
+    增加节点
+
+@para: 
+    tree : 树指针
+    node : 要增加的节点
+
+@return:
+    int : -1 树指针为空， -2 创建节点失败， -3 重复插入
+
+@note:
+    None.
+*/
+static int avl_tree_add(avl_tree_t *tree, void *ele)
+{
+    if(tree == NULL) return -1;
+
+    avl_node_t* node = avl_tree_create_element_node(tree, ele);
+
+    if(NULL == node) return -2;
+
+    avl_tree_lock(tree);
+    int res = avl_tree_insert_node(tree, node);
+    avl_tree_unlock(tree);
+
+    return res;
+}
+
+/*
+@func: 
+    批量增加节点
+
+@para: 
+    tree : 树指针
+    eles : 连续存放的元素数组，每个元素大小为创建树时指定的 element_size
+    cnt : 元素个数
+    status : 每个元素的插入结果，含义与 add 的返回值相同，可传 NULL
+
+@return:
+    int : < 0 参数错误， other 成功插入的元素个数
+
+@note:
+    节点在加锁前全部创建完成，整批插入只获取一次锁
+*/
+static int avl_tree_add_batch(avl_tree_t *tree, void *eles, int cnt, int *status)
+{
+    if(NULL == tree || NULL == eles || cnt < 0) return -1;
+
+    avl_tree_private_t* _this = get_private_member(tree);
+    avl_node_t** nodes = (avl_node_t**)malloc(sizeof(avl_node_t*) * (cnt > 0 ? cnt : 1));
+    if(NULL == nodes) return -2;
+
+    for(int i = 0; i < cnt; ++i)
+        nodes[i] = avl_tree_create_element_node(tree, (char*)eles + (size_t)i * _this->m_element_size);
+
+    int added = 0;
+    avl_tree_lock(tree);
+    for(int i = 0; i < cnt; ++i)
+    {
+        int res = (NULL == nodes[i]) ? -2 : avl_tree_insert_node(tree, nodes[i]);
+        if(0 == res)
+            added++;
+        if(NULL != status)
+            status[i] = res;
+    }
+    avl_tree_unlock(tree);
+
+    free(nodes);
+    return added;
+}
+
+/*
+@func: 
+    把有序节点数组的 [low, high) 区间构建为平衡子树
+
+@para: 
+    nodes : 按键值递增排列的节点
+    low, high : 区间
+    parent : 子树根节点的父节点
+
+@return:
+    avl_node_t* ： 子树的根节点
+
+@note:
+    取区间中点作为根节点，左右子树节点数最多相差 1，高度直接由子树计算
+*/
+static avl_node_t* avl_tree_build_range(avl_node_t** nodes, int low, int high, avl_node_t* parent)
+{
+    if(low >= high) return NULL;
+
+    int mid = low + (high - low) / 2;
+    avl_node_t* node = nodes[mid];
+
+    node->parent = parent;
+    node->left_child = avl_tree_build_range(nodes, low, mid, node);
+    node->right_child = avl_tree_build_range(nodes, mid + 1, high, node);
+    UPDATE(node);
+
+    return node;
+}
+
+/*
+@func: 
+    由按键值严格递增排列的元素直接构建平衡树
+
+@para: 
+    tree : 树指针，必须为空树
+    eles : 连续存放的元素数组，每个元素大小为创建树时指定的 element_size
+    cnt : 元素个数
+
+@return:
+    int : 0 成功， -1 参数错误， -2 创建节点失败， -3 树不为空， -4 元素未按键值严格递增排列
+
+@note:
+    节点在加锁前全部创建完成；失败时已创建的节点只释放节点本身，不调用 pf_free_element
+*/
+static int avl_tree_build_sorted(avl_tree_t *tree, void *eles, int cnt)
+{
+    if(NULL == tree || NULL == eles || cnt < 0) return -1;
+    if(0 == cnt) return 0;
+
+    avl_tree_private_t* _this = get_private_member(tree);
+    avl_node_t** nodes = (avl_node_t**)malloc(sizeof(avl_node_t*) * cnt);
+    if(NULL == nodes) return -2;
+
+    int res = 0;
+    int created = 0;
+    for(; created < cnt; ++created)
+    {
+        nodes[created] = avl_tree_create_element_node(tree, (char*)eles + (size_t)created * _this->m_element_size);
+        if(NULL == nodes[created])
+        {
+            res = -2;
+            break;
+        }
+        if(created > 0 && nodes[created]->key <= nodes[created - 1]->key)
+        {
+            created++;
+            res = -4;
+            break;
+        }
+    }
+
+    if(0 == res)
+    {
+        avl_tree_lock(tree);
+        if(NULL == _this->m_root)
+        {
+            _this->m_root = avl_tree_build_range(nodes, 0, cnt, NULL);
+            _this->m_node_cnt = cnt;
+        }
+        else
+        {
+            res = -3;
+        }
+        avl_tree_unlock(tree);
+    }
+
+    if(0 != res)
+    {
+        for(int i = 0; i < created; ++i)
+            avl_tree_release_node(_this, nodes[i]);
+    }
+
+    free(nodes);
+    return res;
+}
+
 /*
 @func: 
     通过键值查找节点
@@ -469,13 +700,81 @@ static avl_node_t* query_by_key(avl_tree_t *tree, int key)
 
 static void* avl_tree_query_by_key(avl_tree_t *tree, int key)
 {
+    if(NULL == tree) return NULL;
+
+    avl_tree_lock_shared(tree);
     avl_node_t* node = query_by_key(tree, key);
+    avl_tree_unlock(tree);
     
     if(NULL == node) return NULL;
 
     return node->element;
 }
 
+/*
+@func: 
+    通过键值批量查找元素
+
+@para: 
+    tree : 树指针
+    keys : 键值数组
+    cnt : 键值个数
+    eles : 输出每个键值对应的元素，不存在时为 NULL
+
+@return:
+    int : < 0 : 参数错误， other ： 查找到的元素个数
+
+@note:
+    每 AVL_BATCH_GROUP 个键值为一组，轮流沿各自的路径向下走一层，并预取下一层的节点，
+    一个键值等待内存时其他键值的访问可以同时进行
+*/
+static int avl_tree_query_batch(avl_tree_t *tree, const int *keys, int cnt, void **eles)
+{
+    avl_tree_private_t* _this = get_private_member(tree);
+    if(NULL == _this || NULL == keys || NULL == eles || cnt < 0) return -1;
+
+    int found = 0;
+    avl_tree_lock_shared(tree);
+    for(int base = 0; base < cnt; base += AVL_BATCH_GROUP)
+    {
+        int group = cnt - base < AVL_BATCH_GROUP ? cnt - base : AVL_BATCH_GROUP;
+        avl_node_t* nodes[AVL_BATCH_GROUP];
+        for(int i = 0; i < group; ++i)
+        {
+            nodes[i] = _this->m_root;
+            eles[base + i] = NULL;
+        }
+
+        for(int active = group; active > 0; )
+        {
+            active = 0;
+            for(int i = 0; i < group; ++i)
+            {
+                avl_node_t* p = nodes[i];
+                if(NULL == p) continue;
+
+                int key = keys[base + i];
+                if(key == p->key)
+                {
+                    eles[base + i] = p->element;
+                    found++;
+                    p = NULL;
+                }
+                else
+                    p = key > p->key ? p->right_child : p->left_child;
+                nodes[i] = p;
+                if(NULL != p)
+                {
+                    __builtin_prefetch(p);
+                    active++;
+                }
+            }
+        }
+    }
+    avl_tree_unlock(tree);
+    return found;
+}
+
 /*
 @func: 
     通过元素查找节点
@@ -532,11 +831,15 @@ static int avl_tree_del_by_key(avl_tree_t* tree, int key)
 {
     if(NULL == tree) return -1;
     avl_tree_private_t* _this = get_private_member(tree);
-    avl_node_t* node = query_by_key(tree, key);
-
-    if(NULL == node) return -1;
 
     avl_tree_lock(tree);
+    avl_node_t* node = query_by_key(tree, key);
+
+    if(NULL == node)
+    {
+        avl_tree_unlock(tree);
+        return -1;
+    }
     
     _this->m_node_cnt--;
 
@@ -604,7 +907,7 @@ static int avl_tree_del_by_key(avl_tree_t* tree, int key)
         }
 
         temp->parent = node->parent;
-        temp->depth = HEIGHT(temp);
+        UPDATE(temp);
     }
 
     if (NULL != node->parent)
@@ -615,12 +918,12 @@ static int avl_tree_del_by_key(avl_tree_t* tree, int key)
             node->parent->right_child = temp;
     }
 
-    if(NULL == p)
-        _this->m_root = NULL;
+    if(NULL == p) // 删除的是根节点，且替换节点是其直接孩子（或没有孩子）
+        _this->m_root = (NULL == temp) ? NULL : avl_tree_adjust(temp);
 
     while(NULL != p)
     {
-        p->depth = HEIGHT(p);
+        UPDATE(p);
         if(NULL == p->parent)
         {
             // 找到根节点
@@ -663,11 +966,16 @@ static int avl_tree_del_by_key(avl_tree_t* tree, int key)
 */
 static int avl_tree_del_by_element(avl_tree_t* tree, void* ele)
 {
+    if(NULL == tree) return -1;
+
+    avl_tree_lock_shared(tree);
     avl_node_t* node= avl_tree_query_by_element(tree, ele);
+    int key = (NULL == node) ? INIT_KEY : node->key;
+    avl_tree_unlock(tree);
     
     if(NULL == node) return -1;
 
-    return avl_tree_del_by_key(tree, node->key);
+    return avl_tree_del_by_key(tree, key);
 }
 
 /*
@@ -680,6 +988,9 @@ static int avl_tree_del_by_element(avl_tree_t* tree, void* ele)
 
 @return:
     None
+
+@note:
+    线程安全模式下整个遍历持有读锁，visit 中不能修改树
 */
 static void preorder (avl_node_t* node, void( *visit)(void* e) )
 {
@@ -693,7 +1004,328 @@ static void preorder (avl_node_t* node, void( *visit)(void* e) )
 static void avl_tree_preorder(avl_tree_t* tree, void( *visit)(void* e))
 {
     avl_tree_private_t *_this = get_private_member(tree);
+
+    avl_tree_lock_shared(tree);
     preorder(_this->m_root, visit);
+    avl_tree_unlock(tree);
+}
+
+/*
+@func: 
+    中序遍历中的 后继 / 前驱 节点
+
+@para: 
+    node : 当前节点
+
+@return:
+    avl_node_t* ： NULL 没有后继 / 前驱， other 后继 / 前驱节点
+
+@note:
+    沿父节点指针向上查找，不需要递归或栈，遍历整棵树时每个节点平均访问常数次
+*/
+static avl_node_t* avl_tree_successor(avl_node_t* node)
+{
+    if(NULL != node->right_child)
+    {
+        node = node->right_child;
+        while(NULL != node->left_child)
+            node = node->left_child;
+        return node;
+    }
+    while(NULL != node->parent && node == node->parent->right_child)
+        node = node->parent;
+    return node->parent;
+}
+
+static avl_node_t* avl_tree_predecessor(avl_node_t* node)
+{
+    if(NULL != node->left_child)
+    {
+        node = node->left_child;
+        while(NULL != node->right_child)
+            node = node->right_child;
+        return node;
+    }
+    while(NULL != node->parent && node == node->parent->left_child)
+        node = node->parent;
+    return node->parent;
+}
+
+/*
+@func: 
+    查找第一个键值 >= key 的节点 / 最后一个键值 <= key 的节点
+
+@para: 
+    _this : 私有成员
+    key : 键值
+
+@return:
+    avl_node_t* ： NULL 不存在， other 查找到的节点
+*/
+static avl_node_t* avl_tree_lower_bound(avl_tree_private_t* _this, int key)
+{
+    avl_node_t* p = _this->m_root;
+    avl_node_t* res = NULL;
+    while(NULL != p)
+    {
+        if(p->key >= key)
+        {
+            res = p;
+            p = p->left_child;
+        }
+        else
+        {
+            p = p->right_child;
+        }
+    }
+    return res;
+}
+
+static avl_node_t* avl_tree_floor(avl_tree_private_t* _this, int key)
+{
+    avl_node_t* p = _this->m_root;
+    avl_node_t* res = NULL;
+    while(NULL != p)
+    {
+        if(p->key <= key)
+        {
+            res = p;
+            p = p->right_child;
+        }
+        else
+        {
+            p = p->left_child;
+        }
+    }
+    return res;
+}
+
+/*
+@func: 
+    定位到第一个键值 >= key 的元素 / 最后一个键值 <= key 的元素
+
+@para: 
+    tree : 树指针
+    key : 键值
+    pos : 输出定位到的位置，供 next / prev 使用，不存在时为 NULL
+
+@return:
+    void* : NULL 不存在， other 定位到的元素
+
+@note:
+    位置在树被修改之前有效
+*/
+static void* avl_tree_seek(avl_tree_t *tree, int key, void **pos)
+{
+    avl_tree_private_t *_this = get_private_member(tree);
+    if(NULL == _this || NULL == pos) return NULL;
+
+    avl_tree_lock_shared(tree);
+    avl_node_t* node = avl_tree_lower_bound(_this, key);
+    avl_tree_unlock(tree);
+
+    *pos = node;
+    return NULL != node ? node->element : NULL;
+}
+
+static void* avl_tree_seek_last(avl_tree_t *tree, int key, void **pos)
+{
+    avl_tree_private_t *_this = get_private_member(tree);
+    if(NULL == _this || NULL == pos) return NULL;
+
+    avl_tree_lock_shared(tree);
+    avl_node_t* node = avl_tree_floor(_this, key);
+    avl_tree_unlock(tree);
+
+    *pos = node;
+    return NULL != node ? node->element : NULL;
+}
+
+/*
+@func: 
+    按键值顺序移动到 下一个 / 上一个 元素
+
+@para: 
+    tree : 树指针
+    pos : seek / seek_last 输出的位置，移动后更新，到达末尾 / 开头时为 NULL
+
+@return:
+    void* : NULL 已到达末尾 / 开头， other 移动到的元素
+
+@note:
+    位置在树被修改之前有效
+*/
+static void* avl_tree_next(avl_tree_t *tree, void **pos)
+{
+    if(NULL == tree || NULL == pos || NULL == *pos) return NULL;
+
+    avl_tree_lock_shared(tree);
+    avl_node_t* node = avl_tree_successor((avl_node_t*)*pos);
+    avl_tree_unlock(tree);
+
+    *pos = node;
+    return NULL != node ? node->element : NULL;
+}
+
+static void* avl_tree_prev(avl_tree_t *tree, void **pos)
+{
+    if(NULL == tree || NULL == pos || NULL == *pos) return NULL;
+
+    avl_tree_lock_shared(tree);
+    avl_node_t* node = avl_tree_predecessor((avl_node_t*)*pos);
+    avl_tree_unlock(tree);
+
+    *pos = node;
+    return NULL != node ? node->element : NULL;
+}
+
+/*
+@func: 
+    按键值升序访问 [low, high) 范围内的元素
+
+@para: 
+    tree : 树指针
+    low : 范围下限，包含
+    high : 范围上限，不包含
+    visit : 对每个元素执行的操作，返回 false 时停止
+    arg : 传给 visit 的参数
+
+@return:
+    int : < 0 : 失败， other ： 访问的元素个数
+
+@note:
+    从下限所在的节点开始沿父节点指针迭代，只访问范围内的节点；
+    线程安全模式下整个过程持有读锁，visit 中不能修改树
+*/
+static int avl_tree_range(avl_tree_t *tree, int low, int high, bool (*visit)(void *ele, void *arg), void *arg)
+{
+    avl_tree_private_t *_this = get_private_member(tree);
+    if(NULL == _this || NULL == visit) return -1;
+
+    int cnt = 0;
+    avl_tree_lock_shared(tree);
+    for(avl_node_t* node = avl_tree_lower_bound(_this, low); NULL != node && node->key < high; node = avl_tree_successor(node))
+    {
+        cnt++;
+        if(!visit(node->element, arg))
+            break;
+    }
+    avl_tree_unlock(tree);
+    return cnt;
+}
+
+/*
+@func: 
+    获取键值小于 key 的元素个数
+
+@para: 
+    tree : 树指针
+    key : 键值
+
+@return:
+    int : < 0 : 失败， other ： 键值小于 key 的元素个数，即 key 在树中的排名（从 0 开始）
+
+@note:
+    利用每个节点保存的子树节点数，只访问一条从根到叶子的路径，时间复杂度 O(log n)
+*/
+static int avl_tree_rank_of(avl_tree_private_t* _this, int key)
+{
+    int rank = 0;
+    avl_node_t* p = _this->m_root;
+    while(NULL != p)
+    {
+        if(key > p->key)
+        {
+            rank += COUNT(p->left_child) + 1;
+            p = p->right_child;
+        }
+        else
+        {
+            p = p->left_child;
+        }
+    }
+    return rank;
+}
+
+static int avl_tree_rank(avl_tree_t *tree, int key)
+{
+    avl_tree_private_t *_this = get_private_member(tree);
+    if(NULL == _this) return -1;
+
+    avl_tree_lock_shared(tree);
+    int rank = avl_tree_rank_of(_this, key);
+    avl_tree_unlock(tree);
+    return rank;
+}
+
+/*
+@func: 
+    按键值升序获取第 index 个元素（从 0 开始）
+
+@para: 
+    tree : 树指针
+    index : 元素的排名
+    pos : 输出元素的位置，供 next / prev 使用，不存在时为 NULL，可传 NULL
+
+@return:
+    void* : NULL index 越界， other 查找到的元素
+
+@note:
+    时间复杂度 O(log n)；位置在树被修改之前有效
+*/
+static void* avl_tree_select(avl_tree_t *tree, int index, void **pos)
+{
+    avl_tree_private_t *_this = get_private_member(tree);
+    if(NULL == _this) return NULL;
+
+    avl_tree_lock_shared(tree);
+    avl_node_t* p = _this->m_root;
+    while(NULL != p)
+    {
+        int left = COUNT(p->left_child);
+        if(index < left)
+        {
+            p = p->left_child;
+        }
+        else if(index > left)
+        {
+            index -= left + 1;
+            p = p->right_child;
+        }
+        else break;
+    }
+    avl_tree_unlock(tree);
+
+    if(NULL != pos)
+        *pos = p;
+    return NULL != p ? p->element : NULL;
+}
+
+/*
+@func: 
+    统计键值在 [low, high) 范围内的元素个数
+
+@para: 
+    tree : 树指针
+    low : 范围下限，包含
+    high : 范围上限，不包含
+
+@return:
+    int : < 0 : 失败， other ： 范围内的元素个数
+
+@note:
+    由两次 rank 相减得到，不访问范围内的节点，时间复杂度 O(log n)
+*/
+static int avl_tree_count_range(avl_tree_t *tree, int low, int high)
+{
+    avl_tree_private_t *_this = get_private_member(tree);
+    if(NULL == _this) return -1;
+    if(low >= high) return 0;
+
+    avl_tree_lock_shared(tree);
+    int cnt = avl_tree_rank_of(_this, high) - avl_tree_rank_of(_this, low);
+    avl_tree_unlock(tree);
+    return cnt;
 }
 
 /*
@@ -717,17 +1349,17 @@ static int avl_tree_size(avl_tree_t* tree)
 
 /*
 @func: 
-    清除目标节点以及其全部子树包含的节点
+    释放目标节点以及其全部子树包含的元素中的动态内存
 
 @para: 
     tree : 树指针
-    node : 节点的元素
+    node : 子树的根节点
 
 @return:
-    int ： 0 成功  -1 失败
+    None.
 
 @note:
-    None.
+    节点本身的内存由内存池整体释放
 */
 static void avl_tree_node_clear(avl_tree_t* tree, avl_node_t* node)
 {
@@ -736,7 +1368,7 @@ static void avl_tree_node_clear(avl_tree_t* tree, avl_node_t* node)
     avl_tree_node_clear(tree, node->left_child);
     avl_tree_node_clear(tree, node->right_child);
 
-    avl_tree_free_node(tree, node);
+    tree->pf_free_element(node->element);
 }
 
 /*
@@ -750,13 +1382,19 @@ static void avl_tree_node_clear(avl_tree_t* tree, avl_node_t* node)
     None.
 
 @note:
-    None.
+    pf_free_element 为 NULL 时不需要遍历节点，直接整体释放内存池
 */
 static void avl_tree_clear(avl_tree_t *tree)
 {
     avl_tree_private_t* _this = get_private_member(tree);
-    avl_tree_node_clear(tree, _this->m_root);
+
+    avl_tree_lock(tree);
+    if(NULL != tree->pf_free_element)
+        avl_tree_node_clear(tree, _this->m_root);
+    _this->m_pool->clear(_this->m_pool);
+    _this->m_root = NULL;
     _this->m_node_cnt = 0;
+    avl_tree_unlock(tree);
 }
 
 /*
@@ -785,6 +1423,9 @@ static void avl_tree_destory(avl_tree_t** tree)
     
     if(_this->_private_) 
     {
+        avl_tree_private_t* private_member = get_private_member(_this);
+        private_member->m_pool->destory(&private_member->m_pool);
+        pthread_rwlock_destroy(&private_member->m_tree_lock);
         free(_this->_private_);
         _this->_private_ = NULL;
     }
@@ -811,20 +1452,48 @@ static void avl_tree_destory(avl_tree_t** tree)
     avl_tree_t* : 创建平衡二叉树的指针
 */
 avl_tree_t* avl_tree_create(int element_size, int (*pf_hash_func)(void *) ,int (*pf_free_element_func)(void *), bool thread_safe)
+{
+    return avl_tree_create_ex(element_size, pf_hash_func, pf_free_element_func, thread_safe, false);
+}
+
+/*
+@func: 
+    创建一颗平衡二叉树，可指定元素内嵌在节点中
+
+@para: 
+    inline_element ： true 元素与节点在同一块内存中，查找与遍历每个节点只访问一块内存；
+                      false 与 avl_tree_create 相同，元素单独申请内存
+    其余参数与 avl_tree_create 相同
+
+@return:
+    avl_tree_t* : 创建平衡二叉树的指针
+*/
+avl_tree_t* avl_tree_create_ex(int element_size, int (*pf_hash_func)(void *) ,int (*pf_free_element_func)(void *), bool thread_safe, bool inline_element)
 {
 
     if(NULL == pf_hash_func)
         return NULL;
     avl_tree_t *tree = (avl_tree_t *)malloc(sizeof(avl_tree_t));
-    memset(tree, 0, sizeof(avl_tree_t));
-
     avl_tree_private_t *private_member = (avl_tree_private_t *)malloc(sizeof(avl_tree_private_t));
+    mem_pool_t *pool = mem_pool_create(thread_safe);
+    if(NULL == tree || NULL == private_member || NULL == pool)
+    {
+        free(tree);
+        free(private_member);
+        if(NULL != pool)
+            pool->destory(&pool);
+        return NULL;
+    }
+    memset(tree, 0, sizeof(avl_tree_t));
+    memset(private_member, 0, sizeof(avl_tree_private_t));
 
+    private_member->m_pool = pool;
     private_member->m_root = NULL;
     private_member->m_element_size = element_size;
     private_member->m_is_thread_safe = thread_safe;
+    private_member->m_inline_element = inline_element;
     
-    pthread_mutex_init(&private_member->m_tree_mutex, NULL);
+    pthread_rwlock_init(&private_member->m_tree_lock, NULL);
 
     tree->_this = tree;
     tree->_private_ = (void *)private_member;
@@ -832,8 +1501,19 @@ avl_tree_t* avl_tree_create(int element_size, int (*pf_hash_func)(void *) ,int (
     tree->pf_hash = pf_hash_func;
     tree->pf_free_element = pf_free_element_func;
     tree->add = avl_tree_add;
+    tree->add_batch = avl_tree_add_batch;
+    tree->build_sorted = avl_tree_build_sorted;
     tree->query_by_key = avl_tree_query_by_key;
+    tree->query_batch = avl_tree_query_batch;
     tree->preorder = avl_tree_preorder;
+    tree->seek = avl_tree_seek;
+    tree->seek_last = avl_tree_seek_last;
+    tree->next = avl_tree_next;
+    tree->prev = avl_tree_prev;
+    tree->range = avl_tree_range;
+    tree->rank = avl_tree_rank;
+    tree->select = avl_tree_select;
+    tree->count_range = avl_tree_count_range;
     tree->size = avl_tree_size;
     tree->del_node_by_key = avl_tree_del_by_key;
     tree->del_node_by_element = avl_tree_del_by_element;
@@ -37,6 +37,41 @@ struct _avl_tree
 */
     int (*add)(avl_tree_t *tree, void *node);
 
+/*
+@func: 
+    批量增加节点
+
+@para: 
+    tree : 树指针
+    eles : 连续存放的元素数组，每个元素大小为 element_size
+    cnt : 元素个数
+    status : 每个元素的插入结果，含义与 add 的返回值相同，可传 NULL
+
+@return:
+    int : < 0 参数错误， other 成功插入的元素个数
+
+@note:
+    整批插入只获取一次锁
+*/
+    int (*add_batch)(avl_tree_t *tree, void *eles, int cnt, int *status);
+
+/*
+@func: 
+    由按键值严格递增排列的元素直接构建平衡树
+
+@para: 
+    tree : 树指针，必须为空树
+    eles : 连续存放的元素数组，每个元素大小为 element_size
+    cnt : 元素个数
+
+@return:
+    int : 0 成功， -1 参数错误， -2 创建节点失败， -3 树不为空， -4 元素未按键值严格递增排列
+
+@note:
+    时间复杂度 O(n)，不需要旋转；失败时树保持为空，且不会释放元素中的动态内存
+*/
+    int (*build_sorted)(avl_tree_t *tree, void *eles, int cnt);
+
 /*
 @func: 
     通过键值删除节点
@@ -81,10 +116,29 @@ struct _avl_tree
     avl_node_t* ： 查找到的节点
 
 @note:
-    None.
+    线程安全模式下持有读锁查找，多个线程可以同时查询；返回的元素在该节点被删除前有效
 */
     void* (*query_by_key)(avl_tree_t *tree, int key);
 
+/*
+@func: 
+    通过键值批量查找元素
+
+@para: 
+    tree : 树指针
+    keys : 键值数组
+    cnt : 键值个数
+    eles : 输出每个键值对应的元素，不存在时为 NULL
+
+@return:
+    int : < 0 : 参数错误， other ： 查找到的元素个数
+
+@note:
+    一组键值交替查找，每个键值每次只前进一步并预取下一步要访问的节点，多个缓存未命中的等待相互重叠；
+    整批只获取一次读锁
+*/
+    int (*query_batch)(avl_tree_t *tree, const int *keys, int cnt, void **eles);
+
 /*
 @func: 
     前序遍历
@@ -95,9 +149,116 @@ struct _avl_tree
 
 @return:
     None
+
+@note:
+    线程安全模式下整个遍历持有读锁，visit 中不能修改树
 */
     void (*preorder)(avl_tree_t* tree,  void( *visit)(void* ele));
 
+/*
+@func: 
+    定位到第一个键值 >= key 的元素 / 最后一个键值 <= key 的元素
+
+@para: 
+    tree : 树指针
+    key : 键值
+    pos : 输出定位到的位置，供 next / prev 使用，不存在时为 NULL
+
+@return:
+    void* : NULL 不存在， other 定位到的元素
+
+@note:
+    位置在树被修改之前有效
+*/
+    void* (*seek)(avl_tree_t *tree, int key, void **pos);
+    void* (*seek_last)(avl_tree_t *tree, int key, void **pos);
+
+/*
+@func: 
+    按键值顺序移动到 下一个 / 上一个 元素
+
+@para: 
+    tree : 树指针
+    pos : seek / seek_last 输出的位置，移动后更新，到达末尾 / 开头时为 NULL
+
+@return:
+    void* : NULL 已到达末尾 / 开头， other 移动到的元素
+
+@note:
+    沿父节点指针迭代，不需要递归；位置在树被修改之前有效
+*/
+    void* (*next)(avl_tree_t *tree, void **pos);
+    void* (*prev)(avl_tree_t *tree, void **pos);
+
+/*
+@func: 
+    按键值升序访问 [low, high) 范围内的元素
+
+@para: 
+    tree : 树指针
+    low : 范围下限，包含
+    high : 范围上限，不包含
+    visit : 对每个元素执行的操作，返回 false 时停止
+    arg : 传给 visit 的参数
+
+@return:
+    int : < 0 : 失败， other ： 访问的元素个数
+
+@note:
+    只访问范围内的节点；线程安全模式下整个过程持有读锁，visit 中不能修改树
+*/
+    int (*range)(avl_tree_t *tree, int low, int high, bool (*visit)(void *ele, void *arg), void *arg);
+
+/*
+@func: 
+    获取键值小于 key 的元素个数，即 key 的排名（从 0 开始）
+
+@para: 
+    tree : 树指针
+    key : 键值，不要求在树中存在
+
+@return:
+    int : < 0 : 失败， other ： 键值小于 key 的元素个数
+
+@note:
+    每个节点保存子树节点数，时间复杂度 O(log n)
+*/
+    int (*rank)(avl_tree_t *tree, int key);
+
+/*
+@func: 
+    按键值升序获取第 index 个元素（从 0 开始）
+
+@para: 
+    tree : 树指针
+    index : 元素的排名
+    pos : 输出元素的位置，供 next / prev 使用，可传 NULL
+
+@return:
+    void* : NULL index 越界， other 查找到的元素
+
+@note:
+    时间复杂度 O(log n)；位置在树被修改之前有效
+*/
+    void* (*select)(avl_tree_t *tree, int index, void **pos);
+
+/*
+@func: 
+    统计键值在 [low, high) 范围内的元素个数
+
+@para: 
+    tree : 树指针
+    low : 范围下限，包含
+    high : 范围上限，不包含
+
+@return:
+    int : < 0 : 失败， other ： 范围内的元素个数
+
+@note:
+    不访问范围内的节点，时间复杂度 O(log n)
+*/
+    int (*count_range)(avl_tree_t *tree, int low, int high);
+
 /*
 @func: 
     获取树节点的数量
@@ -124,7 +285,7 @@ struct _avl_tree
     None.
 
 @note:
-    None.
+    节点从树的内存池中申请，清除时整体释放；pf_free_element 为 NULL 时不需要遍历节点
 */
     void (*clear_node)(avl_tree_t *tree); 
 
@@ -153,12 +314,27 @@ struct _avl_tree
     element_size : 节点保存元素的大小，单位字节
     pf_hash_func ； 从节点元素获得键值 key 的方法，由用户提供
     pf_free_element_func ： 若节点元素不包含额外的动态内存， 此参数可传 NULL；若节点包含的元素中还包含额外的动态内存，用户需传入此函数以正确释放内存
-    thread_safe ： 是否启用线程安全，若用户保证不会涉及冲突，可关闭线程安全功能
+    thread_safe ： 是否启用线程安全，若用户保证不会涉及冲突，可关闭线程安全功能；
+                   启用后查询与遍历共享读锁，增删与清除独占写锁
 
 @return:
     avl_tree_t* : 创建平衡二叉树的指针
 */
 extern avl_tree_t* avl_tree_create(int element_size, int (*pf_hash_func)(void *), int (*pf_free_element_func)(void *), bool thread_safe);
 
+/*
+@func: 
+    创建一颗平衡二叉树，可指定元素内嵌在节点中
+
+@para: 
+    inline_element ： true 元素与节点在同一块内存中，查找与遍历每个节点只访问一块内存；
+                      false 与 avl_tree_create 相同，元素单独申请内存
+    其余参数与 avl_tree_create 相同
+
+@return:
+    avl_tree_t* : 创建平衡二叉树的指针
+*/
+extern avl_tree_t* avl_tree_create_ex(int element_size, int (*pf_hash_func)(void *), int (*pf_free_element_func)(void *), bool thread_safe, bool inline_element);
+
 
 #endif /* end #ifndef _AVL_TREE_H_ */
\ No newline at end of file
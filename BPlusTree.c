@@ -0,0 +1,1430 @@
+/*
+** File : BPlusTree.c
+** Author : Saury
+** Date : 2020-09-12
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "BPlusTree.h"
+#include "MemPool.h"
+
+
+#define DEBUG_LOG 0
+
+#define BPLUS_LOG_DEBUG(fmt, ...) \
+    do{ \
+        if(DEBUG_LOG) \
+        {\
+            printf("%s at %d " fmt "\r\n", __FILE__, __LINE__, ##__VA_ARGS__);\
+        }\
+    }while(0);
+
+
+#define BPLUS_NODE_SIZE     1024    // 节点按该大小对齐申请，由元素位置可以直接算出所在的叶子节点
+#define BPLUS_MAX_KEYS      60      // 每个节点最多保存的键值个数，保证节点不超过 BPLUS_NODE_SIZE
+#define BPLUS_MIN_KEYS      ((BPLUS_MAX_KEYS - 1) / 2)  // 非根节点删除前至少保留的键值个数，两个节点合并后不超过上限
+#define BPLUS_MAX_DEPTH     32      // 树的最大高度，每个非根节点至少 BPLUS_MIN_KEYS + 1 个孩子，远超过 int 能表示的元素个数
+#define BPLUS_BATCH_GROUP   16      // 批量查找时交替查找的键值个数
+
+typedef struct _bplus_node bplus_node_t;
+typedef struct _bplus_tree_private bplus_tree_private_t;
+
+struct _bplus_node
+{
+    int cnt;                // 键值个数，内部节点的孩子个数为 cnt + 1
+    bool leaf;              // 是否为叶子节点
+    bplus_node_t *prev;     // 叶子节点按键值顺序双向链接
+    bplus_node_t *next;
+    int keys[BPLUS_MAX_KEYS];   // 按键值升序连续存放；内部节点中 children[i] 的键值 < keys[i] <= children[i + 1] 的键值
+    union
+    {
+        void *elements[BPLUS_MAX_KEYS];    // 叶子节点：与 keys 一一对应的元素
+        struct
+        {
+            bplus_node_t *children[BPLUS_MAX_KEYS + 1]; // 内部节点：孩子
+            int counts[BPLUS_MAX_KEYS + 1];             // 内部节点：每个孩子子树中的元素个数
+        };
+    };
+};
+
+// 节点大小超过对齐大小时编译报错
+typedef char bplus_node_size_check[(sizeof(bplus_node_t) <= BPLUS_NODE_SIZE) ? 1 : -1];
+
+struct _bplus_tree_private
+{
+    bplus_node_t *m_root;   // 空树时为 NULL
+    int m_element_size;
+    int m_element_cnt;
+    bool m_is_thread_safe;
+    pthread_rwlock_t m_tree_lock;   // 查询与遍历共享读锁，修改独占写锁
+    mem_pool_t *m_pool;     // 元素的内存池，清除树时整体释放
+};
+
+// 由元素位置得到所在的叶子节点
+#define BPLUS_LEAF_OF(pos) ((bplus_node_t*)((uintptr_t)(pos) & ~(uintptr_t)(BPLUS_NODE_SIZE - 1)))
+
+/*
+@func:
+    获取私有成员变量
+
+@para:
+    tree ： 树指针
+
+@return:
+    bplus_tree_private_t* : 私有成员变量结构体指针
+*/
+static bplus_tree_private_t* get_private_member(avl_tree_t* tree)
+{
+    if(NULL == tree) return NULL;
+
+    return (bplus_tree_private_t*)tree->_private_;
+}
+
+/*
+@func:
+    线程锁， 上写锁/上读锁/解锁
+
+@para:
+    _this ： 私有成员
+
+@return:
+    None
+*/
+static void bplus_tree_lock(bplus_tree_private_t* _this)
+{
+    if(_this->m_is_thread_safe)
+        pthread_rwlock_wrlock(&_this->m_tree_lock);
+}
+
+static void bplus_tree_lock_shared(bplus_tree_private_t* _this)
+{
+    if(_this->m_is_thread_safe)
+        pthread_rwlock_rdlock(&_this->m_tree_lock);
+}
+
+static void bplus_tree_unlock(bplus_tree_private_t* _this)
+{
+    if(_this->m_is_thread_safe)
+        pthread_rwlock_unlock(&_this->m_tree_lock);
+}
+
+/*
+@func:
+    在有序键值数组中查找第一个 >= key / > key 的位置
+
+@para:
+    keys : 键值数组
+    cnt : 键值个数
+    key : 键值
+
+@return:
+    int : 查找到的位置，不存在时为 cnt
+*/
+static int bplus_lower_bound(const int* keys, int cnt, int key)
+{
+    int low = 0, high = cnt;
+    while(low < high)
+    {
+        int mid = (low + high) / 2;
+        if(keys[mid] < key)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+static int bplus_upper_bound(const int* keys, int cnt, int key)
+{
+    int low = 0, high = cnt;
+    while(low < high)
+    {
+        int mid = (low + high) / 2;
+        if(keys[mid] <= key)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+/*
+@func:
+    申请 / 释放节点
+
+@para:
+    leaf : 是否为叶子节点
+
+@return:
+    bplus_node_t* : NULL 失败， other 申请到的节点
+
+@note:
+    节点按 BPLUS_NODE_SIZE 对齐，叶子节点中元素的位置按对齐掩码即可得到所在节点
+*/
+static bplus_node_t* bplus_tree_alloc_node(bool leaf)
+{
+    void* node = NULL;
+    if(0 != posix_memalign(&node, BPLUS_NODE_SIZE, sizeof(bplus_node_t)))
+    {
+        BPLUS_LOG_DEBUG("[ERROR]:node malloc");
+        return NULL;
+    }
+    memset(node, 0, sizeof(bplus_node_t));
+    ((bplus_node_t*)node)->leaf = leaf;
+    return (bplus_node_t*)node;
+}
+
+static void bplus_tree_free_nodes(bplus_node_t* node)
+{
+    if(NULL == node) return;
+
+    if(!node->leaf)
+    {
+        for(int i = 0; i <= node->cnt; ++i)
+            bplus_tree_free_nodes(node->children[i]);
+    }
+    free(node);
+}
+
+/*
+@func:
+    获取子树中的元素个数
+
+@para:
+    node : 子树的根节点
+
+@return:
+    int : 元素个数
+*/
+static int bplus_tree_node_total(bplus_node_t* node)
+{
+    if(node->leaf) return node->cnt;
+
+    int total = 0;
+    for(int i = 0; i <= node->cnt; ++i)
+        total += node->counts[i];
+    return total;
+}
+
+/*
+@func:
+    创建保存指定元素拷贝的元素内存 / 释放元素内存
+
+@para:
+    tree : 树指针
+    ele : 元素
+
+@return:
+    void* : NULL 失败， other 元素的拷贝
+*/
+static void* bplus_tree_create_element(avl_tree_t* tree, void* ele)
+{
+    bplus_tree_private_t* _this = get_private_member(tree);
+    void* element = _this->m_pool->alloc(_this->m_pool, _this->m_element_size);
+    if(NULL == element)
+    {
+        BPLUS_LOG_DEBUG("[ERROR]:element malloc");
+        return NULL;
+    }
+    memcpy(element, ele, _this->m_element_size);
+    return element;
+}
+
+static void bplus_tree_free_element(avl_tree_t* tree, void* element)
+{
+    bplus_tree_private_t* _this = get_private_member(tree);
+    if(NULL != tree->pf_free_element)
+        tree->pf_free_element(element);
+    _this->m_pool->free(_this->m_pool, element, _this->m_element_size);
+}
+
+/*
+@func:
+    分裂父节点的第 i 个孩子
+
+@para:
+    parent : 父节点，未满
+    i : 孩子的位置，孩子已满
+
+@return:
+    int : 0 成功， -2 申请节点失败（树保持不变）
+
+@note:
+    叶子节点分裂后右半部分的第一个键值复制到父节点；
+    内部节点分裂后中间的键值移动到父节点
+*/
+static int bplus_tree_split_child(bplus_node_t* parent, int i)
+{
+    bplus_node_t* child = parent->children[i];
+    bplus_node_t* right = bplus_tree_alloc_node(child->leaf);
+    if(NULL == right) return -2;
+
+    int half = child->cnt / 2;
+    int sep;
+    if(child->leaf)
+    {
+        right->cnt = child->cnt - half;
+        memcpy(right->keys, child->keys + half, sizeof(int) * right->cnt);
+        memcpy(right->elements, child->elements + half, sizeof(void*) * right->cnt);
+        child->cnt = half;
+
+        right->next = child->next;
+        if(NULL != right->next)
+            right->next->prev = right;
+        right->prev = child;
+        child->next = right;
+
+        sep = right->keys[0];
+    }
+    else
+    {
+        sep = child->keys[half];
+        right->cnt = child->cnt - half - 1;
+        memcpy(right->keys, child->keys + half + 1, sizeof(int) * right->cnt);
+        memcpy(right->children, child->children + half + 1, sizeof(bplus_node_t*) * (right->cnt + 1));
+        memcpy(right->counts, child->counts + half + 1, sizeof(int) * (right->cnt + 1));
+        child->cnt = half;
+    }
+
+    int right_total = bplus_tree_node_total(right);
+
+    memmove(parent->keys + i + 1, parent->keys + i, sizeof(int) * (parent->cnt - i));
+    memmove(parent->children + i + 2, parent->children + i + 1, sizeof(bplus_node_t*) * (parent->cnt - i));
+    memmove(parent->counts + i + 2, parent->counts + i + 1, sizeof(int) * (parent->cnt - i));
+    parent->keys[i] = sep;
+    parent->children[i + 1] = right;
+    parent->counts[i + 1] = right_total;
+    parent->counts[i] -= right_total;
+    parent->cnt++;
+
+    return 0;
+}
+
+/*
+@func:
+    把元素插入树中
+
+@para:
+    _this : 私有成员
+    key : 元素的键值
+    element : 元素
+
+@return:
+    int : 0 成功， -2 申请节点失败， -3 重复插入（元素不会被释放）
+
+@note:
+    自顶向下插入：下降前先分裂已满的孩子，插入叶子时一定有空位，不需要回溯；
+    调用者需持有树的锁
+*/
+static int bplus_tree_insert(bplus_tree_private_t* _this, int key, void* element)
+{
+    if(NULL == _this->m_root)
+    {
+        bplus_node_t* leaf = bplus_tree_alloc_node(true);
+        if(NULL == leaf) return -2;
+        leaf->keys[0] = key;
+        leaf->elements[0] = element;
+        leaf->cnt = 1;
+        _this->m_root = leaf;
+        _this->m_element_cnt = 1;
+        return 0;
+    }
+
+    if(BPLUS_MAX_KEYS == _this->m_root->cnt)
+    {
+        bplus_node_t* root = bplus_tree_alloc_node(false);
+        if(NULL == root) return -2;
+        root->children[0] = _this->m_root;
+        root->counts[0] = _this->m_element_cnt;
+        if(0 != bplus_tree_split_child(root, 0))
+        {
+            free(root);
+            return -2;
+        }
+        _this->m_root = root;
+    }
+
+    bplus_node_t* path[BPLUS_MAX_DEPTH];
+    int index[BPLUS_MAX_DEPTH];
+    int depth = 0;
+
+    bplus_node_t* node = _this->m_root;
+    while(!node->leaf)
+    {
+        int i = bplus_upper_bound(node->keys, node->cnt, key);
+        if(BPLUS_MAX_KEYS == node->children[i]->cnt)
+        {
+            if(0 != bplus_tree_split_child(node, i)) return -2;
+            if(key >= node->keys[i]) i++;
+        }
+        path[depth] = node;
+        index[depth] = i;
+        depth++;
+        node = node->children[i];
+    }
+
+    int i = bplus_lower_bound(node->keys, node->cnt, key);
+    if(i < node->cnt && node->keys[i] == key)
+    {
+        BPLUS_LOG_DEBUG("Element repetition");
+        return -3;
+    }
+
+    memmove(node->keys + i + 1, node->keys + i, sizeof(int) * (node->cnt - i));
+    memmove(node->elements + i + 1, node->elements + i, sizeof(void*) * (node->cnt - i));
+    node->keys[i] = key;
+    node->elements[i] = element;
+    node->cnt++;
+
+    for(int d = 0; d < depth; ++d)
+        path[d]->counts[index[d]]++;
+    _this->m_element_cnt++;
+
+    return 0;
+}
+
+/*
+@func:
+    从左 / 右兄弟借一个键值给父节点的第 i 个孩子
+
+@para:
+    parent : 父节点
+    i : 孩子的位置
+
+@return:
+    None.
+*/
+static void bplus_tree_borrow_left(bplus_node_t* parent, int i)
+{
+    bplus_node_t* child = parent->children[i];
+    bplus_node_t* left = parent->children[i - 1];
+    int moved;
+
+    memmove(child->keys + 1, child->keys, sizeof(int) * child->cnt);
+    if(child->leaf)
+    {
+        memmove(child->elements + 1, child->elements, sizeof(void*) * child->cnt);
+        child->keys[0] = left->keys[left->cnt - 1];
+        child->elements[0] = left->elements[left->cnt - 1];
+        parent->keys[i - 1] = child->keys[0];
+        moved = 1;
+    }
+    else
+    {
+        memmove(child->children + 1, child->children, sizeof(bplus_node_t*) * (child->cnt + 1));
+        memmove(child->counts + 1, child->counts, sizeof(int) * (child->cnt + 1));
+        child->keys[0] = parent->keys[i - 1];
+        child->children[0] = left->children[left->cnt];
+        child->counts[0] = left->counts[left->cnt];
+        parent->keys[i - 1] = left->keys[left->cnt - 1];
+        moved = child->counts[0];
+    }
+    left->cnt--;
+    child->cnt++;
+    parent->counts[i - 1] -= moved;
+    parent->counts[i] += moved;
+}
+
+static void bplus_tree_borrow_right(bplus_node_t* parent, int i)
+{
+    bplus_node_t* child = parent->children[i];
+    bplus_node_t* right = parent->children[i + 1];
+    int moved;
+
+    if(child->leaf)
+    {
+        child->keys[child->cnt] = right->keys[0];
+        child->elements[child->cnt] = right->elements[0];
+        memmove(right->keys, right->keys + 1, sizeof(int) * (right->cnt - 1));
+        memmove(right->elements, right->elements + 1, sizeof(void*) * (right->cnt - 1));
+        parent->keys[i] = right->keys[0];
+        moved = 1;
+    }
+    else
+    {
+        child->keys[child->cnt] = parent->keys[i];
+        child->children[child->cnt + 1] = right->children[0];
+        child->counts[child->cnt + 1] = right->counts[0];
+        parent->keys[i] = right->keys[0];
+        moved = right->counts[0];
+        memmove(right->keys, right->keys + 1, sizeof(int) * (right->cnt - 1));
+        memmove(right->children, right->children + 1, sizeof(bplus_node_t*) * right->cnt);
+        memmove(right->counts, right->counts + 1, sizeof(int) * right->cnt);
+    }
+    right->cnt--;
+    child->cnt++;
+    parent->counts[i] += moved;
+    parent->counts[i + 1] -= moved;
+}
+
+/*
+@func:
+    把父节点的第 i + 1 个孩子合并到第 i 个孩子中
+
+@para:
+    parent : 父节点
+    i : 左侧孩子的位置
+
+@return:
+    None.
+
+@note:
+    两个孩子的键值个数都不超过 BPLUS_MIN_KEYS，合并后不会超过上限
+*/
+static void bplus_tree_merge(bplus_node_t* parent, int i)
+{
+    bplus_node_t* left = parent->children[i];
+    bplus_node_t* right = parent->children[i + 1];
+
+    if(left->leaf)
+    {
+        memcpy(left->keys + left->cnt, right->keys, sizeof(int) * right->cnt);
+        memcpy(left->elements + left->cnt, right->elements, sizeof(void*) * right->cnt);
+        left->cnt += right->cnt;
+
+        left->next = right->next;
+        if(NULL != left->next)
+            left->next->prev = left;
+    }
+    else
+    {
+        left->keys[left->cnt] = parent->keys[i];
+        memcpy(left->keys + left->cnt + 1, right->keys, sizeof(int) * right->cnt);
+        memcpy(left->children + left->cnt + 1, right->children, sizeof(bplus_node_t*) * (right->cnt + 1));
+        memcpy(left->counts + left->cnt + 1, right->counts, sizeof(int) * (right->cnt + 1));
+        left->cnt += right->cnt + 1;
+    }
+
+    parent->counts[i] += parent->counts[i + 1];
+    memmove(parent->keys + i, parent->keys + i + 1, sizeof(int) * (parent->cnt - i - 1));
+    memmove(parent->children + i + 1, parent->children + i + 2, sizeof(bplus_node_t*) * (parent->cnt - i - 1));
+    memmove(parent->counts + i + 1, parent->counts + i + 2, sizeof(int) * (parent->cnt - i - 1));
+    parent->cnt--;
+
+    free(right);
+}
+
+/*
+@func:
+    保证父节点的第 i 个孩子至少有 BPLUS_MIN_KEYS + 1 个键值
+
+@para:
+    parent : 父节点
+    i : 孩子的位置
+
+@return:
+    int : 调整后包含原孩子键值范围的孩子位置
+
+@note:
+    优先从兄弟借一个键值，兄弟都不够时与兄弟合并
+*/
+static int bplus_tree_fill_child(bplus_node_t* parent, int i)
+{
+    if(i > 0 && parent->children[i - 1]->cnt > BPLUS_MIN_KEYS)
+    {
+        bplus_tree_borrow_left(parent, i);
+        return i;
+    }
+    if(i < parent->cnt && parent->children[i + 1]->cnt > BPLUS_MIN_KEYS)
+    {
+        bplus_tree_borrow_right(parent, i);
+        return i;
+    }
+    if(i < parent->cnt)
+    {
+        bplus_tree_merge(parent, i);
+        return i;
+    }
+    bplus_tree_merge(parent, i - 1);
+    return i - 1;
+}
+
+/*
+@func:
+    从树中移除指定键值的元素
+
+@para:
+    _this : 私有成员
+    key : 键值
+
+@return:
+    void* : NULL 不存在， other 被移除的元素，由调用者释放
+
+@note:
+    自顶向下删除：下降前先补足键值过少的孩子，从叶子删除后不需要回溯；
+    调用者需持有树的锁
+*/
+static void* bplus_tree_remove(bplus_tree_private_t* _this, int key)
+{
+    if(NULL == _this->m_root) return NULL;
+
+    bplus_node_t* path[BPLUS_MAX_DEPTH];
+    int index[BPLUS_MAX_DEPTH];
+    int depth = 0;
+
+    bplus_node_t* node = _this->m_root;
+    while(!node->leaf)
+    {
+        int i = bplus_upper_bound(node->keys, node->cnt, key);
+        if(node->children[i]->cnt <= BPLUS_MIN_KEYS)
+            i = bplus_tree_fill_child(node, i);
+        path[depth] = node;
+        index[depth] = i;
+        depth++;
+        node = node->children[i];
+    }
+
+    void* element = NULL;
+    int i = bplus_lower_bound(node->keys, node->cnt, key);
+    if(i < node->cnt && node->keys[i] == key)
+    {
+        element = node->elements[i];
+        memmove(node->keys + i, node->keys + i + 1, sizeof(int) * (node->cnt - i - 1));
+        memmove(node->elements + i, node->elements + i + 1, sizeof(void*) * (node->cnt - i - 1));
+        node->cnt--;
+
+        for(int d = 0; d < depth; ++d)
+            path[d]->counts[index[d]]--;
+        _this->m_element_cnt--;
+    }
+
+    // 根节点的孩子合并后只剩一个孩子时降低树的高度
+    while(!_this->m_root->leaf && 0 == _this->m_root->cnt)
+    {
+        bplus_node_t* root = _this->m_root;
+        _this->m_root = root->children[0];
+        free(root);
+    }
+    if(_this->m_root->leaf && 0 == _this->m_root->cnt)
+    {
+        free(_this->m_root);
+        _this->m_root = NULL;
+    }
+
+    return element;
+}
+
+/*
+@func:
+    查找键值所在的叶子节点
+
+@para:
+    _this : 私有成员
+    key : 键值
+
+@return:
+    bplus_node_t* : NULL 空树， other 键值所在（或应插入）的叶子节点
+*/
+static bplus_node_t* bplus_tree_find_leaf(bplus_tree_private_t* _this, int key)
+{
+    bplus_node_t* node = _this->m_root;
+    if(NULL == node) return NULL;
+
+    while(!node->leaf)
+        node = node->children[bplus_upper_bound(node->keys, node->cnt, key)];
+    return node;
+}
+
+/*
+@func:
+    增加节点
+
+@para:
+    tree : 树指针
+    ele : 要增加的元素
+
+@return:
+    int : -1 树指针为空， -2 创建节点失败， -3 重复插入
+*/
+static int bplus_tree_add(avl_tree_t *tree, void *ele)
+{
+    bplus_tree_private_t* _this = get_private_member(tree);
+    if(NULL == _this || NULL == ele) return -1;
+
+    void* element = bplus_tree_create_element(tree, ele);
+    if(NULL == element) return -2;
+
+    bplus_tree_lock(_this);
+    int res = bplus_tree_insert(_this, tree->pf_hash(element), element);
+    bplus_tree_unlock(_this);
+
+    if(0 != res)
+        bplus_tree_free_element(tree, element);
+    return res;
+}
+
+/*
+@func:
+    批量增加节点
+
+@para:
+    tree : 树指针
+    eles : 连续存放的元素数组
+    cnt : 元素个数
+    status : 每个元素的插入结果，含义与 add 的返回值相同，可传 NULL
+
+@return:
+    int : < 0 参数错误， other 成功插入的元素个数
+
+@note:
+    元素在加锁前全部拷贝完成，整批插入只获取一次锁
+*/
+static int bplus_tree_add_batch(avl_tree_t *tree, void *eles, int cnt, int *status)
+{
+    bplus_tree_private_t* _this = get_private_member(tree);
+    if(NULL == _this || NULL == eles || cnt < 0) return -1;
+
+    void** elements = (void**)malloc(sizeof(void*) * (cnt > 0 ? cnt : 1));
+    if(NULL == elements) return -2;
+
+    for(int i = 0; i < cnt; ++i)
+        elements[i] = bplus_tree_create_element(tree, (char*)eles + (size_t)i * _this->m_element_size);
+
+    int added = 0;
+    bplus_tree_lock(_this);
+    for(int i = 0; i < cnt; ++i)
+    {
+        int res = (NULL == elements[i]) ? -2 : bplus_tree_insert(_this, tree->pf_hash(elements[i]), elements[i]);
+        if(0 == res)
+            added++;
+        else if(NULL != elements[i])
+            bplus_tree_free_element(tree, elements[i]);
+        if(NULL != status)
+            status[i] = res;
+    }
+    bplus_tree_unlock(_this);
+
+    free(elements);
+    return added;
+}
+
+/*
+@func:
+    由按键值严格递增排列的元素直接构建 B+ 树
+
+@para:
+    tree : 树指针，必须为空树
+    eles : 连续存放的元素数组
+    cnt : 元素个数
+
+@return:
+    int : 0 成功， -1 参数错误， -2 创建节点失败， -3 树不为空， -4 元素未按键值严格递增排列
+
+@note:
+    自底向上逐层构建，每层的元素平均分配到最少数量的节点中，节点几乎是满的；
+    元素在加锁前全部拷贝完成；失败时树保持为空，且不会释放元素中的动态内存
+*/
+static int bplus_tree_build_sorted(avl_tree_t *tree, void *eles, int cnt)
+{
+    bplus_tree_private_t* _this = get_private_member(tree);
+    if(NULL == _this || NULL == eles || cnt < 0) return -1;
+    if(0 == cnt) return 0;
+
+    int res = 0;
+    int created = 0;
+    int node_cnt = (cnt + BPLUS_MAX_KEYS - 1) / BPLUS_MAX_KEYS;
+    void** elements = (void**)malloc(sizeof(void*) * cnt);
+    bplus_node_t** nodes = (bplus_node_t**)calloc(node_cnt, sizeof(bplus_node_t*));
+    int* min_keys = (int*)malloc(sizeof(int) * node_cnt);   // 每个节点子树中最小的键值，作为上层的分隔键值
+    int* totals = (int*)malloc(sizeof(int) * node_cnt);     // 每个节点子树中的元素个数
+    if(NULL == elements || NULL == nodes || NULL == min_keys || NULL == totals)
+        res = -2;
+
+    for(; 0 == res && created < cnt; ++created)
+    {
+        elements[created] = bplus_tree_create_element(tree, (char*)eles + (size_t)created * _this->m_element_size);
+        if(NULL == elements[created])
+        {
+            res = -2;
+            break;
+        }
+        if(created > 0 && tree->pf_hash(elements[created]) <= tree->pf_hash(elements[created - 1]))
+        {
+            created++;
+            res = -4;
+            break;
+        }
+    }
+
+    // 叶子层
+    for(int i = 0, pos = 0; 0 == res && i < node_cnt; ++i)
+    {
+        nodes[i] = bplus_tree_alloc_node(true);
+        if(NULL == nodes[i])
+        {
+            res = -2;
+            break;
+        }
+        nodes[i]->cnt = cnt / node_cnt + (i < cnt % node_cnt ? 1 : 0);
+        for(int j = 0; j < nodes[i]->cnt; ++j, ++pos)
+        {
+            nodes[i]->keys[j] = tree->pf_hash(elements[pos]);
+            nodes[i]->elements[j] = elements[pos];
+        }
+        if(i > 0)
+        {
+            nodes[i]->prev = nodes[i - 1];
+            nodes[i - 1]->next = nodes[i];
+        }
+        min_keys[i] = nodes[i]->keys[0];
+        totals[i] = nodes[i]->cnt;
+    }
+
+    // 内部节点层，上一层的节点数组在原位置被覆盖
+    while(0 == res && node_cnt > 1)
+    {
+        int child_cnt = node_cnt;
+        node_cnt = (child_cnt + BPLUS_MAX_KEYS) / (BPLUS_MAX_KEYS + 1);
+        for(int i = 0, pos = 0; i < node_cnt; ++i)
+        {
+            bplus_node_t* node = bplus_tree_alloc_node(false);
+            if(NULL == node)
+            {
+                // 未被本层接管的孩子仍在数组中，与已构建的节点一起释放
+                for(int j = pos; j < child_cnt; ++j)
+                    bplus_tree_free_nodes(nodes[j]);
+                node_cnt = i;
+                res = -2;
+                break;
+            }
+            int children = child_cnt / node_cnt + (i < child_cnt % node_cnt ? 1 : 0);
+            int min_key = min_keys[pos];
+            int total = 0;
+            node->cnt = children - 1;
+            for(int j = 0; j < children; ++j, ++pos)
+            {
+                if(j > 0)
+                    node->keys[j - 1] = min_keys[pos];
+                node->children[j] = nodes[pos];
+                node->counts[j] = totals[pos];
+                total += totals[pos];
+            }
+            nodes[i] = node;
+            min_keys[i] = min_key;
+            totals[i] = total;
+        }
+    }
+
+    if(0 == res)
+    {
+        bplus_tree_lock(_this);
+        if(NULL == _this->m_root)
+        {
+            _this->m_root = nodes[0];
+            _this->m_element_cnt = cnt;
+        }
+        else
+        {
+            res = -3;
+        }
+        bplus_tree_unlock(_this);
+    }
+
+    if(0 != res)
+    {
+        if(NULL != nodes)
+        {
+            for(int i = 0; i < node_cnt; ++i)
+                bplus_tree_free_nodes(nodes[i]);
+        }
+        for(int i = 0; i < created; ++i)
+        {
+            if(NULL != elements[i])
+                _this->m_pool->free(_this->m_pool, elements[i], _this->m_element_size);
+        }
+    }
+
+    free(elements);
+    free(nodes);
+    free(min_keys);
+    free(totals);
+    return res;
+}
+
+/*
+@func:
+    通过键值查找元素
+
+@para:
+    tree : 树指针
+    key : 元素对应的键值
+
+@return:
+    void* ： NULL 不存在， other 查找到的元素
+
+@note:
+    每层在连续存放的键值中二分查找，只访问一个节点
+*/
+static void* bplus_tree_query_by_key(avl_tree_t *tree, int key)
+{
+    bplus_tree_private_t* _this = get_private_member(tree);
+    if(NULL == _this) return NULL;
+
+    void* element = NULL;
+    bplus_tree_lock_shared(_this);
+    bplus_node_t* leaf = bplus_tree_find_leaf(_this, key);
+    if(NULL != leaf)
+    {
+        int i = bplus_lower_bound(leaf->keys, leaf->cnt, key);
+        if(i < leaf->cnt && leaf->keys[i] == key)
+            element = leaf->elements[i];
+    }
+    bplus_tree_unlock(_this);
+    return element;
+}
+
+/*
+@func:
+    预取节点中的键值
+
+@para:
+    node : 节点
+
+@return:
+    None
+
+@note:
+    键值数组跨越多个缓存行，二分查找会访问其中的大部分
+*/
+static void bplus_tree_prefetch_keys(const bplus_node_t* node)
+{
+    for(size_t offset = 0; offset < offsetof(bplus_node_t, keys) + sizeof(node->keys); offset += 64)
+        __builtin_prefetch((const char*)node + offset);
+}
+
+/*
+@func:
+    通过键值批量查找元素
+
+@para:
+    tree : 树指针
+    keys : 键值数组
+    cnt : 键值个数
+    eles : 输出每个键值对应的元素，不存在时为 NULL
+
+@return:
+    int : < 0 : 参数错误， other ： 查找到的元素个数
+
+@note:
+    叶子节点都在同一层，每 BPLUS_BATCH_GROUP 个键值为一组逐层同步向下，
+    每层先为组内全部键值预取下一层节点的键值，再依次二分查找
+*/
+static int bplus_tree_query_batch(avl_tree_t *tree, const int *keys, int cnt, void **eles)
+{
+    bplus_tree_private_t* _this = get_private_member(tree);
+    if(NULL == _this || NULL == keys || NULL == eles || cnt < 0) return -1;
+
+    int found = 0;
+    bplus_tree_lock_shared(_this);
+    for(int base = 0; base < cnt; base += BPLUS_BATCH_GROUP)
+    {
+        int group = cnt - base < BPLUS_BATCH_GROUP ? cnt - base : BPLUS_BATCH_GROUP;
+        bplus_node_t* nodes[BPLUS_BATCH_GROUP];
+        for(int i = 0; i < group; ++i)
+        {
+            nodes[i] = _this->m_root;
+            eles[base + i] = NULL;
+        }
+        if(NULL == _this->m_root) continue;
+
+        while(!nodes[0]->leaf)
+        {
+            for(int i = 0; i < group; ++i)
+            {
+                nodes[i] = nodes[i]->children[bplus_upper_bound(nodes[i]->keys, nodes[i]->cnt, keys[base + i])];
+                bplus_tree_prefetch_keys(nodes[i]);
+            }
+        }
+        for(int i = 0; i < group; ++i)
+        {
+            bplus_node_t* leaf = nodes[i];
+            int j = bplus_lower_bound(leaf->keys, leaf->cnt, keys[base + i]);
+            if(j < leaf->cnt && leaf->keys[j] == keys[base + i])
+            {
+                eles[base + i] = leaf->elements[j];
+                found++;
+            }
+        }
+    }
+    bplus_tree_unlock(_this);
+    return found;
+}
+
+/*
+@func:
+    通过键值 / 元素删除节点
+
+@para:
+    tree : 树指针
+    key : 节点元素对应的键值
+    ele : 节点的元素
+
+@return:
+    int ： 0 成功  -1 失败
+*/
+static int bplus_tree_del_by_key(avl_tree_t* tree, int key)
+{
+    bplus_tree_private_t* _this = get_private_member(tree);
+    if(NULL == _this) return -1;
+
+    bplus_tree_lock(_this);
+    void* element = bplus_tree_remove(_this, key);
+    if(NULL != element)
+        bplus_tree_free_element(tree, element);
+    bplus_tree_unlock(_this);
+
+    return NULL != element ? 0 : -1;
+}
+
+static int bplus_tree_del_by_element(avl_tree_t* tree, void* ele)
+{
+    if(NULL == tree || NULL == ele) return -1;
+
+    return bplus_tree_del_by_key(tree, tree->pf_hash(ele));
+}
+
+/*
+@func:
+    遍历全部元素
+
+@para:
+    tree ： 树指针
+    visit : 遍历时对每个元素执行的操作
+
+@return:
+    None
+
+@note:
+    沿叶子链表按键值升序访问；线程安全模式下整个遍历持有读锁，visit 中不能修改树
+*/
+static void bplus_tree_preorder(avl_tree_t* tree, void (*visit)(void* ele))
+{
+    bplus_tree_private_t* _this = get_private_member(tree);
+    if(NULL == _this || NULL == visit) return;
+
+    bplus_tree_lock_shared(_this);
+    bplus_node_t* leaf = _this->m_root;
+    while(NULL != leaf && !leaf->leaf)
+        leaf = leaf->children[0];
+    for(; NULL != leaf; leaf = leaf->next)
+    {
+        for(int i = 0; i < leaf->cnt; ++i)
+            visit(leaf->elements[i]);
+    }
+    bplus_tree_unlock(_this);
+}
+
+/*
+@func:
+    定位到第一个键值 >= key 的元素 / 最后一个键值 <= key 的元素
+
+@para:
+    tree : 树指针
+    key : 键值
+    pos : 输出定位到的位置，供 next / prev 使用，不存在时为 NULL
+
+@return:
+    void* : NULL 不存在， other 定位到的元素
+
+@note:
+    位置是元素在叶子节点中的地址，在树被修改之前有效
+*/
+static void* bplus_tree_seek(avl_tree_t *tree, int key, void **pos)
+{
+    bplus_tree_private_t* _this = get_private_member(tree);
+    if(NULL == _this || NULL == pos) return NULL;
+
+    *pos = NULL;
+    bplus_tree_lock_shared(_this);
+    bplus_node_t* leaf = bplus_tree_find_leaf(_this, key);
+    if(NULL != leaf)
+    {
+        int i = bplus_lower_bound(leaf->keys, leaf->cnt, key);
+        if(i == leaf->cnt)
+        {
+            leaf = leaf->next;
+            i = 0;
+        }
+        if(NULL != leaf)
+            *pos = &leaf->elements[i];
+    }
+    bplus_tree_unlock(_this);
+
+    return NULL != *pos ? *(void**)*pos : NULL;
+}
+
+static void* bplus_tree_seek_last(avl_tree_t *tree, int key, void **pos)
+{
+    bplus_tree_private_t* _this = get_private_member(tree);
+    if(NULL == _this || NULL == pos) return NULL;
+
+    *pos = NULL;
+    bplus_tree_lock_shared(_this);
+    bplus_node_t* leaf = bplus_tree_find_leaf(_this, key);
+    if(NULL != leaf)
+    {
+        int i = bplus_upper_bound(leaf->keys, leaf->cnt, key) - 1;
+        if(i < 0)
+        {
+            leaf = leaf->prev;
+            i = (NULL != leaf) ? leaf->cnt - 1 : 0;
+        }
+        if(NULL != leaf)
+            *pos = &leaf->elements[i];
+    }
+    bplus_tree_unlock(_this);
+
+    return NULL != *pos ? *(void**)*pos : NULL;
+}
+
+/*
+@func:
+    按键值顺序移动到 下一个 / 上一个 元素
+
+@para:
+    tree : 树指针
+    pos : seek / seek_last 输出的位置，移动后更新，到达末尾 / 开头时为 NULL
+
+@return:
+    void* : NULL 已到达末尾 / 开头， other 移动到的元素
+
+@note:
+    在叶子节点内顺序移动，到达节点边界时沿叶子链表进入相邻节点；位置在树被修改之前有效
+*/
+static void* bplus_tree_next(avl_tree_t *tree, void **pos)
+{
+    bplus_tree_private_t* _this = get_private_member(tree);
+    if(NULL == _this || NULL == pos || NULL == *pos) return NULL;
+
+    bplus_tree_lock_shared(_this);
+    bplus_node_t* leaf = BPLUS_LEAF_OF(*pos);
+    int i = (int)((void**)*pos - leaf->elements) + 1;
+    if(i >= leaf->cnt)
+    {
+        leaf = leaf->next;
+        i = 0;
+    }
+    *pos = (NULL != leaf) ? &leaf->elements[i] : NULL;
+    bplus_tree_unlock(_this);
+
+    return NULL != *pos ? *(void**)*pos : NULL;
+}
+
+static void* bplus_tree_prev(avl_tree_t *tree, void **pos)
+{
+    bplus_tree_private_t* _this = get_private_member(tree);
+    if(NULL == _this || NULL == pos || NULL == *pos) return NULL;
+
+    bplus_tree_lock_shared(_this);
+    bplus_node_t* leaf = BPLUS_LEAF_OF(*pos);
+    int i = (int)((void**)*pos - leaf->elements) - 1;
+    if(i < 0)
+    {
+        leaf = leaf->prev;
+        i = (NULL != leaf) ? leaf->cnt - 1 : 0;
+    }
+    *pos = (NULL != leaf) ? &leaf->elements[i] : NULL;
+    bplus_tree_unlock(_this);
+
+    return NULL != *pos ? *(void**)*pos : NULL;
+}
+
+/*
+@func:
+    按键值升序访问 [low, high) 范围内的元素
+
+@para:
+    tree : 树指针
+    low : 范围下限，包含
+    high : 范围上限，不包含
+    visit : 对每个元素执行的操作，返回 false 时停止
+    arg : 传给 visit 的参数
+
+@return:
+    int : < 0 : 失败， other ： 访问的元素个数
+
+@note:
+    定位到下限所在的叶子后沿叶子链表顺序访问；
+    线程安全模式下整个过程持有读锁，visit 中不能修改树
+*/
+static int bplus_tree_range(avl_tree_t *tree, int low, int high, bool (*visit)(void *ele, void *arg), void *arg)
+{
+    bplus_tree_private_t* _this = get_private_member(tree);
+    if(NULL == _this || NULL == visit) return -1;
+
+    int cnt = 0;
+    bplus_tree_lock_shared(_this);
+    bplus_node_t* leaf = bplus_tree_find_leaf(_this, low);
+    int i = (NULL != leaf) ? bplus_lower_bound(leaf->keys, leaf->cnt, low) : 0;
+    for(; NULL != leaf; leaf = leaf->next, i = 0)
+    {
+        for(; i < leaf->cnt && leaf->keys[i] < high; ++i)
+        {
+            cnt++;
+            if(!visit(leaf->elements[i], arg))
+                goto out;
+        }
+        if(i < leaf->cnt)
+            break;
+    }
+out:
+    bplus_tree_unlock(_this);
+    return cnt;
+}
+
+/*
+@func:
+    获取键值小于 key 的元素个数
+
+@para:
+    _this : 私有成员
+    key : 键值
+
+@return:
+    int : 键值小于 key 的元素个数
+
+@note:
+    内部节点保存每个孩子子树的元素个数，下降时累加左侧孩子的元素个数
+*/
+static int bplus_tree_rank_of(bplus_tree_private_t* _this, int key)
+{
+    int rank = 0;
+    bplus_node_t* node = _this->m_root;
+    if(NULL == node) return 0;
+
+    while(!node->leaf)
+    {
+        int i = bplus_upper_bound(node->keys, node->cnt, key);
+        for(int j = 0; j < i; ++j)
+            rank += node->counts[j];
+        node = node->children[i];
+    }
+    return rank + bplus_lower_bound(node->keys, node->cnt, key);
+}
+
+static int bplus_tree_rank(avl_tree_t *tree, int key)
+{
+    bplus_tree_private_t* _this = get_private_member(tree);
+    if(NULL == _this) return -1;
+
+    bplus_tree_lock_shared(_this);
+    int rank = bplus_tree_rank_of(_this, key);
+    bplus_tree_unlock(_this);
+    return rank;
+}
+
+/*
+@func:
+    按键值升序获取第 index 个元素（从 0 开始）
+
+@para:
+    tree : 树指针
+    index : 元素的排名
+    pos : 输出元素的位置，供 next / prev 使用，不存在时为 NULL，可传 NULL
+
+@return:
+    void* : NULL index 越界， other 查找到的元素
+*/
+static void* bplus_tree_select(avl_tree_t *tree, int index, void **pos)
+{
+    bplus_tree_private_t* _this = get_private_member(tree);
+    if(NULL == _this) return NULL;
+
+    void** slot = NULL;
+    bplus_tree_lock_shared(_this);
+    bplus_node_t* node = _this->m_root;
+    if(NULL != node && index >= 0 && index < _this->m_element_cnt)
+    {
+        while(!node->leaf)
+        {
+            int i = 0;
+            while(i < node->cnt && index >= node->counts[i])
+                index -= node->counts[i++];
+            node = node->children[i];
+        }
+        slot = &node->elements[index];
+    }
+    bplus_tree_unlock(_this);
+
+    if(NULL != pos)
+        *pos = slot;
+    return NULL != slot ? *slot : NULL;
+}
+
+/*
+@func:
+    统计键值在 [low, high) 范围内的元素个数
+
+@para:
+    tree : 树指针
+    low : 范围下限，包含
+    high : 范围上限，不包含
+
+@return:
+    int : < 0 : 失败， other ： 范围内的元素个数
+*/
+static int bplus_tree_count_range(avl_tree_t *tree, int low, int high)
+{
+    bplus_tree_private_t* _this = get_private_member(tree);
+    if(NULL == _this) return -1;
+    if(low >= high) return 0;
+
+    bplus_tree_lock_shared(_this);
+    int cnt = bplus_tree_rank_of(_this, high) - bplus_tree_rank_of(_this, low);
+    bplus_tree_unlock(_this);
+    return cnt;
+}
+
+/*
+@func:
+    获取元素的数量
+
+@para:
+    tree : 树指针
+
+@return:
+    int : 元素的数量
+*/
+static int bplus_tree_size(avl_tree_t* tree)
+{
+    bplus_tree_private_t* _this = get_private_member(tree);
+    return _this->m_element_cnt;
+}
+
+/*
+@func:
+    清除树的全部元素
+
+@para:
+    tree : 树指针
+
+@return:
+    None.
+
+@note:
+    元素从树的内存池中申请，清除时整体释放；pf_free_element 为 NULL 时不需要访问元素
+*/
+static void bplus_tree_clear(avl_tree_t *tree)
+{
+    bplus_tree_private_t* _this = get_private_member(tree);
+
+    bplus_tree_lock(_this);
+    if(NULL != tree->pf_free_element)
+    {
+        bplus_node_t* leaf = _this->m_root;
+        while(NULL != leaf && !leaf->leaf)
+            leaf = leaf->children[0];
+        for(; NULL != leaf; leaf = leaf->next)
+        {
+            for(int i = 0; i < leaf->cnt; ++i)
+                tree->pf_free_element(leaf->elements[i]);
+        }
+    }
+    bplus_tree_free_nodes(_this->m_root);
+    _this->m_pool->clear(_this->m_pool);
+    _this->m_root = NULL;
+    _this->m_element_cnt = 0;
+    bplus_tree_unlock(_this);
+}
+
+/*
+@func:
+    销毁树
+
+@para:
+    tree : 树指针
+
+@return:
+    None.
+*/
+static void bplus_tree_destory(avl_tree_t** tree)
+{
+    avl_tree_t* _this = *tree;
+
+    if(NULL == _this) return;
+
+    if(_this->_private_)
+    {
+        bplus_tree_clear(_this);
+
+        bplus_tree_private_t* private_member = get_private_member(_this);
+        private_member->m_pool->destory(&private_member->m_pool);
+        pthread_rwlock_destroy(&private_member->m_tree_lock);
+        free(_this->_private_);
+        _this->_private_ = NULL;
+    }
+
+    free(_this);
+    *tree = NULL;
+}
+
+/*
+@func:
+    创建一颗 B+ 树
+
+@para:
+    element_size : 元素的大小，单位字节
+    pf_hash_func ； 从元素获得键值 key 的方法，由用户提供
+    pf_free_element_func ： 若元素不包含额外的动态内存， 此参数可传 NULL
+    thread_safe ： 是否启用线程安全
+
+@return:
+    avl_tree_t* : NULL 失败， other 与平衡二叉树接口相同的树指针
+*/
+avl_tree_t* bplus_tree_create(int element_size, int (*pf_hash_func)(void *), int (*pf_free_element_func)(void *), bool thread_safe)
+{
+    if(NULL == pf_hash_func || element_size <= 0)
+        return NULL;
+
+    avl_tree_t *tree = (avl_tree_t *)malloc(sizeof(avl_tree_t));
+    bplus_tree_private_t *private_member = (bplus_tree_private_t *)malloc(sizeof(bplus_tree_private_t));
+    mem_pool_t *pool = mem_pool_create(thread_safe);
+    if(NULL == tree || NULL == private_member || NULL == pool)
+    {
+        free(tree);
+        free(private_member);
+        if(NULL != pool)
+            pool->destory(&pool);
+        return NULL;
+    }
+    memset(tree, 0, sizeof(avl_tree_t));
+    memset(private_member, 0, sizeof(bplus_tree_private_t));
+
+    private_member->m_pool = pool;
+    private_member->m_root = NULL;
+    private_member->m_element_size = element_size;
+    private_member->m_is_thread_safe = thread_safe;
+
+    pthread_rwlock_init(&private_member->m_tree_lock, NULL);
+
+    tree->_this = tree;
+    tree->_private_ = (void *)private_member;
+
+    tree->pf_hash = pf_hash_func;
+    tree->pf_free_element = pf_free_element_func;
+    tree->add = bplus_tree_add;
+    tree->add_batch = bplus_tree_add_batch;
+    tree->build_sorted = bplus_tree_build_sorted;
+    tree->query_by_key = bplus_tree_query_by_key;
+    tree->query_batch = bplus_tree_query_batch;
+    tree->preorder = bplus_tree_preorder;
+    tree->seek = bplus_tree_seek;
+    tree->seek_last = bplus_tree_seek_last;
+    tree->next = bplus_tree_next;
+    tree->prev = bplus_tree_prev;
+    tree->range = bplus_tree_range;
+    tree->rank = bplus_tree_rank;
+    tree->select = bplus_tree_select;
+    tree->count_range = bplus_tree_count_range;
+    tree->size = bplus_tree_size;
+    tree->del_node_by_key = bplus_tree_del_by_key;
+    tree->del_node_by_element = bplus_tree_del_by_element;
+    tree->clear_node = bplus_tree_clear;
+    tree->destory = bplus_tree_destory;
+
+    return tree;
+}
@@ -0,0 +1,35 @@
+/*
+** File : BPlusTree.h
+** Author : Saury
+** Date : 2020-09-12
+*/
+
+#ifndef _BPLUS_TREE_H_
+#define _BPLUS_TREE_H_
+
+#include "AVLTree.h"
+
+/*
+    B+ 树索引：提供与 avl_tree_t 完全相同的接口，可以直接替换平衡二叉树作为索引使用。
+    每个节点占一块对齐的连续内存，最多保存 60 个连续存放的键值，
+    查找时每层只访问一个节点，千万级元素只需访问 4 ~ 5 个节点；
+    叶子节点按键值顺序双向链接，范围访问与 next / prev 不需要回到上层节点；
+    元素单独从内存池申请，节点分裂与合并时只移动元素指针，返回的元素在被删除前一直有效
+*/
+
+/*
+@func:
+    创建一颗 B+ 树
+
+@para:
+    element_size : 元素的大小，单位字节
+    pf_hash_func ； 从元素获得键值 key 的方法，由用户提供
+    pf_free_element_func ： 若元素不包含额外的动态内存， 此参数可传 NULL
+    thread_safe ： 是否启用线程安全，启用后查询与遍历共享读锁，增删与清除独占写锁
+
+@return:
+    avl_tree_t* : NULL 失败， other 与平衡二叉树接口相同的树指针
+*/
+extern avl_tree_t* bplus_tree_create(int element_size, int (*pf_hash_func)(void *), int (*pf_free_element_func)(void *), bool thread_safe);
+
+#endif /* end #ifndef _BPLUS_TREE_H_ */
@@ -0,0 +1,958 @@
+/*
+** File : DenseIndex.c
+** Author : Saury
+** Date : 2020-09-12
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include "DenseIndex.h"
+#include "MemPool.h"
+
+
+#define DEBUG_LOG 0
+
+#define DENSE_LOG_DEBUG(fmt, ...) \
+    do{ \
+        if(DEBUG_LOG) \
+        {\
+            printf("%s at %d " fmt "\r\n", __FILE__, __LINE__, ##__VA_ARGS__);\
+        }\
+    }while(0);
+
+
+#define DENSE_WORD_BITS     64          // 位图每个字对应的键值个数，覆盖范围的起点与大小都按它对齐
+#define DENSE_MAX_CAPACITY  (1 << 30)   // 覆盖的最大键值个数，超过时插入失败
+#define DENSE_MIN_SPAN      (1 << 20)   // 元素较少时允许覆盖的键值个数
+#define DENSE_SPAN_RATIO    8           // 覆盖的键值个数最多为元素个数的倍数，少量稀疏的键值不会申请巨大的数组
+
+// 向下对齐到 DENSE_WORD_BITS 的倍数，负数同样向下取整
+#define DENSE_FLOOR(key) ((long long)(key) - (((long long)(key) % DENSE_WORD_BITS + DENSE_WORD_BITS) % DENSE_WORD_BITS))
+
+typedef struct _dense_index_private
+{
+    void **m_slots;         // m_slots[i] 为键值 m_base + i 的元素
+    uint64_t *m_bitmap;     // 第 i 位为 1 表示键值 m_base + i 存在
+    long long m_base;       // 覆盖范围的起始键值
+    int m_capacity;         // 覆盖的键值个数，为 0 时表示还没有插入过元素
+    int m_element_cnt;
+    int m_element_size;
+    bool m_is_thread_safe;
+    pthread_rwlock_t m_tree_lock;   // 查询与遍历共享读锁，修改独占写锁
+    mem_pool_t *m_pool;     // 元素的内存池，清除时整体释放
+}dense_index_private_t;
+
+#define DENSE_TEST(_this, i) (((_this)->m_bitmap[(i) / DENSE_WORD_BITS] >> ((i) % DENSE_WORD_BITS)) & 1)
+#define DENSE_KEY(_this, i) ((int)((_this)->m_base + (i)))
+
+/*
+@func:
+    获取私有成员变量
+
+@para:
+    tree ： 索引指针
+
+@return:
+    dense_index_private_t* : 私有成员变量结构体指针
+*/
+static dense_index_private_t* get_private_member(avl_tree_t* tree)
+{
+    if(NULL == tree) return NULL;
+
+    return (dense_index_private_t*)tree->_private_;
+}
+
+/*
+@func:
+    线程锁， 上写锁/上读锁/解锁
+
+@para:
+    _this ： 私有成员
+
+@return:
+    None
+*/
+static void dense_index_lock(dense_index_private_t* _this)
+{
+    if(_this->m_is_thread_safe)
+        pthread_rwlock_wrlock(&_this->m_tree_lock);
+}
+
+static void dense_index_lock_shared(dense_index_private_t* _this)
+{
+    if(_this->m_is_thread_safe)
+        pthread_rwlock_rdlock(&_this->m_tree_lock);
+}
+
+static void dense_index_unlock(dense_index_private_t* _this)
+{
+    if(_this->m_is_thread_safe)
+        pthread_rwlock_unlock(&_this->m_tree_lock);
+}
+
+/*
+@func:
+    获取键值对应的下标
+
+@para:
+    _this : 私有成员
+    key : 键值
+
+@return:
+    long long : 下标，可能不在 [0, m_capacity) 范围内
+*/
+static long long dense_index_of(dense_index_private_t* _this, int key)
+{
+    return (long long)key - _this->m_base;
+}
+
+/*
+@func:
+    扩展覆盖范围使其包含 [low, high] 内的全部键值
+
+@para:
+    _this : 私有成员
+    low : 范围下限
+    high : 范围上限
+    add_cnt : 即将插入的元素个数
+
+@return:
+    int : 0 成功， -2 申请内存失败或范围超过上限
+
+@note:
+    新的大小至少为原来的两倍，向下扩展时保持原来的上限不变，向上扩展时保持原来的下限不变；
+    覆盖范围不超过 (已有与即将插入的元素个数) * DENSE_SPAN_RATIO 与 DENSE_MIN_SPAN 中的较大者，
+    也不超过 DENSE_MAX_CAPACITY。调用者需持有写锁
+*/
+static int dense_index_reserve(dense_index_private_t* _this, int low, int high, int add_cnt)
+{
+    long long old_end = _this->m_base + _this->m_capacity;
+    if(0 != _this->m_capacity && low >= _this->m_base && high < old_end)
+        return 0;
+
+    long long need_low = DENSE_FLOOR(low);
+    long long need_high = DENSE_FLOOR(high) + DENSE_WORD_BITS;
+    if(0 != _this->m_capacity)
+    {
+        if(_this->m_base < need_low) need_low = _this->m_base;
+        if(old_end > need_high) need_high = old_end;
+    }
+
+    long long limit = DENSE_SPAN_RATIO * ((long long)_this->m_element_cnt + add_cnt);
+    limit = (limit + DENSE_WORD_BITS - 1) / DENSE_WORD_BITS * DENSE_WORD_BITS;
+    if(limit < DENSE_MIN_SPAN)
+        limit = DENSE_MIN_SPAN;
+    if(limit > DENSE_MAX_CAPACITY)
+        limit = DENSE_MAX_CAPACITY;
+
+    long long capacity = need_high - need_low;
+    if(capacity < 2LL * _this->m_capacity)
+        capacity = 2LL * _this->m_capacity;
+    if(capacity > limit)
+    {
+        if(need_high - need_low > limit)
+        {
+            DENSE_LOG_DEBUG("key span too large [%lld, %lld), limit %lld", need_low, need_high, limit);
+            return -2;
+        }
+        capacity = limit;
+    }
+
+    // 向下扩展时新增的部分全部放在前面，否则放在后面，不超出 int 的范围
+    long long base = (0 != _this->m_capacity && need_low < _this->m_base) ? need_high - capacity : need_low;
+    if(base < INT_MIN)
+        base = INT_MIN;
+    if(base + capacity > (long long)INT_MAX + 1)
+        base = (long long)INT_MAX + 1 - capacity;
+
+    void** slots = (void**)calloc((size_t)capacity, sizeof(void*));
+    uint64_t* bitmap = (uint64_t*)calloc((size_t)(capacity / DENSE_WORD_BITS), sizeof(uint64_t));
+    if(NULL == slots || NULL == bitmap)
+    {
+        free(slots);
+        free(bitmap);
+        return -2;
+    }
+
+    if(0 != _this->m_capacity)
+    {
+        long long shift = _this->m_base - base;
+        memcpy(slots + shift, _this->m_slots, sizeof(void*) * _this->m_capacity);
+        memcpy(bitmap + shift / DENSE_WORD_BITS, _this->m_bitmap, sizeof(uint64_t) * (_this->m_capacity / DENSE_WORD_BITS));
+    }
+    free(_this->m_slots);
+    free(_this->m_bitmap);
+    _this->m_slots = slots;
+    _this->m_bitmap = bitmap;
+    _this->m_base = base;
+    _this->m_capacity = (int)capacity;
+    DENSE_LOG_DEBUG("reserve [%lld, %lld)", base, base + capacity);
+    return 0;
+}
+
+/*
+@func:
+    在位图中查找下标 >= from 的第一个元素 / 下标 <= from 的最后一个元素
+
+@para:
+    _this : 私有成员
+    from : 起始下标
+
+@return:
+    int : < 0 不存在， other 查找到的下标
+
+@note:
+    逐字扫描位图，一次跳过 64 个不存在的键值
+*/
+static int dense_index_next_set(dense_index_private_t* _this, long long from)
+{
+    if(from < 0) from = 0;
+    if(from >= _this->m_capacity) return -1;
+
+    int word = (int)(from / DENSE_WORD_BITS);
+    uint64_t bits = _this->m_bitmap[word] & (~0ULL << (from % DENSE_WORD_BITS));
+    int words = _this->m_capacity / DENSE_WORD_BITS;
+    while(0 == bits)
+    {
+        if(++word >= words) return -1;
+        bits = _this->m_bitmap[word];
+    }
+    return word * DENSE_WORD_BITS + __builtin_ctzll(bits);
+}
+
+static int dense_index_prev_set(dense_index_private_t* _this, long long from)
+{
+    if(from < 0) return -1;
+    if(from >= _this->m_capacity) from = _this->m_capacity - 1;
+
+    int word = (int)(from / DENSE_WORD_BITS);
+    uint64_t bits = _this->m_bitmap[word] & (~0ULL >> (DENSE_WORD_BITS - 1 - from % DENSE_WORD_BITS));
+    while(0 == bits)
+    {
+        if(--word < 0) return -1;
+        bits = _this->m_bitmap[word];
+    }
+    return word * DENSE_WORD_BITS + (DENSE_WORD_BITS - 1 - __builtin_clzll(bits));
+}
+
+/*
+@func:
+    统计下标小于 end 的元素个数
+
+@para:
+    _this : 私有成员
+    end : 下标
+
+@return:
+    int : 元素个数
+*/
+static int dense_index_count_below(dense_index_private_t* _this, long long end)
+{
+    if(end <= 0) return 0;
+    if(end >= _this->m_capacity) return _this->m_element_cnt;
+
+    int cnt = 0;
+    int word = (int)(end / DENSE_WORD_BITS);
+    for(int i = 0; i < word; ++i)
+        cnt += __builtin_popcountll(_this->m_bitmap[i]);
+    if(0 != end % DENSE_WORD_BITS)
+        cnt += __builtin_popcountll(_this->m_bitmap[word] & (~0ULL >> (DENSE_WORD_BITS - end % DENSE_WORD_BITS)));
+    return cnt;
+}
+
+/*
+@func:
+    把元素插入索引中
+
+@para:
+    _this : 私有成员
+    key : 元素的键值
+    element : 元素
+
+@return:
+    int : 0 成功， -2 扩展覆盖范围失败， -3 重复插入（元素不会被释放）
+
+@note:
+    调用者需持有写锁
+*/
+static int dense_index_insert(dense_index_private_t* _this, int key, void* element)
+{
+    if(0 != dense_index_reserve(_this, key, key, 1))
+        return -2;
+
+    long long i = dense_index_of(_this, key);
+    if(DENSE_TEST(_this, i))
+    {
+        DENSE_LOG_DEBUG("Element repetition");
+        return -3;
+    }
+    _this->m_slots[i] = element;
+    _this->m_bitmap[i / DENSE_WORD_BITS] |= 1ULL << (i % DENSE_WORD_BITS);
+    _this->m_element_cnt++;
+    return 0;
+}
+
+/*
+@func:
+    创建保存指定元素拷贝的元素内存 / 释放元素内存
+
+@para:
+    tree : 索引指针
+    ele : 元素
+
+@return:
+    void* : NULL 失败， other 元素的拷贝
+*/
+static void* dense_index_create_element(avl_tree_t* tree, void* ele)
+{
+    dense_index_private_t* _this = get_private_member(tree);
+    void* element = _this->m_pool->alloc(_this->m_pool, _this->m_element_size);
+    if(NULL == element)
+    {
+        DENSE_LOG_DEBUG("[ERROR]:element malloc");
+        return NULL;
+    }
+    memcpy(element, ele, _this->m_element_size);
+    return element;
+}
+
+static void dense_index_free_element(avl_tree_t* tree, void* element)
+{
+    dense_index_private_t* _this = get_private_member(tree);
+    if(NULL != tree->pf_free_element)
+        tree->pf_free_element(element);
+    _this->m_pool->free(_this->m_pool, element, _this->m_element_size);
+}
+
+/*
+@func:
+    增加元素
+
+@para:
+    tree : 索引指针
+    ele : 要增加的元素
+
+@return:
+    int : -1 索引指针为空， -2 创建元素或扩展覆盖范围失败， -3 重复插入
+*/
+static int dense_index_add(avl_tree_t *tree, void *ele)
+{
+    dense_index_private_t* _this = get_private_member(tree);
+    if(NULL == _this || NULL == ele) return -1;
+
+    void* element = dense_index_create_element(tree, ele);
+    if(NULL == element) return -2;
+
+    dense_index_lock(_this);
+    int res = dense_index_insert(_this, tree->pf_hash(element), element);
+    dense_index_unlock(_this);
+
+    if(0 != res)
+        dense_index_free_element(tree, element);
+    return res;
+}
+
+/*
+@func:
+    批量增加元素
+
+@para:
+    tree : 索引指针
+    eles : 连续存放的元素数组
+    cnt : 元素个数
+    status : 每个元素的插入结果，含义与 add 的返回值相同，可传 NULL
+
+@return:
+    int : < 0 参数错误， other 成功插入的元素个数
+
+@note:
+    元素在加锁前全部拷贝完成，整批插入只获取一次锁，覆盖范围一次扩展到整批的键值范围
+*/
+static int dense_index_add_batch(avl_tree_t *tree, void *eles, int cnt, int *status)
+{
+    dense_index_private_t* _this = get_private_member(tree);
+    if(NULL == _this || NULL == eles || cnt < 0) return -1;
+
+    void** elements = (void**)malloc(sizeof(void*) * (cnt > 0 ? cnt : 1));
+    if(NULL == elements) return -2;
+
+    int low = INT_MAX, high = INT_MIN;
+    for(int i = 0; i < cnt; ++i)
+    {
+        elements[i] = dense_index_create_element(tree, (char*)eles + (size_t)i * _this->m_element_size);
+        if(NULL == elements[i]) continue;
+        int key = tree->pf_hash(elements[i]);
+        if(key < low) low = key;
+        if(key > high) high = key;
+    }
+
+    int added = 0;
+    dense_index_lock(_this);
+    // 一次扩展失败时（例如整批的键值跨度过大）仍逐个插入
+    if(low <= high)
+        dense_index_reserve(_this, low, high, cnt);
+    for(int i = 0; i < cnt; ++i)
+    {
+        int res = (NULL == elements[i]) ? -2 : dense_index_insert(_this, tree->pf_hash(elements[i]), elements[i]);
+        if(0 == res)
+            added++;
+        else if(NULL != elements[i])
+            dense_index_free_element(tree, elements[i]);
+        if(NULL != status)
+            status[i] = res;
+    }
+    dense_index_unlock(_this);
+
+    free(elements);
+    return added;
+}
+
+/*
+@func:
+    由按键值严格递增排列的元素直接构建索引
+
+@para:
+    tree : 索引指针，必须为空
+    eles : 连续存放的元素数组
+    cnt : 元素个数
+
+@return:
+    int : 0 成功， -1 参数错误， -2 创建元素或扩展覆盖范围失败， -3 索引不为空， -4 元素未按键值严格递增排列
+
+@note:
+    与平衡二叉树的约定相同；首尾元素确定覆盖范围，只申请一次数组；
+    失败时索引保持为空，且不会释放元素中的动态内存
+*/
+static int dense_index_build_sorted(avl_tree_t *tree, void *eles, int cnt)
+{
+    dense_index_private_t* _this = get_private_member(tree);
+    if(NULL == _this || NULL == eles || cnt < 0) return -1;
+    if(0 == cnt) return 0;
+
+    for(int i = 1; i < cnt; ++i)
+    {
+        if(tree->pf_hash((char*)eles + (size_t)i * _this->m_element_size) <= tree->pf_hash((char*)eles + (size_t)(i - 1) * _this->m_element_size))
+            return -4;
+    }
+
+    int res = 0;
+    dense_index_lock(_this);
+    if(0 != _this->m_element_cnt)
+        res = -3;
+    else
+        res = dense_index_reserve(_this, tree->pf_hash(eles), tree->pf_hash((char*)eles + (size_t)(cnt - 1) * _this->m_element_size), cnt);
+
+    int created = 0;
+    for(; 0 == res && created < cnt; ++created)
+    {
+        void* element = dense_index_create_element(tree, (char*)eles + (size_t)created * _this->m_element_size);
+        if(NULL == element)
+        {
+            res = -2;
+            break;
+        }
+        dense_index_insert(_this, tree->pf_hash(element), element);
+    }
+
+    if(0 != res && created > 0)
+    {
+        for(int i = 0; i < _this->m_capacity; ++i)
+        {
+            if(DENSE_TEST(_this, i))
+                _this->m_pool->free(_this->m_pool, _this->m_slots[i], _this->m_element_size);
+        }
+        memset(_this->m_bitmap, 0, sizeof(uint64_t) * (_this->m_capacity / DENSE_WORD_BITS));
+        _this->m_element_cnt = 0;
+    }
+    dense_index_unlock(_this);
+    return res;
+}
+
+/*
+@func:
+    通过键值查找元素
+
+@para:
+    tree : 索引指针
+    key : 元素对应的键值
+
+@return:
+    void* ： NULL 不存在， other 查找到的元素
+
+@note:
+    一次位图访问与一次数组访问
+*/
+static void* dense_index_query_by_key(avl_tree_t *tree, int key)
+{
+    dense_index_private_t* _this = get_private_member(tree);
+    if(NULL == _this) return NULL;
+
+    void* element = NULL;
+    dense_index_lock_shared(_this);
+    long long i = dense_index_of(_this, key);
+    if(i >= 0 && i < _this->m_capacity && DENSE_TEST(_this, i))
+        element = _this->m_slots[i];
+    dense_index_unlock(_this);
+    return element;
+}
+
+/*
+@func:
+    通过键值批量查找元素
+
+@para:
+    tree : 索引指针
+    keys : 键值数组
+    cnt : 键值个数
+    eles : 输出每个键值对应的元素，不存在时为 NULL
+
+@return:
+    int : < 0 : 参数错误， other ： 查找到的元素个数
+
+@note:
+    先为整批键值预取位图与元素指针，再依次读取
+*/
+static int dense_index_query_batch(avl_tree_t *tree, const int *keys, int cnt, void **eles)
+{
+    dense_index_private_t* _this = get_private_member(tree);
+    if(NULL == _this || NULL == keys || NULL == eles || cnt < 0) return -1;
+
+    int found = 0;
+    dense_index_lock_shared(_this);
+    for(int i = 0; i < cnt; ++i)
+    {
+        long long k = dense_index_of(_this, keys[i]);
+        if(k >= 0 && k < _this->m_capacity)
+        {
+            __builtin_prefetch(&_this->m_bitmap[k / DENSE_WORD_BITS]);
+            __builtin_prefetch(&_this->m_slots[k]);
+        }
+    }
+    for(int i = 0; i < cnt; ++i)
+    {
+        long long k = dense_index_of(_this, keys[i]);
+        eles[i] = (k >= 0 && k < _this->m_capacity && DENSE_TEST(_this, k)) ? _this->m_slots[k] : NULL;
+        if(NULL != eles[i])
+            found++;
+    }
+    dense_index_unlock(_this);
+    return found;
+}
+
+/*
+@func:
+    通过键值 / 元素删除元素
+
+@para:
+    tree : 索引指针
+    key : 元素对应的键值
+    ele : 元素
+
+@return:
+    int ： 0 成功  -1 失败
+
+@note:
+    覆盖范围不会缩小
+*/
+static int dense_index_del_by_key(avl_tree_t* tree, int key)
+{
+    dense_index_private_t* _this = get_private_member(tree);
+    if(NULL == _this) return -1;
+
+    int res = -1;
+    dense_index_lock(_this);
+    long long i = dense_index_of(_this, key);
+    if(i >= 0 && i < _this->m_capacity && DENSE_TEST(_this, i))
+    {
+        dense_index_free_element(tree, _this->m_slots[i]);
+        _this->m_slots[i] = NULL;
+        _this->m_bitmap[i / DENSE_WORD_BITS] &= ~(1ULL << (i % DENSE_WORD_BITS));
+        _this->m_element_cnt--;
+        res = 0;
+    }
+    dense_index_unlock(_this);
+    return res;
+}
+
+static int dense_index_del_by_element(avl_tree_t* tree, void* ele)
+{
+    if(NULL == tree || NULL == ele) return -1;
+
+    return dense_index_del_by_key(tree, tree->pf_hash(ele));
+}
+
+/*
+@func:
+    遍历全部元素
+
+@para:
+    tree ： 索引指针
+    visit : 遍历时对每个元素执行的操作
+
+@return:
+    None
+
+@note:
+    按键值升序访问；线程安全模式下整个遍历持有读锁，visit 中不能修改索引
+*/
+static void dense_index_preorder(avl_tree_t* tree, void (*visit)(void* ele))
+{
+    dense_index_private_t* _this = get_private_member(tree);
+    if(NULL == _this || NULL == visit) return;
+
+    dense_index_lock_shared(_this);
+    for(int i = dense_index_next_set(_this, 0); i >= 0; i = dense_index_next_set(_this, (long long)i + 1))
+        visit(_this->m_slots[i]);
+    dense_index_unlock(_this);
+}
+
+/*
+@func:
+    定位到第一个键值 >= key 的元素 / 最后一个键值 <= key 的元素
+
+@para:
+    tree : 索引指针
+    key : 键值
+    pos : 输出定位到的位置，供 next / prev 使用，不存在时为 NULL
+
+@return:
+    void* : NULL 不存在， other 定位到的元素
+
+@note:
+    位置是元素指针在数组中的地址，在索引被修改之前有效
+*/
+static void* dense_index_seek(avl_tree_t *tree, int key, void **pos)
+{
+    dense_index_private_t* _this = get_private_member(tree);
+    if(NULL == _this || NULL == pos) return NULL;
+
+    dense_index_lock_shared(_this);
+    int i = dense_index_next_set(_this, dense_index_of(_this, key));
+    *pos = (i >= 0) ? &_this->m_slots[i] : NULL;
+    dense_index_unlock(_this);
+
+    return NULL != *pos ? *(void**)*pos : NULL;
+}
+
+static void* dense_index_seek_last(avl_tree_t *tree, int key, void **pos)
+{
+    dense_index_private_t* _this = get_private_member(tree);
+    if(NULL == _this || NULL == pos) return NULL;
+
+    dense_index_lock_shared(_this);
+    int i = dense_index_prev_set(_this, dense_index_of(_this, key));
+    *pos = (i >= 0) ? &_this->m_slots[i] : NULL;
+    dense_index_unlock(_this);
+
+    return NULL != *pos ? *(void**)*pos : NULL;
+}
+
+/*
+@func:
+    按键值顺序移动到 下一个 / 上一个 元素
+
+@para:
+    tree : 索引指针
+    pos : seek / seek_last 输出的位置，移动后更新，到达末尾 / 开头时为 NULL
+
+@return:
+    void* : NULL 已到达末尾 / 开头， other 移动到的元素
+*/
+static void* dense_index_next(avl_tree_t *tree, void **pos)
+{
+    dense_index_private_t* _this = get_private_member(tree);
+    if(NULL == _this || NULL == pos || NULL == *pos) return NULL;
+
+    dense_index_lock_shared(_this);
+    int i = dense_index_next_set(_this, (void**)*pos - _this->m_slots + 1);
+    *pos = (i >= 0) ? &_this->m_slots[i] : NULL;
+    dense_index_unlock(_this);
+
+    return NULL != *pos ? *(void**)*pos : NULL;
+}
+
+static void* dense_index_prev(avl_tree_t *tree, void **pos)
+{
+    dense_index_private_t* _this = get_private_member(tree);
+    if(NULL == _this || NULL == pos || NULL == *pos) return NULL;
+
+    dense_index_lock_shared(_this);
+    int i = dense_index_prev_set(_this, (void**)*pos - _this->m_slots - 1);
+    *pos = (i >= 0) ? &_this->m_slots[i] : NULL;
+    dense_index_unlock(_this);
+
+    return NULL != *pos ? *(void**)*pos : NULL;
+}
+
+/*
+@func:
+    按键值升序访问 [low, high) 范围内的元素
+
+@para:
+    tree : 索引指针
+    low : 范围下限，包含
+    high : 范围上限，不包含
+    visit : 对每个元素执行的操作，返回 false 时停止
+    arg : 传给 visit 的参数
+
+@return:
+    int : < 0 : 失败， other ： 访问的元素个数
+
+@note:
+    线程安全模式下整个过程持有读锁，visit 中不能修改索引
+*/
+static int dense_index_range(avl_tree_t *tree, int low, int high, bool (*visit)(void *ele, void *arg), void *arg)
+{
+    dense_index_private_t* _this = get_private_member(tree);
+    if(NULL == _this || NULL == visit) return -1;
+
+    int cnt = 0;
+    dense_index_lock_shared(_this);
+    long long end = dense_index_of(_this, high);
+    for(int i = dense_index_next_set(_this, dense_index_of(_this, low)); i >= 0 && i < end; i = dense_index_next_set(_this, (long long)i + 1))
+    {
+        cnt++;
+        if(!visit(_this->m_slots[i], arg))
+            break;
+    }
+    dense_index_unlock(_this);
+    return cnt;
+}
+
+/*
+@func:
+    获取键值小于 key 的元素个数
+
+@para:
+    tree : 索引指针
+    key : 键值
+
+@return:
+    int : < 0 : 失败， other ： 键值小于 key 的元素个数
+
+@note:
+    对位图逐字计数，时间复杂度与键值跨度成正比
+*/
+static int dense_index_rank(avl_tree_t *tree, int key)
+{
+    dense_index_private_t* _this = get_private_member(tree);
+    if(NULL == _this) return -1;
+
+    dense_index_lock_shared(_this);
+    int rank = dense_index_count_below(_this, dense_index_of(_this, key));
+    dense_index_unlock(_this);
+    return rank;
+}
+
+/*
+@func:
+    按键值升序获取第 index 个元素（从 0 开始）
+
+@para:
+    tree : 索引指针
+    index : 元素的排名
+    pos : 输出元素的位置，供 next / prev 使用，不存在时为 NULL，可传 NULL
+
+@return:
+    void* : NULL index 越界， other 查找到的元素
+
+@note:
+    逐字累加位图中的元素个数，定位到所在的字后在字内逐位查找
+*/
+static void* dense_index_select(avl_tree_t *tree, int index, void **pos)
+{
+    dense_index_private_t* _this = get_private_member(tree);
+    if(NULL == _this) return NULL;
+
+    void** slot = NULL;
+    dense_index_lock_shared(_this);
+    if(index >= 0 && index < _this->m_element_cnt)
+    {
+        int word = 0;
+        for(int cnt = __builtin_popcountll(_this->m_bitmap[0]); index >= cnt; cnt = __builtin_popcountll(_this->m_bitmap[++word]))
+            index -= cnt;
+        uint64_t bits = _this->m_bitmap[word];
+        for(; index > 0; --index)
+            bits &= bits - 1;
+        slot = &_this->m_slots[word * DENSE_WORD_BITS + __builtin_ctzll(bits)];
+    }
+    dense_index_unlock(_this);
+
+    if(NULL != pos)
+        *pos = slot;
+    return NULL != slot ? *slot : NULL;
+}
+
+/*
+@func:
+    统计键值在 [low, high) 范围内的元素个数
+
+@para:
+    tree : 索引指针
+    low : 范围下限，包含
+    high : 范围上限，不包含
+
+@return:
+    int : < 0 : 失败， other ： 范围内的元素个数
+*/
+static int dense_index_count_range(avl_tree_t *tree, int low, int high)
+{
+    dense_index_private_t* _this = get_private_member(tree);
+    if(NULL == _this) return -1;
+    if(low >= high) return 0;
+
+    dense_index_lock_shared(_this);
+    int cnt = dense_index_count_below(_this, dense_index_of(_this, high)) - dense_index_count_below(_this, dense_index_of(_this, low));
+    dense_index_unlock(_this);
+    return cnt;
+}
+
+/*
+@func:
+    获取元素的数量
+
+@para:
+    tree : 索引指针
+
+@return:
+    int : 元素的数量
+*/
+static int dense_index_size(avl_tree_t* tree)
+{
+    dense_index_private_t* _this = get_private_member(tree);
+    return _this->m_element_cnt;
+}
+
+/*
+@func:
+    清除全部元素
+
+@para:
+    tree : 索引指针
+
+@return:
+    None.
+
+@note:
+    元素从内存池中申请，清除时整体释放；数组一并释放，下次插入时按新的键值重新确定覆盖范围
+*/
+static void dense_index_clear(avl_tree_t *tree)
+{
+    dense_index_private_t* _this = get_private_member(tree);
+
+    dense_index_lock(_this);
+    if(NULL != tree->pf_free_element)
+    {
+        for(int i = dense_index_next_set(_this, 0); i >= 0; i = dense_index_next_set(_this, (long long)i + 1))
+            tree->pf_free_element(_this->m_slots[i]);
+    }
+    _this->m_pool->clear(_this->m_pool);
+    free(_this->m_slots);
+    free(_this->m_bitmap);
+    _this->m_slots = NULL;
+    _this->m_bitmap = NULL;
+    _this->m_base = 0;
+    _this->m_capacity = 0;
+    _this->m_element_cnt = 0;
+    dense_index_unlock(_this);
+}
+
+/*
+@func:
+    销毁索引
+
+@para:
+    tree : 索引指针
+
+@return:
+    None.
+*/
+static void dense_index_destory(avl_tree_t** tree)
+{
+    avl_tree_t* _this = *tree;
+
+    if(NULL == _this) return;
+
+    if(_this->_private_)
+    {
+        dense_index_clear(_this);
+
+        dense_index_private_t* private_member = get_private_member(_this);
+        private_member->m_pool->destory(&private_member->m_pool);
+        pthread_rwlock_destroy(&private_member->m_tree_lock);
+        free(_this->_private_);
+        _this->_private_ = NULL;
+    }
+
+    free(_this);
+    *tree = NULL;
+}
+
+/*
+@func:
+    创建一个稠密直接映射索引
+
+@para:
+    element_size : 元素的大小，单位字节
+    pf_hash_func ； 从元素获得键值 key 的方法，由用户提供
+    pf_free_element_func ： 若元素不包含额外的动态内存， 此参数可传 NULL
+    thread_safe ： 是否启用线程安全
+
+@return:
+    avl_tree_t* : NULL 失败， other 与平衡二叉树接口相同的索引指针
+*/
+avl_tree_t* dense_index_create(int element_size, int (*pf_hash_func)(void *), int (*pf_free_element_func)(void *), bool thread_safe)
+{
+    if(NULL == pf_hash_func || element_size <= 0)
+        return NULL;
+
+    avl_tree_t *tree = (avl_tree_t *)malloc(sizeof(avl_tree_t));
+    dense_index_private_t *private_member = (dense_index_private_t *)malloc(sizeof(dense_index_private_t));
+    mem_pool_t *pool = mem_pool_create(thread_safe);
+    if(NULL == tree || NULL == private_member || NULL == pool)
+    {
+        free(tree);
+        free(private_member);
+        if(NULL != pool)
+            pool->destory(&pool);
+        return NULL;
+    }
+    memset(tree, 0, sizeof(avl_tree_t));
+    memset(private_member, 0, sizeof(dense_index_private_t));
+
+    private_member->m_pool = pool;
+    private_member->m_element_size = element_size;
+    private_member->m_is_thread_safe = thread_safe;
+
+    pthread_rwlock_init(&private_member->m_tree_lock, NULL);
+
+    tree->_this = tree;
+    tree->_private_ = (void *)private_member;
+
+    tree->pf_hash = pf_hash_func;
+    tree->pf_free_element = pf_free_element_func;
+    tree->add = dense_index_add;
+    tree->add_batch = dense_index_add_batch;
+    tree->build_sorted = dense_index_build_sorted;
+    tree->query_by_key = dense_index_query_by_key;
+    tree->query_batch = dense_index_query_batch;
+    tree->preorder = dense_index_preorder;
+    tree->seek = dense_index_seek;
+    tree->seek_last = dense_index_seek_last;
+    tree->next = dense_index_next;
+    tree->prev = dense_index_prev;
+    tree->range = dense_index_range;
+    tree->rank = dense_index_rank;
+    tree->select = dense_index_select;
+    tree->count_range = dense_index_count_range;
+    tree->size = dense_index_size;
+    tree->del_node_by_key = dense_index_del_by_key;
+    tree->del_node_by_element = dense_index_del_by_element;
+    tree->clear_node = dense_index_clear;
+    tree->destory = dense_index_destory;
+
+    return tree;
+}
@@ -0,0 +1,36 @@
+/*
+** File : DenseIndex.h
+** Author : Saury
+** Date : 2020-09-12
+*/
+
+#ifndef _DENSE_INDEX_H_
+#define _DENSE_INDEX_H_
+
+#include "AVLTree.h"
+
+/*
+    稠密直接映射索引：提供与 avl_tree_t 相同的接口，适用于分布在较小连续范围内的整数键值。
+    键值减去起始键值后直接作为下标访问元素指针数组，另有一个位图记录每个键值是否存在；
+    查找只需一次数组访问，每个键值的索引开销约 8 字节。
+    数组覆盖的键值范围随插入的键值按倍数扩展，内存占用与键值跨度成正比，键值稀疏时不应使用；
+    键值跨度超过元素个数的 8 倍（至少允许 2^20）时插入与构建失败，不会为少量稀疏的键值申请巨大的数组；
+    按键值顺序访问时逐字扫描位图，rank / select / count_range 的时间复杂度与键值跨度成正比
+*/
+
+/*
+@func:
+    创建一个稠密直接映射索引
+
+@para:
+    element_size : 元素的大小，单位字节
+    pf_hash_func ； 从元素获得键值 key 的方法，由用户提供
+    pf_free_element_func ： 若元素不包含额外的动态内存， 此参数可传 NULL
+    thread_safe ： 是否启用线程安全，启用后查询与遍历共享读锁，增删与清除独占写锁
+
+@return:
+    avl_tree_t* : NULL 失败， other 与平衡二叉树接口相同的索引指针
+*/
+extern avl_tree_t* dense_index_create(int element_size, int (*pf_hash_func)(void *), int (*pf_free_element_func)(void *), bool thread_safe);
+
+#endif /* end #ifndef _DENSE_INDEX_H_ */
@@ -1,10 +1,29 @@
+// mremap 需要 GNU 扩展
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <pthread.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 #include "AVLTree.h"
+#include "BPlusTree.h"
+#include "HashIndex.h"
+#include "DenseIndex.h"
+#include "FrozenIndex.h"
+#include "WriteAheadLog.h"
+#include "PageCache.h"
+#include "IoRing.h"
 #include "FileDatabase.h"
+#include "FileDatabaseAsync.h"
 
 // 调试日志开关
 #define DEBUG_LOG 0
@@ -25,30 +44,171 @@
 |  head  |  cnt  |  data  |  ... 
 +--------+-------+--------+
 
+空闲列表模式下每个记录位置前有一个状态标记，cnt 为记录位置的数量（包含空闲位置），
+最高的标志位表示文件使用空闲列表模式：
++--------+-------+-------+--------+-------+--------+
+|  head  |  cnt  |  tag  |  data  |  tag  |  data  |  ...
++--------+-------+-------+--------+-------+--------+
+
+索引文件结构（path.idx）：
++--------------+---------------------------------+
+|  index head  |  按键值排序的 (key, 记录位置)  |  ...
++--------------+---------------------------------+
+
 */
 
+// 第一条记录在文件中的偏移量
+#define FILE_DB_DATA_START(_this) ((off_t)(_this)->m_head_size + (off_t)sizeof(int))
+
+// 内存映射模式下文件每次扩展的默认大小
+#define FILE_DB_MMAP_GROW_SIZE (16L * 1024 * 1024)
+
+// 内存映射模式下预留的最小地址空间，文件在此范围内扩展时映射区不需要迁移
+#define FILE_DB_MMAP_RESERVE_SIZE (1L << 30)
+
+// 索引文件标识
+#define FILE_DB_INDEX_MAGIC "FDBIDX01"
+
+// 前 cnt 个记录位置的末尾，即文件的实际长度
+#define FILE_DB_SLOT_END(_this, cnt) (FILE_DB_DATA_START(_this) + (off_t)(cnt) * (_this)->m_slot_size)
+
+// 指定序号的记录的用户数据在文件中的偏移量
+#define FILE_DB_SLOT_OFFSET(_this, index) (FILE_DB_SLOT_END(_this, index) + (_this)->m_slot_head)
+
+// 用户数据的偏移量对应的记录序号
+#define FILE_DB_SLOT_INDEX(_this, offset) ((int)(((offset) - FILE_DB_DATA_START(_this)) / (_this)->m_slot_size))
+
+// 空闲列表模式下记录位置的状态标记
+#define FILE_DB_SLOT_USED ((int32_t)0x44455355)  // "USED"
+#define FILE_DB_SLOT_FREE ((int32_t)0x45455246)  // "FREE"
+
+// 记录数量中表示空闲列表模式的标志位
+#define FILE_DB_CNT_FREE_LIST ((int)0x40000000)
+
+// 整理时每次复制的最大字节数，每复制一块持有一次读锁
+#define FILE_DB_COMPACT_CHUNK_SIZE (256L * 1024)
+
+// 触发后台整理的默认空闲位置百分比
+#define FILE_DB_COMPACT_RATIO 25
+
+// 后台整理线程检查空闲位置的间隔（秒）
+#define FILE_DB_COMPACT_INTERVAL 1
+
+// FILE_DB_SYNC_INTERVAL 策略下默认的同步间隔（毫秒）
+#define FILE_DB_SYNC_INTERVAL_MS 1000
+
+// 懒加载模式下页缓存的块大小，按整数个记录位置向下取整
+#define FILE_DB_CACHE_BLOCK_SIZE 4096
+
+// 懒加载模式下页缓存的默认大小
+#define FILE_DB_CACHE_SIZE (16L * 1024 * 1024)
+
+// 扫描数据文件时每次读取的最大字节数，也是启动加载时每个线程至少处理的字节数
+#define FILE_DB_LOAD_CHUNK_SIZE (1L * 1024 * 1024)
+
+// 启动加载时最多使用的线程数
+#define FILE_DB_LOAD_MAX_THREADS 32
+
 typedef struct _file_db_private
 {
     char m_path[128];  // 文件路径
+    int m_fd;          // 数据库文件描述符，在 file_db_init 中打开，file_db_free 中关闭
     int m_head_size;   // 文件头大小
     int m_data_size;   // 用户数据大小
-    int m_data_cnt;    // 文件数据库中记录的用户数据的数量
+    int m_data_cnt;    // 文件中记录位置的数量，空闲列表模式下包含空闲的位置
+    int m_slot_head;   // 每个记录位置前状态标记的大小，空闲列表模式下为 sizeof(int32_t)，否则为 0
+    int m_slot_size;   // 每个记录位置的大小
+    void* m_head;      // 文件头的内存副本
+
+    int* m_slot_keys;  // 文件中每个记录位置上保存的元素的键值，删除时用于找到末尾的记录
+    int m_slot_cap;    // m_slot_keys 的容量
+    int* m_free_slots; // 空闲列表模式下空闲的记录位置，容量与 m_slot_keys 相同
+    int m_free_cnt;    // 空闲的记录位置数量
+    bool m_loaded;     // 数据已全部加载，关闭时才能保存索引文件
+
+    file_db_option_t m_option; // 打开选项
+    wal_t* m_wal;              // 预写日志，未启用时为 NULL
+
+    char* m_map;               // 内存映射模式下文件的映射区，未启用时为 NULL
+    size_t m_map_size;         // 映射区的长度，可以超过文件长度
+    off_t m_map_file_size;     // 内存映射模式下文件的实际长度，按 mmap_grow_size 扩展
+    off_t m_dirty_begin;       // 当前操作修改的映射区范围，用于 msync
+    off_t m_dirty_end;
+
+    page_cache_t* m_cache;     // 懒加载模式下用户数据的页缓存，未启用时为 NULL
+    io_ring_t* m_ring;         // io_uring 写入队列，一次修改的写入在提交时一起写入数据文件，未启用时为 NULL
+
+    long long m_version;       // 索引的版本，添加或删除元素时递增，游标据此判断保存的位置是否仍然有效
+    bool m_frozen;             // 索引已冻结为只读索引，键值集合不再变化，只在持有 m_file_db_lock 写锁时修改
+
+    bool m_compacting;         // 正在整理，期间被修改的键值记录在 m_compact_log 中，只在持有 m_file_db_lock 写锁时修改
+    bool m_compact_abort;      // 整理期间数据库被清空或记录修改失败，本次整理作废
+    int* m_compact_log;        // 整理期间被修改的键值，替换文件前据此修正新文件
+    int m_compact_log_cnt;
+    int m_compact_log_cap;
+    pthread_mutex_t m_compact_run_mutex; // 保证同一时间只有一次整理
+    pthread_t m_compact_thread;          // 后台整理线程
+    bool m_compact_started;              // 后台整理线程已启动
+    bool m_compact_stop;                 // 通知后台整理线程退出，由 m_compact_mutex 保护
+    pthread_mutex_t m_compact_mutex;
+    pthread_cond_t m_compact_cond;
+
+    pthread_t m_load_thread;   // 后台加载线程，加载期间一直持有 m_file_db_lock 写锁
+    bool m_load_started;       // 后台加载线程已启动
+    bool m_load_locked;        // 后台加载线程已获取写锁，由 m_load_mutex 保护
+    bool m_loading;            // 正在后台加载，由 m_load_mutex 保护
+    bool m_probe_open;         // 加载期间查询可以直接探测数据文件，加载线程修改数据文件之前关闭，由 m_load_mutex 保护
+    int m_probe_cnt;           // 加载期间正在直接探测数据文件的查询数量，由 m_load_mutex 保护
+    int m_load_res;            // 加载结果，加载线程在持有写锁时写入，失败后拒绝会写入数据文件的操作
+    pthread_mutex_t m_load_mutex;
+    pthread_cond_t m_load_cond; // 加载线程获取写锁、加载结束与探测结束时广播
+
+    file_db_async_t* m_async;  // 异步接口的队列与 I/O 工作线程，未启用时为 NULL
+
+    long long m_write_seq;     // 未启用预写日志时每次提交递增，只在持有 m_file_db_lock 写锁时修改
+    long long m_synced_seq;    // 数据文件已落盘的提交序号，以下四项由 m_sync_mutex 保护
+    bool m_syncing;            // 有调用者正在同步数据文件，其余调用者等待其完成
+    bool m_sync_stop;          // 通知定时同步线程退出
+    bool m_sync_started;       // 定时同步线程已启动
+    pthread_t m_sync_thread;   // FILE_DB_SYNC_INTERVAL 策略下的定时同步线程
+    pthread_mutex_t m_sync_mutex;
+    pthread_cond_t m_sync_cond; // 同步完成或通知退出时广播
 
     int (*pf_get_ele_key)(void *); // 用户获取元素的键值函数指针
-    void (*pf_visit)(void*); // 用户访问元素的函数指针
+    void (*pf_visit)(void*); // 用户访问元素的函数指针，只在持有 m_visit_mutex 时访问
+    pthread_mutex_t m_visit_mutex;   // 并发遍历时保护 pf_visit
 
-    pthread_mutex_t m_file_db_mutex;  // 文件数据库的文件锁
+    pthread_rwlock_t m_file_db_lock;  // 文件数据库的读写锁，查询与遍历共享读锁，修改操作独占写锁
 
     avl_tree_t *m_tree; // avl 树指针
+    int m_record_size;  // 树中每个记录的大小，非内存映射模式下包含内嵌的用户数据，懒加载模式下只包含键值
+    void* m_record_buff; // 添加单个记录时组装记录的缓冲区，只在持有 m_file_db_lock 写锁时访问
 }file_db_private_t;
 
+typedef struct _file_db_index_head
+{
+    char magic[8];          // 索引文件标识
+    int64_t file_size;      // 以下为写入索引时数据文件的版本信息，任一不同说明数据文件已被修改
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    int64_t ino;
+    int32_t head_size;
+    int32_t data_size;
+    int32_t cnt;            // 记录数量
+    uint32_t checksum;      // 索引项的校验值
+}file_db_index_head_t;
+
 typedef struct _file_db_record
 {
-    int offset; // 当前元素在文件中的偏移量
+    off_t offset; // 当前元素在文件中的偏移量
     void *db;   // 当前元素对应的文件数据库指针
-    void *ele;  // 当前元素保存的用户数据，这里才是文件中真正记录的数据
+    char ele[]; // 当前元素保存的用户数据，内嵌在记录中，与树节点在同一块内存；内存映射模式下为空，数据在映射区中；
+                // 懒加载模式下只保存 int 键值，数据通过页缓存读取
 }file_db_record_t;
 
+// 记录数组中指定下标的记录
+#define FILE_DB_RECORD_AT(_this, records, index) ((file_db_record_t*)((char*)(records) + (size_t)(index) * (_this)->m_record_size))
+
 /*
 @func: 
     获取文件数据库的私有成员变量
@@ -75,586 +235,4315 @@ static file_db_private_t* get_private_member(file_db_t* db)
 
 /*
 @func: 
-    获取记录元素的键值
+    在指定偏移量处 写入/读取 完整的数据
 
 @para: 
-    record_ele ： 指定的记录元素
+    fd : 文件描述符
+    buf : 数据缓冲区
+    len : 数据长度
+    offset : 文件偏移量
 
 @return:
-    int : < 0 : 失败， other ： 获取的键值
+    int : < 0 : 失败， 0 ： 成功
 
 @note:
-    本函数最终也是调用用户传入函数获取键值
+    使用 pwrite/pread 定位读写，不改变文件描述符的读写位置，被信号中断或只完成部分读写时会继续完成剩余部分
 */
-static int file_db_get_key(void *record_ele)
+static int file_db_pwrite(int fd, const void* buf, size_t len, off_t offset)
 {
-    if(NULL == record_ele) 
+    const char* p = (const char*)buf;
+    while(len > 0)
     {
-        FILE_DB_LOG_DEBUG("[file_db_get_key]: record_ele null!");
-        return -1;
+        ssize_t n = pwrite(fd, p, len, offset);
+        if(n < 0)
+        {
+            if(EINTR == errno) continue;
+            FILE_DB_LOG_DEBUG("pwrite error, offset %ld, errno %d", (long)offset, errno);
+            return -1;
+        }
+        p += n;
+        offset += n;
+        len -= n;
     }
-    file_db_record_t* record_data = (file_db_record_t*)record_ele;
-    void *ele = record_data->ele;
-    file_db_t* db = (file_db_t*)record_data->db;
-    file_db_private_t* _this = get_private_member(db);
-    if(NULL == _this)
+    return 0;
+}
+
+static int file_db_pread(int fd, void* buf, size_t len, off_t offset)
+{
+    char* p = (char*)buf;
+    while(len > 0)
     {
-        FILE_DB_LOG_DEBUG("[file_db_get_key]: private member null!");
-        return -2;
+        ssize_t n = pread(fd, p, len, offset);
+        if(n < 0)
+        {
+            if(EINTR == errno) continue;
+            FILE_DB_LOG_DEBUG("pread error, offset %ld, errno %d", (long)offset, errno);
+            return -1;
+        }
+        if(0 == n)
+        {
+            FILE_DB_LOG_DEBUG("pread reach end of file, offset %ld", (long)offset);
+            return -2;
+        }
+        p += n;
+        offset += n;
+        len -= n;
     }
-
-    return _this->pf_get_ele_key(ele);
+    return 0;
 }
 
+static int file_db_mmap_reserve(file_db_private_t* _this, off_t length);
+
 /*
 @func: 
-    释放文件数据库指定元素的资源
+    对数据文件的 写入/截断
 
 @para: 
-    record_ele ： 指定的记录元素
+    _this : 私有成员
+    buf : 数据缓冲区
+    len : 数据长度
+    offset : 文件偏移量
 
 @return:
     int : < 0 : 失败， 0 ： 成功
 
 @note:
-    none.
+    预写日志模式下只暂存到当前操作中，由 file_db_commit 提交；内存映射模式下直接拷贝到映射区；
+    否则直接写入数据文件，启用 io_uring 时暂存到写入队列中由 file_db_commit 一起提交；懒加载模式下同时更新页缓存中已缓存的块
 */
-static int file_db_free_ele(void *record_ele)
+static int file_db_write(file_db_private_t* _this, const void* buf, int len, off_t offset)
+{
+    if(NULL != _this->m_wal)
+        return _this->m_wal->write(_this->m_wal->_this, buf, len, offset);
+
+    if(NULL != _this->m_map)
+    {
+        if(0 != file_db_mmap_reserve(_this, offset + len))
+            return -1;
+        memmove(_this->m_map + offset, buf, len);
+        if(_this->m_dirty_end <= _this->m_dirty_begin)
+        {
+            _this->m_dirty_begin = offset;
+            _this->m_dirty_end = offset + len;
+        }
+        else
+        {
+            _this->m_dirty_begin = offset < _this->m_dirty_begin ? offset : _this->m_dirty_begin;
+            _this->m_dirty_end = offset + len > _this->m_dirty_end ? offset + len : _this->m_dirty_end;
+        }
+        return 0;
+    }
+
+    if(NULL != _this->m_ring)
+    {
+        if(0 != _this->m_ring->write(_this->m_ring->_this, buf, len, offset))
+            return -1;
+    }
+    else if(0 != file_db_pwrite(_this->m_fd, buf, len, offset))
+    {
+        return -1;
+    }
+    if(NULL != _this->m_cache)
+        _this->m_cache->update(_this->m_cache->_this, buf, len, offset);
+    return 0;
+}
+
+static int file_db_truncate(file_db_private_t* _this, off_t length)
 {
-    if(NULL == record_ele) return -1;
-    free(((file_db_record_t*)record_ele)->ele);
+    if(NULL != _this->m_wal)
+        return _this->m_wal->truncate(_this->m_wal->_this, length);
+
+    // 内存映射模式下文件按块扩展，关闭时才截断到实际长度
+    if(NULL != _this->m_map)
+        return 0;
+
+    // 截断之前的写入需先落到文件中
+    if(NULL != _this->m_ring && 0 != _this->m_ring->flush(_this->m_ring->_this))
+        return -1;
+    if(0 != ftruncate(_this->m_fd, length))
+    {
+        FILE_DB_LOG_DEBUG("truncate error, length %ld", (long)length);
+        return -1;
+    }
     return 0;
 }
 
 /*
 @func: 
-    在 avl 树中遍历每个元素需要执行的操作函数
+    提交 / 回滚 / 同步 当前操作对数据文件的修改
 
 @para: 
-    record_ele : avl 树记录的节点元素
+    _this : 私有成员
+    length : 回滚时数据文件恢复到的长度，< 0 表示不需要截断
+    lsn : file_db_commit 返回的日志序号
 
 @return:
-    none.
+    file_db_commit : < 0 : 失败， other ： 日志序号，未启用预写日志时 FILE_DB_SYNC_GROUP 策略下为提交序号，其他策略下为 0
+    file_db_sync : < 0 : 失败， 0 ： 成功
 
 @note:
-    此函数对内部数据稍作处理，然后使用用户传入的访问函数来处理用户元素
+    file_db_commit / file_db_rollback 需在持有 m_file_db_lock 写锁时调用，
+    file_db_sync 应在释放锁之后调用，以便并发的修改合并为一次落盘；
+    FILE_DB_SYNC_EVERY 策略下在 commit 中同步，修改已经写入文件或映射区，同步失败不撤销修改，commit 返回 1 由 file_db_sync 报告错误
 */
-static void file_db_visit_record(void* record_ele)
+static long long file_db_commit(file_db_private_t* _this)
 {
-    if(NULL == record_ele) 
+    if(NULL != _this->m_wal)
+        return _this->m_wal->commit(_this->m_wal->_this);
+
+    if(NULL != _this->m_ring && 0 != _this->m_ring->flush(_this->m_ring->_this))
     {
-        FILE_DB_LOG_DEBUG("[file_db_visit]: record_ele null!");
+        FILE_DB_LOG_DEBUG("io ring flush error");
+        return -1;
+    }
+
+    _this->m_write_seq++;
+    int res = 0;
+    if(NULL != _this->m_map && _this->m_dirty_end > _this->m_dirty_begin)
+    {
+        if(FILE_DB_SYNC_EVERY == _this->m_option.sync)
+        {
+            // msync 要求起始地址按页对齐
+            off_t page = sysconf(_SC_PAGESIZE);
+            off_t begin = _this->m_dirty_begin / page * page;
+            res = msync(_this->m_map + begin, _this->m_dirty_end - begin, MS_SYNC);
+        }
+        _this->m_dirty_begin = _this->m_dirty_end = 0;
+    }
+    else if(NULL == _this->m_map && FILE_DB_SYNC_EVERY == _this->m_option.sync)
+    {
+        res = fdatasync(_this->m_fd);
+    }
+    if(0 != res)
+    {
+        FILE_DB_LOG_DEBUG("sync error, errno %d", errno);
+        return 1;
+    }
+
+    return FILE_DB_SYNC_GROUP == _this->m_option.sync ? _this->m_write_seq : 0;
+}
+
+static void file_db_rollback(file_db_private_t* _this, off_t length)
+{
+    if(NULL != _this->m_wal)
+    {
+        _this->m_wal->rollback(_this->m_wal->_this);
         return;
     }
-    file_db_record_t* record_data = (file_db_record_t*)record_ele;
-    void *ele = record_data->ele;
-    file_db_t* db = (file_db_t*)record_data->db;
-    file_db_private_t* _this = get_private_member(db);
-    if(NULL == _this)
+
+    // 映射区中已修改的内容无法撤销，只清除待同步的范围
+    if(NULL != _this->m_map)
     {
-        FILE_DB_LOG_DEBUG("[file_db_visit]: private member null!");
+        _this->m_dirty_begin = _this->m_dirty_end = 0;
         return;
     }
-    _this->pf_visit(ele);
+
+    if(NULL != _this->m_ring)
+    {
+        // 页缓存在暂存时已经更新，丢弃的写入可能没有落到文件中，缓存的块需从文件重新读取
+        _this->m_ring->discard(_this->m_ring->_this);
+        if(NULL != _this->m_cache)
+            _this->m_cache->reset(_this->m_cache->_this, _this->m_fd);
+    }
+    if(length >= 0 && 0 != ftruncate(_this->m_fd, length))
+        FILE_DB_LOG_DEBUG("rollback truncate error");
+}
+
+static int file_db_sync_data(file_db_private_t* _this, long long seq);
+
+static int file_db_sync(file_db_private_t* _this, long long lsn)
+{
+    if(NULL != _this->m_wal)
+        return _this->m_wal->sync(_this->m_wal->_this, lsn);
+
+    if(FILE_DB_SYNC_GROUP == _this->m_option.sync && lsn > 0)
+        return file_db_sync_data(_this, lsn);
+    return 0 == lsn ? 0 : -1;
 }
 
 /*
 @func: 
-    添加元素到文件数据库中
+    未启用预写日志时等待指定序号的提交落盘
 
 @para: 
-    db : 文件数据库指针
-    ele : 要被添加的元素指针
+    _this : 私有成员
+    seq : file_db_commit 返回的提交序号
 
 @return:
     int : < 0 : 失败， 0 ： 成功
 
 @note:
-    ele 传入的建议是非指针变量的地址，如果使用的是指向动态内存的指针，则用完后需自行释放资源
+    第一个发现未落盘的调用者成为领导者，在读锁内复制文件描述符并取得当前的提交序号，释放读锁后 fdatasync，
+    期间其他修改可以继续提交；其余调用者等待领导者完成，若自己的提交不在本批次中则成为下一批次的领导者。
+    整理替换数据文件前新文件已经 fsync，复制的描述符指向旧文件时同步结果仍然有效；
+    内存映射模式下 fdatasync 同样写回映射区中被修改的页
 */
-static int file_db_add(file_db_t* db, void* ele)
+static int file_db_sync_data(file_db_private_t* _this, long long seq)
 {
-    file_db_private_t* _this = get_private_member(db);
-    if(NULL == _this) 
-        return -4;
+    int res_code = 0;
+    pthread_mutex_lock(&_this->m_sync_mutex);
+    while(_this->m_synced_seq < seq)
+    {
+        if(_this->m_syncing)
+        {
+            pthread_cond_wait(&_this->m_sync_cond, &_this->m_sync_mutex);
+            continue;
+        }
+        _this->m_syncing = true;
+        pthread_mutex_unlock(&_this->m_sync_mutex);
+
+        pthread_rwlock_rdlock(&_this->m_file_db_lock);
+        long long target = _this->m_write_seq;
+        int fd = dup(_this->m_fd);
+        pthread_rwlock_unlock(&_this->m_file_db_lock);
+        int res = fd >= 0 ? fdatasync(fd) : -1;
+        if(fd >= 0)
+            close(fd);
+
+        pthread_mutex_lock(&_this->m_sync_mutex);
+        _this->m_syncing = false;
+        if(0 == res && target > _this->m_synced_seq)
+            _this->m_synced_seq = target;
+        pthread_cond_broadcast(&_this->m_sync_cond);
+        if(0 != res)
+        {
+            FILE_DB_LOG_DEBUG("sync data error, errno %d", errno);
+            res_code = -1;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&_this->m_sync_mutex);
+    return res_code;
+}
 
-    if(NULL != _this->m_tree->query_by_key(_this->m_tree->_this, _this->pf_get_ele_key(ele)))
-        return -5;
+/*
+@func: 
+    FILE_DB_SYNC_INTERVAL 策略下的定时同步线程，每 sync_interval 毫秒把已提交的修改落盘
 
-    int res_code = 0;
-    file_db_record_t* record_data = (file_db_record_t*)malloc(sizeof(file_db_record_t));
-    void* ele_memory = malloc(_this->m_data_size);
-    memcpy(ele_memory, ele, _this->m_data_size);
+@para: 
+    arg : 私有成员
+
+@return:
+    None.
+
+@note:
+    预写日志模式下同步日志，否则同步数据文件；两次同步之间没有新的提交时跳过
+*/
+static void* file_db_sync_thread(void* arg)
+{
+    file_db_private_t* _this = (file_db_private_t*)arg;
+    long interval = _this->m_option.sync_interval > 0 ? _this->m_option.sync_interval : FILE_DB_SYNC_INTERVAL_MS;
 
-    pthread_mutex_lock(&_this->m_file_db_mutex);
-    FILE *db_fp = fopen(_this->m_path, "rb+");
-    if(NULL == db_fp) 
+    pthread_mutex_lock(&_this->m_sync_mutex);
+    while(!_this->m_sync_stop)
     {
-        FILE_DB_LOG_DEBUG("open db file error");
-        res_code = -6;
-        goto RUNTIME_ERROR;
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_sec += interval / 1000;
+        ts.tv_nsec += (interval % 1000) * 1000000L;
+        if(ts.tv_nsec >= 1000000000L)
+        {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&_this->m_sync_cond, &_this->m_sync_mutex, &ts);
+        if(_this->m_sync_stop) break;
+        pthread_mutex_unlock(&_this->m_sync_mutex);
+
+        if(NULL != _this->m_wal)
+        {
+            if(0 != _this->m_wal->sync_all(_this->m_wal->_this))
+                FILE_DB_LOG_DEBUG("interval sync wal error");
+        }
+        else
+        {
+            pthread_rwlock_rdlock(&_this->m_file_db_lock);
+            long long seq = _this->m_write_seq;
+            pthread_rwlock_unlock(&_this->m_file_db_lock);
+            if(0 != file_db_sync_data(_this, seq))
+                FILE_DB_LOG_DEBUG("interval sync data error");
+        }
+
+        pthread_mutex_lock(&_this->m_sync_mutex);
     }
-    fseek(db_fp, 0, SEEK_END);
-    record_data->offset = ftell(db_fp);
-    record_data->db = db;
-    int write_len = fwrite(ele_memory, _this->m_data_size, 1, db_fp);
-    if(write_len != 1) 
+    pthread_mutex_unlock(&_this->m_sync_mutex);
+    return NULL;
+}
+
+/*
+@func: 
+    停止定时同步线程
+
+@para: 
+    _this : 私有成员
+
+@return:
+    None.
+*/
+static void file_db_sync_stop(file_db_private_t* _this)
+{
+    if(!_this->m_sync_started) return;
+
+    pthread_mutex_lock(&_this->m_sync_mutex);
+    _this->m_sync_stop = true;
+    pthread_cond_broadcast(&_this->m_sync_cond);
+    pthread_mutex_unlock(&_this->m_sync_mutex);
+    pthread_join(_this->m_sync_thread, NULL);
+    _this->m_sync_started = false;
+}
+
+/*
+@func: 
+    内存映射模式下确保文件与映射区至少有 length 字节
+
+@para: 
+    _this : 私有成员
+    length : 需要的文件长度
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    文件按 mmap_grow_size 整块扩展；映射区预留了足够的地址空间，一般只需要扩展文件，
+    超出预留范围时才使用 mremap 扩大映射区，此时映射区可能被迁移
+*/
+static int file_db_mmap_reserve(file_db_private_t* _this, off_t length)
+{
+    if(length <= _this->m_map_file_size) return 0;
+
+    off_t grow = _this->m_option.mmap_grow_size > 0 ? _this->m_option.mmap_grow_size : FILE_DB_MMAP_GROW_SIZE;
+    off_t new_size = (length + grow - 1) / grow * grow;
+
+    if((size_t)new_size > _this->m_map_size)
     {
-        FILE_DB_LOG_DEBUG("write ele error, write[%d] but [%d]", _this->m_data_size, write_len);
-        fclose(db_fp);
-        res_code = -7;
-        goto RUNTIME_ERROR;
+        size_t map_size = _this->m_map_size;
+        while(map_size < (size_t)new_size)
+            map_size *= 2;
+
+        void* map = mremap(_this->m_map, _this->m_map_size, map_size, MREMAP_MAYMOVE);
+        if(MAP_FAILED == map)
+        {
+            FILE_DB_LOG_DEBUG("mremap error, errno %d", errno);
+            return -1;
+        }
+        _this->m_map = (char*)map;
+        _this->m_map_size = map_size;
     }
-    _this->m_data_cnt++;
-    FILE_DB_LOG_DEBUG("Write cnt %d, key %d", _this->m_data_cnt, _this->pf_get_ele_key(ele));
-    fseek(db_fp, _this->m_head_size, SEEK_SET);
-    write_len = fwrite(&_this->m_data_cnt, sizeof(int), 1, db_fp);
-    if(write_len != 1)
+
+    if(0 != ftruncate(_this->m_fd, new_size))
     {
-        FILE_DB_LOG_DEBUG("write cnt error");
-        _this->m_data_cnt--;
-        fclose(db_fp);
-        truncate(_this->m_path, record_data->offset);
-        res_code = -8;
-        goto RUNTIME_ERROR;
+        FILE_DB_LOG_DEBUG("grow file error, errno %d", errno);
+        return -2;
     }
-    fflush(db_fp);
-    fclose(db_fp);
-    record_data->ele = ele_memory;
-    pthread_mutex_unlock(&_this->m_file_db_mutex);
-    return _this->m_tree->add(_this->m_tree->_this, (void *)record_data);
-
-RUNTIME_ERROR:
-    free(ele_memory);
-    free(record_data);
-    pthread_mutex_unlock(&_this->m_file_db_mutex);
-    return res_code;
+    _this->m_map_file_size = new_size;
+    return 0;
 }
 
 /*
 @func: 
-    通过键值删除指定键值对应的元素
+    内存映射模式下映射数据文件
 
 @para: 
-    db : 文件数据库指针
-    key : 元素对应的键值
+    _this : 私有成员
 
 @return:
     int : < 0 : 失败， 0 ： 成功
 
 @note:
-    none.
+    映射区预留文件长度两倍与 FILE_DB_MMAP_RESERVE_SIZE 中较大的地址空间，超出文件长度的部分不会访问
 */
-static int file_db_del(file_db_t* db, int key)
+static int file_db_mmap_open(file_db_private_t* _this)
 {
-    file_db_private_t* _this = get_private_member(db);
-
-    if(NULL == _this) 
+    struct stat st;
+    if(0 != fstat(_this->m_fd, &st))
+        return -1;
+    if(st.st_size < FILE_DB_SLOT_END(_this, _this->m_data_cnt))
     {
-        FILE_DB_LOG_DEBUG("Filedatabase error!");
+        FILE_DB_LOG_DEBUG("db file too short, size %ld", (long)st.st_size);
         return -2;
     }
-    file_db_record_t* record_data = _this->m_tree->query_by_key(_this->m_tree->_this, key);
 
-    if(NULL == record_data)
+    size_t map_size = FILE_DB_MMAP_RESERVE_SIZE;
+    while(map_size < (size_t)st.st_size * 2)
+        map_size *= 2;
+
+    void* map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, _this->m_fd, 0);
+    if(MAP_FAILED == map)
     {
-        FILE_DB_LOG_DEBUG("No such element. Del fail!");
+        FILE_DB_LOG_DEBUG("mmap error, errno %d", errno);
         return -3;
     }
 
-    pthread_mutex_lock(&_this->m_file_db_mutex);
-    FILE* db_fp = fopen(_this->m_path, "rb+");
-    if(NULL == db_fp)
-    {
-        pthread_mutex_unlock(&_this->m_file_db_mutex);
-        return -4;
-    }
+    _this->m_map = (char*)map;
+    _this->m_map_size = map_size;
+    _this->m_map_file_size = st.st_size;
+    return 0;
+}
 
-    if(record_data->offset < _this->m_head_size + sizeof(int) + _this->m_data_size * (_this->m_data_cnt - 1))
-    {
-        fseek(db_fp, 0, SEEK_END);
-        
-        fseek(db_fp, -_this->m_data_size, SEEK_END);
-       
-        void* buff = malloc(_this->m_data_size);
-        
-        if(1 != fread(buff, _this->m_data_size, 1, db_fp))
-        {
-            FILE_DB_LOG_DEBUG("Read tail element error! file position %ld", ftell(db_fp));
-            free(buff);
-            fclose(db_fp);
-            pthread_mutex_unlock(&_this->m_file_db_mutex);
-            return -5;
-        }
+/*
+@func: 
+    获取记录对应的用户数据
 
-        fseek(db_fp, record_data->offset, SEEK_SET);
+@para: 
+    _this : 私有成员
+    record_data : 记录
 
-        if(1 != fwrite(buff, _this->m_data_size, 1, db_fp))
-        {
-            FILE_DB_LOG_DEBUG("Write tail element error!");
+@return:
+    void* : 用户数据的指针
 
-            free(buff);
-            fclose(db_fp);
-            pthread_mutex_unlock(&_this->m_file_db_mutex);
-            return -6;
-        }
+@note:
+    内存映射模式下用户数据在映射区中，其他模式下内嵌在记录中
+*/
+static void* file_db_record_ele(file_db_private_t* _this, file_db_record_t* record_data)
+{
+    if(NULL != _this->m_map)
+        return _this->m_map + record_data->offset;
 
-        free(buff);
-    }
-    _this->m_data_cnt--;
-    fseek(db_fp, _this->m_head_size, SEEK_SET);
-    int write_len = fwrite(&_this->m_data_cnt, sizeof(int), 1, db_fp);
-    if(write_len != 1)
-    {
-        FILE_DB_LOG_DEBUG("write cnt error");
-        _this->m_data_cnt++;
-        fclose(db_fp);
-        pthread_mutex_unlock(&_this->m_file_db_mutex);
-        return -7;
-    }
+    return record_data->ele;
+}
+
+/*
+@func: 
+    获取 / 释放 记录对应的用户数据
+
+@para: 
+    _this : 私有成员
+    record_data : 记录
+    ele : file_db_record_acquire 返回的指针
+
+@return:
+    void* : NULL 失败， other 用户数据的指针
+
+@note:
+    懒加载模式下从页缓存读取并固定所在的块，用完后需调用 file_db_record_release；
+    其他模式下与 file_db_record_ele 相同，释放时不需要处理
+*/
+static void* file_db_record_acquire(file_db_private_t* _this, file_db_record_t* record_data)
+{
+    // 未命中时页缓存从文件读取，修改中暂存的写入需先落到文件中
+    if(NULL != _this->m_cache && NULL != _this->m_ring && _this->m_ring->pending(_this->m_ring->_this) > 0
+        && 0 != _this->m_ring->flush(_this->m_ring->_this))
+        return NULL;
+    if(NULL != _this->m_cache)
+        return _this->m_cache->pin(_this->m_cache->_this, record_data->offset);
 
-    fclose(db_fp);
-    truncate(_this->m_path, _this->m_head_size + sizeof(int) + _this->m_data_cnt * _this->m_data_size );
-    pthread_mutex_unlock(&_this->m_file_db_mutex);
+    return file_db_record_ele(_this, record_data);
+}
+
+static void file_db_record_release(file_db_private_t* _this, const void* ele)
+{
+    if(NULL != _this->m_cache)
+        _this->m_cache->unpin(_this->m_cache->_this, ele);
+}
 
-    return _this->m_tree->del_node_by_key(_this->m_tree->_this, key);
+/*
+@func: 
+    把用户数据保存到记录中
+
+@para: 
+    _this : 私有成员
+    record_data : 记录
+    ele : 用户数据
+
+@return:
+    none.
+
+@note:
+    懒加载模式下只保存键值；内存映射模式下数据在映射区中，不需要保存
+*/
+static void file_db_record_store(file_db_private_t* _this, file_db_record_t* record_data, void* ele)
+{
+    if(_this->m_option.lazy)
+    {
+        int key = _this->pf_get_ele_key(ele);
+        memcpy(record_data->ele, &key, sizeof(int));
+    }
+    else if(NULL == _this->m_map)
+    {
+        memcpy(record_data->ele, ele, _this->m_data_size);
+    }
+}
+
+/*
+@func: 
+    确保 m_slot_keys 与 m_free_slots 能容纳 cnt 个记录位置
+
+@para: 
+    _this : 私有成员
+    cnt : 记录位置数量
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    空闲的位置不会多于记录位置，m_free_slots 与 m_slot_keys 容量相同，压入空闲位置时不需要再申请内存
+*/
+static int file_db_slot_reserve(file_db_private_t* _this, int cnt)
+{
+    if(cnt <= _this->m_slot_cap) return 0;
+
+    int new_cap = _this->m_slot_cap > 0 ? _this->m_slot_cap : 64;
+    while(new_cap < cnt)
+        new_cap *= 2;
+
+    int* keys = (int*)realloc(_this->m_slot_keys, sizeof(int) * new_cap);
+    if(NULL == keys) return -1;
+    _this->m_slot_keys = keys;
+
+    if(_this->m_option.free_list)
+    {
+        int* free_slots = (int*)realloc(_this->m_free_slots, sizeof(int) * new_cap);
+        if(NULL == free_slots) return -1;
+        _this->m_free_slots = free_slots;
+    }
+
+    _this->m_slot_cap = new_cap;
+    return 0;
+}
+
+/*
+@func: 
+    获取记录元素的键值
+
+@para: 
+    record_ele ： 指定的记录元素
+
+@return:
+    int : < 0 : 失败， other ： 获取的键值
+
+@note:
+    本函数最终也是调用用户传入函数获取键值
+*/
+static int file_db_get_key(void *record_ele)
+{
+    if(NULL == record_ele) 
+    {
+        FILE_DB_LOG_DEBUG("[file_db_get_key]: record_ele null!");
+        return -1;
+    }
+    file_db_record_t* record_data = (file_db_record_t*)record_ele;
+    file_db_t* db = (file_db_t*)record_data->db;
+    file_db_private_t* _this = get_private_member(db);
+    if(NULL == _this)
+    {
+        FILE_DB_LOG_DEBUG("[file_db_get_key]: private member null!");
+        return -2;
+    }
+
+    // 懒加载模式下键值保存在记录中，不需要读取用户数据
+    if(_this->m_option.lazy)
+    {
+        int key;
+        memcpy(&key, record_data->ele, sizeof(int));
+        return key;
+    }
+
+    return _this->pf_get_ele_key(file_db_record_ele(_this, record_data));
+}
+
+/*
+@func: 
+    在 avl 树中遍历每个元素需要执行的操作函数
+
+@para: 
+    record_ele : avl 树记录的节点元素
+
+@return:
+    none.
+
+@note:
+    此函数对内部数据稍作处理，然后使用用户传入的访问函数来处理用户元素
+*/
+static void file_db_visit_record(void* record_ele)
+{
+    if(NULL == record_ele) 
+    {
+        FILE_DB_LOG_DEBUG("[file_db_visit]: record_ele null!");
+        return;
+    }
+    file_db_record_t* record_data = (file_db_record_t*)record_ele;
+    file_db_t* db = (file_db_t*)record_data->db;
+    file_db_private_t* _this = get_private_member(db);
+    if(NULL == _this)
+    {
+        FILE_DB_LOG_DEBUG("[file_db_visit]: private member null!");
+        return;
+    }
+    void* ele = file_db_record_acquire(_this, record_data);
+    if(NULL == ele)
+    {
+        FILE_DB_LOG_DEBUG("[file_db_visit]: read element error!");
+        return;
+    }
+    _this->pf_visit(ele);
+    file_db_record_release(_this, ele);
+}
+
+/*
+@func: 
+    用文件末尾的记录填补被删除的位置
+
+@para: 
+    _this : 私有成员
+    offset : 被删除记录在文件中的偏移量
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    末尾记录的数据直接取自内存，不需要读文件，被移动记录在内存中的偏移量会同步更新；
+    成功后 m_data_cnt 减一，但不写入记录数量，需随后调用 file_db_write_cnt。需在持有 m_file_db_lock 写锁时调用
+*/
+static int file_db_fill_slot(file_db_private_t* _this, off_t offset)
+{
+    int slot = FILE_DB_SLOT_INDEX(_this, offset);
+    int last = _this->m_data_cnt - 1;
+    off_t tail_offset = FILE_DB_SLOT_OFFSET(_this, last);
+
+    if(slot < last)
+    {
+        file_db_record_t* tail_record = _this->m_tree->query_by_key(_this->m_tree->_this, _this->m_slot_keys[last]);
+        if(NULL == tail_record || tail_record->offset != tail_offset)
+        {
+            FILE_DB_LOG_DEBUG("Tail element not found! file position %ld", (long)tail_offset);
+            return -5;
+        }
+
+        void* tail_ele = file_db_record_acquire(_this, tail_record);
+        int res = NULL != tail_ele ? file_db_write(_this, tail_ele, _this->m_data_size, offset) : -1;
+        file_db_record_release(_this, tail_ele);
+        if(0 != res)
+        {
+            FILE_DB_LOG_DEBUG("Write tail element error!");
+            return -6;
+        }
+
+        // 末尾记录已移动到被删除的位置，同步更新其在内存中的偏移量
+        tail_record->offset = offset;
+        _this->m_slot_keys[slot] = _this->m_slot_keys[last];
+    }
+
+    _this->m_data_cnt--;
+    return 0;
+}
+
+/*
+@func: 
+    写入记录数量 / 写入记录数量并把文件截断到最后一条记录的末尾
+
+@para: 
+    _this : 私有成员
+    cnt : 记录位置的数量
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    空闲列表模式下记录数量带有 FILE_DB_CNT_FREE_LIST 标志位。需在持有 m_file_db_lock 写锁时调用
+*/
+static int file_db_store_cnt(file_db_private_t* _this, int cnt)
+{
+    if(_this->m_option.free_list)
+        cnt |= FILE_DB_CNT_FREE_LIST;
+    return file_db_write(_this, &cnt, sizeof(int), _this->m_head_size);
+}
+
+static int file_db_write_cnt(file_db_private_t* _this)
+{
+    if(0 != file_db_store_cnt(_this, _this->m_data_cnt)
+        || 0 != file_db_truncate(_this, FILE_DB_SLOT_END(_this, _this->m_data_cnt)))
+    {
+        FILE_DB_LOG_DEBUG("write cnt error");
+        return -7;
+    }
+    return 0;
+}
+
+/*
+@func: 
+    空闲列表模式下写入记录位置的状态标记
+
+@para: 
+    _this : 私有成员
+    slot : 记录位置
+    tag : FILE_DB_SLOT_USED / FILE_DB_SLOT_FREE
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    未启用空闲列表模式时没有状态标记，直接返回成功
+*/
+static int file_db_write_tag(file_db_private_t* _this, int slot, int32_t tag)
+{
+    if(!_this->m_option.free_list)
+        return 0;
+    return file_db_write(_this, &tag, sizeof(int32_t), FILE_DB_SLOT_END(_this, slot));
+}
+
+/*
+@func: 
+    空闲列表模式下把记录位置标记为空闲，供之后添加的元素复用
+
+@para: 
+    _this : 私有成员
+    offset : 被删除记录在文件中的偏移量
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    只写入一个状态标记，不移动记录也不修改记录数量。需在持有 m_file_db_lock 写锁时调用
+*/
+static int file_db_free_slot(file_db_private_t* _this, off_t offset)
+{
+    int slot = FILE_DB_SLOT_INDEX(_this, offset);
+    if(0 != file_db_write_tag(_this, slot, FILE_DB_SLOT_FREE))
+    {
+        FILE_DB_LOG_DEBUG("write free tag error, slot %d", slot);
+        return -6;
+    }
+    _this->m_free_slots[_this->m_free_cnt++] = slot;
+    return 0;
+}
+
+/*
+@func: 
+    撤销 file_db_free_slot / file_db_fill_slot 对内存状态的修改
+
+@para: 
+    _this : 私有成员
+    slot : 被删除记录的位置
+    key : 被删除记录的键值
+
+@return:
+    none.
+
+@note:
+    提交失败时调用，多次删除需按相反的顺序撤销；文件中的修改由 file_db_rollback 丢弃。需在持有 m_file_db_lock 写锁时调用
+*/
+static void file_db_restore_slot(file_db_private_t* _this, int slot, int key)
+{
+    if(_this->m_option.free_list)
+    {
+        _this->m_free_cnt--;
+        return;
+    }
+
+    int last = _this->m_data_cnt++;
+    if(slot < last)
+    {
+        // 被移动到该位置的末尾记录恢复原来的偏移量
+        file_db_record_t* tail_record = _this->m_tree->query_by_key(_this->m_tree->_this, _this->m_slot_keys[slot]);
+        if(NULL != tail_record)
+            tail_record->offset = FILE_DB_SLOT_OFFSET(_this, last);
+        _this->m_slot_keys[slot] = key;
+    }
+}
+
+/*
+@func: 
+    删除文件中指定位置的记录
+
+@para: 
+    _this : 私有成员
+    offset : 被删除记录在文件中的偏移量
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    空闲列表模式下只把位置标记为空闲，否则用末尾的记录填补。需在持有 m_file_db_lock 写锁时调用，之后需调用 file_db_commit
+*/
+static int file_db_remove_slot(file_db_private_t* _this, off_t offset)
+{
+    if(_this->m_option.free_list)
+    {
+        int res = file_db_free_slot(_this, offset);
+        if(0 != res)
+            file_db_rollback(_this, -1);
+        return res;
+    }
+
+    int slot = FILE_DB_SLOT_INDEX(_this, offset);
+    int key = _this->m_slot_keys[slot];
+    int res = file_db_fill_slot(_this, offset);
+    if(0 == res)
+    {
+        res = file_db_write_cnt(_this);
+        if(0 != res)
+            file_db_restore_slot(_this, slot, key);
+    }
+
+    if(0 != res)
+        file_db_rollback(_this, -1);
+    return res;
+}
+
+/*
+@func: 
+    整理期间记录被修改的键值
+
+@para: 
+    _this : 私有成员
+    key : 被添加、删除或编辑的元素的键值
+
+@return:
+    none.
+
+@note:
+    未在整理时直接返回；内存不足时作废本次整理。需在持有 m_file_db_lock 写锁时调用
+*/
+static void file_db_compact_log(file_db_private_t* _this, int key)
+{
+    if(!_this->m_compacting) return;
+
+    if(_this->m_compact_log_cnt == _this->m_compact_log_cap)
+    {
+        int new_cap = _this->m_compact_log_cap > 0 ? _this->m_compact_log_cap * 2 : 256;
+        int* log = (int*)realloc(_this->m_compact_log, sizeof(int) * new_cap);
+        if(NULL == log)
+        {
+            _this->m_compact_abort = true;
+            return;
+        }
+        _this->m_compact_log = log;
+        _this->m_compact_log_cap = new_cap;
+    }
+    _this->m_compact_log[_this->m_compact_log_cnt++] = key;
+}
+
+static long long file_db_remove_orphans(file_db_private_t* _this, int* slots, int cnt);
+
+/*
+@func: 
+    添加元素到文件数据库中
+
+@para: 
+    db : 文件数据库指针
+    ele : 要被添加的元素指针
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    ele 传入的建议是非指针变量的地址，如果使用的是指向动态内存的指针，则用完后需自行释放资源
+*/
+static int file_db_add(file_db_t* db, void* ele)
+{
+    file_db_private_t* _this = get_private_member(db);
+    if(NULL == _this) 
+        return -4;
+
+    int key = _this->pf_get_ele_key(ele);
+    int res_code = 0;
+
+    pthread_rwlock_wrlock(&_this->m_file_db_lock);
+    // avl 树会把记录连同内嵌的用户数据拷贝到节点中，这里在缓冲区中组装即可
+    file_db_record_t* record_data = (file_db_record_t*)_this->m_record_buff;
+    if(0 != _this->m_load_res)
+    {
+        res_code = -11;
+        goto RUNTIME_ERROR;
+    }
+    if(_this->m_frozen)
+    {
+        res_code = -10;
+        goto RUNTIME_ERROR;
+    }
+    if(NULL != _this->m_tree->query_by_key(_this->m_tree->_this, key))
+    {
+        res_code = -5;
+        goto RUNTIME_ERROR;
+    }
+    // 空闲列表模式下优先复用被删除的位置，复用时不需要修改记录数量，失败时也不需要截断文件
+    bool reuse = _this->m_free_cnt > 0;
+    int slot = reuse ? _this->m_free_slots[_this->m_free_cnt - 1] : _this->m_data_cnt;
+    off_t rollback_length = reuse ? -1 : FILE_DB_SLOT_END(_this, slot);
+    record_data->offset = FILE_DB_SLOT_OFFSET(_this, slot);
+    record_data->db = db;
+    if(0 != file_db_slot_reserve(_this, _this->m_data_cnt + 1))
+    {
+        res_code = -6;
+        goto RUNTIME_ERROR;
+    }
+    // 先写数据再写状态标记，标记写入前异常退出时该位置仍为空闲
+    if(0 != file_db_write(_this, ele, _this->m_data_size, record_data->offset)
+        || 0 != file_db_write_tag(_this, slot, FILE_DB_SLOT_USED))
+    {
+        FILE_DB_LOG_DEBUG("write ele error, offset %ld", (long)record_data->offset);
+        file_db_rollback(_this, rollback_length);
+        res_code = -7;
+        goto RUNTIME_ERROR;
+    }
+    if(!reuse)
+    {
+        _this->m_data_cnt++;
+        FILE_DB_LOG_DEBUG("Write cnt %d, key %d", _this->m_data_cnt, key);
+        if(0 != file_db_store_cnt(_this, _this->m_data_cnt))
+        {
+            FILE_DB_LOG_DEBUG("write cnt error");
+            _this->m_data_cnt--;
+            file_db_rollback(_this, rollback_length);
+            res_code = -8;
+            goto RUNTIME_ERROR;
+        }
+    }
+    long long lsn = file_db_commit(_this);
+    if(lsn < 0)
+    {
+        if(!reuse)
+            _this->m_data_cnt--;
+        file_db_rollback(_this, rollback_length);
+        res_code = -8;
+        goto RUNTIME_ERROR;
+    }
+    if(reuse)
+        _this->m_free_cnt--;
+    _this->m_slot_keys[slot] = key;
+    file_db_record_store(_this, record_data, ele);
+    if(0 != _this->m_tree->add(_this->m_tree->_this, (void *)record_data))
+    {
+        // 插入索引失败（例如稠密索引的键值跨度过大）时记录已经提交，需从文件中删除，否则重新打开后会再次出现
+        FILE_DB_LOG_DEBUG("add to index error, key %d", key);
+        long long orphan_lsn = file_db_remove_orphans(_this, &slot, 1);
+        pthread_rwlock_unlock(&_this->m_file_db_lock);
+        // 删除失败时仍需同步已经提交的添加
+        long long sync_lsn = orphan_lsn > 0 ? orphan_lsn : lsn;
+        if(sync_lsn > 0)
+            file_db_sync(_this, sync_lsn);
+        return -3;
+    }
+    _this->m_version++;
+    file_db_compact_log(_this, key);
+    pthread_rwlock_unlock(&_this->m_file_db_lock);
+
+    if(0 != file_db_sync(_this, lsn))
+        res_code = -9;
+    return res_code;
+
+RUNTIME_ERROR:
+    pthread_rwlock_unlock(&_this->m_file_db_lock);
+    return res_code;
+}
+
+/*
+@func: 
+    通过键值删除指定键值对应的元素
+
+@para: 
+    db : 文件数据库指针
+    key : 元素对应的键值
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    被删除的位置由文件末尾的记录填补，被移动记录在内存中的偏移量会同步更新；
+    空闲列表模式下只把位置标记为空闲，留给之后添加的元素复用
+*/
+static int file_db_del(file_db_t* db, int key)
+{
+    file_db_private_t* _this = get_private_member(db);
+
+    if(NULL == _this) 
+    {
+        FILE_DB_LOG_DEBUG("Filedatabase error!");
+        return -2;
+    }
+    pthread_rwlock_wrlock(&_this->m_file_db_lock);
+    if(_this->m_frozen)
+    {
+        pthread_rwlock_unlock(&_this->m_file_db_lock);
+        return -10;
+    }
+    file_db_record_t* record_data = _this->m_tree->query_by_key(_this->m_tree->_this, key);
+
+    if(NULL == record_data)
+    {
+        FILE_DB_LOG_DEBUG("No such element. Del fail!");
+        pthread_rwlock_unlock(&_this->m_file_db_lock);
+        return -3;
+    }
+
+    int res_code = file_db_remove_slot(_this, record_data->offset);
+    if(0 != res_code)
+    {
+        pthread_rwlock_unlock(&_this->m_file_db_lock);
+        return res_code;
+    }
+    long long lsn = file_db_commit(_this);
+    if(lsn < 0)
+    {
+        // 提交失败时索引与记录位置保持删除之前的状态
+        file_db_restore_slot(_this, FILE_DB_SLOT_INDEX(_this, record_data->offset), key);
+        file_db_rollback(_this, -1);
+        pthread_rwlock_unlock(&_this->m_file_db_lock);
+        return -9;
+    }
+    res_code = _this->m_tree->del_node_by_key(_this->m_tree->_this, key);
+    _this->m_version++;
+    file_db_compact_log(_this, key);
+    pthread_rwlock_unlock(&_this->m_file_db_lock);
+
+    // 删除已经提交，索引中的节点删除失败也需要落盘
+    if(0 != file_db_sync(_this, lsn) && 0 == res_code)
+        res_code = -8;
+    return res_code;
+}
+
+/*
+@func: 
+    根据键值编辑指定的元素
+
+@para: 
+    db : 文件数据库指针
+    key : 元素对应的键值
+    ele ： 目标元素，将替换给定键值所对应的元素的值
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    ele 参数通过用户传入的获取键值的函数计算得到的键值需要和本函数传入键值 key 一致
+*/
+static int file_db_edit(file_db_t* db, int key, void *ele)
+{
+    file_db_private_t* _this = get_private_member(db);
+
+    if(NULL == _this || NULL == ele) return -1;
+
+    if(key != _this->pf_get_ele_key(ele))
+    {
+        FILE_DB_LOG_DEBUG("Edit error, Key value and element do not match");
+        return -1;
+    }
+    pthread_rwlock_wrlock(&_this->m_file_db_lock);
+    file_db_record_t* record_data = (file_db_record_t*)(_this->m_tree->query_by_key(_this->m_tree->_this, key));
+    if(NULL == record_data)
+    {
+        FILE_DB_LOG_DEBUG("Edit error, Query data error");
+        pthread_rwlock_unlock(&_this->m_file_db_lock);
+        return -2;
+    }
+    
+    if(0 != file_db_write(_this, ele, _this->m_data_size, record_data->offset))
+    {
+        file_db_rollback(_this, -1);
+        pthread_rwlock_unlock(&_this->m_file_db_lock);
+        FILE_DB_LOG_DEBUG("Edit element, write new error!");
+        return -4;
+    }
+    // 提交成功后才更新内存中的记录，失败时仍为修改之前的值
+    long long lsn = file_db_commit(_this);
+    if(lsn < 0)
+    {
+        file_db_rollback(_this, -1);
+        pthread_rwlock_unlock(&_this->m_file_db_lock);
+        FILE_DB_LOG_DEBUG("Edit element, commit error!");
+        return -4;
+    }
+    file_db_record_store(_this, record_data, ele);
+    file_db_compact_log(_this, key);
+    FILE_DB_LOG_DEBUG("query key[%d], ele key[%d], get key[%d]", key, _this->pf_get_ele_key(ele), file_db_get_key(record_data));
+    pthread_rwlock_unlock(&_this->m_file_db_lock);
+
+    if(0 != file_db_sync(_this, lsn))
+        return -5;
+    return 0;
+}
+
+/*
+@func: 
+    按键值排序的比较函数，键值相同时按在批次中的序号排序；file_db_int_cmp 按整数升序排序
+
+@para: 
+    a, b : 比较的两个 file_db_key_index_t
+
+@return:
+    int : 比较结果
+*/
+typedef struct _file_db_key_index
+{
+    int key;    // 键值
+    int index;  // 在批次中的序号，索引文件中为记录位置
+}file_db_key_index_t;
+
+static int file_db_key_index_cmp(const void* a, const void* b)
+{
+    const file_db_key_index_t* x = (const file_db_key_index_t*)a;
+    const file_db_key_index_t* y = (const file_db_key_index_t*)b;
+
+    if(x->key != y->key)
+        return x->key < y->key ? -1 : 1;
+    return x->index < y->index ? -1 : (x->index > y->index);
+}
+
+static int file_db_int_cmp(const void* a, const void* b)
+{
+    int x = *(const int*)a;
+    int y = *(const int*)b;
+
+    return x < y ? -1 : (x > y);
+}
+
+/*
+@func: 
+    从后往前逐个删除不在索引中的记录位置，每删除一个提交一次
+
+@para: 
+    _this : 私有成员
+    slots : 记录位置数组，会被排序
+    cnt : 记录位置数量
+
+@return:
+    long long : < 0 : 失败， other ： 最后一次提交的日志序号
+
+@note:
+    从后往前删除，保证填补空位的末尾记录一定在索引中。需在持有 m_file_db_lock 写锁时调用
+*/
+static long long file_db_remove_orphans(file_db_private_t* _this, int* slots, int cnt)
+{
+    long long lsn = 0;
+    if(cnt > 1)
+        qsort(slots, cnt, sizeof(int), file_db_int_cmp);
+    for(int i = cnt - 1; i >= 0; --i)
+    {
+        FILE_DB_LOG_DEBUG("remove orphan record at slot %d", slots[i]);
+        if(0 != file_db_remove_slot(_this, FILE_DB_SLOT_OFFSET(_this, slots[i])))
+            return -1;
+        lsn = file_db_commit(_this);
+        if(lsn < 0)
+        {
+            file_db_rollback(_this, -1);
+            return -1;
+        }
+    }
+    return lsn;
+}
+
+/*
+@func: 
+    批量添加失败时把复用的空闲位置重新标记为空闲
+
+@para: 
+    _this : 私有成员
+    cnt : 从空闲列表末尾开始复用的位置数量
+
+@return:
+    none.
+
+@note:
+    需在 file_db_rollback 之后调用。预写日志模式下标记随操作一起丢弃，不需要处理；
+    其他模式下已写入的标记可能已经落到文件中，绕过写入队列直接写回。需在持有 m_file_db_lock 写锁时调用
+*/
+static void file_db_revert_tags(file_db_private_t* _this, int cnt)
+{
+    if(NULL != _this->m_wal || !_this->m_option.free_list)
+        return;
+
+    int32_t tag = FILE_DB_SLOT_FREE;
+    for(int i = 0; i < cnt; ++i)
+    {
+        off_t offset = FILE_DB_SLOT_END(_this, _this->m_free_slots[_this->m_free_cnt - 1 - i]);
+        if(NULL != _this->m_map)
+        {
+            memcpy(_this->m_map + offset, &tag, sizeof(int32_t));
+            continue;
+        }
+        if(0 != file_db_pwrite(_this->m_fd, &tag, sizeof(int32_t), offset))
+            FILE_DB_LOG_DEBUG("revert free tag error, offset %ld", (long)offset);
+        if(NULL != _this->m_cache)
+            _this->m_cache->update(_this->m_cache->_this, &tag, sizeof(int32_t), offset);
+    }
+}
+
+/*
+@func: 
+    批量添加元素到文件数据库中
+
+@para: 
+    db : 文件数据库指针
+    eles : 连续存放的元素数组，每个元素大小为 data_size
+    cnt : 元素个数
+    status : 每个元素的添加结果，0 成功，-5 键值已存在或与本批次中之前的元素重复，-3 插入索引失败，可传 NULL
+
+@return:
+    int : < 0 : 失败， other ： 成功添加的元素个数
+
+@note:
+    成功的元素在文件末尾一次连续写入，记录数量只更新一次；重复的元素不影响其他元素的添加
+*/
+static int file_db_add_batch(file_db_t* db, void* eles, int cnt, int* status)
+{
+    file_db_private_t* _this = get_private_member(db);
+    if(NULL == _this || NULL == eles || cnt < 0) 
+        return -1;
+    if(0 == cnt)
+        return 0;
+
+    int data_size = _this->m_data_size;
+    file_db_key_index_t* keys = (file_db_key_index_t*)malloc(sizeof(file_db_key_index_t) * cnt);
+    int* res = (int*)malloc(sizeof(int) * cnt);
+    if(NULL == keys || NULL == res)
+    {
+        free(keys);
+        free(res);
+        return -2;
+    }
+
+    for(int i = 0; i < cnt; ++i)
+    {
+        keys[i].key = _this->pf_get_ele_key((char*)eles + (size_t)i * data_size);
+        keys[i].index = i;
+        res[i] = 0;
+    }
+    qsort(keys, cnt, sizeof(file_db_key_index_t), file_db_key_index_cmp);
+
+    pthread_rwlock_wrlock(&_this->m_file_db_lock);
+    if(_this->m_frozen || 0 != _this->m_load_res)
+    {
+        pthread_rwlock_unlock(&_this->m_file_db_lock);
+        free(keys);
+        free(res);
+        return _this->m_frozen ? -10 : -11;
+    }
+
+    // 排序后同一键值只保留批次中第一个元素
+    int accept_cnt = 0;
+    for(int i = 0; i < cnt; ++i)
+    {
+        if((i > 0 && keys[i].key == keys[i - 1].key)
+            || NULL != _this->m_tree->query_by_key(_this->m_tree->_this, keys[i].key))
+        {
+            res[keys[i].index] = -5;
+        }
+        else
+        {
+            accept_cnt++;
+        }
+    }
+
+    int res_code = 0;
+    char* buff = NULL;
+    char* records = NULL;
+    int* tree_res = NULL;
+    int base = _this->m_data_cnt;
+    // 空闲列表模式下先复用空闲的位置，其余的元素追加到文件末尾
+    int reuse_cnt = accept_cnt < _this->m_free_cnt ? accept_cnt : _this->m_free_cnt;
+    int append_cnt = accept_cnt - reuse_cnt;
+    int slot_size = _this->m_slot_size;
+    if(accept_cnt > 0)
+    {
+        buff = (char*)malloc((size_t)(append_cnt > 0 ? append_cnt : 1) * slot_size);
+        records = (char*)malloc((size_t)accept_cnt * _this->m_record_size);
+        tree_res = (int*)malloc(sizeof(int) * accept_cnt);
+        if(NULL == buff || NULL == records || NULL == tree_res || 0 != file_db_slot_reserve(_this, base + append_cnt))
+        {
+            res_code = -3;
+            goto RUNTIME_ERROR;
+        }
+
+        // 按批次中的原始顺序分配文件位置
+        int n = 0;
+        for(int i = 0; i < cnt; ++i)
+        {
+            if(0 != res[i]) continue;
+
+            void* ele = (char*)eles + (size_t)i * data_size;
+            file_db_record_t* record_data = FILE_DB_RECORD_AT(_this, records, n);
+            int slot = 0;
+            if(n < reuse_cnt)
+            {
+                // 复用的位置逐个写入，先写数据再写状态标记
+                slot = _this->m_free_slots[_this->m_free_cnt - 1 - n];
+                if(0 != file_db_write(_this, ele, data_size, FILE_DB_SLOT_OFFSET(_this, slot))
+                    || 0 != file_db_write_tag(_this, slot, FILE_DB_SLOT_USED))
+                {
+                    FILE_DB_LOG_DEBUG("write batch error, slot %d", slot);
+                    file_db_rollback(_this, -1);
+                    file_db_revert_tags(_this, n + 1);
+                    res_code = -4;
+                    goto RUNTIME_ERROR;
+                }
+            }
+            else
+            {
+                char* p = buff + (size_t)(n - reuse_cnt) * slot_size;
+                int32_t tag = FILE_DB_SLOT_USED;
+                slot = base + n - reuse_cnt;
+                memcpy(p, &tag, _this->m_slot_head);
+                memcpy(p + _this->m_slot_head, ele, data_size);
+            }
+            file_db_record_store(_this, record_data, ele);
+            record_data->offset = FILE_DB_SLOT_OFFSET(_this, slot);
+            record_data->db = db;
+            _this->m_slot_keys[slot] = _this->pf_get_ele_key(ele);
+            file_db_compact_log(_this, _this->m_slot_keys[slot]);
+            n++;
+        }
+
+        if(append_cnt > 0)
+        {
+            _this->m_data_cnt += append_cnt;
+            if(0 != file_db_write(_this, buff, append_cnt * slot_size, FILE_DB_SLOT_END(_this, base))
+                || 0 != file_db_store_cnt(_this, _this->m_data_cnt))
+            {
+                FILE_DB_LOG_DEBUG("write batch error, cnt %d", append_cnt);
+                _this->m_data_cnt = base;
+                file_db_rollback(_this, FILE_DB_SLOT_END(_this, base));
+                file_db_revert_tags(_this, reuse_cnt);
+                res_code = -4;
+                goto RUNTIME_ERROR;
+            }
+        }
+    }
+    long long lsn = file_db_commit(_this);
+    if(lsn < 0)
+    {
+        _this->m_data_cnt = base;
+        file_db_rollback(_this, FILE_DB_SLOT_END(_this, base));
+        file_db_revert_tags(_this, reuse_cnt);
+        res_code = -4;
+        goto RUNTIME_ERROR;
+    }
+
+    _this->m_free_cnt -= reuse_cnt;
+    int add_cnt = accept_cnt;
+    if(accept_cnt > 0)
+    {
+        for(int i = 0; i < accept_cnt; ++i)
+            tree_res[i] = -1;
+        add_cnt = _this->m_tree->add_batch(_this->m_tree->_this, records, accept_cnt, tree_res);
+        if(add_cnt != accept_cnt)
+        {
+            // 插入索引失败的元素已经写入文件，需从文件中删除，否则重新打开后会再次出现；
+            // 失败的记录位置依次写回 tree_res 的前部，写入的下标不会超过正在读取的下标
+            int orphan_cnt = 0;
+            for(int i = 0, n = 0; i < cnt; ++i)
+            {
+                if(0 != res[i]) continue;
+                if(0 != tree_res[n])
+                {
+                    res[i] = -3;
+                    tree_res[orphan_cnt++] = FILE_DB_SLOT_INDEX(_this, FILE_DB_RECORD_AT(_this, records, n)->offset);
+                }
+                n++;
+            }
+            add_cnt = accept_cnt - orphan_cnt;
+            long long orphan_lsn = file_db_remove_orphans(_this, tree_res, orphan_cnt);
+            if(orphan_lsn < 0)
+                res_code = -4;
+            else if(orphan_cnt > 0)
+                lsn = orphan_lsn;
+        }
+        if(add_cnt > 0)
+            _this->m_version++;
+    }
+    pthread_rwlock_unlock(&_this->m_file_db_lock);
+
+    if(NULL != status)
+        memcpy(status, res, sizeof(int) * cnt);
+    free(tree_res);
+    free(records);
+    free(buff);
+    free(res);
+    free(keys);
+
+    // 提交已经成功，删除插入索引失败的记录出错时已提交的元素也需要落盘
+    int sync_res = lsn > 0 ? file_db_sync(_this, lsn) : 0;
+    if(0 != res_code)
+        return res_code;
+    if(0 != sync_res)
+        return -5;
+    return add_cnt;
+
+RUNTIME_ERROR:
+    pthread_rwlock_unlock(&_this->m_file_db_lock);
+    free(tree_res);
+    free(records);
+    free(buff);
+    free(res);
+    free(keys);
+    return res_code;
+}
+
+/*
+@func: 
+    通过键值批量删除元素
+
+@para: 
+    db : 文件数据库指针
+    keys : 键值数组
+    cnt : 键值个数
+    status : 每个键值的删除结果，0 成功，-3 不存在，可传 NULL
+
+@return:
+    int : < 0 : 失败， other ： 成功删除的元素个数
+
+@note:
+    记录数量的更新与文件截断整批只执行一次；空闲列表模式下每个元素只写入一个状态标记
+*/
+static int file_db_del_batch(file_db_t* db, const int* keys, int cnt, int* status)
+{
+    file_db_private_t* _this = get_private_member(db);
+    if(NULL == _this || NULL == keys || cnt < 0) 
+        return -1;
+    if(0 == cnt)
+        return 0;
+
+    int del_cnt = 0;
+    int res_code = 0;
+    // order 按键值排序用于找出批次中重复的键值，removed 按删除的顺序记录键值与位置，提交失败时逆序撤销
+    file_db_key_index_t* order = (file_db_key_index_t*)malloc(sizeof(file_db_key_index_t) * cnt);
+    file_db_key_index_t* removed = (file_db_key_index_t*)malloc(sizeof(file_db_key_index_t) * cnt);
+    int* res = (int*)malloc(sizeof(int) * cnt);
+    if(NULL == order || NULL == removed || NULL == res)
+    {
+        free(order);
+        free(removed);
+        free(res);
+        return -5;
+    }
+
+    for(int i = 0; i < cnt; ++i)
+    {
+        order[i].key = keys[i];
+        order[i].index = i;
+        res[i] = 0;
+    }
+    qsort(order, cnt, sizeof(file_db_key_index_t), file_db_key_index_cmp);
+    // 同一键值只删除批次中第一次出现的，之后的视为不存在
+    for(int i = 1; i < cnt; ++i)
+    {
+        if(order[i].key == order[i - 1].key)
+            res[order[i].index] = -3;
+    }
+
+    pthread_rwlock_wrlock(&_this->m_file_db_lock);
+    if(_this->m_frozen)
+    {
+        pthread_rwlock_unlock(&_this->m_file_db_lock);
+        free(order);
+        free(removed);
+        free(res);
+        return -10;
+    }
+    // 索引中的节点在提交成功后才删除
+    for(int i = 0; i < cnt; ++i)
+    {
+        if(0 != res[i]) continue;
+
+        file_db_record_t* record_data = NULL;
+        if(0 != res_code)
+            res[i] = res_code;
+        else if(NULL == (record_data = _this->m_tree->query_by_key(_this->m_tree->_this, keys[i])))
+            res[i] = -3;
+        else
+        {
+            int slot = FILE_DB_SLOT_INDEX(_this, record_data->offset);
+            if(_this->m_option.free_list)
+                res[i] = file_db_free_slot(_this, record_data->offset);
+            else
+                res[i] = file_db_fill_slot(_this, record_data->offset);
+            if(0 == res[i])
+            {
+                removed[del_cnt].key = keys[i];
+                removed[del_cnt].index = slot;
+                del_cnt++;
+            }
+            else
+            {
+                // 写入失败后不再继续删除，已删除的部分照常提交
+                res_code = res[i];
+            }
+        }
+    }
+
+    long long lsn = 0;
+    if(del_cnt > 0)
+    {
+        // 空闲列表模式下记录数量与文件长度不变
+        if(!_this->m_option.free_list && 0 != file_db_write_cnt(_this))
+            lsn = -1;
+        else
+            lsn = file_db_commit(_this);
+        if(lsn < 0)
+        {
+            // 写入记录数量或提交失败时整批撤销，索引中的节点尚未删除
+            for(int i = del_cnt - 1; i >= 0; --i)
+                file_db_restore_slot(_this, removed[i].index, removed[i].key);
+            file_db_rollback(_this, -1);
+            res_code = -2;
+            del_cnt = 0;
+            for(int i = 0; i < cnt; ++i)
+            {
+                if(0 == res[i])
+                    res[i] = res_code;
+            }
+        }
+        for(int i = 0; i < del_cnt; ++i)
+        {
+            _this->m_tree->del_node_by_key(_this->m_tree->_this, removed[i].key);
+            file_db_compact_log(_this, removed[i].key);
+        }
+        if(del_cnt > 0)
+            _this->m_version++;
+    }
+    pthread_rwlock_unlock(&_this->m_file_db_lock);
+
+    if(NULL != status)
+        memcpy(status, res, sizeof(int) * cnt);
+    free(order);
+    free(removed);
+    free(res);
+
+    // 只要有提交成功的删除就落盘，与每个元素的结果无关
+    int sync_res = lsn > 0 ? file_db_sync(_this, lsn) : 0;
+    if(0 != res_code)
+        return res_code;
+    if(0 != sync_res)
+        return -4;
+    return del_cnt;
+}
+
+/*
+@func: 
+    根据键值批量编辑元素
+
+@para: 
+    db : 文件数据库指针
+    keys : 键值数组
+    eles : 连续存放的目标元素数组，与 keys 一一对应
+    cnt : 元素个数
+    status : 每个元素的编辑结果，0 成功，-1 键值与元素不匹配，-2 不存在，-4 写入或提交失败，可传 NULL
+
+@return:
+    int : < 0 : 失败，整批都没有生效， other ： 成功编辑的元素个数
+
+@note:
+    整批只获取一次锁，预写日志模式下整批作为一个操作提交；
+    某个元素写入失败时之后的元素不再编辑（status 为 -4），之前写入的元素照常提交并计入返回值，
+    直接写入模式下已写入文件的数据无法撤销，不能作为整批失败处理
+*/
+static int file_db_edit_batch(file_db_t* db, const int* keys, void* eles, int cnt, int* status)
+{
+    file_db_private_t* _this = get_private_member(db);
+    if(NULL == _this || NULL == keys || NULL == eles || cnt < 0) 
+        return -1;
+    if(0 == cnt)
+        return 0;
+
+    int edit_cnt = 0;
+    int res_code = 0;
+    // 写入成功的元素在批次中的序号，提交成功后才更新内存中的记录
+    int* edited = (int*)malloc(sizeof(int) * cnt);
+    if(NULL == edited)
+        return -3;
+
+    pthread_rwlock_wrlock(&_this->m_file_db_lock);
+    for(int i = 0; i < cnt; ++i)
+    {
+        void* ele = (char*)eles + (size_t)i * _this->m_data_size;
+        int res = 0;
+        file_db_record_t* record_data = NULL;
+
+        if(keys[i] != _this->pf_get_ele_key(ele))
+            res = -1;
+        else if(NULL == (record_data = _this->m_tree->query_by_key(_this->m_tree->_this, keys[i])))
+            res = -2;
+        else if(0 != file_db_write(_this, ele, _this->m_data_size, record_data->offset))
+            res = -4;
+        else
+            edited[edit_cnt++] = i;
+
+        if(NULL != status)
+            status[i] = res;
+        if(-4 == res)
+        {
+            // 写入失败后不再继续编辑，已编辑的部分照常提交，失败只通过 status 报告
+            for(int j = i + 1; NULL != status && j < cnt; ++j)
+                status[j] = -4;
+            break;
+        }
+    }
+
+    long long lsn = edit_cnt > 0 ? file_db_commit(_this) : 0;
+    if(lsn < 0)
+    {
+        // 提交失败时整批作废，内存中的记录仍为修改之前的值
+        file_db_rollback(_this, -1);
+        res_code = -4;
+        for(int i = 0; NULL != status && i < edit_cnt; ++i)
+            status[edited[i]] = res_code;
+        edit_cnt = 0;
+    }
+    for(int i = 0; i < edit_cnt; ++i)
+    {
+        void* ele = (char*)eles + (size_t)edited[i] * _this->m_data_size;
+        file_db_record_t* record_data = _this->m_tree->query_by_key(_this->m_tree->_this, keys[edited[i]]);
+        file_db_record_store(_this, record_data, ele);
+        file_db_compact_log(_this, keys[edited[i]]);
+    }
+    pthread_rwlock_unlock(&_this->m_file_db_lock);
+    free(edited);
+
+    // 部分元素写入失败时之前的元素已经提交，同样需要落盘
+    int sync_res = lsn > 0 ? file_db_sync(_this, lsn) : 0;
+    if(0 != res_code)
+        return res_code;
+    if(0 != sync_res)
+        return -5;
+    return edit_cnt;
+}
+
+/*
+@func: 
+    获取查询使用的读锁；后台加载期间不等待，改为登记一次对数据文件的直接探测
+
+@para: 
+    _this : 私有成员
+
+@return:
+    bool : true 正在后台加载，调用者使用 file_db_probe 查找，false 已获取读锁
+
+@note:
+    加载线程在整个加载期间持有写锁，读锁可以立即获取时不需要再检查加载状态；
+    只有内存映射与懒加载模式可以探测，探测到的元素在映射区或页缓存中，不依赖索引中的记录
+*/
+static bool file_db_read_lock(file_db_private_t* _this)
+{
+    if(0 == pthread_rwlock_tryrdlock(&_this->m_file_db_lock))
+        return false;
+
+    if(NULL != _this->m_map || NULL != _this->m_cache)
+    {
+        pthread_mutex_lock(&_this->m_load_mutex);
+        bool probe = _this->m_probe_open;
+        if(probe)
+            _this->m_probe_cnt++;
+        pthread_mutex_unlock(&_this->m_load_mutex);
+        if(probe)
+            return true;
+    }
+    pthread_rwlock_rdlock(&_this->m_file_db_lock);
+    return false;
+}
+
+/*
+@func: 
+    后台加载期间直接扫描数据文件查找元素，结束后注销 file_db_read_lock 登记的探测
+
+@para: 
+    _this : 私有成员
+    keys : 键值数组
+    cnt : 键值个数
+    eles : 输出每个键值对应的元素指针，不存在时为 NULL；懒加载模式下已固定，需要 unpin
+    out : 非 NULL 时在注销探测之前把找到的元素依次拷贝到 out 中（每个元素 data_size 字节）并解除固定，
+          此时 eles 只表示是否找到，不能再访问
+
+@return:
+    int : < 0 : 失败，-4 : 页缓存的块不足， other ： 查询到的元素个数
+
+@note:
+    一批键值只顺序扫描一遍数据文件，全部找到后提前结束；与加载时的规则相同，键值重复时取文件中靠前的记录。
+    加载线程修改数据文件或释放写锁之前调用 file_db_probe_close 等待全部探测结束，探测期间数据文件不会被修改；
+    注销之后加载线程可能移动记录，需要拷贝元素的调用者应传入 out
+*/
+static int file_db_probe(file_db_private_t* _this, const int* keys, int cnt, void** eles, void* out)
+{
+    int slot_size = _this->m_slot_size;
+    int chunk_cnt = FILE_DB_LOAD_CHUNK_SIZE / slot_size > 0 ? (int)(FILE_DB_LOAD_CHUNK_SIZE / slot_size) : 1;
+    file_db_key_index_t* sorted = (file_db_key_index_t*)malloc(sizeof(file_db_key_index_t) * (cnt > 0 ? cnt : 1));
+    off_t* offsets = (off_t*)malloc(sizeof(off_t) * (cnt > 0 ? cnt : 1));
+    char* buff = NULL == _this->m_map ? (char*)malloc((size_t)chunk_cnt * slot_size) : NULL;
+    int found = 0;
+    if(NULL == sorted || NULL == offsets || (NULL == _this->m_map && NULL == buff))
+    {
+        found = -3;
+        goto PROBE_END;
+    }
+
+    int remain = 0;
+    for(int i = 0; i < cnt; ++i)
+    {
+        sorted[i].key = keys[i];
+        sorted[i].index = i;
+        offsets[i] = -1;
+    }
+    qsort(sorted, cnt, sizeof(file_db_key_index_t), file_db_key_index_cmp);
+    for(int i = 0; i < cnt; ++i)
+        remain += 0 == i || sorted[i].key != sorted[i - 1].key;
+
+    for(int i = 0; remain > 0 && i < _this->m_data_cnt; i += chunk_cnt)
+    {
+        int chunk = _this->m_data_cnt - i < chunk_cnt ? _this->m_data_cnt - i : chunk_cnt;
+        char* data = NULL != _this->m_map ? _this->m_map + FILE_DB_SLOT_END(_this, i) : buff;
+        if(NULL == _this->m_map && 0 != file_db_pread(_this->m_fd, data, (size_t)chunk * slot_size, FILE_DB_SLOT_END(_this, i)))
+        {
+            FILE_DB_LOG_DEBUG("read element error!");
+            found = -3;
+            goto PROBE_END;
+        }
+        for(int j = 0; remain > 0 && j < chunk; ++j)
+        {
+            char* slot = data + (size_t)j * slot_size;
+            int32_t tag = FILE_DB_SLOT_USED;
+            memcpy(&tag, slot, _this->m_slot_head);
+            if(FILE_DB_SLOT_USED != tag) continue;
+
+            // 在排好序的键值中找到第一个相同的键值
+            int key = _this->pf_get_ele_key(slot + _this->m_slot_head);
+            int low = 0, high = cnt;
+            while(low < high)
+            {
+                int mid = low + (high - low) / 2;
+                if(sorted[mid].key < key) low = mid + 1;
+                else high = mid;
+            }
+            if(low == cnt || sorted[low].key != key || offsets[sorted[low].index] >= 0) continue;
+
+            for(int k = low; k < cnt && sorted[k].key == key; ++k)
+                offsets[sorted[k].index] = FILE_DB_SLOT_OFFSET(_this, i + j);
+            remain--;
+        }
+    }
+
+    if(NULL != _this->m_cache)
+    {
+        // 页缓存的块不足时不固定任何元素
+        found = _this->m_cache->pin_batch(_this->m_cache->_this, offsets, cnt, eles);
+        if(found < 0)
+            found = -4;
+    }
+    else
+    {
+        for(int i = 0; i < cnt; ++i)
+        {
+            eles[i] = offsets[i] >= 0 ? _this->m_map + offsets[i] : NULL;
+            found += NULL != eles[i];
+        }
+    }
+
+PROBE_END:
+    if(found < 0)
+        memset(eles, 0, sizeof(void*) * cnt);
+    for(int i = 0; NULL != out && i < cnt; ++i)
+    {
+        if(NULL == eles[i]) continue;
+        memcpy((char*)out + (size_t)i * _this->m_data_size, eles[i], _this->m_data_size);
+        file_db_record_release(_this, eles[i]);
+    }
+    free(buff);
+    free(offsets);
+    free(sorted);
+
+    pthread_mutex_lock(&_this->m_load_mutex);
+    if(0 == --_this->m_probe_cnt)
+        pthread_cond_broadcast(&_this->m_load_cond);
+    pthread_mutex_unlock(&_this->m_load_mutex);
+    return found;
+}
+
+/*
+@func: 
+    停止登记新的探测并等待已登记的探测全部结束
+
+@para: 
+    _this : 私有成员
+
+@return:
+    none.
+
+@note:
+    需在持有 m_file_db_lock 写锁时调用，之后的查询等待读锁
+*/
+static void file_db_probe_close(file_db_private_t* _this)
+{
+    pthread_mutex_lock(&_this->m_load_mutex);
+    _this->m_probe_open = false;
+    while(_this->m_probe_cnt > 0)
+        pthread_cond_wait(&_this->m_load_cond, &_this->m_load_mutex);
+    pthread_mutex_unlock(&_this->m_load_mutex);
+}
+
+/*
+@func: 
+    根据键值查询文件数据库中的元素
+
+@para: 
+    db : 文件数据库指针
+    key : 元素的键值
+
+@return:
+    void* : NULL 查询失败， other 查询到的元素的指针
+
+@note:
+    持有读锁查找，多个线程可以同时查询；返回的指针在该元素被删除前有效；
+    懒加载模式下用户数据不在内存中，返回 NULL，需使用 file_db_pin；
+    内存映射模式下后台加载期间直接扫描数据文件，不等待加载完成
+*/
+static void* file_db_query(file_db_t* db, int key)
+{
+    file_db_private_t* _this = get_private_member(db);
+    if(NULL == _this) 
+    {
+        FILE_DB_LOG_DEBUG("_this is NULL");
+        return NULL;
+    }
+    if(NULL != _this->m_cache)
+    {
+        FILE_DB_LOG_DEBUG("query is not supported in lazy mode");
+        return NULL;
+    }
+    void* ele = NULL;
+    if(file_db_read_lock(_this))
+    {
+        file_db_probe(_this, &key, 1, &ele, NULL);
+        return ele;
+    }
+    file_db_record_t* record_data = (file_db_record_t*)(_this->m_tree->query_by_key(_this->m_tree->_this, key));
+    if(NULL != record_data) 
+        ele = file_db_record_ele(_this, record_data);
+    pthread_rwlock_unlock(&_this->m_file_db_lock);
+
+    if(NULL == ele)
+        FILE_DB_LOG_DEBUG("record_data is NULL");
+    return ele;
+}
+
+/*
+@func: 
+    根据键值查询元素并固定，固定期间元素所在的缓存块不会被淘汰
+
+@para: 
+    db : 文件数据库指针
+    key : 元素的键值
+
+@return:
+    void* : NULL 查询失败， other 查询到的元素的指针
+
+@note:
+    懒加载模式下未命中时从数据文件读取元素所在的块；其他模式下与 file_db_query 相同。
+    每次成功的 pin 都需要调用一次 file_db_unpin；懒加载模式下后台加载期间直接扫描数据文件，不等待加载完成
+*/
+static void* file_db_pin(file_db_t* db, int key)
+{
+    file_db_private_t* _this = get_private_member(db);
+    if(NULL == _this) 
+        return NULL;
+
+    void* ele = NULL;
+    if(file_db_read_lock(_this))
+    {
+        file_db_probe(_this, &key, 1, &ele, NULL);
+        return ele;
+    }
+    file_db_record_t* record_data = (file_db_record_t*)(_this->m_tree->query_by_key(_this->m_tree->_this, key));
+    if(NULL != record_data) 
+        ele = file_db_record_acquire(_this, record_data);
+    pthread_rwlock_unlock(&_this->m_file_db_lock);
+
+    return ele;
+}
+
+/*
+@func: 
+    解除 file_db_pin 对元素的固定
+
+@para: 
+    db : 文件数据库指针
+    ele : file_db_pin 返回的指针
+
+@return:
+    none.
+
+@note:
+    非懒加载模式下不需要处理
+*/
+static void file_db_unpin(file_db_t* db, void* ele)
+{
+    file_db_private_t* _this = get_private_member(db);
+    if(NULL == _this || NULL == ele) 
+        return;
+
+    file_db_record_release(_this, ele);
+}
+
+/*
+@func: 
+    批量查询元素，可选择同时固定
+
+@para: 
+    _this : 私有成员
+    keys : 键值数组
+    cnt : 键值个数
+    eles : 输出每个键值对应的元素指针，不存在时为 NULL
+    pin : 懒加载模式下是否通过页缓存读取并固定元素
+
+@return:
+    int : < 0 : 失败， other ： 查询到的元素个数
+
+@note:
+    索引批量查找得到记录后转换为用户数据；懒加载模式下把记录位置一次交给页缓存，
+    不存在的键值使用数据区之前的偏移量，页缓存直接返回 NULL；后台加载期间改为直接探测数据文件
+*/
+static int file_db_lookup_batch(file_db_private_t* _this, const int* keys, int cnt, void** eles, bool pin)
+{
+    if(file_db_read_lock(_this))
+        return file_db_probe(_this, keys, cnt, eles, NULL);
+    int found = _this->m_tree->query_batch(_this->m_tree->_this, keys, cnt, eles);
+    if(found > 0 && pin && NULL != _this->m_cache)
+    {
+        off_t* offsets = (off_t*)malloc(sizeof(off_t) * cnt);
+        for(int i = 0; NULL != offsets && i < cnt; ++i)
+            offsets[i] = NULL != eles[i] ? ((file_db_record_t*)eles[i])->offset : -1;
+        if(NULL != offsets)
+        {
+            // 页缓存的块不足时不固定任何元素
+            found = _this->m_cache->pin_batch(_this->m_cache->_this, offsets, cnt, eles);
+            if(found < 0)
+                found = -4;
+        }
+        else
+        {
+            memset(eles, 0, sizeof(void*) * cnt);
+            found = -3;
+        }
+        free(offsets);
+    }
+    else
+    {
+        for(int i = 0; found > 0 && i < cnt; ++i)
+        {
+            if(NULL != eles[i])
+                eles[i] = file_db_record_ele(_this, (file_db_record_t*)eles[i]);
+        }
+    }
+    pthread_rwlock_unlock(&_this->m_file_db_lock);
+    return found;
+}
+
+/*
+@func: 
+    根据键值批量查询元素 / 批量查询并固定元素
+
+@para: 
+    db : 文件数据库指针
+    keys : 键值数组
+    cnt : 键值个数
+    eles : 输出每个键值对应的元素指针，不存在时为 NULL
+
+@return:
+    int : < 0 : 失败， other ： 查询到的元素个数
+
+@note:
+    懒加载模式下 query_batch 返回 -2；pin_batch 在其他模式下与 query_batch 相同，
+    懒加载模式下页缓存的块不足时返回 -4
+*/
+static int file_db_query_batch(file_db_t* db, const int* keys, int cnt, void** eles)
+{
+    file_db_private_t* _this = get_private_member(db);
+    if(NULL == _this || NULL == keys || NULL == eles || cnt < 0) 
+        return -1;
+    if(NULL != _this->m_cache)
+    {
+        FILE_DB_LOG_DEBUG("query is not supported in lazy mode");
+        memset(eles, 0, sizeof(void*) * cnt);
+        return -2;
+    }
+
+    return file_db_lookup_batch(_this, keys, cnt, eles, false);
+}
+
+static int file_db_pin_batch(file_db_t* db, const int* keys, int cnt, void** eles)
+{
+    file_db_private_t* _this = get_private_member(db);
+    if(NULL == _this || NULL == keys || NULL == eles || cnt < 0) 
+        return -1;
+
+    return file_db_lookup_batch(_this, keys, cnt, eles, true);
+}
+
+/*
+@func: 
+    根据键值查询元素并拷贝到调用者的缓冲区
+
+@para: 
+    db : 文件数据库指针
+    key : 元素的键值
+    ele : 输出元素的缓冲区
+
+@return:
+    int : < 0 : 失败，-2 不存在， 0 ： 成功
+
+@note:
+    所有模式下都可以使用，懒加载模式下固定元素所在的块，拷贝后立即解除固定；
+    与 file_db_query 不同，拷贝后不再依赖元素的指针，适合在其他线程删除元素时使用
+*/
+static int file_db_read(file_db_t* db, int key, void* ele)
+{
+    file_db_private_t* _this = get_private_member(db);
+    if(NULL == _this || NULL == ele) 
+        return -1;
+
+    void* data = NULL;
+    if(file_db_read_lock(_this))
+    {
+        // 在探测注销之前拷贝，之后加载线程删除重复记录时可能覆盖该位置
+        int found = file_db_probe(_this, &key, 1, &data, ele);
+        if(found < 0)
+            return -3;
+        return found > 0 ? 0 : -2;
+    }
+
+    file_db_record_t* record_data = (file_db_record_t*)(_this->m_tree->query_by_key(_this->m_tree->_this, key));
+    if(NULL != record_data) 
+        data = file_db_record_acquire(_this, record_data);
+    if(NULL != data)
+    {
+        memcpy(ele, data, _this->m_data_size);
+        file_db_record_release(_this, data);
+    }
+    pthread_rwlock_unlock(&_this->m_file_db_lock);
+
+    return NULL != data ? 0 : (NULL != record_data ? -3 : -2);
+}
+
+/*
+@func: 
+    异步添加 / 删除 / 编辑 / 查询元素
+
+@para: 
+    db : 文件数据库指针
+    key : 元素的键值
+    ele : 添加与编辑的元素，或查询时输出元素的缓冲区
+    cb : 完成时的回调
+    arg : 传给回调的参数
+
+@return:
+    int : < 0 : 提交失败， 0 ： 已提交
+
+@note:
+    操作按键值提交到异步队列，由 I/O 工作线程调用对应的同步接口执行
+*/
+static int file_db_add_async(file_db_t* db, void* ele, file_db_callback_t cb, void* arg)
+{
+    file_db_private_t* _this = get_private_member(db);
+    if(NULL == _this || NULL == _this->m_async || NULL == ele) 
+        return -1;
+
+    return _this->m_async->submit(_this->m_async->_this, FILE_DB_ASYNC_ADD, _this->pf_get_ele_key(ele), ele, NULL, cb, arg);
+}
+
+static int file_db_del_async(file_db_t* db, int key, file_db_callback_t cb, void* arg)
+{
+    file_db_private_t* _this = get_private_member(db);
+    if(NULL == _this || NULL == _this->m_async) 
+        return -1;
+
+    return _this->m_async->submit(_this->m_async->_this, FILE_DB_ASYNC_DEL, key, NULL, NULL, cb, arg);
+}
+
+static int file_db_edit_async(file_db_t* db, int key, void* ele, file_db_callback_t cb, void* arg)
+{
+    file_db_private_t* _this = get_private_member(db);
+    if(NULL == _this || NULL == _this->m_async || NULL == ele) 
+        return -1;
+
+    return _this->m_async->submit(_this->m_async->_this, FILE_DB_ASYNC_EDIT, key, ele, NULL, cb, arg);
+}
+
+static int file_db_query_async(file_db_t* db, int key, void* ele, file_db_callback_t cb, void* arg)
+{
+    file_db_private_t* _this = get_private_member(db);
+    if(NULL == _this || NULL == _this->m_async || NULL == ele) 
+        return -1;
+
+    return _this->m_async->submit(_this->m_async->_this, FILE_DB_ASYNC_READ, key, NULL, ele, cb, arg);
+}
+
+static int file_db_flush_async(file_db_t* db)
+{
+    file_db_private_t* _this = get_private_member(db);
+    if(NULL == _this || NULL == _this->m_async) 
+        return -1;
+
+    return _this->m_async->flush(_this->m_async->_this);
+}
+
+/*
+@func: 
+    写入文件数据库的文件头
+
+@para: 
+    db : 文件数据库指针
+    head : 写入的文件头指针
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    none.
+*/
+static int file_db_write_head(file_db_t* db, void* head)
+{
+    file_db_private_t* _this = get_private_member(db);
+
+    if(NULL == _this || NULL == head) return -1;
+    pthread_rwlock_wrlock(&_this->m_file_db_lock);
+
+    if(0 != file_db_write(_this, head, _this->m_head_size, 0))
+    {
+        file_db_rollback(_this, -1);
+        pthread_rwlock_unlock(&_this->m_file_db_lock);
+        return -3;
+    }
+    long long lsn = file_db_commit(_this);
+    if(lsn < 0)
+    {
+        file_db_rollback(_this, -1);
+        pthread_rwlock_unlock(&_this->m_file_db_lock);
+        return -3;
+    }
+    memcpy(_this->m_head, head, _this->m_head_size);
+
+    pthread_rwlock_unlock(&_this->m_file_db_lock);
+    if(0 != file_db_sync(_this, lsn))
+        return -4;
+    return 0;
+}
+
+
+/*
+@func: 
+    读取文件数据库的文件头到指定内存中
+
+@para: 
+    db : 文件数据库指针
+    head : 读出的文件头指针
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    文件头在内存中保存有副本，不需要读文件
+*/
+static int file_db_read_head(file_db_t* db, void* head)
+{
+    file_db_private_t* _this = get_private_member(db);
+
+    if(NULL == _this || NULL == head) return -1;
+
+    pthread_rwlock_rdlock(&_this->m_file_db_lock);
+    memcpy(head, _this->m_head, _this->m_head_size);
+    pthread_rwlock_unlock(&_this->m_file_db_lock);
+
+    return 0;
+}
+
+
+/*
+@func: 
+    返回文件数据库中的元素个数
+
+@para: 
+    db : 文件数据库指针
+
+@return:
+    int : < 0 : 失败， other ： 元素个数
+
+@note:
+    后台加载期间等待加载结束；加载失败时索引为空，返回 0
+*/
+static int file_db_size(file_db_t* db)
+{
+    file_db_private_t* _this = get_private_member(db);
+
+    if(NULL == _this) return -1;
+
+    pthread_rwlock_rdlock(&_this->m_file_db_lock);
+    int size = 0 == _this->m_load_res ? _this->m_data_cnt - _this->m_free_cnt : 0;
+    pthread_rwlock_unlock(&_this->m_file_db_lock);
+    return size;
+}
+
+/*
+@func: 
+    遍历文件数据库中的所有内容，然后使用传入的函数指针对每个元素执行操作
+
+@para: 
+    db : 文件数据库指针
+    visit : 对元素操作的函数指针
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    持有读锁遍历，可以与查询并发执行；visit 中不能修改本数据库
+*/
+static int file_db_traverse(file_db_t* db, void (*visit)(void*))
+{
+    if(NULL == db || NULL == visit)
+    {
+        FILE_DB_LOG_DEBUG("[file_db_traverse] para error");
+        return -1;
+    }
+
+    file_db_private_t* _this = get_private_member(db);
+
+    if(NULL == _this) return -2;
+
+    pthread_rwlock_rdlock(&_this->m_file_db_lock);
+    pthread_mutex_lock(&_this->m_visit_mutex);
+    _this->pf_visit = visit;
+    _this->m_tree->preorder(_this->m_tree->_this, file_db_visit_record);
+    pthread_mutex_unlock(&_this->m_visit_mutex);
+    pthread_rwlock_unlock(&_this->m_file_db_lock);
+
+    return 0;
+}
+
+/*
+@func: 
+    用索引中的位置更新游标
+
+@para: 
+    _this : 私有成员
+    cursor : 游标
+    record_data : 定位到的记录，NULL 表示不存在
+    pos : 记录在索引中的位置
+
+@return:
+    int : < 0 : 不存在， 0 ： 成功
+
+@note:
+    需在持有 m_file_db_lock 读锁时调用
+*/
+static int file_db_cursor_set(file_db_private_t* _this, file_db_cursor_t* cursor, file_db_record_t* record_data, void* pos)
+{
+    cursor->pos = pos;
+    cursor->version = _this->m_version;
+    if(NULL == record_data)
+    {
+        cursor->pos = NULL;
+        cursor->ele = NULL;
+        return -1;
+    }
+    cursor->key = file_db_get_key(record_data);
+    cursor->ele = NULL != _this->m_cache ? NULL : file_db_record_ele(_this, record_data);
+    return 0;
+}
+
+/*
+@func: 
+    把游标定位到第一个键值 >= key 的元素 / 最后一个键值 <= key 的元素
+
+@para: 
+    db : 文件数据库指针
+    cursor : 游标
+    key : 键值
+
+@return:
+    int : < 0 : 不存在， 0 ： 成功
+
+@note:
+    持有读锁查找，可以与查询并发执行
+*/
+static int file_db_seek(file_db_t* db, file_db_cursor_t* cursor, int key)
+{
+    file_db_private_t* _this = get_private_member(db);
+    if(NULL == _this || NULL == cursor) return -2;
+
+    void* pos = NULL;
+    pthread_rwlock_rdlock(&_this->m_file_db_lock);
+    file_db_record_t* record_data = _this->m_tree->seek(_this->m_tree->_this, key, &pos);
+    int res = file_db_cursor_set(_this, cursor, record_data, pos);
+    pthread_rwlock_unlock(&_this->m_file_db_lock);
+    return res;
+}
+
+static int file_db_seek_last(file_db_t* db, file_db_cursor_t* cursor, int key)
+{
+    file_db_private_t* _this = get_private_member(db);
+    if(NULL == _this || NULL == cursor) return -2;
+
+    void* pos = NULL;
+    pthread_rwlock_rdlock(&_this->m_file_db_lock);
+    file_db_record_t* record_data = _this->m_tree->seek_last(_this->m_tree->_this, key, &pos);
+    int res = file_db_cursor_set(_this, cursor, record_data, pos);
+    pthread_rwlock_unlock(&_this->m_file_db_lock);
+    return res;
+}
+
+/*
+@func: 
+    把游标按键值顺序移动到 下一个 / 上一个 元素
+
+@para: 
+    db : 文件数据库指针
+    cursor : 已定位的游标
+
+@return:
+    int : < 0 : 已到达末尾 / 开头， 0 ： 成功
+
+@note:
+    索引的版本未变化时保存的位置仍然有效，直接沿父节点指针移动；否则按当前键值重新查找
+*/
+static int file_db_next(file_db_t* db, file_db_cursor_t* cursor)
+{
+    file_db_private_t* _this = get_private_member(db);
+    if(NULL == _this || NULL == cursor) return -2;
+
+    void* pos = cursor->pos;
+    file_db_record_t* record_data = NULL;
+    pthread_rwlock_rdlock(&_this->m_file_db_lock);
+    if(NULL != pos && cursor->version == _this->m_version)
+        record_data = _this->m_tree->next(_this->m_tree->_this, &pos);
+    else if(NULL != pos && INT_MAX != cursor->key)
+        record_data = _this->m_tree->seek(_this->m_tree->_this, cursor->key + 1, &pos);
+    int res = file_db_cursor_set(_this, cursor, record_data, pos);
+    pthread_rwlock_unlock(&_this->m_file_db_lock);
+    return res;
+}
+
+static int file_db_prev(file_db_t* db, file_db_cursor_t* cursor)
+{
+    file_db_private_t* _this = get_private_member(db);
+    if(NULL == _this || NULL == cursor) return -2;
+
+    void* pos = cursor->pos;
+    file_db_record_t* record_data = NULL;
+    pthread_rwlock_rdlock(&_this->m_file_db_lock);
+    if(NULL != pos && cursor->version == _this->m_version)
+        record_data = _this->m_tree->prev(_this->m_tree->_this, &pos);
+    else if(NULL != pos && INT_MIN != cursor->key)
+        record_data = _this->m_tree->seek_last(_this->m_tree->_this, cursor->key - 1, &pos);
+    int res = file_db_cursor_set(_this, cursor, record_data, pos);
+    pthread_rwlock_unlock(&_this->m_file_db_lock);
+    return res;
+}
+
+/*
+@func: 
+    范围访问时把记录转换为用户数据后交给用户的访问函数
+
+@para: 
+    record_ele : 记录
+    arg : file_db_range_arg_t
+
+@return:
+    bool : false 停止访问
+*/
+typedef struct _file_db_range_arg
+{
+    file_db_private_t* _this;
+    bool (*visit)(void* ele, void* arg);
+    void* arg;
+}file_db_range_arg_t;
+
+static bool file_db_range_visit(void* record_ele, void* arg)
+{
+    file_db_range_arg_t* range = (file_db_range_arg_t*)arg;
+    void* ele = file_db_record_acquire(range->_this, (file_db_record_t*)record_ele);
+    if(NULL == ele)
+    {
+        FILE_DB_LOG_DEBUG("[file_db_range]: read element error!");
+        return false;
+    }
+    bool res = range->visit(ele, range->arg);
+    file_db_record_release(range->_this, ele);
+    return res;
+}
+
+/*
+@func: 
+    按键值升序访问 [low, high) 范围内的元素
+
+@para: 
+    db : 文件数据库指针
+    low : 范围下限，包含
+    high : 范围上限，不包含
+    visit : 对每个元素执行的操作，返回 false 时停止
+    arg : 传给 visit 的参数
+
+@return:
+    int : < 0 : 失败， other ： 访问的元素个数
+
+@note:
+    持有读锁访问，可以与查询并发执行；visit 中不能修改本数据库
+*/
+static int file_db_range(file_db_t* db, int low, int high, bool (*visit)(void* ele, void* arg), void* arg)
+{
+    file_db_private_t* _this = get_private_member(db);
+    if(NULL == _this || NULL == visit) return -1;
+
+    file_db_range_arg_t range = {_this, visit, arg};
+    pthread_rwlock_rdlock(&_this->m_file_db_lock);
+    int cnt = _this->m_tree->range(_this->m_tree->_this, low, high, file_db_range_visit, &range);
+    pthread_rwlock_unlock(&_this->m_file_db_lock);
+    return cnt;
+}
+
+/*
+@func: 
+    获取键值小于 key 的元素个数，即 key 的排名（从 0 开始）
+
+@para: 
+    db : 文件数据库指针
+    key : 键值，不要求存在
+
+@return:
+    int : < 0 : 失败， other ： 键值小于 key 的元素个数
+
+@note:
+    索引的每个节点保存子树节点数，O(log n)，不读取文件
+*/
+static int file_db_rank(file_db_t* db, int key)
+{
+    file_db_private_t* _this = get_private_member(db);
+    if(NULL == _this) return -1;
+
+    pthread_rwlock_rdlock(&_this->m_file_db_lock);
+    int rank = _this->m_tree->rank(_this->m_tree->_this, key);
+    pthread_rwlock_unlock(&_this->m_file_db_lock);
+    return rank;
+}
+
+/*
+@func: 
+    把游标定位到按键值升序的第 index 个元素（从 0 开始）
+
+@para: 
+    db : 文件数据库指针
+    cursor : 游标
+    index : 元素的排名
+
+@return:
+    int : < 0 : index 越界， 0 ： 成功
+
+@note:
+    O(log n)；定位后可以用 next / prev 继续移动，适合分页访问
+*/
+static int file_db_select(file_db_t* db, file_db_cursor_t* cursor, int index)
+{
+    file_db_private_t* _this = get_private_member(db);
+    if(NULL == _this || NULL == cursor) return -2;
+
+    void* pos = NULL;
+    pthread_rwlock_rdlock(&_this->m_file_db_lock);
+    file_db_record_t* record_data = _this->m_tree->select(_this->m_tree->_this, index, &pos);
+    int res = file_db_cursor_set(_this, cursor, record_data, pos);
+    pthread_rwlock_unlock(&_this->m_file_db_lock);
+    return res;
+}
+
+/*
+@func: 
+    统计键值在 [low, high) 范围内的元素个数
+
+@para: 
+    db : 文件数据库指针
+    low : 范围下限，包含
+    high : 范围上限，不包含
+
+@return:
+    int : < 0 : 失败， other ： 范围内的元素个数
+
+@note:
+    O(log n)，不访问范围内的元素
+*/
+static int file_db_count_range(file_db_t* db, int low, int high)
+{
+    file_db_private_t* _this = get_private_member(db);
+    if(NULL == _this) return -1;
+
+    pthread_rwlock_rdlock(&_this->m_file_db_lock);
+    int cnt = _this->m_tree->count_range(_this->m_tree->_this, low, high);
+    pthread_rwlock_unlock(&_this->m_file_db_lock);
+    return cnt;
+}
+
+/*
+@func: 
+    把索引冻结为只读索引
+
+@para: 
+    db : 文件数据库指针
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    按键值顺序取出全部记录，一次构建只读索引后替换原索引；构建期间持有写锁，失败时原索引保持不变。
+    原索引在释放锁之后销毁，之前 query 返回的指针随之失效
+*/
+static int file_db_freeze(file_db_t* db)
+{
+    file_db_private_t* _this = get_private_member(db);
+    if(NULL == _this) return -1;
+
+    pthread_rwlock_wrlock(&_this->m_file_db_lock);
+    if(_this->m_frozen || 0 != _this->m_load_res)
+    {
+        pthread_rwlock_unlock(&_this->m_file_db_lock);
+        return _this->m_frozen ? 0 : -11;
+    }
+
+    int slot_cnt = _this->m_data_cnt;
+    int cnt = slot_cnt - _this->m_free_cnt;
+    int* keys = (int*)malloc(sizeof(int) * (cnt > 0 ? cnt : 1));
+    char* is_free = (char*)calloc(slot_cnt > 0 ? slot_cnt : 1, 1);
+    char* records = (char*)malloc((size_t)(cnt > 0 ? cnt : 1) * _this->m_record_size);
+    avl_tree_t* tree = frozen_index_create(_this->m_record_size, file_db_get_key, NULL, false);
+    int res = 0;
+    if(NULL == keys || NULL == is_free || NULL == records || NULL == tree)
+        res = -2;
+
+    // 每个非空闲的记录位置上保存的键值即为全部键值
+    int n = 0;
+    for(int i = 0; 0 == res && i < _this->m_free_cnt; ++i)
+        is_free[_this->m_free_slots[i]] = 1;
+    for(int i = 0; 0 == res && i < slot_cnt; ++i)
+    {
+        if(!is_free[i])
+            keys[n++] = _this->m_slot_keys[i];
+    }
+    if(0 == res && n > 1)
+        qsort(keys, n, sizeof(int), file_db_int_cmp);
+    for(int i = 0; 0 == res && i < n; ++i)
+    {
+        file_db_record_t* record_data = _this->m_tree->query_by_key(_this->m_tree->_this, keys[i]);
+        if(NULL == record_data)
+            res = -3;
+        else
+            memcpy(FILE_DB_RECORD_AT(_this, records, i), record_data, _this->m_record_size);
+    }
+    if(0 == res && 0 != tree->build_sorted(tree->_this, records, n))
+        res = -3;
+
+    if(0 == res)
+    {
+        avl_tree_t* old_tree = _this->m_tree;
+        _this->m_tree = tree;
+        tree = old_tree;
+        _this->m_frozen = true;
+        _this->m_version++;
+    }
+    pthread_rwlock_unlock(&_this->m_file_db_lock);
+
+    // 成功时销毁原索引，失败时销毁新索引
+    if(NULL != tree)
+        tree->destory(&tree);
+    free(records);
+    free(is_free);
+    free(keys);
+    return res;
+}
+
+/*
+@func: 
+    清除文件数据库内容，但是保存文件头
+
+@para: 
+    db : 文件数据库指针
+
+@return:
+    int : -1 : 失败， 0 ： 成功
+
+@note:
+    【重要】此函数不能与 file_db_destory 同时使用
+*/
+static int file_db_clear(file_db_t* db)
+{
+    file_db_private_t* _this = get_private_member(db);
+
+    if(NULL == _this) return -1;
+    int cnt = 0;
+
+    pthread_rwlock_wrlock(&_this->m_file_db_lock);
+    if(_this->m_frozen || 0 != _this->m_load_res)
+    {
+        pthread_rwlock_unlock(&_this->m_file_db_lock);
+        return _this->m_frozen ? -10 : -11;
+    }
+    if(0 != file_db_store_cnt(_this, cnt)
+        || 0 != file_db_truncate(_this, FILE_DB_DATA_START(_this)))
+    {
+        file_db_rollback(_this, -1);
+        pthread_rwlock_unlock(&_this->m_file_db_lock);
+        FILE_DB_LOG_DEBUG("[file_db_clear] : write cnt error");
+        return -2;
+    } 
+    long long lsn = file_db_commit(_this);
+    if(lsn < 0)
+    {
+        file_db_rollback(_this, -1);
+        pthread_rwlock_unlock(&_this->m_file_db_lock);
+        FILE_DB_LOG_DEBUG("[file_db_clear] : commit error");
+        return -2;
+    }
+    _this->m_data_cnt = 0;
+    _this->m_free_cnt = 0;
+    // 正在复制的记录已全部失效
+    if(_this->m_compacting)
+        _this->m_compact_abort = true;
+
+    // 用户数据内嵌在树节点中，随节点的内存池整体释放
+    _this->m_tree->clear_node(_this->m_tree->_this);
+    _this->m_version++;
+    if(NULL != _this->m_cache)
+        _this->m_cache->reset(_this->m_cache->_this, _this->m_fd);
+    pthread_rwlock_unlock(&_this->m_file_db_lock);
+
+    if(0 != file_db_sync(_this, lsn))
+        return -3;
+    return 0;
+}
+
+/*
+@func: 
+    获取索引文件路径
+
+@para: 
+    _this : 私有成员
+    path : 输出的路径
+    size : path 的长度
+
+@return:
+    none.
+*/
+static void file_db_index_path(file_db_private_t* _this, char* path, size_t size)
+{
+    snprintf(path, size, "%s.idx", _this->m_path);
+}
+
+/*
+@func: 
+    计算索引项的校验值（FNV-1a）
+
+@para: 
+    buf : 数据
+    len : 数据长度
+
+@return:
+    uint32_t : 校验值
+*/
+static uint32_t file_db_checksum(const void* buf, size_t len)
+{
+    const unsigned char* p = (const unsigned char*)buf;
+    uint32_t h = 2166136261U;
+
+    while(len--)
+    {
+        h ^= *p++;
+        h *= 16777619U;
+    }
+    return h;
+}
+
+/*
+@func: 
+    填写数据文件的版本信息
+
+@para: 
+    _this : 私有成员
+    head : 索引文件头
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    版本信息由数据文件的长度、修改时间与 inode 组成，数据文件的任何修改都会使其改变
+*/
+static int file_db_index_generation(file_db_private_t* _this, file_db_index_head_t* head)
+{
+    struct stat st;
+    if(0 != fstat(_this->m_fd, &st))
+        return -1;
+
+    memset(head, 0, sizeof(file_db_index_head_t));
+    memcpy(head->magic, FILE_DB_INDEX_MAGIC, sizeof(head->magic));
+    head->file_size = st.st_size;
+    head->mtime_sec = st.st_mtim.tv_sec;
+    head->mtime_nsec = st.st_mtim.tv_nsec;
+    head->ino = st.st_ino;
+    head->head_size = _this->m_head_size;
+    head->data_size = _this->m_data_size;
+    head->cnt = _this->m_data_cnt;
+    return 0;
+}
+
+/*
+@func: 
+    把索引保存到索引文件
+
+@para: 
+    _this : 私有成员
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    需在数据文件的全部修改完成后调用；先写入临时文件再重命名，不会留下不完整的索引文件；
+    空闲列表模式下只保存非空闲的位置
+*/
+static int file_db_save_index(file_db_private_t* _this)
+{
+    char path[sizeof(_this->m_path) + 8];
+    char tmp_path[sizeof(_this->m_path) + 16];
+    int slot_cnt = _this->m_data_cnt;
+    int cnt = 0;
+
+    file_db_index_path(_this, path, sizeof(path));
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    file_db_key_index_t* entries = (file_db_key_index_t*)malloc(sizeof(file_db_key_index_t) * (slot_cnt > 0 ? slot_cnt : 1));
+    char* is_free = (char*)calloc(slot_cnt > 0 ? slot_cnt : 1, 1);
+    if(NULL == entries || NULL == is_free)
+    {
+        free(entries);
+        free(is_free);
+        return -1;
+    }
+    for(int i = 0; i < _this->m_free_cnt; ++i)
+        is_free[_this->m_free_slots[i]] = 1;
+    for(int i = 0; i < slot_cnt; ++i)
+    {
+        if(is_free[i]) continue;
+        entries[cnt].key = _this->m_slot_keys[i];
+        entries[cnt].index = i;
+        cnt++;
+    }
+    free(is_free);
+    qsort(entries, cnt, sizeof(file_db_key_index_t), file_db_key_index_cmp);
+
+    // 数据文件先落盘，保证索引描述的数据已经在磁盘上
+    file_db_index_head_t head;
+    if(0 != fsync(_this->m_fd) || 0 != file_db_index_generation(_this, &head))
+    {
+        free(entries);
+        return -2;
+    }
+    head.checksum = file_db_checksum(entries, sizeof(file_db_key_index_t) * cnt);
+
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if(fd < 0)
+    {
+        free(entries);
+        return -3;
+    }
+    int res = 0;
+    if(0 != file_db_pwrite(fd, &head, sizeof(head), 0)
+        || 0 != file_db_pwrite(fd, entries, sizeof(file_db_key_index_t) * cnt, sizeof(head)))
+    {
+        res = -4;
+    }
+    close(fd);
+    free(entries);
+
+    if(0 == res && 0 != rename(tmp_path, path))
+        res = -5;
+    if(0 != res)
+    {
+        FILE_DB_LOG_DEBUG("save index error %d", res);
+        unlink(tmp_path);
+    }
+    return res;
+}
+
+/*
+@func: 
+    读取与数据文件匹配的索引文件
+
+@para: 
+    _this : 私有成员
+    entries : 输出按键值排序的 (key, 记录位置)
+    cnt : 非空闲的记录位置数量，即索引项的数量
+
+@return:
+    int : < 0 : 索引文件不存在或与数据文件不匹配，需要扫描数据文件， 0 ： 成功
+
+@note:
+    一次读取全部索引项
+*/
+static int file_db_read_index(file_db_private_t* _this, file_db_key_index_t* entries, int cnt)
+{
+    char path[sizeof(_this->m_path) + 8];
+
+    file_db_index_path(_this, path, sizeof(path));
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+        return -1;
+
+    file_db_index_head_t head, generation;
+    struct stat st;
+    size_t len = sizeof(file_db_key_index_t) * cnt;
+    if(0 != file_db_pread(fd, &head, sizeof(head), 0)
+        || 0 != fstat(fd, &st) || st.st_size != (off_t)(sizeof(head) + len)
+        || 0 != file_db_index_generation(_this, &generation))
+    {
+        close(fd);
+        return -2;
+    }
+    generation.checksum = head.checksum;
+    if(0 != memcmp(&head, &generation, sizeof(head)))
+    {
+        FILE_DB_LOG_DEBUG("index generation mismatch");
+        close(fd);
+        return -3;
+    }
+
+    int res = 0;
+    if(0 != file_db_pread(fd, entries, len, sizeof(head)) || head.checksum != file_db_checksum(entries, len))
+        res = -4;
+    close(fd);
+
+    for(int i = 0; 0 == res && i < cnt; ++i)
+    {
+        if(entries[i].index < 0 || entries[i].index >= _this->m_data_cnt || (i > 0 && entries[i].key <= entries[i - 1].key))
+            res = -5;
+    }
+    return res;
+}
+
+/*
+@func: 
+    整理线程按写入速度限制等待
+
+@para: 
+    start : 开始复制的时间
+    rate : 每秒最多写入的字节数，<= 0 不限速
+    written : 已写入的字节数
+
+@return:
+    none.
+*/
+static void file_db_compact_throttle(const struct timespec* start, long rate, long long written)
+{
+    if(rate <= 0) return;
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double elapsed = (double)(now.tv_sec - start->tv_sec) + (double)(now.tv_nsec - start->tv_nsec) / 1e9;
+    double wait = (double)written / rate - elapsed;
+    if(wait <= 0) return;
+
+    struct timespec ts;
+    ts.tv_sec = (time_t)wait;
+    ts.tv_nsec = (long)((wait - (double)ts.tv_sec) * 1e9);
+    while(0 != nanosleep(&ts, &ts) && EINTR == errno);
+}
+
+/*
+@func: 
+    组装整理后新文件中一个记录位置的内容
+
+@para: 
+    _this : 私有成员
+    slot : 输出的记录位置，长度为 m_slot_size
+    key : 该位置上元素的键值
+
+@return:
+    int : < 0 : 读取用户数据失败， 0 ： 成功
+
+@note:
+    用户数据取自内存中的最新值，懒加载模式下取自页缓存；元素已被删除时该位置标记为空闲。
+    需在持有 m_file_db_lock 读锁或写锁时调用
+*/
+static int file_db_compact_slot(file_db_private_t* _this, char* slot, int key)
+{
+    file_db_record_t* record_data = _this->m_tree->query_by_key(_this->m_tree->_this, key);
+    int32_t tag = NULL != record_data ? FILE_DB_SLOT_USED : FILE_DB_SLOT_FREE;
+
+    memcpy(slot, &tag, _this->m_slot_head);
+    if(NULL == record_data)
+    {
+        memset(slot + _this->m_slot_head, 0, _this->m_data_size);
+        return 0;
+    }
+
+    void* ele = file_db_record_acquire(_this, record_data);
+    if(NULL == ele)
+        return -1;
+    memcpy(slot + _this->m_slot_head, ele, _this->m_data_size);
+    file_db_record_release(_this, ele);
+    return 0;
+}
+
+/*
+@func: 
+    在按键值排序的 (key, 新记录位置) 中查找键值
+
+@para: 
+    lookup : 按键值排序的数组
+    cnt : 数组长度
+    key : 键值
+
+@return:
+    int : < 0 : 不存在， other ： 键值在新文件中的记录位置
+*/
+static int file_db_compact_find(const file_db_key_index_t* lookup, int cnt, int key)
+{
+    int lo = 0, hi = cnt - 1;
+    while(lo <= hi)
+    {
+        int mid = lo + (hi - lo) / 2;
+        if(lookup[mid].key == key)
+            return lookup[mid].index;
+        if(lookup[mid].key < key)
+            lo = mid + 1;
+        else
+            hi = mid - 1;
+    }
+    return -1;
+}
+
+/*
+@func: 
+    同步数据文件所在目录，使重命名落盘
+
+@para: 
+    _this : 私有成员
+
+@return:
+    none.
+*/
+static void file_db_sync_dir(file_db_private_t* _this)
+{
+    char dir[sizeof(_this->m_path)];
+    strcpy(dir, _this->m_path);
+
+    char* slash = strrchr(dir, '/');
+    if(NULL == slash)
+        strcpy(dir, ".");
+    else if(slash == dir)
+        dir[1] = '\0';
+    else
+        *slash = '\0';
+
+    int fd = open(dir, O_RDONLY | O_DIRECTORY);
+    if(fd < 0) return;
+    if(0 != fsync(fd))
+        FILE_DB_LOG_DEBUG("sync dir error, errno %d", errno);
+    close(fd);
+}
+
+/*
+@func: 
+    整理的最后阶段：按整理期间的修改修正新文件，然后替换数据文件并更新记录的偏移量
+
+@para: 
+    _this : 私有成员
+    fd : 新文件的文件描述符，成功后成为数据文件
+    path : 新文件的路径
+    keys : 复制阶段新文件中每个记录位置的键值
+    lookup : 按键值排序的 (key, 新记录位置)
+    cnt : 复制的记录数量
+
+@return:
+    int : < 0 : 失败，数据文件保持不变， 0 ： 成功
+
+@note:
+    被编辑的记录原地重写；被删除的位置优先由新添加的元素填补，其余的在空闲列表模式下标记为空闲，
+    否则用末尾的记录填补。重命名之前全部失败都可以放弃新文件。需在持有 m_file_db_lock 写锁时调用
+*/
+static int file_db_compact_finish(file_db_private_t* _this, int fd, const char* path, const int* keys, const file_db_key_index_t* lookup, int cnt)
+{
+    int log_cnt = _this->m_compact_log_cnt;
+    int cap = cnt + log_cnt > 0 ? cnt + log_cnt : 1;
+    int* slot_keys = (int*)malloc(sizeof(int) * cap);
+    int* holes = (int*)malloc(sizeof(int) * cap);
+    int* appends = (int*)malloc(sizeof(int) * cap);
+    file_db_record_t** records = (file_db_record_t**)malloc(sizeof(file_db_record_t*) * cap);
+    char* slot = (char*)malloc(_this->m_slot_size > FILE_DB_DATA_START(_this) ? _this->m_slot_size : FILE_DB_DATA_START(_this));
+    int res = 0;
+    if(NULL == slot_keys || NULL == holes || NULL == appends || NULL == records || NULL == slot)
+    {
+        res = -1;
+        goto EXIT;
+    }
+    memcpy(slot_keys, keys, sizeof(int) * cnt);
+
+    int* log = _this->m_compact_log;
+    if(log_cnt > 1)
+        qsort(log, log_cnt, sizeof(int), file_db_int_cmp);
+
+    int hole_cnt = 0, append_cnt = 0, new_cnt = cnt;
+    for(int i = 0; i < log_cnt && 0 == res; ++i)
+    {
+        if(i > 0 && log[i] == log[i - 1]) continue;
+
+        int index = file_db_compact_find(lookup, cnt, log[i]);
+        bool alive = NULL != _this->m_tree->query_by_key(_this->m_tree->_this, log[i]);
+        if(alive && index >= 0)
+        {
+            res = file_db_compact_slot(_this, slot, log[i]);
+            if(0 == res)
+                res = file_db_pwrite(fd, slot, _this->m_slot_size, FILE_DB_SLOT_END(_this, index));
+        }
+        else if(alive)
+            appends[append_cnt++] = log[i];
+        else if(index >= 0)
+            holes[hole_cnt++] = index;
+    }
+    if(hole_cnt > 1)
+        qsort(holes, hole_cnt, sizeof(int), file_db_int_cmp);
+
+    // 新添加的元素先填补被删除的位置，其余的追加到末尾
+    int h = 0;
+    for(int i = 0; i < append_cnt && 0 == res; ++i)
+    {
+        int index = h < hole_cnt ? holes[h++] : new_cnt++;
+        slot_keys[index] = appends[i];
+        res = file_db_compact_slot(_this, slot, appends[i]);
+        if(0 == res)
+            res = file_db_pwrite(fd, slot, _this->m_slot_size, FILE_DB_SLOT_END(_this, index));
+    }
+
+    // 剩余的空位：空闲列表模式下标记为空闲，否则从前往后用末尾的记录填补
+    int end = hole_cnt;
+    while(h < end && 0 == res)
+    {
+        if(_this->m_option.free_list)
+        {
+            res = file_db_compact_slot(_this, slot, slot_keys[holes[h]]);
+            if(0 == res)
+                res = file_db_pwrite(fd, slot, _this->m_slot_size, FILE_DB_SLOT_END(_this, holes[h]));
+            h++;
+        }
+        else if(holes[end - 1] == new_cnt - 1)
+        {
+            end--;
+            new_cnt--;
+        }
+        else
+        {
+            slot_keys[holes[h]] = slot_keys[new_cnt - 1];
+            res = file_db_compact_slot(_this, slot, slot_keys[holes[h]]);
+            if(0 == res)
+                res = file_db_pwrite(fd, slot, _this->m_slot_size, FILE_DB_SLOT_END(_this, holes[h]));
+            h++;
+            new_cnt--;
+        }
+    }
+    if(0 != res)
+    {
+        res = -2;
+        goto EXIT;
+    }
+
+    // 替换映射区之前取出每个位置的记录，内存映射模式下键值取自映射区，替换后才能修改偏移量
+    for(int i = 0; i < new_cnt; ++i)
+        records[i] = _this->m_tree->query_by_key(_this->m_tree->_this, slot_keys[i]);
+
+    int cnt_field = new_cnt | (_this->m_option.free_list ? FILE_DB_CNT_FREE_LIST : 0);
+    memcpy(slot, _this->m_head, _this->m_head_size);
+    memcpy(slot + _this->m_head_size, &cnt_field, sizeof(int));
+    if(0 != file_db_pwrite(fd, slot, FILE_DB_DATA_START(_this), 0)
+        || 0 != ftruncate(fd, FILE_DB_SLOT_END(_this, new_cnt))
+        || 0 != fsync(fd) || 0 != file_db_slot_reserve(_this, new_cnt))
+    {
+        res = -3;
+        goto EXIT;
+    }
+
+    int old_fd = _this->m_fd;
+    int old_cnt = _this->m_data_cnt;
+    char* old_map = _this->m_map;
+    size_t old_map_size = _this->m_map_size;
+    off_t old_map_file_size = _this->m_map_file_size;
+    _this->m_fd = fd;
+    _this->m_data_cnt = new_cnt;
+    if(NULL != old_map)
+    {
+        _this->m_map = NULL;
+        res = file_db_mmap_open(_this);
+    }
+
+    // 日志中的操作针对旧文件，切换前写入旧文件并持久地清空
+    if(0 == res && NULL != _this->m_wal && 0 != _this->m_wal->switch_data_file(_this->m_wal->_this, fd))
+        res = -5;
+    if(0 == res && 0 != rename(path, _this->m_path))
+    {
+        if(NULL != _this->m_wal)
+            _this->m_wal->switch_data_file(_this->m_wal->_this, old_fd);
+        res = -6;
+    }
+    if(0 != res)
+    {
+        if(NULL != old_map && NULL != _this->m_map)
+            munmap(_this->m_map, _this->m_map_size);
+        _this->m_fd = old_fd;
+        _this->m_data_cnt = old_cnt;
+        _this->m_map = old_map;
+        _this->m_map_size = old_map_size;
+        _this->m_map_file_size = old_map_file_size;
+        goto EXIT;
+    }
+    file_db_sync_dir(_this);
+
+    if(NULL != old_map)
+        munmap(old_map, old_map_size);
+    close(old_fd);
+    // 缓存的块按旧文件的位置组织，全部丢弃
+    if(NULL != _this->m_cache)
+        _this->m_cache->reset(_this->m_cache->_this, fd);
+    if(NULL != _this->m_ring)
+        _this->m_ring->reset(_this->m_ring->_this, fd);
+    _this->m_dirty_begin = _this->m_dirty_end = 0;
+
+    // 从后往前压入空闲位置，与加载时一致，之后优先复用靠前的位置
+    _this->m_free_cnt = 0;
+    for(int i = new_cnt - 1; i >= 0; --i)
+    {
+        _this->m_slot_keys[i] = slot_keys[i];
+        if(NULL == records[i])
+            _this->m_free_slots[_this->m_free_cnt++] = i;
+        else
+            records[i]->offset = FILE_DB_SLOT_OFFSET(_this, i);
+    }
+
+EXIT:
+    free(slot);
+    free(records);
+    free(appends);
+    free(holes);
+    free(slot_keys);
+    return res;
+}
+
+/*
+@func: 
+    整理数据文件，把存活的记录重写到紧凑的新文件 path.compact 中并替换原文件
+
+@para: 
+    _this : 私有成员
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    分三个阶段：独占锁下确定每个存活元素在新文件中的位置；
+    分块复制记录，每块只持有读锁，块之间按 compact_rate 限速，期间其他操作照常进行并记录被修改的键值；
+    最后独占锁下修正新文件并替换
+*/
+static int file_db_compact_run(file_db_private_t* _this)
+{
+    char path[sizeof(_this->m_path) + 16];
+    snprintf(path, sizeof(path), "%s.compact", _this->m_path);
+
+    pthread_mutex_lock(&_this->m_compact_run_mutex);
+    pthread_rwlock_wrlock(&_this->m_file_db_lock);
+    int slot_cnt = _this->m_data_cnt;
+    int cnt = slot_cnt - _this->m_free_cnt;
+    int* keys = (int*)malloc(sizeof(int) * (cnt > 0 ? cnt : 1));
+    file_db_key_index_t* lookup = (file_db_key_index_t*)malloc(sizeof(file_db_key_index_t) * (cnt > 0 ? cnt : 1));
+    char* is_free = (char*)calloc(slot_cnt > 0 ? slot_cnt : 1, 1);
+    if(NULL == keys || NULL == lookup || NULL == is_free)
+    {
+        pthread_rwlock_unlock(&_this->m_file_db_lock);
+        pthread_mutex_unlock(&_this->m_compact_run_mutex);
+        free(is_free);
+        free(lookup);
+        free(keys);
+        return -1;
+    }
+
+    for(int i = 0; i < _this->m_free_cnt; ++i)
+        is_free[_this->m_free_slots[i]] = 1;
+    int n = 0;
+    for(int i = 0; i < slot_cnt; ++i)
+    {
+        if(is_free[i]) continue;
+        lookup[n].key = _this->m_slot_keys[i];
+        lookup[n].index = i;
+        n++;
+    }
+    free(is_free);
+    if(_this->m_option.compact_sorted)
+        qsort(lookup, cnt, sizeof(file_db_key_index_t), file_db_key_index_cmp);
+    for(int i = 0; i < cnt; ++i)
+    {
+        keys[i] = lookup[i].key;
+        lookup[i].index = i;
+    }
+    if(!_this->m_option.compact_sorted)
+        qsort(lookup, cnt, sizeof(file_db_key_index_t), file_db_key_index_cmp);
+
+    _this->m_compacting = true;
+    _this->m_compact_abort = false;
+    _this->m_compact_log_cnt = 0;
+    pthread_rwlock_unlock(&_this->m_file_db_lock);
+
+    int res = 0;
+    int slot_size = _this->m_slot_size;
+    int chunk_cnt = FILE_DB_COMPACT_CHUNK_SIZE / slot_size > 0 ? (int)(FILE_DB_COMPACT_CHUNK_SIZE / slot_size) : 1;
+    char* buff = (char*)malloc((size_t)chunk_cnt * slot_size);
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0666);
+    if(NULL == buff || fd < 0)
+        res = -2;
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    long long written = 0;
+    for(int i = 0; i < cnt && 0 == res; i += chunk_cnt)
+    {
+        int chunk = cnt - i < chunk_cnt ? cnt - i : chunk_cnt;
+
+        // 复制期间被删除的元素先写为空位，最后阶段再处理
+        pthread_rwlock_rdlock(&_this->m_file_db_lock);
+        for(int j = 0; j < chunk && 0 == res; ++j)
+            res = file_db_compact_slot(_this, buff + (size_t)j * slot_size, keys[i + j]);
+        pthread_rwlock_unlock(&_this->m_file_db_lock);
+
+        if(0 == res && 0 != file_db_pwrite(fd, buff, (size_t)chunk * slot_size, FILE_DB_SLOT_END(_this, i)))
+            res = -3;
+        written += (long long)chunk * slot_size;
+
+        pthread_mutex_lock(&_this->m_compact_mutex);
+        if(_this->m_compact_stop)
+            res = -4;
+        pthread_mutex_unlock(&_this->m_compact_mutex);
+
+        file_db_compact_throttle(&start, _this->m_option.compact_rate, written);
+    }
+    free(buff);
+
+    pthread_rwlock_wrlock(&_this->m_file_db_lock);
+    if(0 == res && _this->m_compact_abort)
+        res = -5;
+    if(0 == res)
+        res = file_db_compact_finish(_this, fd, path, keys, lookup, cnt);
+    _this->m_compacting = false;
+    _this->m_compact_log_cnt = 0;
+    pthread_rwlock_unlock(&_this->m_file_db_lock);
+    pthread_mutex_unlock(&_this->m_compact_run_mutex);
+
+    if(0 != res)
+    {
+        FILE_DB_LOG_DEBUG("compact error %d", res);
+        if(fd >= 0)
+            close(fd);
+        unlink(path);
+    }
+    free(lookup);
+    free(keys);
+    return res;
+}
+
+/*
+@func: 
+    整理数据文件，把存活的记录重写到紧凑的新文件中并替换原文件
+
+@para: 
+    db : 文件数据库指针
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    与后台整理线程互斥执行
+*/
+static int file_db_compact(file_db_t* db)
+{
+    file_db_private_t* _this = get_private_member(db);
+
+    if(NULL == _this) return -1;
+
+    // 加载失败时索引不完整，按索引重写会丢失记录
+    pthread_rwlock_rdlock(&_this->m_file_db_lock);
+    int load_res = _this->m_load_res;
+    pthread_rwlock_unlock(&_this->m_file_db_lock);
+    if(0 != load_res)
+        return -11;
+
+    return file_db_compact_run(_this);
+}
+
+/*
+@func: 
+    后台整理线程，定期检查空闲位置的比例，达到 compact_ratio 时整理数据文件
+
+@para: 
+    arg : 私有成员
+
+@return:
+    None.
+*/
+static void* file_db_compact_thread(void* arg)
+{
+    file_db_private_t* _this = (file_db_private_t*)arg;
+    int ratio = _this->m_option.compact_ratio > 0 ? _this->m_option.compact_ratio : FILE_DB_COMPACT_RATIO;
+
+    pthread_mutex_lock(&_this->m_compact_mutex);
+    while(!_this->m_compact_stop)
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_sec += FILE_DB_COMPACT_INTERVAL;
+        pthread_cond_timedwait(&_this->m_compact_cond, &_this->m_compact_mutex, &ts);
+        if(_this->m_compact_stop) break;
+        pthread_mutex_unlock(&_this->m_compact_mutex);
+
+        pthread_rwlock_rdlock(&_this->m_file_db_lock);
+        bool need = _this->m_free_cnt > 0 && (long long)_this->m_free_cnt * 100 >= (long long)ratio * _this->m_data_cnt;
+        pthread_rwlock_unlock(&_this->m_file_db_lock);
+        if(need && 0 != file_db_compact_run(_this))
+            FILE_DB_LOG_DEBUG("background compact error");
+
+        pthread_mutex_lock(&_this->m_compact_mutex);
+    }
+    pthread_mutex_unlock(&_this->m_compact_mutex);
+    return NULL;
+}
+
+/*
+@func: 
+    启动后台整理线程
+
+@para: 
+    _this : 私有成员
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+*/
+static int file_db_compact_start(file_db_private_t* _this)
+{
+    if(0 != pthread_create(&_this->m_compact_thread, NULL, file_db_compact_thread, _this))
+    {
+        FILE_DB_LOG_DEBUG("create compact thread error!");
+        return -1;
+    }
+    _this->m_compact_started = true;
+    return 0;
+}
+
+/*
+@func: 
+    停止后台整理线程，正在复制的整理会放弃
+
+@para: 
+    _this : 私有成员
+
+@return:
+    None.
+*/
+static void file_db_compact_stop(file_db_private_t* _this)
+{
+    if(!_this->m_compact_started) return;
+
+    pthread_mutex_lock(&_this->m_compact_mutex);
+    _this->m_compact_stop = true;
+    pthread_cond_signal(&_this->m_compact_cond);
+    pthread_mutex_unlock(&_this->m_compact_mutex);
+    pthread_join(_this->m_compact_thread, NULL);
+    _this->m_compact_started = false;
+}
+
+/*
+@func: 
+    等待后台加载线程退出
+
+@para: 
+    _this : 私有成员
+
+@return:
+    None.
+*/
+static void file_db_load_join(file_db_private_t* _this)
+{
+    if(!_this->m_load_started) return;
+
+    pthread_join(_this->m_load_thread, NULL);
+    _this->m_load_started = false;
+}
+
+/*
+@func: 
+    并释放文件数据库相关动态内存
+
+@para: 
+    db : 文件数据库指针
+
+@return:
+    int : -1 : 失败， 0 ： 成功
+
+@note:
+    【重要】此函数不能与 file_db_destory 同时使用
+*/
+static int file_db_free(file_db_t* db)
+{
+    file_db_private_t* _this = get_private_member(db);
+
+    if(NULL == _this) return -1;
+
+    // 已提交的异步操作需在索引与文件关闭之前执行完
+    if(NULL != _this->m_async)
+        _this->m_async->destory(&_this->m_async);
+    file_db_sync_stop(_this);
+    file_db_load_join(_this);
+    file_db_compact_stop(_this);
+
+    if(NULL != _this->m_tree)
+        _this->m_tree->destory(&_this->m_tree);
+
+    // 关闭日志时会执行最后一次检查点，需在关闭数据文件之前
+    if(NULL != _this->m_wal)
+        _this->m_wal->destory(&_this->m_wal);
+
+    // 解除映射后把按块扩展的文件截断到实际长度
+    if(NULL != _this->m_map)
+    {
+        munmap(_this->m_map, _this->m_map_size);
+        _this->m_map = NULL;
+        if(0 != ftruncate(_this->m_fd, FILE_DB_SLOT_END(_this, _this->m_data_cnt)))
+            FILE_DB_LOG_DEBUG("truncate mmap db error");
+    }
+
+    if(NULL != _this->m_ring)
+    {
+        if(0 != _this->m_ring->flush(_this->m_ring->_this))
+            FILE_DB_LOG_DEBUG("flush io ring error");
+        _this->m_ring->destory(&_this->m_ring);
+    }
+
+    // 定时同步的最后一个间隔内的修改在关闭时落盘
+    if(FILE_DB_SYNC_NONE != _this->m_option.sync && !_this->m_option.wal && _this->m_fd >= 0 && 0 != fdatasync(_this->m_fd))
+        FILE_DB_LOG_DEBUG("sync db error");
+
+    // 索引文件需在数据文件的全部修改之后写入
+    if(_this->m_option.index_file && _this->m_loaded)
+        file_db_save_index(_this);
+
+    if(NULL != _this->m_cache)
+        _this->m_cache->destory(&_this->m_cache);
+
+    if(_this->m_fd >= 0)
+        close(_this->m_fd);
+    pthread_rwlock_destroy(&_this->m_file_db_lock);
+    pthread_mutex_destroy(&_this->m_visit_mutex);
+    pthread_mutex_destroy(&_this->m_compact_run_mutex);
+    pthread_mutex_destroy(&_this->m_compact_mutex);
+    pthread_cond_destroy(&_this->m_compact_cond);
+    pthread_mutex_destroy(&_this->m_load_mutex);
+    pthread_cond_destroy(&_this->m_load_cond);
+    pthread_mutex_destroy(&_this->m_sync_mutex);
+    pthread_cond_destroy(&_this->m_sync_cond);
+
+    free(_this->m_compact_log);
+    free(_this->m_slot_keys);
+    free(_this->m_free_slots);
+    free(_this->m_record_buff);
+    free(_this->m_head);
+
+    free(_this);
+    free(db);
+    return 0;
+}
+
+/*
+@func: 
+    销毁数据库文件并释放相关动态内存
+
+@para: 
+    db : 文件数据库指针
+
+@return:
+    int : -1 : 失败， 0 ： 成功
+
+@note:
+    【重要】此函数不能与 file_db_free 同时使用
+*/
+static int file_db_destory(file_db_t* db)
+{
+    file_db_private_t* _this = get_private_member(db);
+
+    if(NULL == _this) 
+    {
+        FILE_DB_LOG_DEBUG("destory error");
+        return -1;
+    }
+    char path[sizeof(_this->m_path) + 16];
+    file_db_index_path(_this, path, sizeof(path));
+
+    // 整理完成时会重新创建数据文件，需在删除文件之前停止；后台加载成功后才启动整理线程
+    if(NULL != _this->m_async)
+        _this->m_async->destory(&_this->m_async);
+    file_db_load_join(_this);
+    file_db_compact_stop(_this);
+    unlink(_this->m_path);
+    unlink(path);
+    wal_remove(_this->m_path);
+    snprintf(path, sizeof(path), "%s.compact", _this->m_path);
+    unlink(path);
+
+    _this->m_option.index_file = false;
+    return file_db_free(db);
+}
+/*
+    启动加载时每个线程处理的一段连续的记录位置
+*/
+typedef struct _file_db_load_part
+{
+    file_db_private_t* _this;
+    char* slots;                    // 内存映射区中全部记录位置的起始地址，NULL 时按 FILE_DB_LOAD_CHUNK_SIZE 分块读取到临时缓冲区
+    file_db_key_index_t* entries;   // 非 NULL 时提取本段的键值，从 entries[begin] 开始存放并排序
+    int* free_slots;                // 非 NULL 时记录本段空闲的位置，从 free_slots[begin] 开始按升序存放
+    char* records;                  // 非 NULL 时把本段的用户数据拷贝到 records 中 positions 指定的记录
+    const int* positions;           // 每个记录位置对应的记录下标，空闲与重复的记录位置为 -1
+    int begin;                      // 本段的第一个记录位置
+    int end;                        // 本段之后的第一个记录位置
+    int used_cnt;                   // 本段非空闲的记录位置数量
+    int free_cnt;                   // 本段空闲的记录位置数量
+    int res_code;                   // 0 成功，-3 读取失败，-7 状态标记错误
+}file_db_load_part_t;
+
+/*
+    合并两段有序的 (key, 记录位置)
+*/
+typedef struct _file_db_load_merge
+{
+    const file_db_key_index_t* left;    // 记录位置较小的一段
+    int left_cnt;
+    const file_db_key_index_t* right;
+    int right_cnt;
+    file_db_key_index_t* out;           // 输出，长度为 left_cnt + right_cnt
+}file_db_load_merge_t;
+
+/*
+    把排好序的 (key, 记录位置) 转换为索引中的记录
+*/
+typedef struct _file_db_load_fill
+{
+    file_db_private_t* _this;
+    file_db_t* db;
+    const file_db_key_index_t* entries;
+    int* positions;                 // 非 NULL 时输出每个记录位置对应的记录下标，之后按记录位置分块拷贝用户数据
+    char* records;                  // 输出的记录数组
+    int begin;                      // 本段处理 entries[begin, end)
+    int end;
+    int first;                      // 本段第一个记录在 records 中的下标
+}file_db_load_fill_t;
+
+/*
+@func: 
+    确定启动加载使用的线程数
+
+@para: 
+    _this : 私有成员
+    slot_cnt : 需要扫描的记录位置数量
+
+@return:
+    int : 线程数，至少为 1
+
+@note:
+    load_threads 为 0 时使用在线的 CPU 数量；每个线程至少处理 FILE_DB_LOAD_CHUNK_SIZE 字节，小文件不创建线程
+*/
+static int file_db_load_threads(file_db_private_t* _this, int slot_cnt)
+{
+    long threads = _this->m_option.load_threads;
+    if(threads <= 0)
+        threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if(threads > FILE_DB_LOAD_MAX_THREADS)
+        threads = FILE_DB_LOAD_MAX_THREADS;
+
+    long long chunks = (long long)slot_cnt * _this->m_slot_size / FILE_DB_LOAD_CHUNK_SIZE;
+    if(threads > chunks)
+        threads = chunks;
+    return threads > 0 ? (int)threads : 1;
+}
+
+/*
+@func: 
+    并行执行一组任务
+
+@para: 
+    worker : 任务函数
+    args : 连续存放的任务参数
+    arg_size : 每个任务参数的大小
+    cnt : 任务数量
+
+@return:
+    none.
+
+@note:
+    第一个任务在调用线程上执行，其余各创建一个线程；线程创建失败的任务在调用线程上依次执行，
+    任务的结果保存在各自的参数中
+*/
+static void file_db_parallel(void* (*worker)(void*), void* args, size_t arg_size, int cnt)
+{
+    pthread_t threads[FILE_DB_LOAD_MAX_THREADS];
+    bool started[FILE_DB_LOAD_MAX_THREADS] = {false};
+
+    for(int i = 1; i < cnt; ++i)
+        started[i] = 0 == pthread_create(&threads[i], NULL, worker, (char*)args + i * arg_size);
+    for(int i = 0; i < cnt; ++i)
+    {
+        if(!started[i])
+            worker((char*)args + i * arg_size);
+    }
+    for(int i = 1; i < cnt; ++i)
+    {
+        if(started[i])
+            pthread_join(threads[i], NULL);
+    }
+}
+
+/*
+@func: 
+    扫描一段记录位置，提取键值并找出空闲的位置
+
+@para: 
+    arg : file_db_load_part_t 指针
+
+@return:
+    NULL
+
+@note:
+    pf_get_ele_key 会被多个线程同时调用，只能读取传入的元素；拷贝用户数据时不提取键值
+*/
+static void* file_db_load_scan(void* arg)
+{
+    file_db_load_part_t* part = (file_db_load_part_t*)arg;
+    file_db_private_t* _this = part->_this;
+    int slot_size = _this->m_slot_size;
+    int chunk_cnt = FILE_DB_LOAD_CHUNK_SIZE / slot_size > 0 ? (int)(FILE_DB_LOAD_CHUNK_SIZE / slot_size) : 1;
+    char* buff = NULL;
+
+    if(NULL == part->slots && NULL == (buff = (char*)malloc((size_t)chunk_cnt * slot_size)))
+    {
+        part->res_code = -3;
+        return NULL;
+    }
+
+    for(int i = part->begin; 0 == part->res_code && i < part->end; i += chunk_cnt)
+    {
+        int chunk = part->end - i < chunk_cnt ? part->end - i : chunk_cnt;
+        char* data = NULL != part->slots ? part->slots + (size_t)i * slot_size : buff;
+        if(NULL == part->slots && 0 != file_db_pread(_this->m_fd, data, (size_t)chunk * slot_size, FILE_DB_SLOT_END(_this, i)))
+        {
+            FILE_DB_LOG_DEBUG("read element error!");
+            part->res_code = -3;
+            break;
+        }
+        if(NULL != part->records)
+        {
+            for(int j = 0; j < chunk; ++j)
+            {
+                int n = part->positions[i + j];
+                if(n >= 0)
+                    memcpy(FILE_DB_RECORD_AT(_this, part->records, n)->ele, data + (size_t)j * slot_size + _this->m_slot_head, _this->m_data_size);
+            }
+            continue;
+        }
+        if(NULL == part->entries && NULL == part->free_slots)
+            continue;
+
+        for(int j = 0; j < chunk; ++j)
+        {
+            char* slot = data + (size_t)j * slot_size;
+            int32_t tag = FILE_DB_SLOT_USED;
+            memcpy(&tag, slot, _this->m_slot_head);
+            if(FILE_DB_SLOT_FREE == tag)
+            {
+                if(NULL != part->free_slots)
+                    part->free_slots[part->begin + part->free_cnt] = i + j;
+                part->free_cnt++;
+                continue;
+            }
+            if(FILE_DB_SLOT_USED != tag)
+            {
+                FILE_DB_LOG_DEBUG("bad slot tag at slot %d", i + j);
+                part->res_code = -7;
+                break;
+            }
+            if(NULL != part->entries)
+            {
+                file_db_key_index_t* entry = part->entries + part->begin + part->used_cnt;
+                entry->key = _this->pf_get_ele_key(slot + _this->m_slot_head);
+                entry->index = i + j;
+            }
+            part->used_cnt++;
+        }
+    }
+    free(buff);
+
+    if(0 == part->res_code && NULL != part->entries)
+        qsort(part->entries + part->begin, part->used_cnt, sizeof(file_db_key_index_t), file_db_key_index_cmp);
+    return NULL;
+}
+
+/*
+@func: 
+    把记录位置平均分段后并行扫描
+
+@para: 
+    _this : 私有成员
+    slots : 内存映射区中全部记录位置的起始地址，NULL 时分块读取到临时缓冲区
+    entries : 非 NULL 时提取键值，每段的结果从该段的第一个记录位置开始存放
+    find_free : 是否找出空闲的位置，汇总到 m_free_slots 中
+    parts : 输出每段的扫描结果，容量为 FILE_DB_LOAD_MAX_THREADS
+    part_cnt : 分段数量
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    空闲位置按从后往前的顺序压入，之后优先复用靠前的位置
+*/
+static int file_db_load_run(file_db_private_t* _this, char* slots, file_db_key_index_t* entries, bool find_free, file_db_load_part_t* parts, int part_cnt)
+{
+    int slot_cnt = _this->m_data_cnt;
+    for(int i = 0; i < part_cnt; ++i)
+    {
+        file_db_load_part_t* part = &parts[i];
+        memset(part, 0, sizeof(file_db_load_part_t));
+        part->_this = _this;
+        part->slots = slots;
+        part->entries = entries;
+        part->free_slots = find_free ? _this->m_free_slots : NULL;
+        part->begin = (int)((long long)slot_cnt * i / part_cnt);
+        part->end = (int)((long long)slot_cnt * (i + 1) / part_cnt);
+    }
+    file_db_parallel(file_db_load_scan, parts, sizeof(file_db_load_part_t), part_cnt);
+
+    for(int i = 0; i < part_cnt; ++i)
+    {
+        if(0 != parts[i].res_code)
+            return parts[i].res_code;
+    }
+    if(!find_free)
+        return 0;
+
+    _this->m_free_cnt = 0;
+    for(int i = 0; i < part_cnt; ++i)
+    {
+        if(parts[i].free_cnt > 0)
+            memmove(_this->m_free_slots + _this->m_free_cnt, _this->m_free_slots + parts[i].begin, sizeof(int) * parts[i].free_cnt);
+        _this->m_free_cnt += parts[i].free_cnt;
+    }
+    for(int i = 0, j = _this->m_free_cnt - 1; i < j; ++i, --j)
+    {
+        int tmp = _this->m_free_slots[i];
+        _this->m_free_slots[i] = _this->m_free_slots[j];
+        _this->m_free_slots[j] = tmp;
+    }
+    return 0;
 }
 
 /*
 @func: 
-    根据键值编辑指定的元素
+    把记录位置平均分段后并行地分块读取，把用户数据拷贝到对应的记录中
 
 @para: 
-    db : 文件数据库指针
-    key : 元素对应的键值
-    ele ： 目标元素，将替换给定键值所对应的元素的值
+    _this : 私有成员
+    records : 记录数组
+    positions : 每个记录位置对应的记录下标，空闲与重复的记录位置为 -1
+    parts : 每段的读取结果，容量为 FILE_DB_LOAD_MAX_THREADS
+    part_cnt : 分段数量
 
 @return:
     int : < 0 : 失败， 0 ： 成功
 
 @note:
-    ele 参数通过用户传入的获取键值的函数计算得到的键值需要和本函数传入键值 key 一致
+    按记录位置顺序读取文件，每个线程只使用 FILE_DB_LOAD_CHUNK_SIZE 大小的缓冲区
 */
-static int file_db_edit(file_db_t* db, int key, void *ele)
+static int file_db_load_copy(file_db_private_t* _this, char* records, const int* positions, file_db_load_part_t* parts, int part_cnt)
 {
-    file_db_private_t* _this = get_private_member(db);
-
-    if(NULL == _this || NULL == ele) return -1;
-
-    if(key != _this->pf_get_ele_key(ele))
-    {
-        FILE_DB_LOG_DEBUG("Edit error, Key value and element do not match");
-        return -1;
-    }
-    pthread_mutex_lock(&_this->m_file_db_mutex);
-    file_db_record_t* record_data = (file_db_record_t*)(_this->m_tree->query_by_key(_this->m_tree->_this, key));
-    if(NULL == record_data)
-    {
-        FILE_DB_LOG_DEBUG("Edit error, Query data error");
-        pthread_mutex_unlock(&_this->m_file_db_mutex);
-        return -2;
-    }
-    
-    memset(record_data->ele, 0, _this->m_data_size);
-    memcpy(record_data->ele, ele, _this->m_data_size);
-    FILE_DB_LOG_DEBUG("query key[%d], ele key[%d], get key[%d]", key, _this->pf_get_ele_key(ele), _this->pf_get_ele_key(record_data->ele));
-    FILE* db_fp = fopen(_this->m_path, "rb+");
-
-    if(NULL == db_fp) 
+    int slot_cnt = _this->m_data_cnt;
+    for(int i = 0; i < part_cnt; ++i)
     {
-        FILE_DB_LOG_DEBUG("Edit error, File error");
-        pthread_mutex_unlock(&_this->m_file_db_mutex);
-        return -3;
+        file_db_load_part_t* part = &parts[i];
+        memset(part, 0, sizeof(file_db_load_part_t));
+        part->_this = _this;
+        part->records = records;
+        part->positions = positions;
+        part->begin = (int)((long long)slot_cnt * i / part_cnt);
+        part->end = (int)((long long)slot_cnt * (i + 1) / part_cnt);
     }
-    fseek(db_fp, record_data->offset, SEEK_SET);
+    file_db_parallel(file_db_load_scan, parts, sizeof(file_db_load_part_t), part_cnt);
 
-    if(fwrite(record_data->ele, _this->m_data_size, 1, db_fp) != 1)
+    for(int i = 0; i < part_cnt; ++i)
     {
-        fclose(db_fp);
-        pthread_mutex_unlock(&_this->m_file_db_mutex);
-        FILE_DB_LOG_DEBUG("Edit element, write new error!");
-        return -4;
+        if(0 != parts[i].res_code)
+            return parts[i].res_code;
     }
-    fclose(db_fp);
-    pthread_mutex_unlock(&_this->m_file_db_mutex);
     return 0;
 }
 
+static void* file_db_load_merge_pair(void* arg)
+{
+    file_db_load_merge_t* merge = (file_db_load_merge_t*)arg;
+    const file_db_key_index_t* left = merge->left;
+    const file_db_key_index_t* left_end = left + merge->left_cnt;
+    const file_db_key_index_t* right = merge->right;
+    const file_db_key_index_t* right_end = right + merge->right_cnt;
+    file_db_key_index_t* out = merge->out;
+
+    // 左段的记录位置都小于右段，键值相同时取左段即保持按 (key, 记录位置) 的顺序
+    while(left < left_end && right < right_end)
+        *out++ = right->key < left->key ? *right++ : *left++;
+    if(left < left_end)
+        memcpy(out, left, sizeof(file_db_key_index_t) * (left_end - left));
+    else if(right < right_end)
+        memcpy(out, right, sizeof(file_db_key_index_t) * (right_end - right));
+    return NULL;
+}
+
 /*
 @func: 
-    根据键值查询文件数据库中的元素
+    合并各段排好序的 (key, 记录位置)
 
 @para: 
-    db : 文件数据库指针
-    key : 元素的键值
+    entries : 各段的结果从该段的第一个记录位置开始存放，输出时连续存放且整体有序
+    parts : 各段的扫描结果
+    part_cnt : 分段数量
 
 @return:
-    void* : NULL 查询失败， other 查询到的元素的指针
+    int : 合并后的项数
 
 @note:
-    none.
+    每轮把相邻的两段并行合并到另一个缓冲区，共 log2(part_cnt) 轮；临时缓冲区申请失败时整体排序
 */
-static void* file_db_query(file_db_t* db, int key)
+static int file_db_load_merge(file_db_key_index_t* entries, const file_db_load_part_t* parts, int part_cnt)
 {
-    file_db_private_t* _this = get_private_member(db);
-    if(NULL == _this) 
+    const file_db_key_index_t* runs[FILE_DB_LOAD_MAX_THREADS];
+    int run_cnts[FILE_DB_LOAD_MAX_THREADS];
+    int cnt = 0;
+    for(int i = 0; i < part_cnt; ++i)
     {
-        FILE_DB_LOG_DEBUG("_this is NULL");
-        return NULL;
+        runs[i] = entries + parts[i].begin;
+        run_cnts[i] = parts[i].used_cnt;
+        cnt += parts[i].used_cnt;
     }
-    file_db_record_t* record_data = (file_db_record_t*)(_this->m_tree->query_by_key(_this->m_tree->_this, key));
-    if(NULL == record_data) 
+    if(part_cnt <= 1)
+        return cnt;
+
+    file_db_key_index_t* buff = (file_db_key_index_t*)malloc(sizeof(file_db_key_index_t) * (cnt > 0 ? cnt : 1));
+    if(NULL == buff)
     {
-        FILE_DB_LOG_DEBUG("record_data is NULL");
-        return NULL;
+        int n = 0;
+        for(int i = 0; i < part_cnt; ++i)
+        {
+            memmove(entries + n, runs[i], sizeof(file_db_key_index_t) * run_cnts[i]);
+            n += run_cnts[i];
+        }
+        qsort(entries, cnt, sizeof(file_db_key_index_t), file_db_key_index_cmp);
+        return cnt;
     }
-    return record_data->ele;
+
+    file_db_load_merge_t merges[FILE_DB_LOAD_MAX_THREADS];
+    file_db_key_index_t* dst = buff;
+    int run_cnt = part_cnt;
+    while(run_cnt > 1)
+    {
+        int merge_cnt = 0;
+        int pos = 0;
+        for(int i = 0; i < run_cnt; i += 2)
+        {
+            file_db_load_merge_t* merge = &merges[merge_cnt++];
+            merge->left = runs[i];
+            merge->left_cnt = run_cnts[i];
+            merge->right = i + 1 < run_cnt ? runs[i + 1] : NULL;
+            merge->right_cnt = i + 1 < run_cnt ? run_cnts[i + 1] : 0;
+            merge->out = dst + pos;
+            pos += merge->left_cnt + merge->right_cnt;
+        }
+        file_db_parallel(file_db_load_merge_pair, merges, sizeof(file_db_load_merge_t), merge_cnt);
+
+        for(int i = 0; i < merge_cnt; ++i)
+        {
+            runs[i] = merges[i].out;
+            run_cnts[i] = merges[i].left_cnt + merges[i].right_cnt;
+        }
+        run_cnt = merge_cnt;
+        dst = dst == buff ? entries : buff;
+    }
+
+    if(runs[0] != entries)
+        memcpy(entries, runs[0], sizeof(file_db_key_index_t) * cnt);
+    free(buff);
+    return cnt;
 }
 
 /*
 @func: 
-    写入文件数据库的文件头
+    把一段排好序的 (key, 记录位置) 转换为索引中的记录
 
 @para: 
-    db : 文件数据库指针
-    head : 写入的文件头指针
+    arg : file_db_load_fill_t 指针
 
 @return:
-    int : < 0 : 失败， 0 ： 成功
+    NULL
 
 @note:
-    none.
+    键值与前一项相同的记录不写入，各段写入的位置由调用者预先计算，互不重叠；
+    需要用户数据时只记录每个记录位置对应的记录下标，之后由 file_db_load_copy 分块读取
 */
-static int file_db_write_head(file_db_t* db, void* head)
+static void* file_db_load_fill(void* arg)
 {
-    file_db_private_t* _this = get_private_member(db);
-
-    if(NULL == _this || NULL == head) return -1;
-    pthread_mutex_lock(&_this->m_file_db_mutex);
-    FILE* db_fp = fopen(_this->m_path, "rb+");
-
-    if(NULL == db_fp) return -2;
+    file_db_load_fill_t* fill = (file_db_load_fill_t*)arg;
+    file_db_private_t* _this = fill->_this;
+    int n = fill->first;
 
-    if(fwrite(head, _this->m_head_size, 1, db_fp) != 1)
+    for(int i = fill->begin; i < fill->end; ++i)
     {
-        fclose(db_fp);
-        pthread_mutex_unlock(&_this->m_file_db_mutex);
-        return -3;
+        const file_db_key_index_t* entry = fill->entries + i;
+        _this->m_slot_keys[entry->index] = entry->key;
+        if(i > 0 && entry->key == entry[-1].key)
+            continue;
+
+        file_db_record_t* record_data = FILE_DB_RECORD_AT(_this, fill->records, n);
+        record_data->offset = FILE_DB_SLOT_OFFSET(_this, entry->index);
+        record_data->db = fill->db;
+        if(_this->m_option.lazy)
+            memcpy(record_data->ele, &entry->key, sizeof(int));
+        else if(NULL != fill->positions)
+            fill->positions[entry->index] = n;
+        n++;
     }
-
-    fclose(db_fp);
-    pthread_mutex_unlock(&_this->m_file_db_mutex);
-    return 0;
+    return NULL;
 }
 
-
 /*
 @func: 
-    读取文件数据库的文件头到指定内存中
+    内存映射模式下确定每个记录位置上的键值与空闲的位置
 
 @para: 
-    db : 文件数据库指针
-    head : 读出的文件头指针
+    _this : 私有成员
+    entries : 输出按键值排序的 (key, 记录位置)，键值相同时按记录位置排序
 
 @return:
     int : < 0 : 失败， 0 ： 成功
 
 @note:
-    none.
+    优先使用与数据文件匹配的索引文件，索引文件使用后即删除，异常退出时不会留下过期的索引；
+    否则扫描全部记录的键值并排序。记录直接引用映射区，不需要读取；
+    提取键值与排序按记录位置分段并行执行，各段的有序结果再归并
 */
-static int file_db_read_head(file_db_t* db, void* head)
+static int file_db_load_entries_mmap(file_db_private_t* _this, file_db_key_index_t* entries)
 {
-    file_db_private_t* _this = get_private_member(db);
-
-    if(NULL == _this || NULL == head) return -1;
-
-    FILE* db_fp = fopen(_this->m_path, "rb+");
+    int slot_cnt = _this->m_data_cnt;
+    int slot_size = _this->m_slot_size;
+    int part_cnt = file_db_load_threads(_this, slot_cnt);
+    file_db_load_part_t parts[FILE_DB_LOAD_MAX_THREADS];
+    char* slots = _this->m_map + FILE_DB_DATA_START(_this);
+
+    // 第一遍找出空闲的位置，确定记录数量后才能校验索引文件
+    if(_this->m_option.free_list)
+    {
+        int res_code = file_db_load_run(_this, slots, NULL, true, parts, part_cnt);
+        if(0 != res_code)
+            return res_code;
+    }
+    int cnt = slot_cnt - _this->m_free_cnt;
 
-    if(NULL == db_fp) return -1;
+    char path[sizeof(_this->m_path) + 8];
+    file_db_index_path(_this, path, sizeof(path));
+    int index_res = file_db_read_index(_this, entries, cnt);
+    unlink(path);
 
-    if(fread(head, _this->m_head_size, 1, db_fp) != 1)
+    // 索引项必须指向非空闲的位置
+    for(int i = 0; 0 == index_res && _this->m_option.free_list && i < cnt; ++i)
     {
-        fclose(db_fp);
-        return -2;
+        int32_t tag;
+        memcpy(&tag, slots + (size_t)entries[i].index * slot_size, sizeof(int32_t));
+        if(FILE_DB_SLOT_USED != tag)
+            index_res = -6;
     }
 
-    fclose(db_fp);
+    if(0 != index_res)
+    {
+        int res_code = file_db_load_run(_this, slots, entries, false, parts, part_cnt);
+        if(0 != res_code)
+            return res_code;
+        file_db_load_merge(entries, parts, part_cnt);
+    }
     return 0;
 }
 
-
 /*
 @func: 
-    返回文件数据库中的元素个数
+    确定每个记录位置上的键值与空闲的位置
 
 @para: 
-    db : 文件数据库指针
+    _this : 私有成员
+    entries : 输出按键值排序的 (key, 记录位置)，键值相同时按记录位置排序
 
 @return:
-    int : < 0 : 失败， other ： 元素个数
+    int : < 0 : 失败， 0 ： 成功
 
 @note:
-    none.
+    非空闲列表模式下索引文件匹配时不需要扫描数据文件；否则各线程按 FILE_DB_LOAD_CHUNK_SIZE 分块扫描各自的一段，
+    同时找出空闲的位置，只保留键值，内存占用与数据文件大小无关。
+    空闲列表模式下找出空闲位置本身就要读取全部记录，不使用索引文件
 */
-static int file_db_size(file_db_t* db)
+static int file_db_load_entries(file_db_private_t* _this, file_db_key_index_t* entries)
 {
-    file_db_private_t* _this = get_private_member(db);
-
-    if(NULL == _this) return -1;
-
-    return _this->m_data_cnt;
+    int slot_cnt = _this->m_data_cnt;
+
+    char path[sizeof(_this->m_path) + 8];
+    file_db_index_path(_this, path, sizeof(path));
+    int index_res = _this->m_option.free_list ? -1 : file_db_read_index(_this, entries, slot_cnt);
+    unlink(path);
+    if(0 == index_res)
+        return 0;
+
+    file_db_load_part_t parts[FILE_DB_LOAD_MAX_THREADS];
+    int part_cnt = file_db_load_threads(_this, slot_cnt);
+    int res_code = file_db_load_run(_this, NULL, entries, true, parts, part_cnt);
+    if(0 != res_code)
+        return res_code;
+    file_db_load_merge(entries, parts, part_cnt);
+    return 0;
 }
 
 /*
 @func: 
-    遍历文件数据库中的所有内容，然后使用传入的函数指针对每个元素执行操作
+    读取数据文件中的全部记录并建立索引
 
 @para: 
     db : 文件数据库指针
-    visit : 对元素操作的函数指针
 
 @return:
     int : < 0 : 失败， 0 ： 成功
 
 @note:
-    none.
+    有序的记录一次构建为平衡树，不需要逐个插入与旋转；记录数量多时分段并行拷贝数据到记录中；
+    默认模式下用户数据按记录位置顺序分块读取后拷贝，不会一次读出整个数据文件；
+    键值重复的记录只保留文件中的第一个，其余的加载完成后从文件中删除
 */
-static int file_db_traverse(file_db_t* db, void (*visit)(void*))
+static int file_db_load(file_db_t* db)
 {
-    if(NULL == db || NULL == visit)
-    {
-        FILE_DB_LOG_DEBUG("[file_db_traverse] para error");
+    file_db_private_t* _this = get_private_member(db);
+    int slot_cnt = _this->m_data_cnt;
+
+    if(0 != file_db_slot_reserve(_this, slot_cnt))
         return -1;
+    if(0 == slot_cnt)
+        return 0;
+
+    file_db_key_index_t* entries = (file_db_key_index_t*)malloc(sizeof(file_db_key_index_t) * slot_cnt);
+    char* records = (char*)malloc((size_t)slot_cnt * _this->m_record_size);
+    // 默认模式下记录中保存用户数据，先确定每个记录位置对应的记录，再按记录位置顺序读取
+    bool copy = !_this->m_option.lazy && NULL == _this->m_map;
+    int* positions = copy ? (int*)malloc(sizeof(int) * slot_cnt) : NULL;
+    int* orphans = NULL;
+    int orphan_cnt = 0;
+    int res_code = 0;
+    if(NULL == entries || NULL == records || (copy && NULL == positions))
+    {
+        res_code = -2;
+        goto RUNTIME_ERROR;
     }
 
-    file_db_private_t* _this = get_private_member(db);
-
-    if(NULL == _this) return -2;
+    if(NULL != _this->m_map)
+        res_code = file_db_load_entries_mmap(_this, entries);
+    else
+        res_code = file_db_load_entries(_this, entries);
+    if(0 != res_code)
+        goto RUNTIME_ERROR;
+    if(copy)
+        memset(positions, 0xff, sizeof(int) * slot_cnt);
+
+    // 先找出重复的记录并确定每段第一个记录的下标，再并行拷贝数据到记录中
+    int cnt = slot_cnt - _this->m_free_cnt;
+    int part_cnt = file_db_load_threads(_this, cnt);
+    file_db_load_fill_t fills[FILE_DB_LOAD_MAX_THREADS];
+    int n = 0;
+    for(int p = 0; p < part_cnt; ++p)
+    {
+        file_db_load_fill_t* fill = &fills[p];
+        fill->_this = _this;
+        fill->db = db;
+        fill->entries = entries;
+        fill->positions = positions;
+        fill->records = records;
+        fill->begin = (int)((long long)cnt * p / part_cnt);
+        fill->end = (int)((long long)cnt * (p + 1) / part_cnt);
+        fill->first = n;
+        for(int i = fill->begin; i < fill->end; ++i)
+        {
+            if(i == 0 || entries[i].key != entries[i - 1].key)
+            {
+                n++;
+                continue;
+            }
+            int* orphan = (int*)realloc(orphans, sizeof(int) * (orphan_cnt + 1));
+            if(NULL == orphan)
+            {
+                res_code = -4;
+                goto RUNTIME_ERROR;
+            }
+            orphans = orphan;
+            orphans[orphan_cnt++] = entries[i].index;
+        }
+    }
+    file_db_parallel(file_db_load_fill, fills, sizeof(file_db_load_fill_t), part_cnt);
+    if(copy)
+    {
+        file_db_load_part_t parts[FILE_DB_LOAD_MAX_THREADS];
+        res_code = file_db_load_copy(_this, records, positions, parts, file_db_load_threads(_this, slot_cnt));
+        free(positions);
+        positions = NULL;
+        if(0 != res_code)
+            goto RUNTIME_ERROR;
+    }
 
-    _this->pf_visit = visit;
-    _this->m_tree->preorder(_this->m_tree->_this, file_db_visit_record);
+    if(0 != _this->m_tree->build_sorted(_this->m_tree->_this, records, n))
+    {
+        FILE_DB_LOG_DEBUG("build index error!");
+        res_code = -5;
+        goto RUNTIME_ERROR;
+    }
+    free(records);
+    free(entries);
+
+    // 删除重复的记录会移动记录并修改记录数量，后台加载时先等待正在扫描数据文件的探测结束
+    if(orphan_cnt > 0)
+        file_db_probe_close(_this);
+    res_code = file_db_remove_orphans(_this, orphans, orphan_cnt) < 0 ? -6 : 0;
+    free(orphans);
+    return res_code;
 
-    return 0;
+RUNTIME_ERROR:
+    free(positions);
+    free(orphans);
+    free(records);
+    free(entries);
+    return res_code;
 }
 
 /*
 @func: 
-    清除文件数据库内容，但是保存文件头
+    后台加载线程，持有写锁加载全部记录并建立索引，结束后通知等待者并调用 on_ready
 
 @para: 
-    db : 文件数据库指针
+    arg : 文件数据库指针
 
 @return:
-    int : -1 : 失败， 0 ： 成功
+    NULL
 
 @note:
-    【重要】此函数不能与 file_db_destory 同时使用
+    加载失败时清空索引，之后会写入数据文件的操作返回 -11
 */
-static int file_db_clear(file_db_t* db)
+static void* file_db_load_thread(void* arg)
 {
+    file_db_t* db = (file_db_t*)arg;
     file_db_private_t* _this = get_private_member(db);
 
-    if(NULL == _this) return -1;
-    int cnt = 0;
+    pthread_rwlock_wrlock(&_this->m_file_db_lock);
+    pthread_mutex_lock(&_this->m_load_mutex);
+    _this->m_load_locked = true;
+    pthread_cond_broadcast(&_this->m_load_cond);
+    pthread_mutex_unlock(&_this->m_load_mutex);
 
-    pthread_mutex_lock(&_this->m_file_db_mutex);
-    FILE* db_fp = fopen(_this->m_path, "rb+");
-    if(NULL == db_fp)
+    int res_code = file_db_load(db);
+    if(0 == res_code)
     {
-        pthread_mutex_unlock(&_this->m_file_db_mutex);
-        return -1;
+        _this->m_loaded = true;
+        if(_this->m_option.compact && 0 != file_db_compact_start(_this))
+            FILE_DB_LOG_DEBUG("background compact disabled");
     }
-    fseek(db_fp, _this->m_head_size, SEEK_SET);
-    if(1 != fwrite(&cnt, sizeof(int), 1, db_fp))
+    else
     {
-        fclose(db_fp);
-        pthread_mutex_unlock(&_this->m_file_db_mutex);
-        FILE_DB_LOG_DEBUG("[file_db_clear] : write cnt error");
-        return -2;
-    } 
-    fclose(db_fp);
-    truncate(_this->m_path, _this->m_head_size + sizeof(int));
-    pthread_mutex_unlock(&_this->m_file_db_mutex);
-    
-    _this->m_data_cnt = 0;
-
-    _this->m_tree->clear_node(_this->m_tree->_this);
-
-    return 0;
+        FILE_DB_LOG_DEBUG("background load error %d", res_code);
+        _this->m_tree->clear_node(_this->m_tree->_this);
+    }
+    _this->m_load_res = res_code;
+
+    // 加载期间开始的探测全部结束后才释放写锁，之后的修改不会与探测同时进行
+    file_db_probe_close(_this);
+    pthread_mutex_lock(&_this->m_load_mutex);
+    _this->m_loading = false;
+    pthread_cond_broadcast(&_this->m_load_cond);
+    pthread_mutex_unlock(&_this->m_load_mutex);
+    pthread_rwlock_unlock(&_this->m_file_db_lock);
+
+    if(NULL != _this->m_option.on_ready)
+        _this->m_option.on_ready(db, res_code, _this->m_option.on_ready_arg);
+    return NULL;
 }
 
 /*
 @func: 
-    并释放文件数据库相关动态内存
+    查询后台加载的状态 / 等待后台加载结束
 
 @para: 
     db : 文件数据库指针
 
 @return:
-    int : -1 : 失败， 0 ： 成功
+    int : < 0 : 加载失败， 0 ： 加载完成， 1 ： 正在加载（只有 ready 返回）
 
 @note:
-    【重要】此函数不能与 file_db_destory 同时使用
+    未启用 background_load 时 file_db_init_ex 返回前已加载完成，总是返回 0
 */
-static int file_db_free(file_db_t* db)
+static int file_db_ready(file_db_t* db)
 {
     file_db_private_t* _this = get_private_member(db);
-
     if(NULL == _this) return -1;
 
-    if(_this->m_data_cnt > 0)
-        _this->m_tree->clear_node(_this->m_tree->_this);
+    pthread_mutex_lock(&_this->m_load_mutex);
+    int res_code = _this->m_loading ? 1 : _this->m_load_res;
+    pthread_mutex_unlock(&_this->m_load_mutex);
+    return res_code;
+}
 
-    _this->m_tree->destory(&_this->m_tree);
+static int file_db_wait_ready(file_db_t* db)
+{
+    file_db_private_t* _this = get_private_member(db);
+    if(NULL == _this) return -1;
 
-    free(_this);
-    free(db);
-    return 0;
+    pthread_mutex_lock(&_this->m_load_mutex);
+    while(_this->m_loading)
+        pthread_cond_wait(&_this->m_load_cond, &_this->m_load_mutex);
+    int res_code = _this->m_load_res;
+    pthread_mutex_unlock(&_this->m_load_mutex);
+    return res_code;
 }
 
 /*
 @func: 
-    销毁数据库文件并释放相关动态内存
+    使用指定的文件初始化文件数据库
 
 @para: 
-    db : 文件数据库指针
+    path : 存放数据的文件所在路径 
 
 @return:
-    int : -1 : 失败， 0 ： 成功
+    file_db_t* : 文件数据库指针
 
 @note:
-    【重要】此函数不能与 file_db_free 同时使用
+    如果不再使用该数据库需要调用销毁函数释放内存
+    【重要】保存的数据的数据类型大小必须是固定的
 */
-static int file_db_destory(file_db_t* db)
+file_db_t* file_db_init(const char* path, int head_size, int data_size, int (*pf_hash_func)(void *), void* head)
 {
-    file_db_private_t* _this = get_private_member(db);
-
-    if(NULL == _this) 
-    {
-        FILE_DB_LOG_DEBUG("destory error");
-        return -1;
-    }
-    unlink(_this->m_path);
-
-    return file_db_free(db);
+    return file_db_init_ex(path, head_size, data_size, pf_hash_func, head, NULL);
 }
+
 /*
 @func: 
-    使用指定的文件初始化文件数据库
+    使用指定的文件与打开选项初始化文件数据库
 
 @para: 
     path : 存放数据的文件所在路径 
+    option : 打开选项，NULL 时与 file_db_init 相同
 
 @return:
     file_db_t* : 文件数据库指针
 
 @note:
-    如果不再使用该数据库需要调用销毁函数释放内存
-    【重要】保存的数据的数据类型大小必须是固定的
+    其余参数与 file_db_init 相同
 */
-file_db_t* file_db_init(const char* path, int head_size, int data_size, int (*pf_hash_func)(void *), void* head)
+file_db_t* file_db_init_ex(const char* path, int head_size, int data_size, int (*pf_hash_func)(void *), void* head, const file_db_option_t* option)
 {
     if(NULL == path || NULL == pf_hash_func || NULL == head) return NULL;
+    if(strlen(path) >= sizeof(((file_db_private_t*)0)->m_path) || head_size <= 0 || data_size <= 0) return NULL;
+    // 映射区的修改不经过日志，两种模式不能同时使用
+    if(NULL != option && option->wal && option->mmap) return NULL;
+    // 懒加载模式从数据文件读取用户数据，日志中未写回的修改读不到；内存映射模式本身就按需读取
+    if(NULL != option && option->lazy && (option->wal || option->mmap)) return NULL;
     
     file_db_private_t* _private_ = (file_db_private_t*) malloc(sizeof(file_db_private_t));
     if(NULL == _private_)
@@ -664,7 +4553,25 @@ file_db_t* file_db_init(const char* path, int head_size, int data_size, int (*pf
     }
     
     
-    avl_tree_t* tree = avl_tree_create(sizeof(file_db_record_t), file_db_get_key, file_db_free_ele, 1);
+    // 用户数据内嵌在记录中，平衡二叉树把记录内嵌在树节点中，查找与遍历每个记录只访问一块内存；
+    // 内存映射模式下用户数据在映射区中，记录不需要保存；懒加载模式下记录只保存键值。
+    // 树的全部访问都在 m_file_db_lock 保护下进行，树本身不需要再加锁
+    int record_size = (int)sizeof(file_db_record_t) + ((NULL != option && option->mmap) ? 0 : data_size);
+    if(NULL != option && option->lazy)
+        record_size = (int)sizeof(file_db_record_t) + (int)sizeof(int);
+    // 记录数组中的每个记录需按 off_t 对齐
+    record_size = (record_size + (int)sizeof(off_t) - 1) / (int)sizeof(off_t) * (int)sizeof(off_t);
+    avl_tree_t* tree = NULL;
+    if(NULL != option && option->frozen)
+        tree = frozen_index_create(record_size, file_db_get_key, NULL, false);
+    else if(NULL != option && FILE_DB_INDEX_BPLUS == option->index)
+        tree = bplus_tree_create(record_size, file_db_get_key, NULL, false);
+    else if(NULL != option && FILE_DB_INDEX_HASH == option->index)
+        tree = hash_index_create(record_size, file_db_get_key, NULL, false);
+    else if(NULL != option && FILE_DB_INDEX_DENSE == option->index)
+        tree = dense_index_create(record_size, file_db_get_key, NULL, false);
+    else
+        tree = avl_tree_create_ex(record_size, file_db_get_key, NULL, false, true);
     if(NULL == tree)
     {
         free(_private_);
@@ -689,9 +4596,24 @@ file_db_t* file_db_init(const char* path, int head_size, int data_size, int (*pf
     _private_->m_head_size = head_size;
     _private_->m_data_size = data_size;
     _private_->m_tree = tree;
+    _private_->m_record_size = record_size;
     _private_->m_data_cnt = 0;
+    _private_->m_fd = -1;
     _private_->pf_get_ele_key = pf_hash_func;
-    pthread_mutex_init(&_private_->m_file_db_mutex, NULL);
+    if(NULL != option)
+        _private_->m_option = *option;
+    _private_->m_frozen = _private_->m_option.frozen;
+    _private_->m_slot_head = _private_->m_option.free_list ? (int)sizeof(int32_t) : 0;
+    _private_->m_slot_size = _private_->m_slot_head + data_size;
+    pthread_rwlock_init(&_private_->m_file_db_lock, NULL);
+    pthread_mutex_init(&_private_->m_visit_mutex, NULL);
+    pthread_mutex_init(&_private_->m_compact_run_mutex, NULL);
+    pthread_mutex_init(&_private_->m_compact_mutex, NULL);
+    pthread_cond_init(&_private_->m_compact_cond, NULL);
+    pthread_mutex_init(&_private_->m_load_mutex, NULL);
+    pthread_cond_init(&_private_->m_load_cond, NULL);
+    pthread_mutex_init(&_private_->m_sync_mutex, NULL);
+    pthread_cond_init(&_private_->m_sync_cond, NULL);
  
     
     file_db->_this = file_db;
@@ -700,105 +4622,209 @@ file_db_t* file_db_init(const char* path, int head_size, int data_size, int (*pf
     file_db->add = file_db_add;
     file_db->del = file_db_del;
     file_db->edit = file_db_edit;
+    file_db->add_batch = file_db_add_batch;
+    file_db->del_batch = file_db_del_batch;
+    file_db->edit_batch = file_db_edit_batch;
     file_db->query = file_db_query;
+    file_db->pin = file_db_pin;
+    file_db->unpin = file_db_unpin;
+    file_db->query_batch = file_db_query_batch;
+    file_db->pin_batch = file_db_pin_batch;
     file_db->write_head = file_db_write_head;
     file_db->read_head = file_db_read_head;
     file_db->size = file_db_size;
     file_db->traverse = file_db_traverse;
+    file_db->seek = file_db_seek;
+    file_db->seek_last = file_db_seek_last;
+    file_db->next = file_db_next;
+    file_db->prev = file_db_prev;
+    file_db->range = file_db_range;
+    file_db->rank = file_db_rank;
+    file_db->select = file_db_select;
+    file_db->count_range = file_db_count_range;
+    file_db->freeze = file_db_freeze;
+    file_db->compact = file_db_compact;
     file_db->clear = file_db_clear;
+    file_db->ready = file_db_ready;
+    file_db->wait_ready = file_db_wait_ready;
+    file_db->read = file_db_read;
+    file_db->add_async = file_db_add_async;
+    file_db->del_async = file_db_del_async;
+    file_db->edit_async = file_db_edit_async;
+    file_db->query_async = file_db_query_async;
+    file_db->flush_async = file_db_flush_async;
     file_db->free = file_db_free;
     file_db->destory = file_db_destory;
 
-    FILE* db_fp = fopen(_private_->m_path, "rb");
-    if(NULL == db_fp)
+    _private_->m_head = malloc(head_size);
+    _private_->m_record_buff = malloc(record_size);
+    if(NULL == _private_->m_head || NULL == _private_->m_record_buff)
+    {
+        FILE_DB_LOG_DEBUG("head null!");
+        file_db_free(file_db);
+        return NULL;
+    }
+
+    _private_->m_fd = open(_private_->m_path, O_RDWR);
+    if(_private_->m_fd < 0)
     {
-        db_fp = fopen(_private_->m_path, "wb");
-        if(NULL == db_fp)
+        _private_->m_fd = open(_private_->m_path, O_RDWR | O_CREAT | O_EXCL, 0666);
+        if(_private_->m_fd < 0)
         {
             FILE_DB_LOG_DEBUG("create db error!");
             file_db_free(file_db);
             return NULL;
         }
+        // 数据文件不存在时，残留的日志不属于新文件
+        wal_remove(path);
 
-        if(1 != fwrite(head, head_size, 1, db_fp))
+        // 文件头与记录数量合并为一次写入
+        char* head_buff = (char*)malloc(FILE_DB_DATA_START(_private_));
+        if(NULL == head_buff)
         {
-            FILE_DB_LOG_DEBUG("write head error!");
+            FILE_DB_LOG_DEBUG("head buff null!");
             file_db_free(file_db);
-            fclose(db_fp);
             unlink(path);
             return NULL;
         }
+        int cnt_field = _private_->m_option.free_list ? FILE_DB_CNT_FREE_LIST : 0;
+        memcpy(head_buff, head, head_size);
+        memcpy(head_buff + head_size, &cnt_field, sizeof(int));
 
-        if(1 != fwrite(&_private_->m_data_cnt, sizeof(int), 1, db_fp))
+        if(0 != file_db_pwrite(_private_->m_fd, head_buff, FILE_DB_DATA_START(_private_), 0))
         {
             FILE_DB_LOG_DEBUG("write head error!");
+            free(head_buff);
             file_db_free(file_db);
-            fclose(db_fp);
             unlink(path);
             return NULL;
         }
-        fclose(db_fp);
+        free(head_buff);
     }
-    else
+
+    // 打开日志时会把上次未写入数据文件的修改重放到数据文件中
+    if(_private_->m_option.wal)
+    {
+        _private_->m_wal = wal_create(path, _private_->m_fd, FILE_DB_SYNC_GROUP == _private_->m_option.sync || FILE_DB_SYNC_EVERY == _private_->m_option.sync, _private_->m_option.wal_checkpoint_size);
+        if(NULL == _private_->m_wal)
+        {
+            FILE_DB_LOG_DEBUG("open wal error!");
+            file_db_free(file_db);
+            return NULL;
+        }
+    }
+
+    // 内核不支持 io_uring 时退回 pwrite
+    if(FILE_DB_IO_URING == _private_->m_option.io && NULL == _private_->m_wal && !_private_->m_option.mmap)
+    {
+        _private_->m_ring = io_ring_create(_private_->m_fd, 0, 0);
+        if(NULL == _private_->m_ring)
+            FILE_DB_LOG_DEBUG("io_uring unavailable, use pwrite");
+    }
+
+    if(0 != file_db_pread(_private_->m_fd, head, head_size, 0))
+    {
+        FILE_DB_LOG_DEBUG("read head error!");
+        file_db_free(file_db);
+        return NULL;
+    }
+    memcpy(_private_->m_head, head, head_size);
+
+    int cnt_field = 0;
+    if(0 != file_db_pread(_private_->m_fd, &cnt_field, sizeof(int), head_size))
+    {
+        FILE_DB_LOG_DEBUG("read cnt error!");
+        file_db_free(file_db);
+        return NULL;
+    }
+    // 两种删除模式的文件结构不同，不能混用
+    if((0 != (cnt_field & FILE_DB_CNT_FREE_LIST)) != _private_->m_option.free_list)
+    {
+        FILE_DB_LOG_DEBUG("free list mode mismatch!");
+        file_db_free(file_db);
+        return NULL;
+    }
+    _private_->m_data_cnt = cnt_field & ~FILE_DB_CNT_FREE_LIST;
+
+    if(_private_->m_option.mmap && 0 != file_db_mmap_open(_private_))
     {
-        if(1 != fread(head, head_size, 1, db_fp))
+        FILE_DB_LOG_DEBUG("mmap db error!");
+        file_db_free(file_db);
+        return NULL;
+    }
+
+    // 每个缓存块包含整数个记录位置，记录不会跨越块的边界
+    if(_private_->m_option.lazy)
+    {
+        int block_size = FILE_DB_CACHE_BLOCK_SIZE / _private_->m_slot_size * _private_->m_slot_size;
+        if(block_size <= 0)
+            block_size = _private_->m_slot_size;
+        long cache_size = _private_->m_option.cache_size > 0 ? _private_->m_option.cache_size : FILE_DB_CACHE_SIZE;
+        _private_->m_cache = page_cache_create(_private_->m_fd, FILE_DB_DATA_START(_private_), block_size, cache_size);
+        if(NULL == _private_->m_cache)
         {
-            FILE_DB_LOG_DEBUG("read head error!");
-            fclose(db_fp);
+            FILE_DB_LOG_DEBUG("create page cache error!");
             file_db_free(file_db);
             return NULL;
         }
-        if(1 != fread(&_private_->m_data_cnt, sizeof(int), 1, db_fp))
+    }
+
+    // 工作线程通过同步接口执行操作，后台加载期间提交的操作在加载完成后执行
+    if(_private_->m_option.async_threads > 0)
+    {
+        _private_->m_async = file_db_async_create(file_db, _private_->m_data_size, _private_->m_option.async_threads, _private_->m_option.async_queue_size, _private_->m_option.async_block);
+        if(NULL == _private_->m_async)
         {
-            FILE_DB_LOG_DEBUG("read cnt error!");
-            fclose(db_fp);
+            FILE_DB_LOG_DEBUG("create async queue error!");
             file_db_free(file_db);
             return NULL;
         }
+    }
 
-        file_db_record_t* record_data = NULL;
-        void* element = NULL;
+    if(FILE_DB_SYNC_INTERVAL == _private_->m_option.sync)
+    {
+        if(0 != pthread_create(&_private_->m_sync_thread, NULL, file_db_sync_thread, _private_))
+        {
+            FILE_DB_LOG_DEBUG("create sync thread error!");
+            file_db_free(file_db);
+            return NULL;
+        }
+        _private_->m_sync_started = true;
+    }
 
-        for(int i = 0; i < _private_->m_data_cnt; ++i)
+    // 后台加载线程获取写锁后才返回，加载完成前的其他操作都会等待，查询可以直接探测数据文件
+    if(_private_->m_option.background_load)
+    {
+        _private_->m_loading = true;
+        _private_->m_probe_open = true;
+        if(0 != pthread_create(&_private_->m_load_thread, NULL, file_db_load_thread, file_db))
         {
-            record_data = (file_db_record_t*)malloc(sizeof(file_db_record_t));
-            if(NULL == record_data)
-            {
-                FILE_DB_LOG_DEBUG("record data null!");
-                file_db_free(file_db);
-                fclose(db_fp);
-                return NULL;
-            }
+            FILE_DB_LOG_DEBUG("create load thread error!");
+            _private_->m_loading = false;
+            _private_->m_probe_open = false;
+            file_db_free(file_db);
+            return NULL;
+        }
+        _private_->m_load_started = true;
 
-            element = malloc(_private_->m_data_size);
-            if(NULL == element)
-            {
-                FILE_DB_LOG_DEBUG("element null!");
-                file_db_free(file_db);
-                free(record_data);
-                fclose(db_fp);
-                return NULL;
-            }
-            memset(record_data, 0, sizeof(file_db_record_t));
-            memset(element, 0, _private_->m_data_size);
+        pthread_mutex_lock(&_private_->m_load_mutex);
+        while(!_private_->m_load_locked)
+            pthread_cond_wait(&_private_->m_load_cond, &_private_->m_load_mutex);
+        pthread_mutex_unlock(&_private_->m_load_mutex);
+        return file_db;
+    }
 
-            record_data->offset = ftell(db_fp);
-            record_data->db = file_db;
+    if(0 != file_db_load(file_db))
+    {
+        file_db_free(file_db);
+        return NULL;
+    }
+    _private_->m_loaded = true;
 
-            if(1 != fread(element, _private_->m_data_size, 1, db_fp))
-            {
-                FILE_DB_LOG_DEBUG("read element error!");
-                file_db_free(file_db);
-                free(record_data);
-                free(element);
-                fclose(db_fp);
-                return NULL;
-            }
-            
-            record_data->ele = element;
-            _private_->m_tree->add( _private_->m_tree->_this, record_data);
-        }
-        fclose(db_fp);
+    if(_private_->m_option.compact && 0 != file_db_compact_start(_private_))
+    {
+        file_db_free(file_db);
+        return NULL;
     }
     
     FILE_DB_LOG_DEBUG("init data size %d, head size %d, data cnt %d", _private_->m_data_size, _private_->m_head_size, _private_->m_data_cnt);
@@ -1,8 +1,112 @@
 #ifndef _FILE_DATABASE_H_
 #define _FILE_DATABASE_H_
 
+#include <stdbool.h>
+
 typedef struct _file_db file_db_t;
 
+/*
+    异步操作完成时的回调，在 I/O 工作线程中调用：res 与对应同步接口的返回值相同，arg 为提交时传入的参数
+*/
+typedef void (*file_db_callback_t)(file_db_t* db, int res, void* arg);
+
+/*
+    持久化策略
+*/
+typedef enum _file_db_sync
+{
+    FILE_DB_SYNC_NONE = 0,  // 不主动同步，由操作系统决定何时写回磁盘
+    FILE_DB_SYNC_GROUP,     // 修改操作返回前落盘，并发的修改合并为一次同步
+    FILE_DB_SYNC_EVERY,     // 每次修改在持有写锁时单独同步后才返回，延迟稳定但并发时吞吐量低；预写日志模式下与 GROUP 相同
+    FILE_DB_SYNC_INTERVAL,  // 修改操作不等待落盘，后台线程每 sync_interval 毫秒同步一次，崩溃时最多丢失最近一个间隔内的修改
+}file_db_sync_t;
+
+/*
+    直接写入数据文件时使用的 I/O 方式
+*/
+typedef enum _file_db_io
+{
+    FILE_DB_IO_PWRITE = 0,  // 每次写入调用一次 pwrite
+    FILE_DB_IO_URING,       // 一次修改的全部写入暂存后作为链接的 io_uring 请求一次提交，系统调用更少；内核不支持时退回 pwrite。
+                            // 不支持异步缓冲写的文件系统（如 ext4）上写入由内核工作线程执行，单次修改的延迟反而更高
+}file_db_io_t;
+
+/*
+    索引引擎
+*/
+typedef enum _file_db_index
+{
+    FILE_DB_INDEX_AVL = 0,  // 平衡二叉树，记录内嵌在树节点中
+    FILE_DB_INDEX_BPLUS,    // B+ 树，键值在宽节点中连续存放，叶子节点顺序链接，数据量大时查找与范围访问更快
+    FILE_DB_INDEX_HASH,     // 开放寻址哈希表，只支持按键值精确访问：traverse 的顺序不确定，
+                            // seek / next / prev / range / rank / select / count_range 返回失败
+    FILE_DB_INDEX_DENSE,    // 以键值为下标的直接映射数组，适用于分布在较小连续范围内的键值；
+                            // 内存占用与键值跨度成正比，rank / select / count_range 的耗时也与跨度成正比；
+                            // 键值跨度超过元素个数的 8 倍（至少允许 2^20）时 add 返回 -3，打开已有文件时失败
+}file_db_index_t;
+
+/*
+    文件数据库的打开选项，全部成员为 0 时与 file_db_init 的行为一致
+*/
+typedef struct _file_db_option
+{
+    bool wal;                   // 启用预写日志：修改先顺序追加到 path.wal0/path.wal1，由检查点写回数据文件
+    file_db_sync_t sync;        // 持久化策略，可以按数据库分别设置；未启用预写日志时同步的是数据文件
+    int sync_interval;          // FILE_DB_SYNC_INTERVAL 策略下两次同步的间隔（毫秒），0 使用默认值 1000
+    long wal_checkpoint_size;   // 日志段超过该大小（字节）时触发检查点，0 使用默认值 16MB
+
+    bool mmap;                  // 内存映射模式：记录直接保存在映射的文件中，query 返回指向映射区的指针，不能与 wal 同时使用
+    long mmap_grow_size;        // 内存映射模式下文件每次扩展的大小（字节），0 使用默认值 16MB
+
+    file_db_io_t io;            // 直接写入数据文件时的 I/O 方式，预写日志与内存映射模式下忽略
+
+    bool index_file;            // 关闭时把索引保存到 path.idx，下次打开时直接加载，数据文件被修改过则重新扫描
+
+    bool free_list;             // 空闲列表模式：删除只把记录位置标记为空闲，之后添加的元素优先复用，文件不会缩小；
+                                // 文件结构与默认模式不同，打开已有文件时必须与创建时的设置一致
+
+    bool compact;               // 启用后台整理线程：空闲位置达到 compact_ratio 时把存活的记录重写到紧凑的新文件中
+    int compact_ratio;          // 空闲位置占全部记录位置的百分比达到该值时触发后台整理，0 使用默认值 25
+    long compact_rate;          // 整理时每秒最多写入的字节数，0 不限速
+    bool compact_sorted;        // 整理后的记录按键值升序排列，提高按键值顺序访问文件时的局部性
+
+    bool lazy;                  // 懒加载模式：内存中只保存键值与记录位置，用户数据通过固定大小的页缓存按块读取，
+                                // 内存占用与记录数量无关；需使用 pin/unpin 访问元素，不能与 wal、mmap 同时使用
+    long cache_size;            // 懒加载模式下页缓存的大小（字节），0 使用默认值 16MB；按约 4KB 的块缓存，至少 16 个块，
+                                // 同时固定的元素所在的块不能超过块数
+
+    file_db_index_t index;      // 内存索引使用的引擎，默认平衡二叉树；索引只在内存中，打开已有文件时可以更换
+    bool frozen;                // 加载时直接构建只读索引，效果与打开后立即调用 freeze 相同，但不需要先构建可修改的索引；
+                                // 启用后忽略 index
+
+    int load_threads;           // 打开时扫描数据文件使用的线程数：各线程分段读取、提取键值并排序，再归并后一次构建索引；
+                                // 0 使用在线的 CPU 数量，1 只在调用线程上加载；小文件总是只使用调用线程。
+                                // 大于 1 时 pf_hash_func 会被多个线程同时调用
+
+    bool background_load;       // 后台加载：打开文件后立即返回，索引在后台线程中构建，ready / wait_ready 查询与等待加载结果；
+                                // 加载期间内存映射模式下的 query / pin / query_batch / pin_batch 与懒加载模式下的 pin / pin_batch
+                                // 直接扫描数据文件查找，其他操作等待加载结束；加载失败后 add / add_batch / clear / freeze / compact 返回 -11
+    void (*on_ready)(file_db_t* db, int res, void* arg); // 后台加载结束时在加载线程中调用，res 与 wait_ready 的返回值相同；
+                                                          // 回调中可以访问数据库，但不能释放
+    void* on_ready_arg;         // 传给 on_ready 的参数
+
+    int async_threads;          // 异步接口的 I/O 工作线程数，0 不启用，此时 *_async 返回 -1
+    int async_queue_size;       // 异步队列的总容量，0 使用默认值 1024
+    bool async_block;           // 队列满时 *_async 阻塞等待空位，否则立即返回 -12，由调用者稍后重试
+}file_db_option_t;
+
+/*
+    有序游标：由 seek / seek_last 定位，next / prev 按键值顺序移动；
+    游标不持有锁，两次移动之间数据库被修改时根据当前键值重新定位
+*/
+typedef struct _file_db_cursor
+{
+    int key;            // 当前元素的键值
+    void* ele;          // 当前元素，与 query 的返回值相同，懒加载模式下为 NULL，需使用 pin
+    void* pos;          // 以下为内部状态：当前元素在索引中的位置
+    long long version;  // 定位时索引的版本
+}file_db_cursor_t;
+
 struct _file_db
 {
     file_db_t* _this;
@@ -57,6 +161,61 @@ struct _file_db
 */   
     int (*edit)(file_db_t* db, int key, void *ele);
 
+/*
+@func: 
+    批量添加元素到文件数据库中
+
+@para: 
+    db : 文件数据库指针
+    eles : 连续存放的元素数组，每个元素大小为 data_size
+    cnt : 元素个数
+    status : 每个元素的添加结果，0 成功，-5 键值已存在或与本批次中之前的元素重复，可传 NULL
+
+@return:
+    int : < 0 : 失败， other ： 成功添加的元素个数
+
+@note:
+    成功的元素在文件末尾一次连续写入，记录数量只更新一次；重复的元素不影响其他元素的添加
+*/
+    int (*add_batch)(file_db_t* db, void *eles, int cnt, int *status);
+
+/*
+@func: 
+    通过键值批量删除元素
+
+@para: 
+    db : 文件数据库指针
+    keys : 键值数组
+    cnt : 键值个数
+    status : 每个键值的删除结果，0 成功，-3 不存在，可传 NULL
+
+@return:
+    int : < 0 : 失败， other ： 成功删除的元素个数
+
+@note:
+    记录数量的更新与文件截断整批只执行一次；空闲列表模式下每个元素只写入一个状态标记
+*/
+    int (*del_batch)(file_db_t* db, const int *keys, int cnt, int *status);
+
+/*
+@func: 
+    根据键值批量编辑元素
+
+@para: 
+    db : 文件数据库指针
+    keys : 键值数组
+    eles : 连续存放的目标元素数组，与 keys 一一对应
+    cnt : 元素个数
+    status : 每个元素的编辑结果，0 成功，-1 键值与元素不匹配，-2 不存在，-4 写入或提交失败，可传 NULL
+
+@return:
+    int : < 0 : 失败，整批都没有生效， other ： 成功编辑的元素个数
+
+@note:
+    某个元素写入失败时之后的元素不再编辑，之前的元素仍然生效并计入返回值，失败的元素通过 status 报告
+*/
+    int (*edit_batch)(file_db_t* db, const int *keys, void *eles, int cnt, int *status);
+
 /*
 @func: 
     根据键值查询文件数据库中的元素
@@ -69,10 +228,67 @@ struct _file_db
     void* : NULL 查询失败， other 查询到的元素的指针
 
 @note:
-    none.
+    多个线程可以同时查询，修改操作进行时查询等待其完成；返回的指针在该元素被删除前有效，
+    内存映射模式下返回的指针指向映射区，映射区超出预留的地址空间而被迁移后失效；
+    懒加载模式下返回 NULL，需使用 pin
 */
     void* (*query)(file_db_t* db, int key);
 
+/*
+@func: 
+    根据键值查询元素并固定，固定期间元素所在的缓存块不会被淘汰
+
+@para: 
+    db : 文件数据库指针
+    key : 元素的键值
+
+@return:
+    void* : NULL 查询失败， other 查询到的元素的指针
+
+@note:
+    懒加载模式下访问元素需使用本接口，返回的指针在 unpin 之前有效；其他模式下与 query 相同。
+    每次成功的 pin 都需要调用一次 unpin
+*/
+    void* (*pin)(file_db_t* db, int key);
+
+/*
+@func: 
+    解除 pin 对元素的固定
+
+@para: 
+    db : 文件数据库指针
+    ele : pin 返回的指针
+
+@return:
+    none.
+
+@note:
+    none.
+*/
+    void (*unpin)(file_db_t* db, void* ele);
+
+/*
+@func: 
+    根据键值批量查询元素 / 批量查询并固定元素
+
+@para: 
+    db : 文件数据库指针
+    keys : 键值数组
+    cnt : 键值个数
+    eles : 输出每个键值对应的元素指针，不存在时为 NULL
+
+@return:
+    int : < 0 : 失败，-4 : 页缓存的块不足， other ： 查询到的元素个数
+
+@note:
+    结果与逐个调用 query / pin 相同，整批只获取一次读锁；索引中多个键值交替查找，缓存未命中的等待相互重叠。
+    懒加载模式下 query_batch 返回 -2，需使用 pin_batch：未缓存的块按文件位置排序，相邻的块合并为一次向量读，
+    每个非 NULL 的元素都需要调用一次 unpin。整批结果同时固定，涉及的块多于页缓存中未被固定的块
+    （cache_size / 4KB，至少 16 个）时 pin_batch 返回 -4 且不固定任何元素，应减少每批的键值个数后重试
+*/
+    int (*query_batch)(file_db_t* db, const int* keys, int cnt, void** eles);
+    int (*pin_batch)(file_db_t* db, const int* keys, int cnt, void** eles);
+
 /*
 @func: 
     写入文件数据库的文件头
@@ -132,10 +348,149 @@ struct _file_db
     int : < 0 : 失败， 0 ： 成功
 
 @note:
-    none.
+    遍历可以与查询同时进行，visit 中不能修改本数据库
 */
     int (*traverse)(file_db_t* db, void (*visit)(void*));
 
+/*
+@func: 
+    把游标定位到第一个键值 >= key 的元素 / 最后一个键值 <= key 的元素
+
+@para: 
+    db : 文件数据库指针
+    cursor : 游标
+    key : 键值
+
+@return:
+    int : < 0 : 不存在， 0 ： 成功，cursor->key 与 cursor->ele 为定位到的元素
+
+@note:
+    seek_last(db, cursor, INT_MAX) 定位到最后一个元素，可以从后往前遍历
+*/
+    int (*seek)(file_db_t* db, file_db_cursor_t* cursor, int key);
+    int (*seek_last)(file_db_t* db, file_db_cursor_t* cursor, int key);
+
+/*
+@func: 
+    把游标按键值顺序移动到 下一个 / 上一个 元素
+
+@para: 
+    db : 文件数据库指针
+    cursor : 已定位的游标
+
+@return:
+    int : < 0 : 已到达末尾 / 开头， 0 ： 成功
+
+@note:
+    数据库未被修改时沿索引的父节点指针移动，平均 O(1)；否则按当前键值重新查找，O(log n)；
+    返回 < 0 后需重新定位
+*/
+    int (*next)(file_db_t* db, file_db_cursor_t* cursor);
+    int (*prev)(file_db_t* db, file_db_cursor_t* cursor);
+
+/*
+@func: 
+    按键值升序访问 [low, high) 范围内的元素
+
+@para: 
+    db : 文件数据库指针
+    low : 范围下限，包含
+    high : 范围上限，不包含
+    visit : 对每个元素执行的操作，返回 false 时停止
+    arg : 传给 visit 的参数
+
+@return:
+    int : < 0 : 失败， other ： 访问的元素个数
+
+@note:
+    只访问范围内的元素，不需要遍历整个数据库；持有读锁访问，visit 中不能修改本数据库
+*/
+    int (*range)(file_db_t* db, int low, int high, bool (*visit)(void* ele, void* arg), void* arg);
+
+/*
+@func: 
+    获取键值小于 key 的元素个数，即 key 的排名（从 0 开始）
+
+@para: 
+    db : 文件数据库指针
+    key : 键值，不要求存在
+
+@return:
+    int : < 0 : 失败， other ： 键值小于 key 的元素个数
+
+@note:
+    O(log n)，不需要遍历
+*/
+    int (*rank)(file_db_t* db, int key);
+
+/*
+@func: 
+    把游标定位到按键值升序的第 index 个元素（从 0 开始）
+
+@para: 
+    db : 文件数据库指针
+    cursor : 游标
+    index : 元素的排名
+
+@return:
+    int : < 0 : index 越界， 0 ： 成功
+
+@note:
+    O(log n)；定位后可以用 next / prev 继续移动，适合分页访问或按百分位取键值
+*/
+    int (*select)(file_db_t* db, file_db_cursor_t* cursor, int index);
+
+/*
+@func: 
+    统计键值在 [low, high) 范围内的元素个数
+
+@para: 
+    db : 文件数据库指针
+    low : 范围下限，包含
+    high : 范围上限，不包含
+
+@return:
+    int : < 0 : 失败， other ： 范围内的元素个数
+
+@note:
+    O(log n)，不访问范围内的元素
+*/
+    int (*count_range)(file_db_t* db, int low, int high);
+
+/*
+@func: 
+    把索引冻结为只读索引，适用于加载后只查询的场景
+
+@para: 
+    db : 文件数据库指针
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    键值按 Eytzinger 布局存放在连续数组中，记录按相同顺序存放在并列数组中，查找没有指针跳转，
+    内存占用也比树节点小；冻结后 add / del / add_batch / del_batch / clear 返回 -10，edit 仍可原地修改元素。
+    冻结时重新构建索引，之前 query 返回的指针失效，游标会按当前键值重新定位；已冻结时直接返回 0
+*/
+    int (*freeze)(file_db_t* db);
+
+/*
+@func: 
+    整理数据文件，把存活的记录重写到紧凑的新文件中并替换原文件
+
+@para: 
+    db : 文件数据库指针
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    复制记录期间其他操作照常进行，只在开始与最后替换文件时短暂独占；
+    写入速度受 compact_rate 限制，compact_sorted 时记录按键值排序；
+    内存映射模式下整理后之前 query 返回的指针失效
+*/
+    int (*compact)(file_db_t* db);
+
 /*
 @func: 
     清除文件数据库内容，但是保存文件头
@@ -151,6 +506,77 @@ struct _file_db
 */
     int (*clear)(file_db_t* db);
 
+/*
+@func: 
+    查询后台加载的状态 / 等待后台加载结束
+
+@para: 
+    db : 文件数据库指针
+
+@return:
+    int : < 0 : 加载失败， 0 ： 加载完成， 1 ： 正在加载（只有 ready 返回）
+
+@note:
+    未启用 background_load 时总是返回 0
+*/
+    int (*ready)(file_db_t* db);
+    int (*wait_ready)(file_db_t* db);
+
+/*
+@func: 
+    根据键值查询元素并拷贝到调用者的缓冲区
+
+@para: 
+    db : 文件数据库指针
+    key : 元素的键值
+    ele : 输出元素的缓冲区，大小为 data_size
+
+@return:
+    int : < 0 : 失败，-2 不存在， 0 ： 成功
+
+@note:
+    持有读锁拷贝，拷贝的内容不会被并发的修改破坏；各种模式下都可以使用，不需要 unpin
+*/
+    int (*read)(file_db_t* db, int key, void* ele);
+
+/*
+@func: 
+    异步添加 / 删除 / 编辑 / 查询元素，query_async 与 read 相同，把元素拷贝到调用者的缓冲区
+
+@para: 
+    db : 文件数据库指针
+    key : 元素的键值
+    ele : 添加与编辑时为元素，提交时拷贝，调用者的缓冲区可以立即复用；查询时为输出元素的缓冲区，回调之前写入
+    cb : 完成时在 I/O 工作线程中调用，res 与 add / del / edit / read 的返回值相同，可传 NULL
+    arg : 传给回调的参数
+
+@return:
+    int : < 0 : 提交失败，-12 队列已满，-13 正在关闭， 0 ： 已提交
+
+@note:
+    需启用 async_threads；同一键值的操作按提交的顺序执行，不同键值的操作可能并发执行。
+    阻塞模式下不要在回调中提交新的操作；关闭数据库时先执行完已提交的操作
+*/
+    int (*add_async)(file_db_t* db, void* ele, file_db_callback_t cb, void* arg);
+    int (*del_async)(file_db_t* db, int key, file_db_callback_t cb, void* arg);
+    int (*edit_async)(file_db_t* db, int key, void* ele, file_db_callback_t cb, void* arg);
+    int (*query_async)(file_db_t* db, int key, void* ele, file_db_callback_t cb, void* arg);
+
+/*
+@func: 
+    等待已提交的全部异步操作完成
+
+@para: 
+    db : 文件数据库指针
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    不能在回调中调用
+*/
+    int (*flush_async)(file_db_t* db);
+
 /*
 @func: 
     并释放文件数据库相关动态内存
@@ -199,6 +625,22 @@ struct _file_db
 */
 extern file_db_t* file_db_init(const char* path, int head_size, int data_size, int (*pf_hash_func)(void *), void* head);
 
+/*
+@func: 
+    使用指定的文件与打开选项初始化文件数据库
+
+@para: 
+    path : 存放数据的文件所在路径 
+    option : 打开选项，NULL 时与 file_db_init 相同
+
+@return:
+    file_db_t* : 文件数据库指针
+
+@note:
+    其余参数与 file_db_init 相同
+*/
+extern file_db_t* file_db_init_ex(const char* path, int head_size, int data_size, int (*pf_hash_func)(void *), void* head, const file_db_option_t* option);
+
 
 
 
@@ -0,0 +1,360 @@
+/*
+** File : FileDatabaseAsync.c
+** Author : Saury
+** Date : 2020-09-12
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "FileDatabaseAsync.h"
+
+
+#define DEBUG_LOG 0
+
+#define FILE_DB_ASYNC_LOG_DEBUG(fmt, ...) \
+    do{ \
+        if(DEBUG_LOG) \
+        {\
+            printf("%s at %d " fmt "\r\n", __FILE__, __LINE__, ##__VA_ARGS__);\
+        }\
+    }while(0);
+
+
+// 未指定时全部队列的总容量
+#define FILE_DB_ASYNC_QUEUE_SIZE 1024
+
+/*
+    队列中的一个操作，添加与编辑的元素保存在队列的 m_datas 中，下标相同
+*/
+typedef struct _file_db_async_task
+{
+    file_db_async_op_t op;
+    int key;
+    void* out;
+    file_db_callback_t cb;
+    void* arg;
+}file_db_async_task_t;
+
+/*
+    一个工作线程与它的环形队列
+*/
+typedef struct _file_db_async_worker
+{
+    struct _file_db_async_private* m_owner;
+    pthread_t m_thread;
+    bool m_started;
+    file_db_async_task_t* m_tasks;  // 环形队列
+    char* m_datas;                  // 每个任务的元素，第 i 个从 m_datas + i * data_size 开始
+    char* m_ele;                    // 正在执行的任务的元素副本
+    int m_head;                     // 队首下标
+    int m_cnt;                      // 队列中的任务数量
+    int m_pending;                  // 已入队未完成的任务数量，包含正在执行的任务
+    bool m_stop;                    // 正在关闭，不再接受提交
+    pthread_mutex_t m_mutex;        // 保护以上队列状态
+    pthread_cond_t m_not_empty;     // 入队或关闭时通知工作线程
+    pthread_cond_t m_not_full;      // 出队或关闭时通知阻塞的提交者
+    pthread_cond_t m_idle;          // m_pending 变为 0 时通知 flush
+}file_db_async_worker_t;
+
+typedef struct _file_db_async_private
+{
+    file_db_t* m_db;                    // 执行操作的文件数据库
+    int m_data_size;                    // 元素的大小
+    int m_capacity;                     // 每个队列的容量
+    bool m_block;                       // 队列满时提交是否阻塞
+    int m_worker_cnt;
+    file_db_async_worker_t* m_workers;
+}file_db_async_private_t;
+
+
+static file_db_async_private_t* get_private_member(file_db_async_t* async)
+{
+    if(NULL == async) return NULL;
+
+    return (file_db_async_private_t*)async->_private_;
+}
+
+/*
+@func:
+    执行一个任务
+
+@para:
+    _this : 私有成员
+    task : 任务
+    ele : 任务的元素副本
+
+@return:
+    int : 同步接口的返回值
+*/
+static int file_db_async_execute(file_db_async_private_t* _this, const file_db_async_task_t* task, void* ele)
+{
+    file_db_t* db = _this->m_db;
+    switch(task->op)
+    {
+    case FILE_DB_ASYNC_ADD:
+        return db->add(db->_this, ele);
+    case FILE_DB_ASYNC_DEL:
+        return db->del(db->_this, task->key);
+    case FILE_DB_ASYNC_EDIT:
+        return db->edit(db->_this, task->key, ele);
+    case FILE_DB_ASYNC_READ:
+        return db->read(db->_this, task->key, task->out);
+    default:
+        return -1;
+    }
+}
+
+/*
+@func:
+    工作线程：依次取出队首的任务执行并回调，关闭时执行完剩余的任务后退出
+
+@para:
+    arg : 工作线程
+
+@return:
+    NULL
+*/
+static void* file_db_async_thread(void* arg)
+{
+    file_db_async_worker_t* worker = (file_db_async_worker_t*)arg;
+    file_db_async_private_t* _this = worker->m_owner;
+    int data_size = _this->m_data_size;
+
+    pthread_mutex_lock(&worker->m_mutex);
+    while(true)
+    {
+        while(0 == worker->m_cnt && !worker->m_stop)
+            pthread_cond_wait(&worker->m_not_empty, &worker->m_mutex);
+        if(0 == worker->m_cnt)
+            break;
+
+        // 任务与元素拷贝出来后立即腾出位置，执行期间可以继续入队
+        file_db_async_task_t task = worker->m_tasks[worker->m_head];
+        if(FILE_DB_ASYNC_ADD == task.op || FILE_DB_ASYNC_EDIT == task.op)
+            memcpy(worker->m_ele, worker->m_datas + (size_t)worker->m_head * data_size, data_size);
+        worker->m_head = (worker->m_head + 1) % _this->m_capacity;
+        worker->m_cnt--;
+        pthread_cond_signal(&worker->m_not_full);
+        pthread_mutex_unlock(&worker->m_mutex);
+
+        int res = file_db_async_execute(_this, &task, worker->m_ele);
+        if(NULL != task.cb)
+            task.cb(_this->m_db, res, task.arg);
+
+        pthread_mutex_lock(&worker->m_mutex);
+        if(0 == --worker->m_pending)
+            pthread_cond_broadcast(&worker->m_idle);
+    }
+    pthread_mutex_unlock(&worker->m_mutex);
+    return NULL;
+}
+
+/*
+@func:
+    提交一个异步操作
+
+@para:
+    async : 异步队列指针
+    op : 操作类型
+    key : 操作的键值
+    ele : 添加与编辑的元素
+    out : 读取时输出元素的缓冲区
+    cb : 完成时的回调
+    arg : 传给回调的参数
+
+@return:
+    int : < 0 : 失败， 0 ： 已入队
+
+@note:
+    键值经过乘法哈希选择队列，连续的键值分散到不同的工作线程
+*/
+static int file_db_async_submit(file_db_async_t* async, file_db_async_op_t op, int key, const void* ele, void* out, file_db_callback_t cb, void* arg)
+{
+    file_db_async_private_t* _this = get_private_member(async);
+    if(NULL == _this) return -1;
+    if((FILE_DB_ASYNC_ADD == op || FILE_DB_ASYNC_EDIT == op) && NULL == ele) return -1;
+    if(FILE_DB_ASYNC_READ == op && NULL == out) return -1;
+
+    unsigned int hash = (unsigned int)key * 2654435761U;
+    file_db_async_worker_t* worker = &_this->m_workers[(int)((unsigned long long)hash * _this->m_worker_cnt >> 32)];
+
+    pthread_mutex_lock(&worker->m_mutex);
+    while(_this->m_block && !worker->m_stop && worker->m_cnt == _this->m_capacity)
+        pthread_cond_wait(&worker->m_not_full, &worker->m_mutex);
+    if(worker->m_stop || worker->m_cnt == _this->m_capacity)
+    {
+        int res_code = worker->m_stop ? -13 : -12;
+        pthread_mutex_unlock(&worker->m_mutex);
+        FILE_DB_ASYNC_LOG_DEBUG("submit rejected %d", res_code);
+        return res_code;
+    }
+
+    int tail = (worker->m_head + worker->m_cnt) % _this->m_capacity;
+    file_db_async_task_t* task = &worker->m_tasks[tail];
+    task->op = op;
+    task->key = key;
+    task->out = out;
+    task->cb = cb;
+    task->arg = arg;
+    if(FILE_DB_ASYNC_ADD == op || FILE_DB_ASYNC_EDIT == op)
+        memcpy(worker->m_datas + (size_t)tail * _this->m_data_size, ele, _this->m_data_size);
+    worker->m_cnt++;
+    worker->m_pending++;
+    pthread_cond_signal(&worker->m_not_empty);
+    pthread_mutex_unlock(&worker->m_mutex);
+    return 0;
+}
+
+/*
+@func:
+    等待已提交的全部操作完成
+
+@para:
+    async : 异步队列指针
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+*/
+static int file_db_async_flush(file_db_async_t* async)
+{
+    file_db_async_private_t* _this = get_private_member(async);
+    if(NULL == _this) return -1;
+
+    for(int i = 0; i < _this->m_worker_cnt; ++i)
+    {
+        file_db_async_worker_t* worker = &_this->m_workers[i];
+        pthread_mutex_lock(&worker->m_mutex);
+        while(worker->m_pending > 0)
+            pthread_cond_wait(&worker->m_idle, &worker->m_mutex);
+        pthread_mutex_unlock(&worker->m_mutex);
+    }
+    return 0;
+}
+
+/*
+@func:
+    停止工作线程并释放队列
+
+@para:
+    async : 异步队列指针的地址
+
+@return:
+    None.
+
+@note:
+    已入队的操作全部执行完才退出；阻塞的提交者被唤醒并返回 -13
+*/
+static void file_db_async_destory(file_db_async_t** async)
+{
+    if(NULL == async || NULL == *async) return;
+
+    file_db_async_private_t* _this = get_private_member(*async);
+    for(int i = 0; i < _this->m_worker_cnt; ++i)
+    {
+        file_db_async_worker_t* worker = &_this->m_workers[i];
+        pthread_mutex_lock(&worker->m_mutex);
+        worker->m_stop = true;
+        pthread_cond_broadcast(&worker->m_not_empty);
+        pthread_cond_broadcast(&worker->m_not_full);
+        pthread_mutex_unlock(&worker->m_mutex);
+    }
+    for(int i = 0; i < _this->m_worker_cnt; ++i)
+    {
+        file_db_async_worker_t* worker = &_this->m_workers[i];
+        if(worker->m_started)
+            pthread_join(worker->m_thread, NULL);
+        pthread_mutex_destroy(&worker->m_mutex);
+        pthread_cond_destroy(&worker->m_not_empty);
+        pthread_cond_destroy(&worker->m_not_full);
+        pthread_cond_destroy(&worker->m_idle);
+        free(worker->m_tasks);
+        free(worker->m_datas);
+        free(worker->m_ele);
+    }
+    free(_this->m_workers);
+    free(_this);
+    free(*async);
+    *async = NULL;
+}
+
+/*
+@func:
+    创建异步队列并启动工作线程
+
+@para:
+    db : 执行操作的文件数据库
+    data_size : 元素的大小
+    threads : 工作线程数量
+    queue_size : 全部队列的总容量，<= 0 使用默认值 FILE_DB_ASYNC_QUEUE_SIZE
+    block : 队列满时 submit 是否阻塞等待
+
+@return:
+    file_db_async_t* : NULL 失败， other 异步队列指针
+
+@note:
+    每个队列的容量向上取整，至少为 1
+*/
+file_db_async_t* file_db_async_create(file_db_t* db, int data_size, int threads, int queue_size, bool block)
+{
+    if(NULL == db || data_size <= 0 || threads <= 0) return NULL;
+    if(queue_size <= 0)
+        queue_size = FILE_DB_ASYNC_QUEUE_SIZE;
+
+    file_db_async_t* async = (file_db_async_t*)malloc(sizeof(file_db_async_t));
+    file_db_async_private_t* _this = (file_db_async_private_t*)malloc(sizeof(file_db_async_private_t));
+    file_db_async_worker_t* workers = (file_db_async_worker_t*)calloc(threads, sizeof(file_db_async_worker_t));
+    if(NULL == async || NULL == _this || NULL == workers)
+    {
+        FILE_DB_ASYNC_LOG_DEBUG("alloc async error");
+        free(async);
+        free(_this);
+        free(workers);
+        return NULL;
+    }
+    memset(async, 0, sizeof(file_db_async_t));
+    memset(_this, 0, sizeof(file_db_async_private_t));
+
+    _this->m_db = db;
+    _this->m_data_size = data_size;
+    _this->m_capacity = (queue_size + threads - 1) / threads;
+    _this->m_block = block;
+    _this->m_worker_cnt = threads;
+    _this->m_workers = workers;
+
+    async->_this = async;
+    async->_private_ = (void*)_this;
+    async->submit = file_db_async_submit;
+    async->flush = file_db_async_flush;
+    async->destory = file_db_async_destory;
+
+    bool failed = false;
+    for(int i = 0; i < threads; ++i)
+    {
+        file_db_async_worker_t* worker = &workers[i];
+        worker->m_owner = _this;
+        pthread_mutex_init(&worker->m_mutex, NULL);
+        pthread_cond_init(&worker->m_not_empty, NULL);
+        pthread_cond_init(&worker->m_not_full, NULL);
+        pthread_cond_init(&worker->m_idle, NULL);
+        worker->m_tasks = (file_db_async_task_t*)malloc(sizeof(file_db_async_task_t) * _this->m_capacity);
+        worker->m_datas = (char*)malloc((size_t)_this->m_capacity * data_size);
+        worker->m_ele = (char*)malloc(data_size);
+        if(failed || NULL == worker->m_tasks || NULL == worker->m_datas || NULL == worker->m_ele)
+        {
+            failed = true;
+            continue;
+        }
+        worker->m_started = 0 == pthread_create(&worker->m_thread, NULL, file_db_async_thread, worker);
+        failed = !worker->m_started;
+    }
+    if(failed)
+    {
+        FILE_DB_ASYNC_LOG_DEBUG("start async worker error");
+        file_db_async_destory(&async);
+        return NULL;
+    }
+
+    return async;
+}
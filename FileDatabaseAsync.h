@@ -0,0 +1,101 @@
+/*
+** File : FileDatabaseAsync.h
+** Author : Saury
+** Date : 2020-09-12
+*/
+
+#ifndef _FILE_DATABASE_ASYNC_H_
+#define _FILE_DATABASE_ASYNC_H_
+
+#include "FileDatabase.h"
+
+typedef struct _file_db_async file_db_async_t;
+
+/*
+    异步执行的操作
+*/
+typedef enum _file_db_async_op
+{
+    FILE_DB_ASYNC_ADD = 0,  // db->add(db, ele)
+    FILE_DB_ASYNC_DEL,      // db->del(db, key)
+    FILE_DB_ASYNC_EDIT,     // db->edit(db, key, ele)
+    FILE_DB_ASYNC_READ,     // db->read(db, key, out)
+}file_db_async_op_t;
+
+/*
+    异步操作队列：每个 I/O 工作线程有一个有界的环形队列，操作按键值的哈希分配到队列中，
+    同一键值的操作按提交的顺序执行；提交时元素拷贝到队列中，调用者的缓冲区可以立即复用。
+    工作线程通过 file_db_t 的同步接口执行操作，完成后在工作线程中调用回调
+*/
+struct _file_db_async
+{
+    file_db_async_t* _this;
+    void* _private_;
+
+/*
+@func:
+    提交一个异步操作
+
+@para:
+    async : 异步队列指针
+    op : 操作类型
+    key : 操作的键值，用于选择队列；添加时为元素的键值
+    ele : 添加与编辑的元素，拷贝到队列中，其他操作传 NULL
+    out : 读取时输出元素的缓冲区，回调之前写入，其他操作传 NULL
+    cb : 完成时的回调，可传 NULL
+    arg : 传给回调的参数
+
+@return:
+    int : < 0 : 失败， 0 ： 已入队
+
+@note:
+    队列满时按创建时的设置阻塞等待或返回 -12；正在关闭时返回 -13。
+    阻塞模式下不要在回调中提交，工作线程等待自己的队列会死锁
+*/
+    int (*submit)(file_db_async_t* async, file_db_async_op_t op, int key, const void* ele, void* out, file_db_callback_t cb, void* arg);
+
+/*
+@func:
+    等待已提交的全部操作完成
+
+@para:
+    async : 异步队列指针
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    等待期间其他线程提交的操作也会被等待；不能在回调中调用
+*/
+    int (*flush)(file_db_async_t* async);
+
+/*
+@func:
+    执行完已入队的全部操作后停止工作线程并释放队列
+
+@para:
+    async : 异步队列指针的地址，释放后置为 NULL
+
+@return:
+    None.
+*/
+    void (*destory)(file_db_async_t** async);
+};
+
+/*
+@func:
+    创建异步队列并启动工作线程
+
+@para:
+    db : 执行操作的文件数据库
+    data_size : 元素的大小
+    threads : 工作线程数量
+    queue_size : 全部队列的总容量，平均分配给各工作线程，<= 0 使用默认值 1024
+    block : 队列满时 submit 是否阻塞等待
+
+@return:
+    file_db_async_t* : NULL 失败， other 异步队列指针
+*/
+extern file_db_async_t* file_db_async_create(file_db_t* db, int data_size, int threads, int queue_size, bool block);
+
+#endif /* end #ifndef _FILE_DATABASE_ASYNC_H_ */
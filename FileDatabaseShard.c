@@ -0,0 +1,1535 @@
+/*
+** File : FileDatabaseShard.c
+** Author : Saury
+** Date : 2020-09-12
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "FileDatabaseShard.h"
+#include "FileDatabaseAsync.h"
+
+
+#define DEBUG_LOG 0
+
+#define FILE_DB_SHARD_LOG_DEBUG(fmt, ...) \
+    do{ \
+        if(DEBUG_LOG) \
+        {\
+            printf("%s at %d " fmt "\r\n", __FILE__, __LINE__, ##__VA_ARGS__);\
+        }\
+    }while(0);
+
+
+// 分片路径的最大长度，与 file_db_init 的路径长度限制一致
+#define FILE_DB_SHARD_PATH_SIZE 128
+// 分片数量标记文件的魔数
+#define FILE_DB_SHARD_MAGIC "FDBSHD01"
+
+/*
+    分片数量标记文件 path.shards 的内容
+*/
+typedef struct _file_db_shard_marker
+{
+    char magic[8];          // FILE_DB_SHARD_MAGIC
+    int shard_cnt;          // 分片数量
+}file_db_shard_marker_t;
+
+typedef struct _file_db_shard_private
+{
+    file_db_t** m_shards;   // 各分片的文件数据库
+    int m_shard_cnt;        // 分片数量
+    int m_data_size;        // 用户数据大小
+    int (*pf_get_ele_key)(void *); // 用户获取元素的键值函数指针
+
+    void (*pf_on_ready)(file_db_t* db, int res, void* arg); // 用户的后台加载回调，全部分片加载结束后调用一次
+    void* m_on_ready_arg;
+    int m_ready_cnt;        // 已结束后台加载的分片数量，以下三项由 m_ready_mutex 保护
+    int m_ready_res;        // 第一个失败的分片的加载结果
+    bool m_notifying;       // 正在调用用户的回调，回调中可能访问任一分片
+    pthread_mutex_t m_ready_mutex;
+    pthread_cond_t m_ready_cond;
+
+    file_db_async_t* m_async; // 全部分片共用的异步队列，未启用时为 NULL
+    char m_marker_path[FILE_DB_SHARD_PATH_SIZE]; // 分片数量标记文件的路径
+}file_db_shard_private_t;
+
+/*
+    批量操作按分片拆分的结果：order 中同一分片的输入序号连续存放，
+    第 i 个分片的输入序号为 order[begin[i]] ... order[begin[i + 1] - 1]
+*/
+typedef struct _file_db_shard_split
+{
+    int* order;
+    int* begin;
+}file_db_shard_split_t;
+
+/*
+@func:
+    获取分片文件数据库的私有成员变量
+
+@para:
+    db ： 文件数据库指针
+
+@return:
+    NULL : 失败， other ： 获取到的成员变量
+*/
+static file_db_shard_private_t* get_private_member(file_db_t* db)
+{
+    if(NULL == db)
+    {
+        FILE_DB_SHARD_LOG_DEBUG("db is NULL");
+        return NULL;
+    }
+    return (file_db_shard_private_t*)(db->_private_);
+}
+
+/*
+@func:
+    获取键值所在的分片
+
+@para:
+    _this : 私有成员
+    key : 键值
+
+@return:
+    file_db_shard_index : 分片序号
+    file_db_shard_of : 分片的文件数据库指针
+
+@note:
+    键值先乘以黄金分割常数打散，再取高位映射到分片，连续或等间隔的键值也能均匀分布
+*/
+static int file_db_shard_index(file_db_shard_private_t* _this, int key)
+{
+    uint32_t hash = (uint32_t)key * 2654435761U;
+    return (int)(((uint64_t)hash * (uint64_t)_this->m_shard_cnt) >> 32);
+}
+
+static file_db_t* file_db_shard_of(file_db_shard_private_t* _this, int key)
+{
+    return _this->m_shards[file_db_shard_index(_this, key)];
+}
+
+/*
+@func:
+    按键值把批量操作的输入拆分到各分片 / 释放拆分结果
+
+@para:
+    _this : 私有成员
+    keys : 每个输入的键值
+    cnt : 输入个数
+    split : 输出的拆分结果
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    同一分片内保持输入的原始顺序
+*/
+static int file_db_shard_split(file_db_shard_private_t* _this, const int* keys, int cnt, file_db_shard_split_t* split)
+{
+    int* shard = (int*)malloc(sizeof(int) * (cnt > 0 ? cnt : 1));
+    split->order = (int*)malloc(sizeof(int) * (cnt > 0 ? cnt : 1));
+    split->begin = (int*)calloc(_this->m_shard_cnt + 1, sizeof(int));
+    if(NULL == shard || NULL == split->order || NULL == split->begin)
+    {
+        free(shard);
+        free(split->order);
+        free(split->begin);
+        return -1;
+    }
+
+    for(int i = 0; i < cnt; ++i)
+    {
+        shard[i] = file_db_shard_index(_this, keys[i]);
+        split->begin[shard[i] + 1]++;
+    }
+    for(int i = 0; i < _this->m_shard_cnt; ++i)
+        split->begin[i + 1] += split->begin[i];
+
+    // 借用 begin 作为各分片的写入位置，完成后再恢复
+    for(int i = 0; i < cnt; ++i)
+        split->order[split->begin[shard[i]]++] = i;
+    for(int i = _this->m_shard_cnt; i > 0; --i)
+        split->begin[i] = split->begin[i - 1];
+    split->begin[0] = 0;
+
+    free(shard);
+    return 0;
+}
+
+static void file_db_shard_split_free(file_db_shard_split_t* split)
+{
+    free(split->order);
+    free(split->begin);
+}
+
+/*
+@func:
+    添加元素到文件数据库中
+
+@para:
+    db : 文件数据库指针
+    ele : 要被添加的元素指针
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    none.
+*/
+static int file_db_shard_add(file_db_t* db, void* ele)
+{
+    file_db_shard_private_t* _this = get_private_member(db);
+    if(NULL == _this || NULL == ele)
+        return -4;
+
+    file_db_t* shard = file_db_shard_of(_this, _this->pf_get_ele_key(ele));
+    return shard->add(shard->_this, ele);
+}
+
+/*
+@func:
+    通过键值删除指定键值对应的元素
+
+@para:
+    db : 文件数据库指针
+    key : 元素对应的键值
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    none.
+*/
+static int file_db_shard_del(file_db_t* db, int key)
+{
+    file_db_shard_private_t* _this = get_private_member(db);
+    if(NULL == _this)
+        return -2;
+
+    file_db_t* shard = file_db_shard_of(_this, key);
+    return shard->del(shard->_this, key);
+}
+
+/*
+@func:
+    根据键值编辑指定的元素
+
+@para:
+    db : 文件数据库指针
+    key : 元素对应的键值
+    ele ： 目标元素，将替换给定键值所对应的元素的值
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    none.
+*/
+static int file_db_shard_edit(file_db_t* db, int key, void* ele)
+{
+    file_db_shard_private_t* _this = get_private_member(db);
+    if(NULL == _this)
+        return -1;
+
+    file_db_t* shard = file_db_shard_of(_this, key);
+    return shard->edit(shard->_this, key, ele);
+}
+
+/*
+@func:
+    批量添加元素到文件数据库中
+
+@para:
+    db : 文件数据库指针
+    eles : 连续存放的元素数组，每个元素大小为 data_size
+    cnt : 元素个数
+    status : 每个元素的添加结果，可传 NULL
+
+@return:
+    int : < 0 : 失败， other ： 成功添加的元素个数
+
+@note:
+    元素按分片拷贝为连续数组后交给各分片的 add_batch；某个分片失败时其余分片照常执行，返回第一个错误
+*/
+static int file_db_shard_add_batch(file_db_t* db, void* eles, int cnt, int* status)
+{
+    file_db_shard_private_t* _this = get_private_member(db);
+    if(NULL == _this || NULL == eles || cnt < 0)
+        return -1;
+    if(0 == cnt)
+        return 0;
+
+    int data_size = _this->m_data_size;
+    int* keys = (int*)malloc(sizeof(int) * cnt);
+    int* res = (int*)malloc(sizeof(int) * cnt);
+    char* buff = (char*)malloc((size_t)cnt * data_size);
+    file_db_shard_split_t split;
+    if(NULL == keys || NULL == res || NULL == buff)
+    {
+        free(keys);
+        free(res);
+        free(buff);
+        return -2;
+    }
+    for(int i = 0; i < cnt; ++i)
+        keys[i] = _this->pf_get_ele_key((char*)eles + (size_t)i * data_size);
+    if(0 != file_db_shard_split(_this, keys, cnt, &split))
+    {
+        free(keys);
+        free(res);
+        free(buff);
+        return -2;
+    }
+
+    for(int i = 0; i < cnt; ++i)
+        memcpy(buff + (size_t)i * data_size, (char*)eles + (size_t)split.order[i] * data_size, data_size);
+
+    int res_code = 0;
+    int added = 0;
+    for(int i = 0; i < _this->m_shard_cnt; ++i)
+    {
+        int begin = split.begin[i];
+        int shard_cnt = split.begin[i + 1] - begin;
+        if(0 == shard_cnt) continue;
+
+        file_db_t* shard = _this->m_shards[i];
+        int n = shard->add_batch(shard->_this, buff + (size_t)begin * data_size, shard_cnt, res + begin);
+        if(n < 0)
+        {
+            for(int j = begin; j < begin + shard_cnt; ++j)
+                res[j] = n;
+            if(0 == res_code)
+                res_code = n;
+            continue;
+        }
+        added += n;
+    }
+
+    for(int i = 0; NULL != status && i < cnt; ++i)
+        status[split.order[i]] = res[i];
+
+    file_db_shard_split_free(&split);
+    free(keys);
+    free(res);
+    free(buff);
+    return 0 != res_code ? res_code : added;
+}
+
+/*
+@func:
+    通过键值批量删除元素
+
+@para:
+    db : 文件数据库指针
+    keys : 键值数组
+    cnt : 键值个数
+    status : 每个键值的删除结果，可传 NULL
+
+@return:
+    int : < 0 : 失败， other ： 成功删除的元素个数
+
+@note:
+    某个分片失败时其余分片照常执行，返回第一个错误
+*/
+static int file_db_shard_del_batch(file_db_t* db, const int* keys, int cnt, int* status)
+{
+    file_db_shard_private_t* _this = get_private_member(db);
+    if(NULL == _this || NULL == keys || cnt < 0)
+        return -1;
+    if(0 == cnt)
+        return 0;
+
+    int* shard_keys = (int*)malloc(sizeof(int) * cnt);
+    int* res = (int*)malloc(sizeof(int) * cnt);
+    file_db_shard_split_t split;
+    if(NULL == shard_keys || NULL == res || 0 != file_db_shard_split(_this, keys, cnt, &split))
+    {
+        free(shard_keys);
+        free(res);
+        return -2;
+    }
+
+    for(int i = 0; i < cnt; ++i)
+        shard_keys[i] = keys[split.order[i]];
+
+    int res_code = 0;
+    int deleted = 0;
+    for(int i = 0; i < _this->m_shard_cnt; ++i)
+    {
+        int begin = split.begin[i];
+        int shard_cnt = split.begin[i + 1] - begin;
+        if(0 == shard_cnt) continue;
+
+        file_db_t* shard = _this->m_shards[i];
+        int n = shard->del_batch(shard->_this, shard_keys + begin, shard_cnt, res + begin);
+        if(n < 0)
+        {
+            if(0 == res_code)
+                res_code = n;
+            continue;
+        }
+        deleted += n;
+    }
+
+    for(int i = 0; NULL != status && i < cnt; ++i)
+        status[split.order[i]] = res[i];
+
+    file_db_shard_split_free(&split);
+    free(shard_keys);
+    free(res);
+    return 0 != res_code ? res_code : deleted;
+}
+
+/*
+@func:
+    根据键值批量编辑元素
+
+@para:
+    db : 文件数据库指针
+    keys : 键值数组
+    eles : 连续存放的目标元素数组，与 keys 一一对应
+    cnt : 元素个数
+    status : 每个元素的编辑结果，可传 NULL
+
+@return:
+    int : < 0 : 失败， other ： 成功编辑的元素个数
+
+@note:
+    某个分片失败时其余分片照常执行，返回第一个错误
+*/
+static int file_db_shard_edit_batch(file_db_t* db, const int* keys, void* eles, int cnt, int* status)
+{
+    file_db_shard_private_t* _this = get_private_member(db);
+    if(NULL == _this || NULL == keys || NULL == eles || cnt < 0)
+        return -1;
+    if(0 == cnt)
+        return 0;
+
+    int data_size = _this->m_data_size;
+    int* shard_keys = (int*)malloc(sizeof(int) * cnt);
+    int* res = (int*)malloc(sizeof(int) * cnt);
+    char* buff = (char*)malloc((size_t)cnt * data_size);
+    file_db_shard_split_t split;
+    if(NULL == shard_keys || NULL == res || NULL == buff || 0 != file_db_shard_split(_this, keys, cnt, &split))
+    {
+        free(shard_keys);
+        free(res);
+        free(buff);
+        return -2;
+    }
+
+    for(int i = 0; i < cnt; ++i)
+    {
+        shard_keys[i] = keys[split.order[i]];
+        memcpy(buff + (size_t)i * data_size, (char*)eles + (size_t)split.order[i] * data_size, data_size);
+    }
+
+    int res_code = 0;
+    int edited = 0;
+    for(int i = 0; i < _this->m_shard_cnt; ++i)
+    {
+        int begin = split.begin[i];
+        int shard_cnt = split.begin[i + 1] - begin;
+        if(0 == shard_cnt) continue;
+
+        file_db_t* shard = _this->m_shards[i];
+        int n = shard->edit_batch(shard->_this, shard_keys + begin, buff + (size_t)begin * data_size, shard_cnt, res + begin);
+        if(n < 0)
+        {
+            if(0 == res_code)
+                res_code = n;
+            continue;
+        }
+        edited += n;
+    }
+
+    for(int i = 0; NULL != status && i < cnt; ++i)
+        status[split.order[i]] = res[i];
+
+    file_db_shard_split_free(&split);
+    free(shard_keys);
+    free(res);
+    free(buff);
+    return 0 != res_code ? res_code : edited;
+}
+
+/*
+@func:
+    根据键值查询文件数据库中的元素
+
+@para:
+    db : 文件数据库指针
+    key : 元素的键值
+
+@return:
+    void* : NULL 查询失败， other 查询到的元素的指针
+
+@note:
+    none.
+*/
+static void* file_db_shard_query(file_db_t* db, int key)
+{
+    file_db_shard_private_t* _this = get_private_member(db);
+    if(NULL == _this)
+        return NULL;
+
+    file_db_t* shard = file_db_shard_of(_this, key);
+    return shard->query(shard->_this, key);
+}
+
+/*
+@func:
+    根据键值查询元素并拷贝到调用者的缓冲区
+
+@para:
+    db : 文件数据库指针
+    key : 元素的键值
+    ele : 输出元素的缓冲区
+
+@return:
+    int : < 0 : 失败，-2 不存在， 0 ： 成功
+*/
+static int file_db_shard_read(file_db_t* db, int key, void* ele)
+{
+    file_db_shard_private_t* _this = get_private_member(db);
+    if(NULL == _this)
+        return -1;
+
+    file_db_t* shard = file_db_shard_of(_this, key);
+    return shard->read(shard->_this, key, ele);
+}
+
+/*
+@func:
+    异步添加 / 删除 / 编辑 / 查询元素
+
+@para:
+    db : 文件数据库指针
+    key : 元素的键值
+    ele : 添加与编辑的元素，或查询时输出元素的缓冲区
+    cb : 完成时的回调
+    arg : 传给回调的参数
+
+@return:
+    int : < 0 : 提交失败， 0 ： 已提交
+
+@note:
+    全部分片共用一组工作线程，工作线程通过分片文件数据库的同步接口执行，回调收到的是分片文件数据库
+*/
+static int file_db_shard_add_async(file_db_t* db, void* ele, file_db_callback_t cb, void* arg)
+{
+    file_db_shard_private_t* _this = get_private_member(db);
+    if(NULL == _this || NULL == _this->m_async || NULL == ele)
+        return -1;
+
+    return _this->m_async->submit(_this->m_async->_this, FILE_DB_ASYNC_ADD, _this->pf_get_ele_key(ele), ele, NULL, cb, arg);
+}
+
+static int file_db_shard_del_async(file_db_t* db, int key, file_db_callback_t cb, void* arg)
+{
+    file_db_shard_private_t* _this = get_private_member(db);
+    if(NULL == _this || NULL == _this->m_async)
+        return -1;
+
+    return _this->m_async->submit(_this->m_async->_this, FILE_DB_ASYNC_DEL, key, NULL, NULL, cb, arg);
+}
+
+static int file_db_shard_edit_async(file_db_t* db, int key, void* ele, file_db_callback_t cb, void* arg)
+{
+    file_db_shard_private_t* _this = get_private_member(db);
+    if(NULL == _this || NULL == _this->m_async || NULL == ele)
+        return -1;
+
+    return _this->m_async->submit(_this->m_async->_this, FILE_DB_ASYNC_EDIT, key, ele, NULL, cb, arg);
+}
+
+static int file_db_shard_query_async(file_db_t* db, int key, void* ele, file_db_callback_t cb, void* arg)
+{
+    file_db_shard_private_t* _this = get_private_member(db);
+    if(NULL == _this || NULL == _this->m_async || NULL == ele)
+        return -1;
+
+    return _this->m_async->submit(_this->m_async->_this, FILE_DB_ASYNC_READ, key, NULL, ele, cb, arg);
+}
+
+static int file_db_shard_flush_async(file_db_t* db)
+{
+    file_db_shard_private_t* _this = get_private_member(db);
+    if(NULL == _this || NULL == _this->m_async)
+        return -1;
+
+    return _this->m_async->flush(_this->m_async->_this);
+}
+
+/*
+@func:
+    根据键值查询元素并固定 / 解除固定
+
+@para:
+    db : 文件数据库指针
+    key : 元素的键值
+    ele : pin 返回的指针
+
+@return:
+    void* : NULL 查询失败， other 查询到的元素的指针
+
+@note:
+    解除固定时通过元素的键值找到所在的分片
+*/
+static void* file_db_shard_pin(file_db_t* db, int key)
+{
+    file_db_shard_private_t* _this = get_private_member(db);
+    if(NULL == _this)
+        return NULL;
+
+    file_db_t* shard = file_db_shard_of(_this, key);
+    return shard->pin(shard->_this, key);
+}
+
+static void file_db_shard_unpin(file_db_t* db, void* ele)
+{
+    file_db_shard_private_t* _this = get_private_member(db);
+    if(NULL == _this || NULL == ele)
+        return;
+
+    file_db_t* shard = file_db_shard_of(_this, _this->pf_get_ele_key(ele));
+    shard->unpin(shard->_this, ele);
+}
+
+/*
+@func:
+    根据键值批量查询元素 / 批量查询并固定元素
+
+@para:
+    db : 文件数据库指针
+    keys : 键值数组
+    cnt : 键值个数
+    eles : 输出每个键值对应的元素指针，不存在时为 NULL
+
+@return:
+    int : < 0 : 失败， other ： 查询到的元素个数
+
+@note:
+    键值按分片拆分为连续数组后交给各分片的批量查询；某个分片失败时其余分片照常执行，返回第一个错误，
+    此时其余分片已固定的元素全部解除固定，eles 全部为 NULL
+*/
+static int file_db_shard_lookup_batch(file_db_t* db, const int* keys, int cnt, void** eles, bool pin)
+{
+    file_db_shard_private_t* _this = get_private_member(db);
+    if(NULL == _this || NULL == keys || NULL == eles || cnt < 0)
+        return -1;
+    if(0 == cnt)
+        return 0;
+
+    int* shard_keys = (int*)malloc(sizeof(int) * cnt);
+    void** res = (void**)malloc(sizeof(void*) * cnt);
+    file_db_shard_split_t split;
+    if(NULL == shard_keys || NULL == res || 0 != file_db_shard_split(_this, keys, cnt, &split))
+    {
+        free(shard_keys);
+        free(res);
+        return -2;
+    }
+
+    for(int i = 0; i < cnt; ++i)
+        shard_keys[i] = keys[split.order[i]];
+
+    int res_code = 0;
+    int found = 0;
+    for(int i = 0; i < _this->m_shard_cnt; ++i)
+    {
+        int begin = split.begin[i];
+        int shard_cnt = split.begin[i + 1] - begin;
+        if(0 == shard_cnt) continue;
+
+        file_db_t* shard = _this->m_shards[i];
+        int n = pin ? shard->pin_batch(shard->_this, shard_keys + begin, shard_cnt, res + begin)
+                    : shard->query_batch(shard->_this, shard_keys + begin, shard_cnt, res + begin);
+        if(n < 0)
+        {
+            memset(res + begin, 0, sizeof(void*) * shard_cnt);
+            if(0 == res_code)
+                res_code = n;
+            continue;
+        }
+        found += n;
+    }
+
+    // 返回错误时调用者不会 unpin，释放成功的分片固定的元素
+    for(int i = 0; 0 != res_code && i < _this->m_shard_cnt; ++i)
+    {
+        file_db_t* shard = _this->m_shards[i];
+        for(int j = split.begin[i]; j < split.begin[i + 1]; ++j)
+        {
+            if(pin && NULL != res[j])
+                shard->unpin(shard->_this, res[j]);
+            res[j] = NULL;
+        }
+    }
+    for(int i = 0; i < cnt; ++i)
+        eles[split.order[i]] = res[i];
+
+    file_db_shard_split_free(&split);
+    free(shard_keys);
+    free(res);
+    return 0 != res_code ? res_code : found;
+}
+
+static int file_db_shard_query_batch(file_db_t* db, const int* keys, int cnt, void** eles)
+{
+    return file_db_shard_lookup_batch(db, keys, cnt, eles, false);
+}
+
+static int file_db_shard_pin_batch(file_db_t* db, const int* keys, int cnt, void** eles)
+{
+    return file_db_shard_lookup_batch(db, keys, cnt, eles, true);
+}
+
+/*
+@func:
+    写入文件数据库的文件头
+
+@para:
+    db : 文件数据库指针
+    head : 写入的文件头指针
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    文件头写入全部分片，遇到失败立即返回
+*/
+static int file_db_shard_write_head(file_db_t* db, void* head)
+{
+    file_db_shard_private_t* _this = get_private_member(db);
+    if(NULL == _this || NULL == head)
+        return -1;
+
+    for(int i = 0; i < _this->m_shard_cnt; ++i)
+    {
+        file_db_t* shard = _this->m_shards[i];
+        int res = shard->write_head(shard->_this, head);
+        if(0 != res)
+            return res;
+    }
+    return 0;
+}
+
+/*
+@func:
+    读取文件数据库的文件头到指定内存中
+
+@para:
+    db : 文件数据库指针
+    head : 读出的文件头指针
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    各分片的文件头相同，读取第一个分片即可
+*/
+static int file_db_shard_read_head(file_db_t* db, void* head)
+{
+    file_db_shard_private_t* _this = get_private_member(db);
+    if(NULL == _this || NULL == head)
+        return -1;
+
+    file_db_t* shard = _this->m_shards[0];
+    return shard->read_head(shard->_this, head);
+}
+
+/*
+@func:
+    返回文件数据库中的元素个数
+
+@para:
+    db : 文件数据库指针
+
+@return:
+    int : < 0 : 失败， other ： 全部分片的元素总数
+
+@note:
+    none.
+*/
+static int file_db_shard_size(file_db_t* db)
+{
+    file_db_shard_private_t* _this = get_private_member(db);
+    if(NULL == _this)
+        return -1;
+
+    int total = 0;
+    for(int i = 0; i < _this->m_shard_cnt; ++i)
+    {
+        file_db_t* shard = _this->m_shards[i];
+        total += shard->size(shard->_this);
+    }
+    return total;
+}
+
+/*
+@func:
+    遍历文件数据库中的所有内容，然后使用传入的函数指针对每个元素执行操作
+
+@para:
+    db : 文件数据库指针
+    visit : 对元素操作的函数指针
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    依次遍历每个分片，visit 中不能修改本数据库
+*/
+static int file_db_shard_traverse(file_db_t* db, void (*visit)(void*))
+{
+    file_db_shard_private_t* _this = get_private_member(db);
+    if(NULL == _this || NULL == visit)
+        return -1;
+
+    for(int i = 0; i < _this->m_shard_cnt; ++i)
+    {
+        file_db_t* shard = _this->m_shards[i];
+        int res = shard->traverse(shard->_this, visit);
+        if(0 != res)
+            return res;
+    }
+    return 0;
+}
+
+/*
+@func:
+    在全部分片中定位第一个键值 >= key 的元素 / 最后一个键值 <= key 的元素
+
+@para:
+    _this : 私有成员
+    cursor : 游标
+    key : 键值
+    forward : true 定位第一个键值 >= key 的元素，false 定位最后一个键值 <= key 的元素
+
+@return:
+    int : < 0 : 不存在， 0 ： 成功
+
+@note:
+    每个分片分别定位后取键值最接近的一个；元素按键值分散在各分片中，
+    游标不保存分片内的位置，每次移动都按当前键值重新定位
+*/
+static int file_db_shard_locate(file_db_shard_private_t* _this, file_db_cursor_t* cursor, int key, bool forward)
+{
+    file_db_cursor_t cur;
+    bool found = false;
+
+    for(int i = 0; i < _this->m_shard_cnt; ++i)
+    {
+        file_db_t* shard = _this->m_shards[i];
+        int res = forward ? shard->seek(shard->_this, &cur, key) : shard->seek_last(shard->_this, &cur, key);
+        if(0 != res) continue;
+        if(!found || (forward ? cur.key < cursor->key : cur.key > cursor->key))
+        {
+            cursor->key = cur.key;
+            cursor->ele = cur.ele;
+            found = true;
+        }
+    }
+    cursor->pos = found ? (void*)cursor : NULL;
+    cursor->version = 0;
+    if(!found)
+        cursor->ele = NULL;
+    return found ? 0 : -1;
+}
+
+/*
+@func:
+    把游标定位到第一个键值 >= key 的元素 / 最后一个键值 <= key 的元素
+
+@para:
+    db : 文件数据库指针
+    cursor : 游标
+    key : 键值
+
+@return:
+    int : < 0 : 不存在， 0 ： 成功
+
+@note:
+    需要在每个分片中查找
+*/
+static int file_db_shard_seek(file_db_t* db, file_db_cursor_t* cursor, int key)
+{
+    file_db_shard_private_t* _this = get_private_member(db);
+    if(NULL == _this || NULL == cursor)
+        return -2;
+
+    return file_db_shard_locate(_this, cursor, key, true);
+}
+
+static int file_db_shard_seek_last(file_db_t* db, file_db_cursor_t* cursor, int key)
+{
+    file_db_shard_private_t* _this = get_private_member(db);
+    if(NULL == _this || NULL == cursor)
+        return -2;
+
+    return file_db_shard_locate(_this, cursor, key, false);
+}
+
+/*
+@func:
+    把游标按键值顺序移动到 下一个 / 上一个 元素
+
+@para:
+    db : 文件数据库指针
+    cursor : 已定位的游标
+
+@return:
+    int : < 0 : 已到达末尾 / 开头， 0 ： 成功
+
+@note:
+    按当前键值在每个分片中重新定位
+*/
+static int file_db_shard_next(file_db_t* db, file_db_cursor_t* cursor)
+{
+    file_db_shard_private_t* _this = get_private_member(db);
+    if(NULL == _this || NULL == cursor)
+        return -2;
+    if(NULL == cursor->pos || INT_MAX == cursor->key)
+        return -1;
+
+    return file_db_shard_locate(_this, cursor, cursor->key + 1, true);
+}
+
+static int file_db_shard_prev(file_db_t* db, file_db_cursor_t* cursor)
+{
+    file_db_shard_private_t* _this = get_private_member(db);
+    if(NULL == _this || NULL == cursor)
+        return -2;
+    if(NULL == cursor->pos || INT_MIN == cursor->key)
+        return -1;
+
+    return file_db_shard_locate(_this, cursor, cursor->key - 1, false);
+}
+
+/*
+@func:
+    按键值升序访问 [low, high) 范围内的元素
+
+@para:
+    db : 文件数据库指针
+    low : 范围下限，包含
+    high : 范围上限，不包含
+    visit : 对每个元素执行的操作，返回 false 时停止
+    arg : 传给 visit 的参数
+
+@return:
+    int : < 0 : 失败， other ： 访问的元素个数
+
+@note:
+    用游标在各分片间按键值顺序归并；访问期间不持有锁，元素通过 pin 固定，
+    访问过程中被删除的元素会被跳过
+*/
+static int file_db_shard_range(file_db_t* db, int low, int high, bool (*visit)(void* ele, void* arg), void* arg)
+{
+    file_db_shard_private_t* _this = get_private_member(db);
+    if(NULL == _this || NULL == visit)
+        return -1;
+
+    int cnt = 0;
+    file_db_cursor_t cursor;
+    for(int res = file_db_shard_locate(_this, &cursor, low, true); 0 == res && cursor.key < high;
+        res = file_db_shard_next(db, &cursor))
+    {
+        file_db_t* shard = file_db_shard_of(_this, cursor.key);
+        void* ele = shard->pin(shard->_this, cursor.key);
+        if(NULL == ele) continue;
+
+        cnt++;
+        bool go_on = visit(ele, arg);
+        shard->unpin(shard->_this, ele);
+        if(!go_on)
+            break;
+    }
+    return cnt;
+}
+
+/*
+@func:
+    获取键值小于 key 的元素个数 / 统计键值在 [low, high) 范围内的元素个数
+
+@para:
+    db : 文件数据库指针
+    key : 键值
+    low : 范围下限，包含
+    high : 范围上限，不包含
+
+@return:
+    int : < 0 : 失败， other ： 元素个数
+
+@note:
+    各分片分别统计后求和
+*/
+static int file_db_shard_rank(file_db_t* db, int key)
+{
+    file_db_shard_private_t* _this = get_private_member(db);
+    if(NULL == _this)
+        return -1;
+
+    int total = 0;
+    for(int i = 0; i < _this->m_shard_cnt; ++i)
+    {
+        file_db_t* shard = _this->m_shards[i];
+        int rank = shard->rank(shard->_this, key);
+        if(rank < 0)
+            return rank;
+        total += rank;
+    }
+    return total;
+}
+
+static int file_db_shard_count_range(file_db_t* db, int low, int high)
+{
+    file_db_shard_private_t* _this = get_private_member(db);
+    if(NULL == _this)
+        return -1;
+
+    int total = 0;
+    for(int i = 0; i < _this->m_shard_cnt; ++i)
+    {
+        file_db_t* shard = _this->m_shards[i];
+        int cnt = shard->count_range(shard->_this, low, high);
+        if(cnt < 0)
+            return cnt;
+        total += cnt;
+    }
+    return total;
+}
+
+/*
+@func:
+    把游标定位到按键值升序的第 index 个元素（从 0 开始）
+
+@para:
+    db : 文件数据库指针
+    cursor : 游标
+    index : 元素的排名
+
+@return:
+    int : < 0 : index 越界， 0 ： 成功
+
+@note:
+    元素按键值分散在各分片中，在键值空间上二分查找排名不超过 index 的最大键值，
+    每一步在每个分片中计算一次 rank，共 O(32 * shard_cnt * log n)
+*/
+static int file_db_shard_select(file_db_t* db, file_db_cursor_t* cursor, int index)
+{
+    file_db_shard_private_t* _this = get_private_member(db);
+    if(NULL == _this || NULL == cursor)
+        return -2;
+    if(index < 0 || index >= file_db_shard_size(db))
+    {
+        cursor->pos = cursor->ele = NULL;
+        return -1;
+    }
+
+    long long low = INT_MIN, high = INT_MAX;
+    while(low < high)
+    {
+        long long mid = low + (high - low + 1) / 2;
+        int rank = file_db_shard_rank(db, (int)mid);
+        if(rank < 0)
+            return rank;
+        if(rank <= index)
+            low = mid;
+        else
+            high = mid - 1;
+    }
+    return file_db_shard_locate(_this, cursor, (int)low, true);
+}
+
+/*
+@func:
+    依次冻结每个分片的索引
+
+@para:
+    db : 文件数据库指针
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    每个分片分别持有自己的写锁重建索引；全部分片都会尝试冻结，返回第一个错误
+*/
+static int file_db_shard_freeze(file_db_t* db)
+{
+    file_db_shard_private_t* _this = get_private_member(db);
+    if(NULL == _this)
+        return -1;
+
+    int res_code = 0;
+    for(int i = 0; i < _this->m_shard_cnt; ++i)
+    {
+        file_db_t* shard = _this->m_shards[i];
+        int res = shard->freeze(shard->_this);
+        if(0 == res_code)
+            res_code = res;
+    }
+    return res_code;
+}
+
+/*
+@func:
+    依次整理每个分片的数据文件
+
+@para:
+    db : 文件数据库指针
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    每次只整理一个分片，其余分片不受影响；全部分片都会被整理，返回第一个错误
+*/
+static int file_db_shard_compact(file_db_t* db)
+{
+    file_db_shard_private_t* _this = get_private_member(db);
+    if(NULL == _this)
+        return -1;
+
+    int res_code = 0;
+    for(int i = 0; i < _this->m_shard_cnt; ++i)
+    {
+        file_db_t* shard = _this->m_shards[i];
+        int res = shard->compact(shard->_this);
+        if(0 == res_code)
+            res_code = res;
+    }
+    return res_code;
+}
+
+/*
+@func:
+    清除文件数据库内容，但是保存文件头
+
+@para:
+    db : 文件数据库指针
+
+@return:
+    int : -1 : 失败， 0 ： 成功
+
+@note:
+    全部分片都会被清除，返回第一个错误
+*/
+static int file_db_shard_clear(file_db_t* db)
+{
+    file_db_shard_private_t* _this = get_private_member(db);
+    if(NULL == _this)
+        return -1;
+
+    int res_code = 0;
+    for(int i = 0; i < _this->m_shard_cnt; ++i)
+    {
+        file_db_t* shard = _this->m_shards[i];
+        int res = shard->clear(shard->_this);
+        if(0 == res_code)
+            res_code = res;
+    }
+    return res_code;
+}
+
+/*
+@func:
+    查询全部分片后台加载的状态 / 等待全部分片后台加载结束
+
+@para:
+    db : 文件数据库指针
+
+@return:
+    int : < 0 : 任一分片加载失败， 0 ： 全部加载完成， 1 ： 仍有分片正在加载（只有 ready 返回）
+*/
+static int file_db_shard_ready(file_db_t* db)
+{
+    file_db_shard_private_t* _this = get_private_member(db);
+    if(NULL == _this)
+        return -1;
+
+    int res_code = 0;
+    for(int i = 0; i < _this->m_shard_cnt; ++i)
+    {
+        file_db_t* shard = _this->m_shards[i];
+        int res = shard->ready(shard->_this);
+        if(res < 0)
+            return res;
+        if(res > 0)
+            res_code = res;
+    }
+    return res_code;
+}
+
+static int file_db_shard_wait_ready(file_db_t* db)
+{
+    file_db_shard_private_t* _this = get_private_member(db);
+    if(NULL == _this)
+        return -1;
+
+    int res_code = 0;
+    for(int i = 0; i < _this->m_shard_cnt; ++i)
+    {
+        file_db_t* shard = _this->m_shards[i];
+        int res = shard->wait_ready(shard->_this);
+        if(res < 0 && 0 == res_code)
+            res_code = res;
+    }
+    return res_code;
+}
+
+/*
+@func:
+    单个分片后台加载结束时的回调，最后一个分片结束时调用用户的 on_ready
+
+@para:
+    shard : 加载结束的分片
+    res : 该分片的加载结果
+    arg : 分片文件数据库指针
+
+@return:
+    none.
+
+@note:
+    分片在各自的加载线程中回调；释放前等待全部分片回调结束，回调期间私有成员与各分片一定有效
+*/
+static void file_db_shard_on_ready(file_db_t* shard, int res, void* arg)
+{
+    (void)shard;
+    file_db_t* db = (file_db_t*)arg;
+    file_db_shard_private_t* _this = (file_db_shard_private_t*)db->_private_;
+
+    pthread_mutex_lock(&_this->m_ready_mutex);
+    if(res < 0 && 0 == _this->m_ready_res)
+        _this->m_ready_res = res;
+    bool last = ++_this->m_ready_cnt == _this->m_shard_cnt;
+    int res_code = _this->m_ready_res;
+    _this->m_notifying = last;
+    pthread_cond_broadcast(&_this->m_ready_cond);
+    pthread_mutex_unlock(&_this->m_ready_mutex);
+
+    if(!last)
+        return;
+    _this->pf_on_ready(db, res_code, _this->m_on_ready_arg);
+
+    pthread_mutex_lock(&_this->m_ready_mutex);
+    _this->m_notifying = false;
+    pthread_cond_broadcast(&_this->m_ready_cond);
+    pthread_mutex_unlock(&_this->m_ready_mutex);
+}
+
+/*
+@func:
+    释放 / 销毁全部分片，并释放分片文件数据库相关动态内存
+
+@para:
+    db : 文件数据库指针
+    destory : true 同时删除各分片的文件与分片数量标记文件
+
+@return:
+    int : -1 : 失败， 0 ： 成功
+
+@note:
+    未打开成功的分片为 NULL，直接跳过；用户的加载回调可能访问任一分片，需等待已打开的分片全部回调结束后再释放
+*/
+static int file_db_shard_release(file_db_t* db, bool destory)
+{
+    file_db_shard_private_t* _this = get_private_member(db);
+    if(NULL == _this)
+        return -1;
+
+    // 已提交的异步操作需在分片关闭之前执行完
+    if(NULL != _this->m_async)
+        _this->m_async->destory(&_this->m_async);
+
+    int opened = 0;
+    for(int i = 0; i < _this->m_shard_cnt; ++i)
+        opened += NULL != _this->m_shards[i];
+    pthread_mutex_lock(&_this->m_ready_mutex);
+    while(NULL != _this->pf_on_ready && (_this->m_ready_cnt < opened || _this->m_notifying))
+        pthread_cond_wait(&_this->m_ready_cond, &_this->m_ready_mutex);
+    pthread_mutex_unlock(&_this->m_ready_mutex);
+
+    for(int i = 0; i < _this->m_shard_cnt; ++i)
+    {
+        file_db_t* shard = _this->m_shards[i];
+        if(NULL == shard) continue;
+
+        if(destory)
+            shard->destory(shard->_this);
+        else
+            shard->free(shard->_this);
+    }
+    if(destory)
+        unlink(_this->m_marker_path);
+
+    pthread_mutex_destroy(&_this->m_ready_mutex);
+    pthread_cond_destroy(&_this->m_ready_cond);
+    free(_this->m_shards);
+    free(_this);
+    free(db);
+    return 0;
+}
+
+/*
+@func:
+    并释放文件数据库相关动态内存
+
+@para:
+    db : 文件数据库指针
+
+@return:
+    int : -1 : 失败， 0 ： 成功
+
+@note:
+    【重要】此函数不能与 file_db_shard_destory 同时使用
+*/
+static int file_db_shard_free(file_db_t* db)
+{
+    return file_db_shard_release(db, false);
+}
+
+/*
+@func:
+    销毁数据库文件并释放相关动态内存
+
+@para:
+    db : 文件数据库指针
+
+@return:
+    int : -1 : 失败， 0 ： 成功
+
+@note:
+    【重要】此函数不能与 file_db_shard_free 同时使用
+*/
+static int file_db_shard_destory(file_db_t* db)
+{
+    return file_db_shard_release(db, true);
+}
+
+/*
+@func:
+    检查分片数量与标记文件中保存的是否一致，没有标记文件时新建
+
+@para:
+    path : 文件路径前缀
+    marker_path : 标记文件路径
+    shard_cnt : 分片数量
+
+@return:
+    int : < 0 : 失败，-3 分片数量不一致， 0 ： 成功
+
+@note:
+    没有标记文件但已有分片文件时（标记文件引入之前创建的文件），按已有分片文件的数量检查；
+    先写入临时文件再重命名，不会留下不完整的标记文件
+*/
+static int file_db_shard_check_cnt(const char* path, const char* marker_path, int shard_cnt)
+{
+    file_db_shard_marker_t marker;
+    int fd = open(marker_path, O_RDONLY);
+    if(fd >= 0)
+    {
+        ssize_t n = pread(fd, &marker, sizeof(marker), 0);
+        close(fd);
+        if(n != (ssize_t)sizeof(marker) || 0 != memcmp(marker.magic, FILE_DB_SHARD_MAGIC, sizeof(marker.magic)))
+        {
+            FILE_DB_SHARD_LOG_DEBUG("invalid shard marker %s", marker_path);
+            return -2;
+        }
+        if(marker.shard_cnt != shard_cnt)
+        {
+            FILE_DB_SHARD_LOG_DEBUG("shard count mismatch, saved %d, given %d", marker.shard_cnt, shard_cnt);
+            return -3;
+        }
+        return 0;
+    }
+    if(ENOENT != errno)
+        return -2;
+
+    char shard_path[FILE_DB_SHARD_PATH_SIZE];
+    snprintf(shard_path, sizeof(shard_path), "%s.%d", path, 0);
+    if(0 == access(shard_path, F_OK))
+    {
+        for(int i = 1; i <= shard_cnt; ++i)
+        {
+            snprintf(shard_path, sizeof(shard_path), "%s.%d", path, i);
+            if((0 == access(shard_path, F_OK)) != (i < shard_cnt))
+            {
+                FILE_DB_SHARD_LOG_DEBUG("shard files do not match shard count %d", shard_cnt);
+                return -3;
+            }
+        }
+    }
+
+    char tmp_path[FILE_DB_SHARD_PATH_SIZE + 8];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", marker_path);
+    memset(&marker, 0, sizeof(marker));
+    memcpy(marker.magic, FILE_DB_SHARD_MAGIC, sizeof(marker.magic));
+    marker.shard_cnt = shard_cnt;
+
+    fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if(fd < 0)
+        return -4;
+    int res = 0;
+    if((ssize_t)sizeof(marker) != pwrite(fd, &marker, sizeof(marker), 0) || 0 != fsync(fd))
+        res = -4;
+    close(fd);
+    if(0 == res && 0 != rename(tmp_path, marker_path))
+        res = -5;
+    if(0 != res)
+    {
+        FILE_DB_SHARD_LOG_DEBUG("write shard marker error %d", res);
+        unlink(tmp_path);
+    }
+    return res;
+}
+
+/*
+@func:
+    使用指定的文件路径前缀初始化分片文件数据库
+
+@para:
+    path : 文件路径前缀，第 i 个分片保存在 path.i 中
+    shard_cnt : 分片数量
+    option : 每个分片的打开选项，NULL 时与 file_db_init 相同
+
+@return:
+    file_db_t* : 文件数据库指针
+
+@note:
+    其余参数与 file_db_init 相同；任一分片打开失败时已打开的分片会被释放；
+    分片数量保存在 path.shards 中，与之后打开时传入的 shard_cnt 不一致时返回 NULL
+*/
+file_db_t* file_db_shard_init(const char* path, int shard_cnt, int head_size, int data_size, int (*pf_hash_func)(void *), void* head, const file_db_option_t* option)
+{
+    if(NULL == path || NULL == pf_hash_func || NULL == head || shard_cnt <= 0 || data_size <= 0) return NULL;
+
+    file_db_shard_private_t* _private_ = (file_db_shard_private_t*)malloc(sizeof(file_db_shard_private_t));
+    file_db_t* file_db = (file_db_t*)malloc(sizeof(file_db_t));
+    file_db_t** shards = (file_db_t**)calloc(shard_cnt, sizeof(file_db_t*));
+    if(NULL == _private_ || NULL == file_db || NULL == shards)
+    {
+        FILE_DB_SHARD_LOG_DEBUG("shard db malloc error!");
+        free(_private_);
+        free(file_db);
+        free(shards);
+        return NULL;
+    }
+
+    memset(_private_, 0, sizeof(file_db_shard_private_t));
+    memset(file_db, 0, sizeof(file_db_t));
+
+    _private_->m_shards = shards;
+    _private_->m_shard_cnt = shard_cnt;
+    _private_->m_data_size = data_size;
+    _private_->pf_get_ele_key = pf_hash_func;
+    pthread_mutex_init(&_private_->m_ready_mutex, NULL);
+    pthread_cond_init(&_private_->m_ready_cond, NULL);
+
+    // 各分片的回调汇总后只通知一次，传给用户的是分片文件数据库
+    const file_db_option_t* user_option = option;
+    file_db_option_t shard_option;
+    if(NULL != option)
+    {
+        shard_option = *option;
+        _private_->pf_on_ready = option->background_load ? option->on_ready : NULL;
+        _private_->m_on_ready_arg = option->on_ready_arg;
+        shard_option.on_ready = NULL != _private_->pf_on_ready ? file_db_shard_on_ready : NULL;
+        shard_option.on_ready_arg = file_db;
+        shard_option.async_threads = 0;
+        option = &shard_option;
+    }
+
+    file_db->_this = file_db;
+    file_db->_private_ = (void*)_private_;
+
+    file_db->add = file_db_shard_add;
+    file_db->del = file_db_shard_del;
+    file_db->edit = file_db_shard_edit;
+    file_db->add_batch = file_db_shard_add_batch;
+    file_db->del_batch = file_db_shard_del_batch;
+    file_db->edit_batch = file_db_shard_edit_batch;
+    file_db->query = file_db_shard_query;
+    file_db->pin = file_db_shard_pin;
+    file_db->query_batch = file_db_shard_query_batch;
+    file_db->pin_batch = file_db_shard_pin_batch;
+    file_db->unpin = file_db_shard_unpin;
+    file_db->write_head = file_db_shard_write_head;
+    file_db->read_head = file_db_shard_read_head;
+    file_db->size = file_db_shard_size;
+    file_db->traverse = file_db_shard_traverse;
+    file_db->seek = file_db_shard_seek;
+    file_db->seek_last = file_db_shard_seek_last;
+    file_db->next = file_db_shard_next;
+    file_db->prev = file_db_shard_prev;
+    file_db->range = file_db_shard_range;
+    file_db->rank = file_db_shard_rank;
+    file_db->select = file_db_shard_select;
+    file_db->count_range = file_db_shard_count_range;
+    file_db->freeze = file_db_shard_freeze;
+    file_db->compact = file_db_shard_compact;
+    file_db->clear = file_db_shard_clear;
+    file_db->ready = file_db_shard_ready;
+    file_db->wait_ready = file_db_shard_wait_ready;
+    file_db->read = file_db_shard_read;
+    file_db->add_async = file_db_shard_add_async;
+    file_db->del_async = file_db_shard_del_async;
+    file_db->edit_async = file_db_shard_edit_async;
+    file_db->query_async = file_db_shard_query_async;
+    file_db->flush_async = file_db_shard_flush_async;
+    file_db->free = file_db_shard_free;
+    file_db->destory = file_db_shard_destory;
+
+    // 分片数量不同时键值会被分配到不同的分片，需与首次创建时一致
+    if(snprintf(_private_->m_marker_path, sizeof(_private_->m_marker_path), "%s.shards", path) >= (int)sizeof(_private_->m_marker_path)
+        || 0 != file_db_shard_check_cnt(path, _private_->m_marker_path, shard_cnt))
+    {
+        FILE_DB_SHARD_LOG_DEBUG("check shard count error!");
+        file_db_shard_free(file_db);
+        return NULL;
+    }
+
+    for(int i = 0; i < shard_cnt; ++i)
+    {
+        char shard_path[FILE_DB_SHARD_PATH_SIZE];
+        if(snprintf(shard_path, sizeof(shard_path), "%s.%d", path, i) >= (int)sizeof(shard_path))
+        {
+            FILE_DB_SHARD_LOG_DEBUG("shard path too long!");
+            file_db_shard_free(file_db);
+            return NULL;
+        }
+
+        // head 会被读出的已有文件头覆盖，之后新建的分片使用同一文件头
+        shards[i] = file_db_init_ex(shard_path, head_size, data_size, pf_hash_func, head, option);
+        if(NULL == shards[i])
+        {
+            FILE_DB_SHARD_LOG_DEBUG("open shard %d error!", i);
+            file_db_shard_free(file_db);
+            return NULL;
+        }
+    }
+
+    // 分片不单独启动工作线程，同一键值总是由同一工作线程提交到同一分片
+    if(NULL != user_option && user_option->async_threads > 0)
+    {
+        _private_->m_async = file_db_async_create(file_db, data_size, user_option->async_threads, user_option->async_queue_size, user_option->async_block);
+        if(NULL == _private_->m_async)
+        {
+            FILE_DB_SHARD_LOG_DEBUG("create async queue error!");
+            file_db_shard_free(file_db);
+            return NULL;
+        }
+    }
+
+    return file_db;
+}
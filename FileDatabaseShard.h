@@ -0,0 +1,39 @@
+/*
+** File : FileDatabaseShard.h
+** Author : Saury
+** Date : 2020-09-12
+*/
+
+#ifndef _FILE_DATABASE_SHARD_H_
+#define _FILE_DATABASE_SHARD_H_
+
+#include "FileDatabase.h"
+
+/*
+    分片文件数据库：按键值把元素分散到 N 个独立的文件数据库（path.0 ... path.N-1）中，N 保存在 path.shards 中，
+    每个分片有自己的文件、索引与锁，不同分片上的修改可以在多个线程中并行执行。
+    返回的 file_db_t 与 file_db_init 返回的接口完全相同：
+    size 返回全部分片的元素总数，traverse 依次遍历每个分片，write_head 写入全部分片，
+    read_head 读取第一个分片；批量接口按分片拆分后分别执行，status 与输入一一对应；
+    游标与范围访问在各分片间按键值归并，每次移动需要在每个分片中查找
+*/
+
+/*
+@func:
+    使用指定的文件路径前缀初始化分片文件数据库
+
+@para:
+    path : 文件路径前缀，第 i 个分片保存在 path.i 中
+    shard_cnt : 分片数量
+    option : 每个分片的打开选项，NULL 时与 file_db_init 相同
+
+@return:
+    file_db_t* : 文件数据库指针
+
+@note:
+    其余参数与 file_db_init 相同；
+    同一组文件每次打开时 shard_cnt 必须相同，否则元素会被分配到错误的分片，与 path.shards 中保存的不一致时返回 NULL
+*/
+extern file_db_t* file_db_shard_init(const char* path, int shard_cnt, int head_size, int data_size, int (*pf_hash_func)(void *), void* head, const file_db_option_t* option);
+
+#endif /* end #ifndef _FILE_DATABASE_SHARD_H_ */
@@ -0,0 +1,805 @@
+/*
+** File : FrozenIndex.c
+** Author : Saury
+** Date : 2020-09-12
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "FrozenIndex.h"
+
+
+#define DEBUG_LOG 0
+
+#define FROZEN_LOG_DEBUG(fmt, ...) \
+    do{ \
+        if(DEBUG_LOG) \
+        {\
+            printf("%s at %d " fmt "\r\n", __FILE__, __LINE__, ##__VA_ARGS__);\
+        }\
+    }while(0);
+
+
+#define FROZEN_LINE_SIZE    64  // 键值数组按缓存行对齐，下标为 16 的倍数的键值位于缓存行的开头
+#define FROZEN_PREFETCH     16  // 节点 k 往下第四层的 16 个子孙从下标 16k 开始连续存放，恰好占一个缓存行
+#define FROZEN_BATCH_GROUP  16  // 批量查找时交替查找的键值个数
+
+typedef struct _frozen_index_private
+{
+    int *m_keys;            // m_keys[k] 为 Eytzinger 布局中第 k 个节点的键值，k 从 1 开始，节点 k 的孩子为 2k 与 2k + 1
+    char *m_elements;       // 第 k 个节点的元素位于 m_elements + (k - 1) * m_element_size
+    int m_element_cnt;
+    int m_element_size;
+    bool m_is_thread_safe;
+    pthread_rwlock_t m_tree_lock;   // 查询与遍历共享读锁，构建与清除独占写锁
+}frozen_index_private_t;
+
+#define FROZEN_ELEMENT(_this, k) ((_this)->m_elements + (size_t)((k) - 1) * (_this)->m_element_size)
+
+/*
+@func:
+    获取私有成员变量
+
+@para:
+    tree ： 索引指针
+
+@return:
+    frozen_index_private_t* : 私有成员变量结构体指针
+*/
+static frozen_index_private_t* get_private_member(avl_tree_t* tree)
+{
+    if(NULL == tree) return NULL;
+
+    return (frozen_index_private_t*)tree->_private_;
+}
+
+/*
+@func:
+    线程锁， 上写锁/上读锁/解锁
+
+@para:
+    _this ： 私有成员
+
+@return:
+    None
+*/
+static void frozen_index_lock(frozen_index_private_t* _this)
+{
+    if(_this->m_is_thread_safe)
+        pthread_rwlock_wrlock(&_this->m_tree_lock);
+}
+
+static void frozen_index_lock_shared(frozen_index_private_t* _this)
+{
+    if(_this->m_is_thread_safe)
+        pthread_rwlock_rdlock(&_this->m_tree_lock);
+}
+
+static void frozen_index_unlock(frozen_index_private_t* _this)
+{
+    if(_this->m_is_thread_safe)
+        pthread_rwlock_unlock(&_this->m_tree_lock);
+}
+
+/*
+@func:
+    查找第一个键值 >= key / > key 的节点
+
+@para:
+    _this : 私有成员
+    key : 键值
+
+@return:
+    int : 0 不存在， other 节点的下标
+
+@note:
+    每层只根据比较结果计算孩子的下标，没有分支；循环结束后 k 的二进制末尾的 1 是最后几次向右走，
+    去掉它们以及再上一层即为最后一次向左走的节点，也就是要找的节点
+*/
+static int frozen_index_lower_bound(frozen_index_private_t* _this, int key)
+{
+    const int* keys = _this->m_keys;
+    unsigned long long n = (unsigned long long)_this->m_element_cnt;
+    unsigned long long k = 1;
+    while(k <= n)
+    {
+        __builtin_prefetch((const void*)((uintptr_t)keys + k * FROZEN_PREFETCH * sizeof(int)));
+        k = 2 * k + (keys[k] < key);
+    }
+    k >>= __builtin_ffsll(~k);
+    return (int)k;
+}
+
+static int frozen_index_upper_bound(frozen_index_private_t* _this, int key)
+{
+    const int* keys = _this->m_keys;
+    unsigned long long n = (unsigned long long)_this->m_element_cnt;
+    unsigned long long k = 1;
+    while(k <= n)
+    {
+        __builtin_prefetch((const void*)((uintptr_t)keys + k * FROZEN_PREFETCH * sizeof(int)));
+        k = 2 * k + (keys[k] <= key);
+    }
+    k >>= __builtin_ffsll(~k);
+    return (int)k;
+}
+
+/*
+@func:
+    按键值顺序获取节点 k 的 后继 / 前驱
+
+@para:
+    _this : 私有成员
+    k : 节点的下标
+
+@return:
+    int : 0 不存在， other 节点的下标
+
+@note:
+    有右子树时为右子树最左的节点，否则沿父节点向上，直到从左孩子上来；前驱对称
+*/
+static int frozen_index_successor(frozen_index_private_t* _this, long long k)
+{
+    long long n = _this->m_element_cnt;
+    if(2 * k + 1 <= n)
+    {
+        k = 2 * k + 1;
+        while(2 * k <= n)
+            k = 2 * k;
+        return (int)k;
+    }
+    while(k & 1)
+        k >>= 1;
+    return (int)(k >> 1);
+}
+
+static int frozen_index_predecessor(frozen_index_private_t* _this, long long k)
+{
+    long long n = _this->m_element_cnt;
+    if(2 * k <= n)
+    {
+        k = 2 * k;
+        while(2 * k + 1 <= n)
+            k = 2 * k + 1;
+        return (int)k;
+    }
+    while(k > 0 && 0 == (k & 1))
+        k >>= 1;
+    return (int)(k >> 1);
+}
+
+/*
+@func:
+    获取以节点 k 为根的子树中的节点个数
+
+@para:
+    _this : 私有成员
+    k : 节点的下标
+
+@return:
+    int : 节点个数
+
+@note:
+    只有最后一层可能不满，最后一层属于该子树的节点下标连续，O(1) 计算
+*/
+static int frozen_index_subtree_size(frozen_index_private_t* _this, long long k)
+{
+    long long n = _this->m_element_cnt;
+    if(k > n) return 0;
+
+    int levels = (63 - __builtin_clzll((unsigned long long)n)) - (63 - __builtin_clzll((unsigned long long)k));
+    long long first = k << levels;
+    long long last_level = n - first + 1;
+    if(last_level < 0) last_level = 0;
+    if(last_level > (1LL << levels)) last_level = 1LL << levels;
+    return (int)((1LL << levels) - 1 + last_level);
+}
+
+/*
+@func:
+    按中序把有序的元素依次放入 Eytzinger 布局
+
+@para:
+    _this : 私有成员
+    eles : 按键值严格递增排列的元素数组
+    pf_hash : 从元素获得键值的方法
+    k : 当前节点的下标
+    next : 下一个要放入的元素下标
+
+@return:
+    None
+
+@note:
+    递归深度为树的高度
+*/
+static void frozen_index_fill(frozen_index_private_t* _this, const char* eles, int (*pf_hash)(void *), long long k, int* next)
+{
+    if(k > _this->m_element_cnt) return;
+
+    frozen_index_fill(_this, eles, pf_hash, 2 * k, next);
+    const char* ele = eles + (size_t)(*next) * _this->m_element_size;
+    memcpy(FROZEN_ELEMENT(_this, k), ele, _this->m_element_size);
+    _this->m_keys[k] = pf_hash(FROZEN_ELEMENT(_this, k));
+    (*next)++;
+    frozen_index_fill(_this, eles, pf_hash, 2 * k + 1, next);
+}
+
+/*
+@func:
+    增加元素 / 批量增加元素 / 删除元素
+
+@para:
+    tree : 索引指针
+
+@return:
+    int : -1 只读索引不支持修改
+
+@note:
+    add_batch 中每个元素的结果也为 -1
+*/
+static int frozen_index_add(avl_tree_t *tree, void *ele)
+{
+    (void)tree;
+    (void)ele;
+    FROZEN_LOG_DEBUG("frozen index is read only");
+    return -1;
+}
+
+static int frozen_index_add_batch(avl_tree_t *tree, void *eles, int cnt, int *status)
+{
+    (void)tree;
+    (void)eles;
+    for(int i = 0; NULL != status && i < cnt; ++i)
+        status[i] = -1;
+    return -1;
+}
+
+static int frozen_index_del_by_key(avl_tree_t* tree, int key)
+{
+    (void)tree;
+    (void)key;
+    return -1;
+}
+
+static int frozen_index_del_by_element(avl_tree_t* tree, void* ele)
+{
+    (void)tree;
+    (void)ele;
+    return -1;
+}
+
+/*
+@func:
+    由按键值严格递增排列的元素构建索引
+
+@para:
+    tree : 索引指针，必须为空
+    eles : 连续存放的元素数组
+    cnt : 元素个数
+
+@return:
+    int : 0 成功， -1 参数错误， -2 申请内存失败， -3 索引不为空， -4 元素未按键值严格递增排列
+
+@note:
+    与平衡二叉树的约定相同；键值与元素各申请一块连续内存，失败时索引保持为空
+*/
+static int frozen_index_build_sorted(avl_tree_t *tree, void *eles, int cnt)
+{
+    frozen_index_private_t* _this = get_private_member(tree);
+    if(NULL == _this || NULL == eles || cnt < 0) return -1;
+    if(0 == cnt) return 0;
+
+    for(int i = 1; i < cnt; ++i)
+    {
+        if(tree->pf_hash((char*)eles + (size_t)i * _this->m_element_size) <= tree->pf_hash((char*)eles + (size_t)(i - 1) * _this->m_element_size))
+            return -4;
+    }
+
+    // 键值数组多留一个缓存行，下标 0 不使用
+    size_t keys_size = ((size_t)(cnt + 1) * sizeof(int) + FROZEN_LINE_SIZE - 1) / FROZEN_LINE_SIZE * FROZEN_LINE_SIZE;
+    void* keys = NULL;
+    if(0 != posix_memalign(&keys, FROZEN_LINE_SIZE, keys_size))
+        keys = NULL;
+    char* elements = (char*)malloc((size_t)cnt * _this->m_element_size);
+    if(NULL == keys || NULL == elements)
+    {
+        free(keys);
+        free(elements);
+        return -2;
+    }
+
+    int res = 0;
+    frozen_index_lock(_this);
+    if(0 != _this->m_element_cnt)
+    {
+        res = -3;
+        free(keys);
+        free(elements);
+    }
+    else
+    {
+        _this->m_keys = (int*)keys;
+        _this->m_elements = elements;
+        _this->m_element_cnt = cnt;
+        int next = 0;
+        frozen_index_fill(_this, (const char*)eles, tree->pf_hash, 1, &next);
+        FROZEN_LOG_DEBUG("build %d elements", cnt);
+    }
+    frozen_index_unlock(_this);
+    return res;
+}
+
+/*
+@func:
+    通过键值查找元素
+
+@para:
+    tree : 索引指针
+    key : 元素对应的键值
+
+@return:
+    void* ： NULL 不存在， other 查找到的元素
+*/
+static void* frozen_index_query_by_key(avl_tree_t *tree, int key)
+{
+    frozen_index_private_t* _this = get_private_member(tree);
+    if(NULL == _this) return NULL;
+
+    void* element = NULL;
+    frozen_index_lock_shared(_this);
+    int k = frozen_index_lower_bound(_this, key);
+    if(0 != k && key == _this->m_keys[k])
+        element = FROZEN_ELEMENT(_this, k);
+    frozen_index_unlock(_this);
+    return element;
+}
+
+/*
+@func:
+    通过键值批量查找元素
+
+@para:
+    tree : 索引指针
+    keys : 键值数组
+    cnt : 键值个数
+    eles : 输出每个键值对应的元素，不存在时为 NULL
+
+@return:
+    int : < 0 : 参数错误， other ： 查找到的元素个数
+
+@note:
+    树的高度固定，每 FROZEN_BATCH_GROUP 个键值为一组逐层同步向下，每层预取各自下一层的键值
+*/
+static int frozen_index_query_batch(avl_tree_t *tree, const int *keys, int cnt, void **eles)
+{
+    frozen_index_private_t* _this = get_private_member(tree);
+    if(NULL == _this || NULL == keys || NULL == eles || cnt < 0) return -1;
+
+    int found = 0;
+    frozen_index_lock_shared(_this);
+    const int* tree_keys = _this->m_keys;
+    unsigned long long n = (unsigned long long)_this->m_element_cnt;
+    for(int base = 0; base < cnt; base += FROZEN_BATCH_GROUP)
+    {
+        int group = cnt - base < FROZEN_BATCH_GROUP ? cnt - base : FROZEN_BATCH_GROUP;
+        unsigned long long k[FROZEN_BATCH_GROUP];
+        for(int i = 0; i < group; ++i)
+            k[i] = 1;
+
+        // 最后一层可能不满，各键值的路径长度最多相差一层
+        for(bool active = n > 0; active; )
+        {
+            active = false;
+            for(int i = 0; i < group; ++i)
+            {
+                if(k[i] > n) continue;
+                k[i] = 2 * k[i] + (tree_keys[k[i]] < keys[base + i]);
+                __builtin_prefetch((const void*)((uintptr_t)tree_keys + k[i] * sizeof(int)));
+                active = active || k[i] <= n;
+            }
+        }
+        for(int i = 0; i < group; ++i)
+        {
+            unsigned long long j = k[i] >> __builtin_ffsll(~k[i]);
+            eles[base + i] = (0 != j && keys[base + i] == tree_keys[j]) ? FROZEN_ELEMENT(_this, j) : NULL;
+            if(NULL != eles[base + i])
+                found++;
+        }
+    }
+    frozen_index_unlock(_this);
+    return found;
+}
+
+/*
+@func:
+    遍历全部元素
+
+@para:
+    tree ： 索引指针
+    visit : 遍历时对每个元素执行的操作
+
+@return:
+    None
+
+@note:
+    按键值升序访问；线程安全模式下整个遍历持有读锁
+*/
+static void frozen_index_preorder(avl_tree_t* tree, void (*visit)(void* ele))
+{
+    frozen_index_private_t* _this = get_private_member(tree);
+    if(NULL == _this || NULL == visit) return;
+
+    frozen_index_lock_shared(_this);
+    int k = (0 == _this->m_element_cnt) ? 0 : frozen_index_successor(_this, 0);
+    for(; 0 != k; k = frozen_index_successor(_this, k))
+        visit(FROZEN_ELEMENT(_this, k));
+    frozen_index_unlock(_this);
+}
+
+/*
+@func:
+    获取元素在索引中的位置对应的节点下标 / 节点下标对应的位置
+
+@para:
+    _this : 私有成员
+    pos : 元素的位置，即元素的地址
+    k : 节点的下标，0 表示不存在
+
+@return:
+    节点下标 / 位置
+*/
+static int frozen_index_pos_node(frozen_index_private_t* _this, void* pos)
+{
+    return (int)(((char*)pos - _this->m_elements) / _this->m_element_size) + 1;
+}
+
+static void* frozen_index_node_pos(frozen_index_private_t* _this, int k)
+{
+    return 0 != k ? FROZEN_ELEMENT(_this, k) : NULL;
+}
+
+/*
+@func:
+    定位到第一个键值 >= key 的元素 / 最后一个键值 <= key 的元素
+
+@para:
+    tree : 索引指针
+    key : 键值
+    pos : 输出定位到的位置，供 next / prev 使用，不存在时为 NULL
+
+@return:
+    void* : NULL 不存在， other 定位到的元素
+
+@note:
+    位置即元素的地址，在索引被清除前有效
+*/
+static void* frozen_index_seek(avl_tree_t *tree, int key, void **pos)
+{
+    frozen_index_private_t* _this = get_private_member(tree);
+    if(NULL == _this || NULL == pos) return NULL;
+
+    frozen_index_lock_shared(_this);
+    *pos = frozen_index_node_pos(_this, frozen_index_lower_bound(_this, key));
+    frozen_index_unlock(_this);
+    return *pos;
+}
+
+static void* frozen_index_seek_last(avl_tree_t *tree, int key, void **pos)
+{
+    frozen_index_private_t* _this = get_private_member(tree);
+    if(NULL == _this || NULL == pos) return NULL;
+
+    frozen_index_lock_shared(_this);
+    int k = 0;
+    if(0 != _this->m_element_cnt)
+    {
+        // 第一个键值 > key 的节点的前驱；不存在时为最后一个节点，即根节点开始的最右节点
+        k = frozen_index_upper_bound(_this, key);
+        k = 0 != k ? frozen_index_predecessor(_this, k) : frozen_index_predecessor(_this, 0);
+    }
+    *pos = frozen_index_node_pos(_this, k);
+    frozen_index_unlock(_this);
+    return *pos;
+}
+
+/*
+@func:
+    按键值顺序移动到 下一个 / 上一个 元素
+
+@para:
+    tree : 索引指针
+    pos : seek / seek_last 输出的位置，移动后更新，到达末尾 / 开头时为 NULL
+
+@return:
+    void* : NULL 已到达末尾 / 开头， other 移动到的元素
+
+@note:
+    平均 O(1)
+*/
+static void* frozen_index_next(avl_tree_t *tree, void **pos)
+{
+    frozen_index_private_t* _this = get_private_member(tree);
+    if(NULL == _this || NULL == pos || NULL == *pos) return NULL;
+
+    frozen_index_lock_shared(_this);
+    *pos = frozen_index_node_pos(_this, frozen_index_successor(_this, frozen_index_pos_node(_this, *pos)));
+    frozen_index_unlock(_this);
+    return *pos;
+}
+
+static void* frozen_index_prev(avl_tree_t *tree, void **pos)
+{
+    frozen_index_private_t* _this = get_private_member(tree);
+    if(NULL == _this || NULL == pos || NULL == *pos) return NULL;
+
+    frozen_index_lock_shared(_this);
+    *pos = frozen_index_node_pos(_this, frozen_index_predecessor(_this, frozen_index_pos_node(_this, *pos)));
+    frozen_index_unlock(_this);
+    return *pos;
+}
+
+/*
+@func:
+    按键值升序访问 [low, high) 范围内的元素
+
+@para:
+    tree : 索引指针
+    low : 范围下限，包含
+    high : 范围上限，不包含
+    visit : 对每个元素执行的操作，返回 false 时停止
+    arg : 传给 visit 的参数
+
+@return:
+    int : < 0 : 失败， other ： 访问的元素个数
+*/
+static int frozen_index_range(avl_tree_t *tree, int low, int high, bool (*visit)(void *ele, void *arg), void *arg)
+{
+    frozen_index_private_t* _this = get_private_member(tree);
+    if(NULL == _this || NULL == visit) return -1;
+
+    int cnt = 0;
+    frozen_index_lock_shared(_this);
+    for(int k = frozen_index_lower_bound(_this, low); 0 != k && _this->m_keys[k] < high; k = frozen_index_successor(_this, k))
+    {
+        cnt++;
+        if(!visit(FROZEN_ELEMENT(_this, k), arg))
+            break;
+    }
+    frozen_index_unlock(_this);
+    return cnt;
+}
+
+/*
+@func:
+    获取键值小于 key 的元素个数
+
+@para:
+    tree : 索引指针
+    key : 键值
+
+@return:
+    int : < 0 : 失败， other ： 键值小于 key 的元素个数
+
+@note:
+    从根往下查找，每次向右走时加上左子树与当前节点
+*/
+static int frozen_index_rank(avl_tree_t *tree, int key)
+{
+    frozen_index_private_t* _this = get_private_member(tree);
+    if(NULL == _this) return -1;
+
+    int rank = 0;
+    frozen_index_lock_shared(_this);
+    long long n = _this->m_element_cnt;
+    for(long long k = 1; k <= n; )
+    {
+        if(_this->m_keys[k] < key)
+        {
+            rank += frozen_index_subtree_size(_this, 2 * k) + 1;
+            k = 2 * k + 1;
+        }
+        else
+            k = 2 * k;
+    }
+    frozen_index_unlock(_this);
+    return rank;
+}
+
+/*
+@func:
+    按键值升序获取第 index 个元素（从 0 开始）
+
+@para:
+    tree : 索引指针
+    index : 元素的排名
+    pos : 输出元素的位置，供 next / prev 使用，不存在时为 NULL，可传 NULL
+
+@return:
+    void* : NULL index 越界， other 查找到的元素
+*/
+static void* frozen_index_select(avl_tree_t *tree, int index, void **pos)
+{
+    frozen_index_private_t* _this = get_private_member(tree);
+    if(NULL == _this) return NULL;
+
+    int k = 0;
+    frozen_index_lock_shared(_this);
+    if(index >= 0 && index < _this->m_element_cnt)
+    {
+        k = 1;
+        for(int left = frozen_index_subtree_size(_this, 2); index != left; left = frozen_index_subtree_size(_this, 2LL * k))
+        {
+            if(index < left)
+                k = 2 * k;
+            else
+            {
+                index -= left + 1;
+                k = 2 * k + 1;
+            }
+        }
+    }
+    void* element = frozen_index_node_pos(_this, k);
+    frozen_index_unlock(_this);
+
+    if(NULL != pos)
+        *pos = element;
+    return element;
+}
+
+/*
+@func:
+    统计键值在 [low, high) 范围内的元素个数
+
+@para:
+    tree : 索引指针
+    low : 范围下限，包含
+    high : 范围上限，不包含
+
+@return:
+    int : < 0 : 失败， other ： 范围内的元素个数
+*/
+static int frozen_index_count_range(avl_tree_t *tree, int low, int high)
+{
+    if(NULL == get_private_member(tree)) return -1;
+    if(low >= high) return 0;
+
+    return frozen_index_rank(tree, high) - frozen_index_rank(tree, low);
+}
+
+/*
+@func:
+    获取元素的数量
+
+@para:
+    tree : 索引指针
+
+@return:
+    int : 元素的数量
+*/
+static int frozen_index_size(avl_tree_t* tree)
+{
+    frozen_index_private_t* _this = get_private_member(tree);
+    return _this->m_element_cnt;
+}
+
+/*
+@func:
+    清除全部元素
+
+@para:
+    tree : 索引指针
+
+@return:
+    None.
+
+@note:
+    清除后可以再次 build_sorted
+*/
+static void frozen_index_clear(avl_tree_t *tree)
+{
+    frozen_index_private_t* _this = get_private_member(tree);
+
+    frozen_index_lock(_this);
+    for(int k = 1; NULL != tree->pf_free_element && k <= _this->m_element_cnt; ++k)
+        tree->pf_free_element(FROZEN_ELEMENT(_this, k));
+    free(_this->m_keys);
+    free(_this->m_elements);
+    _this->m_keys = NULL;
+    _this->m_elements = NULL;
+    _this->m_element_cnt = 0;
+    frozen_index_unlock(_this);
+}
+
+/*
+@func:
+    销毁索引
+
+@para:
+    tree : 索引指针
+
+@return:
+    None.
+*/
+static void frozen_index_destory(avl_tree_t** tree)
+{
+    avl_tree_t* _this = *tree;
+
+    if(NULL == _this) return;
+
+    if(_this->_private_)
+    {
+        frozen_index_clear(_this);
+
+        frozen_index_private_t* private_member = get_private_member(_this);
+        pthread_rwlock_destroy(&private_member->m_tree_lock);
+        free(_this->_private_);
+        _this->_private_ = NULL;
+    }
+
+    free(_this);
+    *tree = NULL;
+}
+
+/*
+@func:
+    创建一个只读索引
+
+@para:
+    element_size : 元素的大小，单位字节
+    pf_hash_func ； 从元素获得键值 key 的方法，由用户提供
+    pf_free_element_func ： 若元素不包含额外的动态内存， 此参数可传 NULL
+    thread_safe ： 是否启用线程安全
+
+@return:
+    avl_tree_t* : NULL 失败， other 与平衡二叉树接口相同的索引指针
+*/
+avl_tree_t* frozen_index_create(int element_size, int (*pf_hash_func)(void *), int (*pf_free_element_func)(void *), bool thread_safe)
+{
+    if(NULL == pf_hash_func || element_size <= 0)
+        return NULL;
+
+    avl_tree_t *tree = (avl_tree_t *)malloc(sizeof(avl_tree_t));
+    frozen_index_private_t *private_member = (frozen_index_private_t *)malloc(sizeof(frozen_index_private_t));
+    if(NULL == tree || NULL == private_member)
+    {
+        free(tree);
+        free(private_member);
+        return NULL;
+    }
+    memset(tree, 0, sizeof(avl_tree_t));
+    memset(private_member, 0, sizeof(frozen_index_private_t));
+
+    private_member->m_element_size = element_size;
+    private_member->m_is_thread_safe = thread_safe;
+
+    pthread_rwlock_init(&private_member->m_tree_lock, NULL);
+
+    tree->_this = tree;
+    tree->_private_ = (void *)private_member;
+
+    tree->pf_hash = pf_hash_func;
+    tree->pf_free_element = pf_free_element_func;
+    tree->add = frozen_index_add;
+    tree->add_batch = frozen_index_add_batch;
+    tree->build_sorted = frozen_index_build_sorted;
+    tree->query_by_key = frozen_index_query_by_key;
+    tree->query_batch = frozen_index_query_batch;
+    tree->preorder = frozen_index_preorder;
+    tree->seek = frozen_index_seek;
+    tree->seek_last = frozen_index_seek_last;
+    tree->next = frozen_index_next;
+    tree->prev = frozen_index_prev;
+    tree->range = frozen_index_range;
+    tree->rank = frozen_index_rank;
+    tree->select = frozen_index_select;
+    tree->count_range = frozen_index_count_range;
+    tree->size = frozen_index_size;
+    tree->del_node_by_key = frozen_index_del_by_key;
+    tree->del_node_by_element = frozen_index_del_by_element;
+    tree->clear_node = frozen_index_clear;
+    tree->destory = frozen_index_destory;
+
+    return tree;
+}
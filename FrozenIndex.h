@@ -0,0 +1,35 @@
+/*
+** File : FrozenIndex.h
+** Author : Saury
+** Date : 2020-09-12
+*/
+
+#ifndef _FROZEN_INDEX_H_
+#define _FROZEN_INDEX_H_
+
+#include "AVLTree.h"
+
+/*
+    只读索引：提供与 avl_tree_t 相同的接口，只能通过 build_sorted 一次构建，之后不能增删元素。
+    键值按 Eytzinger 布局（隐式完全二叉树的层序）连续存放在一个数组中，元素按相同的顺序存放在并列的数组中；
+    查找时没有指针跳转与难以预测的分支，并提前预取四层之后的键值所在的缓存行。
+    add / add_batch / del_node_by_key / del_node_by_element 返回 -1；clear_node 清空后可以再次 build_sorted；
+    按键值顺序访问、rank、select 与 count_range 均为 O(log n)
+*/
+
+/*
+@func:
+    创建一个只读索引
+
+@para:
+    element_size : 元素的大小，单位字节
+    pf_hash_func ； 从元素获得键值 key 的方法，由用户提供
+    pf_free_element_func ： 若元素不包含额外的动态内存， 此参数可传 NULL
+    thread_safe ： 是否启用线程安全，启用后查询与遍历共享读锁，构建与清除独占写锁
+
+@return:
+    avl_tree_t* : NULL 失败， other 与平衡二叉树接口相同的索引指针
+*/
+extern avl_tree_t* frozen_index_create(int element_size, int (*pf_hash_func)(void *), int (*pf_free_element_func)(void *), bool thread_safe);
+
+#endif /* end #ifndef _FROZEN_INDEX_H_ */
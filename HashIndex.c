@@ -0,0 +1,1024 @@
+/*
+** File : HashIndex.c
+** Author : Saury
+** Date : 2020-09-12
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "HashIndex.h"
+#include "MemPool.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+#define DEBUG_LOG 0
+
+#define HASH_LOG_DEBUG(fmt, ...) \
+    do{ \
+        if(DEBUG_LOG) \
+        {\
+            printf("%s at %d " fmt "\r\n", __FILE__, __LINE__, ##__VA_ARGS__);\
+        }\
+    }while(0);
+
+
+#define HASH_GROUP_SIZE     16      // 一次比较的控制字节个数
+#define HASH_MIN_CAPACITY   16      // 表的最小位置数，必须是 HASH_GROUP_SIZE 的倍数
+#define HASH_MIGRATE_STEP   64      // 扩容期间每次修改迁移的旧表位置数
+#define HASH_BATCH_GROUP    16      // 批量查找时一起预取的键值个数
+
+#define HASH_CTRL_EMPTY     ((int8_t)-128)  // 空位置，查找到含有空位置的组即可停止
+#define HASH_CTRL_DELETED   ((int8_t)-2)    // 已删除，查找时需继续向后探测
+                                            // 其余值 0 ~ 127 为已占用，保存键值哈希的低 7 位
+
+typedef struct _hash_table
+{
+    int8_t *ctrl;       // 控制字节，按组对齐
+    int *keys;          // 键值连续存放，与控制字节一一对应
+    void **elements;    // 元素
+    int capacity;       // 位置数，2 的幂
+    int used;           // 已占用与已删除的位置数，决定何时扩容
+    int cnt;            // 已占用的位置数
+}hash_table_t;
+
+typedef struct _hash_index_private
+{
+    hash_table_t m_table;   // 当前表，新元素都插入到当前表
+    hash_table_t m_old;     // 扩容时尚未迁移完的旧表，capacity 为 0 表示没有
+    int m_migrate_pos;      // 旧表中下一个要迁移的位置
+    int m_element_size;
+    bool m_is_thread_safe;
+    pthread_rwlock_t m_tree_lock;   // 查询与遍历共享读锁，修改独占写锁
+    mem_pool_t *m_pool;     // 元素的内存池，清除时整体释放
+}hash_index_private_t;
+
+/*
+@func:
+    获取私有成员变量
+
+@para:
+    tree ： 索引指针
+
+@return:
+    hash_index_private_t* : 私有成员变量结构体指针
+*/
+static hash_index_private_t* get_private_member(avl_tree_t* tree)
+{
+    if(NULL == tree) return NULL;
+
+    return (hash_index_private_t*)tree->_private_;
+}
+
+/*
+@func:
+    线程锁， 上写锁/上读锁/解锁
+
+@para:
+    _this ： 私有成员
+
+@return:
+    None
+*/
+static void hash_index_lock(hash_index_private_t* _this)
+{
+    if(_this->m_is_thread_safe)
+        pthread_rwlock_wrlock(&_this->m_tree_lock);
+}
+
+static void hash_index_lock_shared(hash_index_private_t* _this)
+{
+    if(_this->m_is_thread_safe)
+        pthread_rwlock_rdlock(&_this->m_tree_lock);
+}
+
+static void hash_index_unlock(hash_index_private_t* _this)
+{
+    if(_this->m_is_thread_safe)
+        pthread_rwlock_unlock(&_this->m_tree_lock);
+}
+
+/*
+@func:
+    计算键值的哈希
+
+@para:
+    key : 键值
+
+@return:
+    uint64_t : 哈希值，低 7 位保存到控制字节，其余位决定探测的起始组
+
+@note:
+    连续的整数键值经乘法与移位混合后分散到各组
+*/
+static uint64_t hash_index_hash(int key)
+{
+    uint64_t h = (uint64_t)(uint32_t)key * 0x9E3779B97F4A7C15ULL;
+    return h ^ (h >> 32);
+}
+
+#define HASH_H1(h) ((h) >> 7)
+#define HASH_H2(h) ((int8_t)((h) & 0x7F))
+
+/*
+@func:
+    在一组控制字节中查找等于 value 的位置 / 空位置 / 空或已删除的位置
+
+@para:
+    group : 一组控制字节的起始地址
+    value : 要比较的控制字节
+
+@return:
+    unsigned : 位掩码，第 i 位为 1 表示组内第 i 个位置满足条件
+*/
+static unsigned hash_index_match(const int8_t* group, int8_t value)
+{
+#ifdef __SSE2__
+    __m128i ctrl = _mm_load_si128((const __m128i*)group);
+    return (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(value)));
+#else
+    unsigned mask = 0;
+    for(int i = 0; i < HASH_GROUP_SIZE; ++i)
+    {
+        if(group[i] == value)
+            mask |= 1u << i;
+    }
+    return mask;
+#endif
+}
+
+static unsigned hash_index_match_free(const int8_t* group)
+{
+#ifdef __SSE2__
+    // 空与已删除的控制字节最高位为 1
+    return (unsigned)_mm_movemask_epi8(_mm_load_si128((const __m128i*)group));
+#else
+    unsigned mask = 0;
+    for(int i = 0; i < HASH_GROUP_SIZE; ++i)
+    {
+        if(group[i] < 0)
+            mask |= 1u << i;
+    }
+    return mask;
+#endif
+}
+
+/*
+@func:
+    申请 / 释放表
+
+@para:
+    table : 表
+    capacity : 位置数，2 的幂且不小于 HASH_MIN_CAPACITY
+
+@return:
+    int : 0 成功， -2 申请内存失败
+*/
+static int hash_table_init(hash_table_t* table, int capacity)
+{
+    void* ctrl = NULL;
+    memset(table, 0, sizeof(hash_table_t));
+    if(0 != posix_memalign(&ctrl, HASH_GROUP_SIZE, capacity))
+        return -2;
+    table->ctrl = (int8_t*)ctrl;
+    table->keys = (int*)malloc(sizeof(int) * capacity);
+    table->elements = (void**)malloc(sizeof(void*) * capacity);
+    if(NULL == table->keys || NULL == table->elements)
+    {
+        free(table->ctrl);
+        free(table->keys);
+        free(table->elements);
+        memset(table, 0, sizeof(hash_table_t));
+        return -2;
+    }
+    memset(table->ctrl, HASH_CTRL_EMPTY, capacity);
+    table->capacity = capacity;
+    return 0;
+}
+
+static void hash_table_free(hash_table_t* table)
+{
+    free(table->ctrl);
+    free(table->keys);
+    free(table->elements);
+    memset(table, 0, sizeof(hash_table_t));
+}
+
+/*
+@func:
+    在表中查找键值所在的位置
+
+@para:
+    table : 表
+    key : 键值
+    h : 键值的哈希
+
+@return:
+    int : < 0 不存在， other 键值所在的位置
+
+@note:
+    按组三角数序列探测，表的组数为 2 的幂时可以访问到每一组；
+    探测到含有空位置的组时停止
+*/
+static int hash_table_find(const hash_table_t* table, int key, uint64_t h)
+{
+    if(0 == table->capacity) return -1;
+
+    int group_mask = table->capacity / HASH_GROUP_SIZE - 1;
+    int group = (int)(HASH_H1(h) & (uint64_t)group_mask);
+    int8_t h2 = HASH_H2(h);
+    for(int step = 1; step <= group_mask + 1; ++step)
+    {
+        const int8_t* ctrl = table->ctrl + group * HASH_GROUP_SIZE;
+        for(unsigned mask = hash_index_match(ctrl, h2); 0 != mask; mask &= mask - 1)
+        {
+            int slot = group * HASH_GROUP_SIZE + __builtin_ctz(mask);
+            if(table->keys[slot] == key)
+                return slot;
+        }
+        if(0 != hash_index_match(ctrl, HASH_CTRL_EMPTY))
+            return -1;
+        group = (group + step) & group_mask;
+    }
+    return -1;
+}
+
+/*
+@func:
+    把确定不存在的键值插入表中
+
+@para:
+    table : 表，插入前至少有一个空位置
+    key : 键值
+    h : 键值的哈希
+    element : 元素
+
+@return:
+    None.
+
+@note:
+    沿与查找相同的探测序列使用第一个空或已删除的位置
+*/
+static void hash_table_insert(hash_table_t* table, int key, uint64_t h, void* element)
+{
+    int group_mask = table->capacity / HASH_GROUP_SIZE - 1;
+    int group = (int)(HASH_H1(h) & (uint64_t)group_mask);
+    for(int step = 1; ; ++step)
+    {
+        unsigned mask = hash_index_match_free(table->ctrl + group * HASH_GROUP_SIZE);
+        if(0 != mask)
+        {
+            int slot = group * HASH_GROUP_SIZE + __builtin_ctz(mask);
+            if(HASH_CTRL_EMPTY == table->ctrl[slot])
+                table->used++;
+            table->ctrl[slot] = HASH_H2(h);
+            table->keys[slot] = key;
+            table->elements[slot] = element;
+            table->cnt++;
+            return;
+        }
+        group = (group + step) & group_mask;
+    }
+}
+
+/*
+@func:
+    删除表中指定位置的元素
+
+@para:
+    table : 表
+    slot : 位置
+
+@return:
+    None.
+
+@note:
+    所在组中还有空位置时，探测不会越过该组，可以直接标记为空，否则标记为已删除
+*/
+static void hash_table_erase(hash_table_t* table, int slot)
+{
+    const int8_t* group = table->ctrl + slot / HASH_GROUP_SIZE * HASH_GROUP_SIZE;
+    if(0 != hash_index_match(group, HASH_CTRL_EMPTY))
+    {
+        table->ctrl[slot] = HASH_CTRL_EMPTY;
+        table->used--;
+    }
+    else
+    {
+        table->ctrl[slot] = HASH_CTRL_DELETED;
+    }
+    table->cnt--;
+}
+
+/*
+@func:
+    计算保存 cnt 个元素所需的位置数
+
+@para:
+    cnt : 元素个数
+
+@return:
+    int : 位置数，使迁移完成后的负载不超过 1/2
+*/
+static int hash_index_capacity_for(int cnt)
+{
+    int capacity = HASH_MIN_CAPACITY;
+    while(capacity < 2 * cnt + 2)
+        capacity *= 2;
+    return capacity;
+}
+
+/*
+@func:
+    把旧表中的一段位置迁移到当前表
+
+@para:
+    _this : 私有成员
+    step : 迁移的位置数，<= 0 时迁移全部
+
+@return:
+    None.
+
+@note:
+    旧表迁移完成后释放；调用者需持有写锁
+*/
+static void hash_index_migrate(hash_index_private_t* _this, int step)
+{
+    hash_table_t* old = &_this->m_old;
+    if(0 == old->capacity) return;
+
+    int end = (step <= 0 || _this->m_migrate_pos + step > old->capacity) ? old->capacity : _this->m_migrate_pos + step;
+    for(int slot = _this->m_migrate_pos; slot < end; ++slot)
+    {
+        if(old->ctrl[slot] >= 0)
+        {
+            int key = old->keys[slot];
+            hash_table_insert(&_this->m_table, key, hash_index_hash(key), old->elements[slot]);
+            old->ctrl[slot] = HASH_CTRL_DELETED;
+            old->cnt--;
+        }
+    }
+    _this->m_migrate_pos = end;
+    if(end == old->capacity)
+    {
+        hash_table_free(old);
+        _this->m_migrate_pos = 0;
+    }
+}
+
+/*
+@func:
+    当前表的负载超过 7/8 时开始扩容
+
+@para:
+    _this : 私有成员
+
+@return:
+    int : 0 成功， -2 申请内存失败
+
+@note:
+    新表按存活的元素个数确定大小，已删除位置较多时大小可能不变，只清除已删除标记；
+    旧表保留到逐步迁移完成，调用者需持有写锁
+*/
+static int hash_index_grow(hash_index_private_t* _this)
+{
+    hash_table_t* table = &_this->m_table;
+    if((table->used + 1) * 8 <= table->capacity * 7)
+        return 0;
+
+    // 上一次扩容还未迁移完时先一次迁移完，按当前表的负载这种情况很少发生
+    hash_index_migrate(_this, 0);
+
+    hash_table_t grown;
+    if(0 != hash_table_init(&grown, hash_index_capacity_for(table->cnt + 1)))
+        return -2;
+
+    _this->m_old = *table;
+    _this->m_table = grown;
+    _this->m_migrate_pos = 0;
+    HASH_LOG_DEBUG("grow %d -> %d", _this->m_old.capacity, grown.capacity);
+    return 0;
+}
+
+/*
+@func:
+    在当前表与旧表中查找键值
+
+@para:
+    _this : 私有成员
+    key : 键值
+    table : 输出键值所在的表，可传 NULL
+
+@return:
+    int : < 0 不存在， other 键值在所在表中的位置
+*/
+static int hash_index_find(hash_index_private_t* _this, int key, hash_table_t** table)
+{
+    uint64_t h = hash_index_hash(key);
+    int slot = hash_table_find(&_this->m_table, key, h);
+    hash_table_t* found = &_this->m_table;
+    if(slot < 0)
+    {
+        slot = hash_table_find(&_this->m_old, key, h);
+        found = &_this->m_old;
+    }
+    if(NULL != table)
+        *table = found;
+    return slot;
+}
+
+/*
+@func:
+    把元素插入索引中
+
+@para:
+    _this : 私有成员
+    key : 元素的键值
+    element : 元素
+
+@return:
+    int : 0 成功， -2 申请内存失败， -3 重复插入（元素不会被释放）
+
+@note:
+    调用者需持有写锁
+*/
+static int hash_index_insert(hash_index_private_t* _this, int key, void* element)
+{
+    hash_index_migrate(_this, HASH_MIGRATE_STEP);
+
+    if(hash_index_find(_this, key, NULL) >= 0)
+    {
+        HASH_LOG_DEBUG("Element repetition");
+        return -3;
+    }
+    if(0 != hash_index_grow(_this))
+        return -2;
+
+    hash_table_insert(&_this->m_table, key, hash_index_hash(key), element);
+    return 0;
+}
+
+/*
+@func:
+    创建保存指定元素拷贝的元素内存 / 释放元素内存
+
+@para:
+    tree : 索引指针
+    ele : 元素
+
+@return:
+    void* : NULL 失败， other 元素的拷贝
+*/
+static void* hash_index_create_element(avl_tree_t* tree, void* ele)
+{
+    hash_index_private_t* _this = get_private_member(tree);
+    void* element = _this->m_pool->alloc(_this->m_pool, _this->m_element_size);
+    if(NULL == element)
+    {
+        HASH_LOG_DEBUG("[ERROR]:element malloc");
+        return NULL;
+    }
+    memcpy(element, ele, _this->m_element_size);
+    return element;
+}
+
+static void hash_index_free_element(avl_tree_t* tree, void* element)
+{
+    hash_index_private_t* _this = get_private_member(tree);
+    if(NULL != tree->pf_free_element)
+        tree->pf_free_element(element);
+    _this->m_pool->free(_this->m_pool, element, _this->m_element_size);
+}
+
+/*
+@func:
+    增加元素
+
+@para:
+    tree : 索引指针
+    ele : 要增加的元素
+
+@return:
+    int : -1 索引指针为空， -2 创建元素失败， -3 重复插入
+*/
+static int hash_index_add(avl_tree_t *tree, void *ele)
+{
+    hash_index_private_t* _this = get_private_member(tree);
+    if(NULL == _this || NULL == ele) return -1;
+
+    void* element = hash_index_create_element(tree, ele);
+    if(NULL == element) return -2;
+
+    hash_index_lock(_this);
+    int res = hash_index_insert(_this, tree->pf_hash(element), element);
+    hash_index_unlock(_this);
+
+    if(0 != res)
+        hash_index_free_element(tree, element);
+    return res;
+}
+
+/*
+@func:
+    批量增加元素
+
+@para:
+    tree : 索引指针
+    eles : 连续存放的元素数组
+    cnt : 元素个数
+    status : 每个元素的插入结果，含义与 add 的返回值相同，可传 NULL
+
+@return:
+    int : < 0 参数错误， other 成功插入的元素个数
+
+@note:
+    元素在加锁前全部拷贝完成，整批插入只获取一次锁
+*/
+static int hash_index_add_batch(avl_tree_t *tree, void *eles, int cnt, int *status)
+{
+    hash_index_private_t* _this = get_private_member(tree);
+    if(NULL == _this || NULL == eles || cnt < 0) return -1;
+
+    void** elements = (void**)malloc(sizeof(void*) * (cnt > 0 ? cnt : 1));
+    if(NULL == elements) return -2;
+
+    for(int i = 0; i < cnt; ++i)
+        elements[i] = hash_index_create_element(tree, (char*)eles + (size_t)i * _this->m_element_size);
+
+    int added = 0;
+    hash_index_lock(_this);
+    for(int i = 0; i < cnt; ++i)
+    {
+        int res = (NULL == elements[i]) ? -2 : hash_index_insert(_this, tree->pf_hash(elements[i]), elements[i]);
+        if(0 == res)
+            added++;
+        else if(NULL != elements[i])
+            hash_index_free_element(tree, elements[i]);
+        if(NULL != status)
+            status[i] = res;
+    }
+    hash_index_unlock(_this);
+
+    free(elements);
+    return added;
+}
+
+/*
+@func:
+    由按键值严格递增排列的元素直接构建索引
+
+@para:
+    tree : 索引指针，必须为空
+    eles : 连续存放的元素数组
+    cnt : 元素个数
+
+@return:
+    int : 0 成功， -1 参数错误， -2 创建元素失败， -3 索引不为空， -4 元素未按键值严格递增排列
+
+@note:
+    与平衡二叉树的约定相同；按元素个数一次申请足够大的表，构建过程中不需要扩容；
+    失败时索引保持为空，且不会释放元素中的动态内存
+*/
+static int hash_index_build_sorted(avl_tree_t *tree, void *eles, int cnt)
+{
+    hash_index_private_t* _this = get_private_member(tree);
+    if(NULL == _this || NULL == eles || cnt < 0) return -1;
+    if(0 == cnt) return 0;
+
+    for(int i = 1; i < cnt; ++i)
+    {
+        if(tree->pf_hash((char*)eles + (size_t)i * _this->m_element_size) <= tree->pf_hash((char*)eles + (size_t)(i - 1) * _this->m_element_size))
+            return -4;
+    }
+
+    hash_table_t table;
+    if(0 != hash_table_init(&table, hash_index_capacity_for(cnt)))
+        return -2;
+
+    int res = 0;
+    for(int i = 0; i < cnt; ++i)
+    {
+        void* element = hash_index_create_element(tree, (char*)eles + (size_t)i * _this->m_element_size);
+        if(NULL == element)
+        {
+            res = -2;
+            break;
+        }
+        int key = tree->pf_hash(element);
+        hash_table_insert(&table, key, hash_index_hash(key), element);
+    }
+
+    if(0 == res)
+    {
+        hash_index_lock(_this);
+        if(0 == _this->m_table.cnt && 0 == _this->m_old.cnt)
+        {
+            hash_table_free(&_this->m_old);
+            hash_table_free(&_this->m_table);
+            _this->m_table = table;
+            _this->m_migrate_pos = 0;
+        }
+        else
+        {
+            res = -3;
+        }
+        hash_index_unlock(_this);
+    }
+
+    if(0 != res)
+    {
+        for(int slot = 0; slot < table.capacity; ++slot)
+        {
+            if(table.ctrl[slot] >= 0)
+                _this->m_pool->free(_this->m_pool, table.elements[slot], _this->m_element_size);
+        }
+        hash_table_free(&table);
+    }
+    return res;
+}
+
+/*
+@func:
+    通过键值查找元素
+
+@para:
+    tree : 索引指针
+    key : 元素对应的键值
+
+@return:
+    void* ： NULL 不存在， other 查找到的元素
+
+@note:
+    通常只比较一组控制字节与一个键值
+*/
+static void* hash_index_query_by_key(avl_tree_t *tree, int key)
+{
+    hash_index_private_t* _this = get_private_member(tree);
+    if(NULL == _this) return NULL;
+
+    hash_table_t* table = NULL;
+    hash_index_lock_shared(_this);
+    int slot = hash_index_find(_this, key, &table);
+    void* element = (slot >= 0) ? table->elements[slot] : NULL;
+    hash_index_unlock(_this);
+    return element;
+}
+
+/*
+@func:
+    通过键值批量查找元素
+
+@para:
+    tree : 索引指针
+    keys : 键值数组
+    cnt : 键值个数
+    eles : 输出每个键值对应的元素，不存在时为 NULL
+
+@return:
+    int : < 0 : 参数错误， other ： 查找到的元素个数
+
+@note:
+    每 HASH_BATCH_GROUP 个键值为一组分三步：预取每个键值第一组探测位置的控制字节与键值，
+    查找并预取元素指针，最后取出元素；每一步中各键值的缓存未命中相互重叠
+*/
+static int hash_index_query_batch(avl_tree_t *tree, const int *keys, int cnt, void **eles)
+{
+    hash_index_private_t* _this = get_private_member(tree);
+    if(NULL == _this || NULL == keys || NULL == eles || cnt < 0) return -1;
+
+    int found = 0;
+    hash_index_lock_shared(_this);
+    const hash_table_t* table = &_this->m_table;
+    for(int base = 0; base < cnt; base += HASH_BATCH_GROUP)
+    {
+        int group = cnt - base < HASH_BATCH_GROUP ? cnt - base : HASH_BATCH_GROUP;
+        hash_table_t* tables[HASH_BATCH_GROUP];
+        int slots[HASH_BATCH_GROUP];
+        for(int i = 0; table->capacity > 0 && i < group; ++i)
+        {
+            int group_mask = table->capacity / HASH_GROUP_SIZE - 1;
+            int first = (int)(HASH_H1(hash_index_hash(keys[base + i])) & (uint64_t)group_mask) * HASH_GROUP_SIZE;
+            __builtin_prefetch(table->ctrl + first);
+            __builtin_prefetch(table->keys + first);
+        }
+        for(int i = 0; i < group; ++i)
+        {
+            slots[i] = hash_index_find(_this, keys[base + i], &tables[i]);
+            if(slots[i] >= 0)
+                __builtin_prefetch(&tables[i]->elements[slots[i]]);
+        }
+        for(int i = 0; i < group; ++i)
+        {
+            eles[base + i] = slots[i] >= 0 ? tables[i]->elements[slots[i]] : NULL;
+            if(slots[i] >= 0)
+                found++;
+        }
+    }
+    hash_index_unlock(_this);
+    return found;
+}
+
+/*
+@func:
+    通过键值 / 元素删除元素
+
+@para:
+    tree : 索引指针
+    key : 元素对应的键值
+    ele : 元素
+
+@return:
+    int ： 0 成功  -1 失败
+*/
+static int hash_index_del_by_key(avl_tree_t* tree, int key)
+{
+    hash_index_private_t* _this = get_private_member(tree);
+    if(NULL == _this) return -1;
+
+    hash_table_t* table = NULL;
+    hash_index_lock(_this);
+    hash_index_migrate(_this, HASH_MIGRATE_STEP);
+    int slot = hash_index_find(_this, key, &table);
+    if(slot >= 0)
+    {
+        hash_index_free_element(tree, table->elements[slot]);
+        hash_table_erase(table, slot);
+    }
+    hash_index_unlock(_this);
+
+    return slot >= 0 ? 0 : -1;
+}
+
+static int hash_index_del_by_element(avl_tree_t* tree, void* ele)
+{
+    if(NULL == tree || NULL == ele) return -1;
+
+    return hash_index_del_by_key(tree, tree->pf_hash(ele));
+}
+
+/*
+@func:
+    遍历全部元素
+
+@para:
+    tree ： 索引指针
+    visit : 遍历时对每个元素执行的操作
+
+@return:
+    None
+
+@note:
+    按位置顺序访问，与键值顺序无关；线程安全模式下整个遍历持有读锁，visit 中不能修改索引
+*/
+static void hash_index_preorder(avl_tree_t* tree, void (*visit)(void* ele))
+{
+    hash_index_private_t* _this = get_private_member(tree);
+    if(NULL == _this || NULL == visit) return;
+
+    hash_index_lock_shared(_this);
+    hash_table_t* tables[2] = {&_this->m_old, &_this->m_table};
+    for(int t = 0; t < 2; ++t)
+    {
+        for(int slot = 0; slot < tables[t]->capacity; ++slot)
+        {
+            if(tables[t]->ctrl[slot] >= 0)
+                visit(tables[t]->elements[slot]);
+        }
+    }
+    hash_index_unlock(_this);
+}
+
+/*
+@func:
+    有序访问接口，哈希索引不支持
+
+@return:
+    void* : NULL
+    int : -1
+*/
+static void* hash_index_seek(avl_tree_t *tree, int key, void **pos)
+{
+    (void)tree;
+    (void)key;
+    if(NULL != pos)
+        *pos = NULL;
+    return NULL;
+}
+
+static void* hash_index_step(avl_tree_t *tree, void **pos)
+{
+    (void)tree;
+    if(NULL != pos)
+        *pos = NULL;
+    return NULL;
+}
+
+static int hash_index_range(avl_tree_t *tree, int low, int high, bool (*visit)(void *ele, void *arg), void *arg)
+{
+    (void)tree;
+    (void)low;
+    (void)high;
+    (void)visit;
+    (void)arg;
+    return -1;
+}
+
+static int hash_index_rank(avl_tree_t *tree, int key)
+{
+    (void)tree;
+    (void)key;
+    return -1;
+}
+
+static void* hash_index_select(avl_tree_t *tree, int index, void **pos)
+{
+    (void)tree;
+    (void)index;
+    if(NULL != pos)
+        *pos = NULL;
+    return NULL;
+}
+
+static int hash_index_count_range(avl_tree_t *tree, int low, int high)
+{
+    (void)tree;
+    (void)low;
+    (void)high;
+    return -1;
+}
+
+/*
+@func:
+    获取元素的数量
+
+@para:
+    tree : 索引指针
+
+@return:
+    int : 元素的数量
+*/
+static int hash_index_size(avl_tree_t* tree)
+{
+    hash_index_private_t* _this = get_private_member(tree);
+    return _this->m_table.cnt + _this->m_old.cnt;
+}
+
+/*
+@func:
+    清除全部元素
+
+@para:
+    tree : 索引指针
+
+@return:
+    None.
+
+@note:
+    元素从内存池中申请，清除时整体释放；表恢复为最小大小
+*/
+static void hash_index_clear(avl_tree_t *tree)
+{
+    hash_index_private_t* _this = get_private_member(tree);
+
+    hash_index_lock(_this);
+    if(NULL != tree->pf_free_element)
+    {
+        hash_table_t* tables[2] = {&_this->m_old, &_this->m_table};
+        for(int t = 0; t < 2; ++t)
+        {
+            for(int slot = 0; slot < tables[t]->capacity; ++slot)
+            {
+                if(tables[t]->ctrl[slot] >= 0)
+                    tree->pf_free_element(tables[t]->elements[slot]);
+            }
+        }
+    }
+    _this->m_pool->clear(_this->m_pool);
+    hash_table_free(&_this->m_old);
+    _this->m_migrate_pos = 0;
+
+    hash_table_t table;
+    if(HASH_MIN_CAPACITY != _this->m_table.capacity && 0 == hash_table_init(&table, HASH_MIN_CAPACITY))
+    {
+        hash_table_free(&_this->m_table);
+        _this->m_table = table;
+    }
+    else
+    {
+        // 已经是最小的表，或申请失败时保留原来的表
+        memset(_this->m_table.ctrl, HASH_CTRL_EMPTY, _this->m_table.capacity);
+        _this->m_table.used = _this->m_table.cnt = 0;
+    }
+    hash_index_unlock(_this);
+}
+
+/*
+@func:
+    销毁索引
+
+@para:
+    tree : 索引指针
+
+@return:
+    None.
+*/
+static void hash_index_destory(avl_tree_t** tree)
+{
+    avl_tree_t* _this = *tree;
+
+    if(NULL == _this) return;
+
+    if(_this->_private_)
+    {
+        hash_index_private_t* private_member = get_private_member(_this);
+        if(NULL != _this->pf_free_element)
+            hash_index_clear(_this);
+        hash_table_free(&private_member->m_old);
+        hash_table_free(&private_member->m_table);
+        private_member->m_pool->destory(&private_member->m_pool);
+        pthread_rwlock_destroy(&private_member->m_tree_lock);
+        free(_this->_private_);
+        _this->_private_ = NULL;
+    }
+
+    free(_this);
+    *tree = NULL;
+}
+
+/*
+@func:
+    创建一个哈希索引
+
+@para:
+    element_size : 元素的大小，单位字节
+    pf_hash_func ； 从元素获得键值 key 的方法，由用户提供
+    pf_free_element_func ： 若元素不包含额外的动态内存， 此参数可传 NULL
+    thread_safe ： 是否启用线程安全
+
+@return:
+    avl_tree_t* : NULL 失败， other 与平衡二叉树接口相同的索引指针
+*/
+avl_tree_t* hash_index_create(int element_size, int (*pf_hash_func)(void *), int (*pf_free_element_func)(void *), bool thread_safe)
+{
+    if(NULL == pf_hash_func || element_size <= 0)
+        return NULL;
+
+    avl_tree_t *tree = (avl_tree_t *)malloc(sizeof(avl_tree_t));
+    hash_index_private_t *private_member = (hash_index_private_t *)malloc(sizeof(hash_index_private_t));
+    mem_pool_t *pool = mem_pool_create(thread_safe);
+    if(NULL == tree || NULL == private_member || NULL == pool)
+    {
+        free(tree);
+        free(private_member);
+        if(NULL != pool)
+            pool->destory(&pool);
+        return NULL;
+    }
+    memset(tree, 0, sizeof(avl_tree_t));
+    memset(private_member, 0, sizeof(hash_index_private_t));
+
+    if(0 != hash_table_init(&private_member->m_table, HASH_MIN_CAPACITY))
+    {
+        free(tree);
+        free(private_member);
+        pool->destory(&pool);
+        return NULL;
+    }
+
+    private_member->m_pool = pool;
+    private_member->m_element_size = element_size;
+    private_member->m_is_thread_safe = thread_safe;
+
+    pthread_rwlock_init(&private_member->m_tree_lock, NULL);
+
+    tree->_this = tree;
+    tree->_private_ = (void *)private_member;
+
+    tree->pf_hash = pf_hash_func;
+    tree->pf_free_element = pf_free_element_func;
+    tree->add = hash_index_add;
+    tree->add_batch = hash_index_add_batch;
+    tree->build_sorted = hash_index_build_sorted;
+    tree->query_by_key = hash_index_query_by_key;
+    tree->query_batch = hash_index_query_batch;
+    tree->preorder = hash_index_preorder;
+    tree->seek = hash_index_seek;
+    tree->seek_last = hash_index_seek;
+    tree->next = hash_index_step;
+    tree->prev = hash_index_step;
+    tree->range = hash_index_range;
+    tree->rank = hash_index_rank;
+    tree->select = hash_index_select;
+    tree->count_range = hash_index_count_range;
+    tree->size = hash_index_size;
+    tree->del_node_by_key = hash_index_del_by_key;
+    tree->del_node_by_element = hash_index_del_by_element;
+    tree->clear_node = hash_index_clear;
+    tree->destory = hash_index_destory;
+
+    return tree;
+}
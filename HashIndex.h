@@ -0,0 +1,36 @@
+/*
+** File : HashIndex.h
+** Author : Saury
+** Date : 2020-09-12
+*/
+
+#ifndef _HASH_INDEX_H_
+#define _HASH_INDEX_H_
+
+#include "AVLTree.h"
+
+/*
+    开放寻址哈希索引：提供与 avl_tree_t 相同的接口，只适用于按键值精确访问的场景。
+    每个位置有一个控制字节（空 / 已删除 / 键值哈希的低 7 位），16 个位置为一组，
+    查找时一次比较一组控制字节（x86 上使用 SSE2），只有哈希低位相同的位置才比较键值；
+    扩容时新表与旧表同时存在，之后每次修改迁移一小段旧表，不会在一次操作中重建整个表。
+    query_by_key / del_node_by_key 为 O(1)；preorder 的访问顺序不确定；
+    seek / seek_last / next / prev / select 返回 NULL，range / rank / count_range 返回 -1
+*/
+
+/*
+@func:
+    创建一个哈希索引
+
+@para:
+    element_size : 元素的大小，单位字节
+    pf_hash_func ； 从元素获得键值 key 的方法，由用户提供
+    pf_free_element_func ： 若元素不包含额外的动态内存， 此参数可传 NULL
+    thread_safe ： 是否启用线程安全，启用后查询与遍历共享读锁，增删与清除独占写锁
+
+@return:
+    avl_tree_t* : NULL 失败， other 与平衡二叉树接口相同的索引指针
+*/
+extern avl_tree_t* hash_index_create(int element_size, int (*pf_hash_func)(void *), int (*pf_free_element_func)(void *), bool thread_safe);
+
+#endif /* end #ifndef _HASH_INDEX_H_ */
@@ -0,0 +1,480 @@
+/*
+** File : IoRing.c
+** Author : Saury
+** Date : 2020-09-12
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/syscall.h>
+#include "IoRing.h"
+
+#ifdef __NR_io_uring_setup
+#include <linux/io_uring.h>
+#endif
+
+
+#define DEBUG_LOG 0
+
+#define IO_RING_LOG_DEBUG(fmt, ...) \
+    do{ \
+        if(DEBUG_LOG) \
+        {\
+            printf("%s at %d " fmt "\r\n", __FILE__, __LINE__, ##__VA_ARGS__);\
+        }\
+    }while(0);
+
+
+// 一次提交的最多写入数量的默认值
+#define IO_RING_DEPTH 64
+// 暂存缓冲区大小的默认值
+#define IO_RING_BUFF_SIZE (256 * 1024)
+
+/*
+    一次暂存的写入，数据在暂存缓冲区的 pos 处
+*/
+typedef struct _io_ring_entry
+{
+    off_t offset;
+    int len;
+    int pos;
+}io_ring_entry_t;
+
+typedef struct _io_ring_private
+{
+    int m_fd;                   // 写入的文件描述符
+    int m_ring_fd;              // io_uring 的文件描述符
+
+    void* m_sq_ptr;             // 提交队列的映射区
+    size_t m_sq_size;
+    void* m_cq_ptr;             // 完成队列的映射区，内核支持单次映射时与 m_sq_ptr 相同
+    size_t m_cq_size;
+    void* m_sqes;               // SQE 数组的映射区
+    size_t m_sqes_size;
+    unsigned* m_sq_head;
+    unsigned* m_sq_tail;
+    unsigned* m_sq_mask;
+    unsigned* m_sq_array;
+    unsigned* m_cq_head;
+    unsigned* m_cq_tail;
+    unsigned* m_cq_mask;
+    void* m_cqes;
+
+    bool m_fixed_file;          // 文件描述符已注册，SQE 中使用下标 0
+    bool m_fixed_buff;          // 暂存缓冲区已注册，使用 IORING_OP_WRITE_FIXED
+
+    char* m_buff;               // 暂存缓冲区
+    int m_buff_size;
+    int m_buff_used;
+    io_ring_entry_t* m_entries; // 暂存的写入
+    int* m_results;             // flush 时每个写入的完成结果
+    int m_capacity;             // 暂存的写入数量上限，等于提交队列的大小
+    int m_cnt;                  // 暂存的写入数量
+}io_ring_private_t;
+
+
+static io_ring_private_t* get_private_member(io_ring_t* ring)
+{
+    if(NULL == ring) return NULL;
+
+    return (io_ring_private_t*)ring->_private_;
+}
+
+/*
+@func:
+    定位写入完整的数据
+
+@para:
+    fd : 文件描述符
+    buf : 数据缓冲区
+    len : 数据长度
+    offset : 文件偏移量
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+*/
+static int io_ring_pwrite(int fd, const void* buf, size_t len, off_t offset)
+{
+    const char* p = (const char*)buf;
+    while(len > 0)
+    {
+        ssize_t n = pwrite(fd, p, len, offset);
+        if(n < 0)
+        {
+            if(EINTR == errno) continue;
+            IO_RING_LOG_DEBUG("pwrite error, offset %ld, errno %d", (long)offset, errno);
+            return -1;
+        }
+        p += n;
+        offset += n;
+        len -= n;
+    }
+    return 0;
+}
+
+#ifdef __NR_io_uring_setup
+
+/*
+@func:
+    提交暂存的全部写入并等待完成
+
+@para:
+    ring : 写入队列指针
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    全部写入用 IOSQE_IO_LINK 串成一条链；io_uring_enter 出错时收回未被内核取走的 SQE，
+    等待已提交的写入完成后，从第一个未完整写入的位置开始按顺序用 pwrite 补完
+*/
+static int io_ring_flush(io_ring_t* ring)
+{
+    io_ring_private_t* _this = get_private_member(ring);
+    if(NULL == _this) return -1;
+    if(0 == _this->m_cnt) return 0;
+
+    int cnt = _this->m_cnt;
+    unsigned tail = *_this->m_sq_tail;
+    struct io_uring_sqe* sqes = (struct io_uring_sqe*)_this->m_sqes;
+    for(int i = 0; i < cnt; ++i)
+    {
+        io_ring_entry_t* entry = &_this->m_entries[i];
+        unsigned index = tail & *_this->m_sq_mask;
+        struct io_uring_sqe* sqe = &sqes[index];
+        memset(sqe, 0, sizeof(struct io_uring_sqe));
+        sqe->opcode = _this->m_fixed_buff ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+        sqe->fd = _this->m_fixed_file ? 0 : _this->m_fd;
+        sqe->flags = (_this->m_fixed_file ? IOSQE_FIXED_FILE : 0) | (i + 1 < cnt ? IOSQE_IO_LINK : 0);
+        sqe->addr = (uint64_t)(uintptr_t)(_this->m_buff + entry->pos);
+        sqe->len = entry->len;
+        sqe->off = entry->offset;
+        sqe->buf_index = 0;
+        sqe->user_data = i;
+        _this->m_sq_array[index] = index;
+        _this->m_results[i] = -ECANCELED;
+        tail++;
+    }
+    __atomic_store_n(_this->m_sq_tail, tail, __ATOMIC_RELEASE);
+
+    int submitted = 0;
+    int completed = 0;
+    bool aborted = false;
+    while(completed < submitted || (!aborted && submitted < cnt))
+    {
+        unsigned to_submit = aborted ? 0 : cnt - submitted;
+        long ret = syscall(__NR_io_uring_enter, _this->m_ring_fd, to_submit, (aborted ? submitted : cnt) - completed, IORING_ENTER_GETEVENTS, NULL, 0);
+        if(ret < 0 && EINTR != errno)
+        {
+            // 收回内核还没有取走的 SQE，只等待已提交的写入
+            IO_RING_LOG_DEBUG("io_uring_enter error, errno %d", errno);
+            __atomic_store_n(_this->m_sq_tail, __atomic_load_n(_this->m_sq_head, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+            aborted = true;
+        }
+        else if(ret > 0)
+        {
+            submitted += (int)ret;
+        }
+        else if(0 == ret && to_submit > 0)
+        {
+            __atomic_store_n(_this->m_sq_tail, __atomic_load_n(_this->m_sq_head, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+            aborted = true;
+        }
+
+        unsigned head = *_this->m_cq_head;
+        unsigned cq_tail = __atomic_load_n(_this->m_cq_tail, __ATOMIC_ACQUIRE);
+        struct io_uring_cqe* cqes = (struct io_uring_cqe*)_this->m_cqes;
+        while(head != cq_tail)
+        {
+            struct io_uring_cqe* cqe = &cqes[head & *_this->m_cq_mask];
+            if(cqe->user_data < (uint64_t)cnt)
+                _this->m_results[cqe->user_data] = cqe->res;
+            completed++;
+            head++;
+        }
+        __atomic_store_n(_this->m_cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    int res_code = 0;
+    int first = 0;
+    while(first < cnt && _this->m_results[first] == _this->m_entries[first].len)
+        first++;
+    for(int i = first; i < cnt; ++i)
+    {
+        io_ring_entry_t* entry = &_this->m_entries[i];
+        if(0 != io_ring_pwrite(_this->m_fd, _this->m_buff + entry->pos, entry->len, entry->offset))
+        {
+            res_code = -1;
+            break;
+        }
+    }
+
+    _this->m_cnt = 0;
+    _this->m_buff_used = 0;
+    return res_code;
+}
+
+#else
+
+static int io_ring_flush(io_ring_t* ring)
+{
+    return -1;
+}
+
+#endif /* end #ifdef __NR_io_uring_setup */
+
+/*
+@func:
+    暂存一次写入
+
+@para:
+    ring : 写入队列指针
+    buf : 数据缓冲区
+    len : 数据长度
+    offset : 文件偏移量
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    与上一次暂存的写入在文件与暂存缓冲区中都相邻时合并为一个 SQE
+*/
+static int io_ring_write(io_ring_t* ring, const void* buf, int len, off_t offset)
+{
+    io_ring_private_t* _this = get_private_member(ring);
+    if(NULL == _this || NULL == buf || len < 0) return -1;
+    if(0 == len) return 0;
+
+    if(len > _this->m_buff_size)
+    {
+        if(0 != io_ring_flush(ring))
+            return -1;
+        return io_ring_pwrite(_this->m_fd, buf, len, offset);
+    }
+
+    io_ring_entry_t* last = _this->m_cnt > 0 ? &_this->m_entries[_this->m_cnt - 1] : NULL;
+    bool merge = NULL != last && last->offset + last->len == offset && last->pos + last->len == _this->m_buff_used
+        && _this->m_buff_used + len <= _this->m_buff_size;
+    if(!merge && (_this->m_cnt == _this->m_capacity || _this->m_buff_used + len > _this->m_buff_size))
+    {
+        if(0 != io_ring_flush(ring))
+            return -1;
+    }
+
+    memcpy(_this->m_buff + _this->m_buff_used, buf, len);
+    if(merge)
+    {
+        last->len += len;
+    }
+    else
+    {
+        io_ring_entry_t* entry = &_this->m_entries[_this->m_cnt++];
+        entry->offset = offset;
+        entry->len = len;
+        entry->pos = _this->m_buff_used;
+    }
+    _this->m_buff_used += len;
+    return 0;
+}
+
+static void io_ring_discard(io_ring_t* ring)
+{
+    io_ring_private_t* _this = get_private_member(ring);
+    if(NULL == _this) return;
+
+    _this->m_cnt = 0;
+    _this->m_buff_used = 0;
+}
+
+static int io_ring_pending(io_ring_t* ring)
+{
+    io_ring_private_t* _this = get_private_member(ring);
+    if(NULL == _this) return 0;
+
+    return _this->m_cnt;
+}
+
+static int io_ring_reset(io_ring_t* ring, int fd)
+{
+    io_ring_private_t* _this = get_private_member(ring);
+    if(NULL == _this) return -1;
+
+    io_ring_discard(ring);
+    _this->m_fd = fd;
+#ifdef __NR_io_uring_setup
+    if(_this->m_fixed_file)
+    {
+        struct io_uring_files_update update;
+        memset(&update, 0, sizeof(update));
+        update.offset = 0;
+        update.fds = (uint64_t)(uintptr_t)&_this->m_fd;
+        if(1 != syscall(__NR_io_uring_register, _this->m_ring_fd, IORING_REGISTER_FILES_UPDATE, &update, 1))
+        {
+            IO_RING_LOG_DEBUG("update registered file error, errno %d", errno);
+            syscall(__NR_io_uring_register, _this->m_ring_fd, IORING_UNREGISTER_FILES, NULL, 0);
+            _this->m_fixed_file = false;
+        }
+    }
+#endif
+    return 0;
+}
+
+static void io_ring_destory(io_ring_t** ring)
+{
+    if(NULL == ring || NULL == *ring) return;
+
+    io_ring_private_t* _this = get_private_member(*ring);
+    if(NULL != _this->m_sqes)
+        munmap(_this->m_sqes, _this->m_sqes_size);
+    if(NULL != _this->m_cq_ptr && _this->m_cq_ptr != _this->m_sq_ptr)
+        munmap(_this->m_cq_ptr, _this->m_cq_size);
+    if(NULL != _this->m_sq_ptr)
+        munmap(_this->m_sq_ptr, _this->m_sq_size);
+    if(_this->m_ring_fd >= 0)
+        close(_this->m_ring_fd);
+    free(_this->m_buff);
+    free(_this->m_entries);
+    free(_this->m_results);
+    free(_this);
+    free(*ring);
+    *ring = NULL;
+}
+
+/*
+@func:
+    创建 io_uring 写入队列
+
+@para:
+    fd : 写入的文件描述符
+    depth : 一次提交的最多写入数量
+    buff_size : 暂存缓冲区的大小（字节）
+
+@return:
+    io_ring_t* : NULL 失败， other 写入队列指针
+
+@note:
+    提交队列与完成队列映射到用户空间，提交与收割不需要额外的系统调用；
+    注册文件与暂存缓冲区失败（如超出 RLIMIT_MEMLOCK）不影响创建
+*/
+io_ring_t* io_ring_create(int fd, int depth, int buff_size)
+{
+#ifdef __NR_io_uring_setup
+    if(fd < 0) return NULL;
+    if(depth <= 0)
+        depth = IO_RING_DEPTH;
+    if(buff_size <= 0)
+        buff_size = IO_RING_BUFF_SIZE;
+
+    io_ring_t* ring = (io_ring_t*)malloc(sizeof(io_ring_t));
+    io_ring_private_t* _this = (io_ring_private_t*)malloc(sizeof(io_ring_private_t));
+    if(NULL == ring || NULL == _this)
+    {
+        IO_RING_LOG_DEBUG("alloc ring error");
+        free(ring);
+        free(_this);
+        return NULL;
+    }
+    memset(ring, 0, sizeof(io_ring_t));
+    memset(_this, 0, sizeof(io_ring_private_t));
+    ring->_this = ring;
+    ring->_private_ = (void*)_this;
+    ring->write = io_ring_write;
+    ring->flush = io_ring_flush;
+    ring->discard = io_ring_discard;
+    ring->pending = io_ring_pending;
+    ring->reset = io_ring_reset;
+    ring->destory = io_ring_destory;
+    _this->m_fd = fd;
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    _this->m_ring_fd = (int)syscall(__NR_io_uring_setup, depth, &params);
+    if(_this->m_ring_fd < 0)
+    {
+        IO_RING_LOG_DEBUG("io_uring_setup error, errno %d", errno);
+        io_ring_destory(&ring);
+        return NULL;
+    }
+
+    _this->m_sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    _this->m_cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if(params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if(_this->m_cq_size > _this->m_sq_size)
+            _this->m_sq_size = _this->m_cq_size;
+        _this->m_cq_size = _this->m_sq_size;
+    }
+    _this->m_sq_ptr = mmap(NULL, _this->m_sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _this->m_ring_fd, IORING_OFF_SQ_RING);
+    if(MAP_FAILED == _this->m_sq_ptr)
+    {
+        _this->m_sq_ptr = NULL;
+        IO_RING_LOG_DEBUG("map sq ring error, errno %d", errno);
+        io_ring_destory(&ring);
+        return NULL;
+    }
+    if(params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        _this->m_cq_ptr = _this->m_sq_ptr;
+    }
+    else
+    {
+        _this->m_cq_ptr = mmap(NULL, _this->m_cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _this->m_ring_fd, IORING_OFF_CQ_RING);
+        if(MAP_FAILED == _this->m_cq_ptr)
+        {
+            _this->m_cq_ptr = NULL;
+            IO_RING_LOG_DEBUG("map cq ring error, errno %d", errno);
+            io_ring_destory(&ring);
+            return NULL;
+        }
+    }
+    _this->m_sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    _this->m_sqes = mmap(NULL, _this->m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _this->m_ring_fd, IORING_OFF_SQES);
+    if(MAP_FAILED == _this->m_sqes)
+    {
+        _this->m_sqes = NULL;
+        IO_RING_LOG_DEBUG("map sqes error, errno %d", errno);
+        io_ring_destory(&ring);
+        return NULL;
+    }
+
+    char* sq = (char*)_this->m_sq_ptr;
+    char* cq = (char*)_this->m_cq_ptr;
+    _this->m_sq_head = (unsigned*)(sq + params.sq_off.head);
+    _this->m_sq_tail = (unsigned*)(sq + params.sq_off.tail);
+    _this->m_sq_mask = (unsigned*)(sq + params.sq_off.ring_mask);
+    _this->m_sq_array = (unsigned*)(sq + params.sq_off.array);
+    _this->m_cq_head = (unsigned*)(cq + params.cq_off.head);
+    _this->m_cq_tail = (unsigned*)(cq + params.cq_off.tail);
+    _this->m_cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+    _this->m_cqes = cq + params.cq_off.cqes;
+
+    _this->m_capacity = (int)params.sq_entries;
+    _this->m_buff_size = buff_size;
+    _this->m_buff = (char*)malloc(buff_size);
+    _this->m_entries = (io_ring_entry_t*)malloc(sizeof(io_ring_entry_t) * _this->m_capacity);
+    _this->m_results = (int*)malloc(sizeof(int) * _this->m_capacity);
+    if(NULL == _this->m_buff || NULL == _this->m_entries || NULL == _this->m_results)
+    {
+        IO_RING_LOG_DEBUG("alloc buff error");
+        io_ring_destory(&ring);
+        return NULL;
+    }
+
+    _this->m_fixed_file = 0 == syscall(__NR_io_uring_register, _this->m_ring_fd, IORING_REGISTER_FILES, &_this->m_fd, 1);
+    struct iovec iov;
+    iov.iov_base = _this->m_buff;
+    iov.iov_len = buff_size;
+    _this->m_fixed_buff = 0 == syscall(__NR_io_uring_register, _this->m_ring_fd, IORING_REGISTER_BUFFERS, &iov, 1);
+    IO_RING_LOG_DEBUG("io ring entries %d, fixed file %d, fixed buff %d", _this->m_capacity, _this->m_fixed_file, _this->m_fixed_buff);
+
+    return ring;
+#else
+    return NULL;
+#endif
+}
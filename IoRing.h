@@ -0,0 +1,127 @@
+/*
+** File : IoRing.h
+** Author : Saury
+** Date : 2020-09-12
+*/
+
+#ifndef _IO_RING_H_
+#define _IO_RING_H_
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+typedef struct _io_ring io_ring_t;
+
+/*
+    io_uring 写入队列：write 把数据拷贝到注册过的暂存缓冲区中，flush 把暂存的全部写入作为一条链接的 SQE 链
+    一次提交并等待完成，链中的写入按暂存的顺序依次执行，前一个失败时后面的不会执行。
+    文件描述符与暂存缓冲区注册到内核中，注册失败时退回普通的 IORING_OP_WRITE。
+    不是线程安全的，由调用者加锁
+*/
+
+struct _io_ring
+{
+    io_ring_t *_this;
+    void *_private_;    // 私有成员
+
+/*
+@func:
+    暂存一次写入
+
+@para:
+    ring : 写入队列指针
+    buf : 数据缓冲区，拷贝到暂存缓冲区后即可复用
+    len : 数据长度
+    offset : 文件偏移量
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    暂存缓冲区或 SQE 不足时先 flush 已暂存的写入；超过暂存缓冲区大小的写入在 flush 之后直接 pwrite
+*/
+    int (*write)(io_ring_t *ring, const void *buf, int len, off_t offset);
+
+/*
+@func:
+    提交暂存的全部写入并等待完成
+
+@para:
+    ring : 写入队列指针
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    只完成部分写入或被取消的写入按顺序用 pwrite 补完，补写失败时返回 -1，之后的写入不会执行
+*/
+    int (*flush)(io_ring_t *ring);
+
+/*
+@func:
+    丢弃暂存的全部写入
+
+@para:
+    ring : 写入队列指针
+
+@return:
+    None.
+*/
+    void (*discard)(io_ring_t *ring);
+
+/*
+@func:
+    获取暂存的写入数量
+
+@para:
+    ring : 写入队列指针
+
+@return:
+    int : 暂存的写入数量
+*/
+    int (*pending)(io_ring_t *ring);
+
+/*
+@func:
+    丢弃暂存的写入并改为写入新的文件
+
+@para:
+    ring : 写入队列指针
+    fd : 新的文件描述符
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    更新注册的文件失败时改用未注册的文件描述符
+*/
+    int (*reset)(io_ring_t *ring, int fd);
+
+/*
+@func:
+    关闭 io_uring 并释放写入队列，暂存的写入被丢弃
+
+@para:
+    ring : 写入队列指针的地址，释放后置为 NULL
+
+@return:
+    None.
+*/
+    void (*destory)(io_ring_t **ring);
+};
+
+/*
+@func:
+    创建 io_uring 写入队列
+
+@para:
+    fd : 写入的文件描述符
+    depth : 一次提交的最多写入数量，<= 0 使用默认值 64
+    buff_size : 暂存缓冲区的大小（字节），<= 0 使用默认值 256KB
+
+@return:
+    io_ring_t* : NULL 失败（内核不支持或被禁用 io_uring 时），other 写入队列指针
+*/
+extern io_ring_t* io_ring_create(int fd, int depth, int buff_size);
+
+#endif /* end #ifndef _IO_RING_H_ */
@@ -0,0 +1,314 @@
+/*
+** File : MemPool.c
+** Author : Saury
+** Date : 2020-09-12
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "MemPool.h"
+
+
+#define DEBUG_LOG 0
+
+#define MEM_POOL_LOG_DEBUG(fmt, ...) \
+    do{ \
+        if(DEBUG_LOG) \
+        {\
+            printf("%s at %d " fmt "\r\n", __FILE__, __LINE__, ##__VA_ARGS__);\
+        }\
+    }while(0);
+
+
+#define MEM_POOL_ALIGN      16                  // 对齐字节数，也是大小等级的间隔
+#define MEM_POOL_MAX_SIZE   1024                // 超过该大小的内存直接向系统申请
+#define MEM_POOL_CLASS_CNT  (MEM_POOL_MAX_SIZE / MEM_POOL_ALIGN)
+#define MEM_POOL_SLAB_SIZE  (64 * 1024)         // 每次向系统申请的 slab 大小
+
+// 大小对应的等级
+#define MEM_POOL_CLASS(size) (((size) + MEM_POOL_ALIGN - 1) / MEM_POOL_ALIGN - 1)
+
+// slab 与大块内存头部占用的字节数，保证返回的内存按 MEM_POOL_ALIGN 对齐
+#define MEM_POOL_HEAD_SIZE  MEM_POOL_ALIGN
+
+typedef struct _mem_pool_slab mem_pool_slab_t;
+typedef struct _mem_pool_large mem_pool_large_t;
+typedef struct _mem_pool_free mem_pool_free_t;
+
+struct _mem_pool_slab
+{
+    mem_pool_slab_t *next;
+};
+
+struct _mem_pool_large
+{
+    mem_pool_large_t *prev;
+    mem_pool_large_t *next;
+};
+
+struct _mem_pool_free
+{
+    mem_pool_free_t *next;
+};
+
+typedef struct _mem_pool_private
+{
+    mem_pool_free_t *m_free_list[MEM_POOL_CLASS_CNT];  // 每个大小等级的空闲链表
+    mem_pool_slab_t *m_slabs;   // 全部 slab
+    char *m_cur;                // 当前 slab 中未切分部分的起止位置
+    char *m_end;
+    mem_pool_large_t *m_large;  // 直接向系统申请的大块内存
+    bool m_is_thread_safe;
+    pthread_mutex_t m_mutex;
+}mem_pool_private_t;
+
+
+static mem_pool_private_t* get_private_member(mem_pool_t *pool)
+{
+    if(NULL == pool) return NULL;
+
+    return (mem_pool_private_t*)pool->_private_;
+}
+
+/*
+@func:
+    线程锁， 上锁/解锁
+
+@para:
+    _this ： 私有成员
+
+@return:
+    None
+*/
+static void mem_pool_lock(mem_pool_private_t *_this)
+{
+    if(_this->m_is_thread_safe)
+        pthread_mutex_lock(&_this->m_mutex);
+}
+
+static void mem_pool_unlock(mem_pool_private_t *_this)
+{
+    if(_this->m_is_thread_safe)
+        pthread_mutex_unlock(&_this->m_mutex);
+}
+
+/*
+@func:
+    申请大块内存
+
+@para:
+    _this : 私有成员
+    size : 申请的字节数
+
+@return:
+    void* : NULL 失败， other 申请到的内存
+
+@note:
+    调用者需持有锁
+*/
+static void* mem_pool_alloc_large(mem_pool_private_t *_this, int size)
+{
+    mem_pool_large_t *block = (mem_pool_large_t*)malloc(MEM_POOL_HEAD_SIZE + (size_t)size);
+    if(NULL == block) return NULL;
+
+    block->prev = NULL;
+    block->next = _this->m_large;
+    if(NULL != _this->m_large)
+        _this->m_large->prev = block;
+    _this->m_large = block;
+
+    return (char*)block + MEM_POOL_HEAD_SIZE;
+}
+
+/*
+@func:
+    申请内存
+
+@para:
+    pool : 内存池指针
+    size : 申请的字节数
+
+@return:
+    void* : NULL 失败， other 申请到的内存
+*/
+static void* mem_pool_alloc(mem_pool_t *pool, int size)
+{
+    mem_pool_private_t *_this = get_private_member(pool);
+    if(NULL == _this || size <= 0) return NULL;
+
+    void *ptr = NULL;
+    mem_pool_lock(_this);
+
+    if(size > MEM_POOL_MAX_SIZE)
+    {
+        ptr = mem_pool_alloc_large(_this, size);
+        mem_pool_unlock(_this);
+        return ptr;
+    }
+
+    int cls = MEM_POOL_CLASS(size);
+    size_t real_size = (size_t)(cls + 1) * MEM_POOL_ALIGN;
+
+    if(NULL != _this->m_free_list[cls])
+    {
+        ptr = _this->m_free_list[cls];
+        _this->m_free_list[cls] = _this->m_free_list[cls]->next;
+    }
+    else
+    {
+        if(NULL == _this->m_cur || (size_t)(_this->m_end - _this->m_cur) < real_size)
+        {
+            mem_pool_slab_t *slab = (mem_pool_slab_t*)malloc(MEM_POOL_SLAB_SIZE);
+            if(NULL == slab)
+            {
+                MEM_POOL_LOG_DEBUG("slab malloc error");
+                mem_pool_unlock(_this);
+                return NULL;
+            }
+            slab->next = _this->m_slabs;
+            _this->m_slabs = slab;
+            _this->m_cur = (char*)slab + MEM_POOL_HEAD_SIZE;
+            _this->m_end = (char*)slab + MEM_POOL_SLAB_SIZE;
+        }
+        ptr = _this->m_cur;
+        _this->m_cur += real_size;
+    }
+
+    mem_pool_unlock(_this);
+    return ptr;
+}
+
+/*
+@func:
+    释放内存
+
+@para:
+    pool : 内存池指针
+    ptr : alloc 返回的内存
+    size : 申请时的字节数
+
+@return:
+    None.
+*/
+static void mem_pool_free(mem_pool_t *pool, void *ptr, int size)
+{
+    mem_pool_private_t *_this = get_private_member(pool);
+    if(NULL == _this || NULL == ptr || size <= 0) return;
+
+    mem_pool_lock(_this);
+    if(size > MEM_POOL_MAX_SIZE)
+    {
+        mem_pool_large_t *block = (mem_pool_large_t*)((char*)ptr - MEM_POOL_HEAD_SIZE);
+        if(NULL != block->prev)
+            block->prev->next = block->next;
+        else
+            _this->m_large = block->next;
+        if(NULL != block->next)
+            block->next->prev = block->prev;
+        free(block);
+    }
+    else
+    {
+        int cls = MEM_POOL_CLASS(size);
+        mem_pool_free_t *node = (mem_pool_free_t*)ptr;
+        node->next = _this->m_free_list[cls];
+        _this->m_free_list[cls] = node;
+    }
+    mem_pool_unlock(_this);
+}
+
+/*
+@func:
+    一次释放内存池中申请的全部内存
+
+@para:
+    pool : 内存池指针
+
+@return:
+    None.
+*/
+static void mem_pool_clear(mem_pool_t *pool)
+{
+    mem_pool_private_t *_this = get_private_member(pool);
+    if(NULL == _this) return;
+
+    mem_pool_lock(_this);
+    while(NULL != _this->m_slabs)
+    {
+        mem_pool_slab_t *next = _this->m_slabs->next;
+        free(_this->m_slabs);
+        _this->m_slabs = next;
+    }
+    while(NULL != _this->m_large)
+    {
+        mem_pool_large_t *next = _this->m_large->next;
+        free(_this->m_large);
+        _this->m_large = next;
+    }
+    memset(_this->m_free_list, 0, sizeof(_this->m_free_list));
+    _this->m_cur = _this->m_end = NULL;
+    mem_pool_unlock(_this);
+}
+
+/*
+@func:
+    释放全部内存并销毁内存池
+
+@para:
+    pool : 内存池指针
+
+@return:
+    None.
+*/
+static void mem_pool_destory(mem_pool_t **pool)
+{
+    if(NULL == pool || NULL == *pool) return;
+
+    mem_pool_t *p = *pool;
+    mem_pool_private_t *_this = get_private_member(p);
+
+    mem_pool_clear(p);
+    pthread_mutex_destroy(&_this->m_mutex);
+
+    free(_this);
+    free(p);
+    *pool = NULL;
+}
+
+/*
+@func:
+    创建内存池
+
+@para:
+    thread_safe : 是否启用线程安全
+
+@return:
+    mem_pool_t* : NULL 失败， other 内存池指针
+*/
+mem_pool_t* mem_pool_create(bool thread_safe)
+{
+    mem_pool_t *pool = (mem_pool_t*)malloc(sizeof(mem_pool_t));
+    mem_pool_private_t *_this = (mem_pool_private_t*)malloc(sizeof(mem_pool_private_t));
+    if(NULL == pool || NULL == _this)
+    {
+        free(pool);
+        free(_this);
+        return NULL;
+    }
+    memset(pool, 0, sizeof(mem_pool_t));
+    memset(_this, 0, sizeof(mem_pool_private_t));
+
+    _this->m_is_thread_safe = thread_safe;
+    pthread_mutex_init(&_this->m_mutex, NULL);
+
+    pool->_this = pool;
+    pool->_private_ = (void*)_this;
+    pool->alloc = mem_pool_alloc;
+    pool->free = mem_pool_free;
+    pool->clear = mem_pool_clear;
+    pool->destory = mem_pool_destory;
+
+    return pool;
+}
@@ -0,0 +1,102 @@
+/*
+** File : MemPool.h
+** Author : Saury
+** Date : 2020-09-12
+*/
+
+#ifndef _MEM_POOL_H_
+#define _MEM_POOL_H_
+
+#include <stdbool.h>
+
+typedef struct _mem_pool mem_pool_t;
+
+/*
+    内存池：小块内存按 16 字节对齐分为若干大小等级，从整块申请的 slab 中切分，
+    释放的内存进入对应等级的空闲链表供后续申请复用；大块内存直接向系统申请。
+    clear / destory 一次释放全部 slab，不需要逐个释放
+*/
+
+struct _mem_pool
+{
+    mem_pool_t *_this;
+    void *_private_;    // 私有成员
+
+/*
+@func:
+    申请内存
+
+@para:
+    pool : 内存池指针
+    size : 申请的字节数
+
+@return:
+    void* : NULL 失败， other 申请到的内存，按 16 字节对齐
+
+@note:
+    None.
+*/
+    void* (*alloc)(mem_pool_t *pool, int size);
+
+/*
+@func:
+    释放内存
+
+@para:
+    pool : 内存池指针
+    ptr : alloc 返回的内存，可以为 NULL
+    size : 申请时的字节数
+
+@return:
+    None.
+
+@note:
+    内存回到对应大小等级的空闲链表，不归还系统
+*/
+    void (*free)(mem_pool_t *pool, void *ptr, int size);
+
+/*
+@func:
+    一次释放内存池中申请的全部内存
+
+@para:
+    pool : 内存池指针
+
+@return:
+    None.
+
+@note:
+    调用后之前申请的内存全部失效
+*/
+    void (*clear)(mem_pool_t *pool);
+
+/*
+@func:
+    释放全部内存并销毁内存池
+
+@para:
+    pool : 内存池指针
+
+@return:
+    None.
+
+@note:
+    None.
+*/
+    void (*destory)(mem_pool_t **pool);
+};
+
+
+/*
+@func:
+    创建内存池
+
+@para:
+    thread_safe : 是否启用线程安全，若用户保证不会并发访问，可关闭线程安全功能
+
+@return:
+    mem_pool_t* : NULL 失败， other 内存池指针
+*/
+extern mem_pool_t* mem_pool_create(bool thread_safe);
+
+#endif /* end #ifndef _MEM_POOL_H_ */
@@ -0,0 +1,711 @@
+/*
+** File : PageCache.c
+** Author : Saury
+** Date : 2020-09-12
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/uio.h>
+#include "PageCache.h"
+
+
+#define DEBUG_LOG 0
+
+#define PAGE_CACHE_LOG_DEBUG(fmt, ...) \
+    do{ \
+        if(DEBUG_LOG) \
+        {\
+            printf("%s at %d " fmt "\r\n", __FILE__, __LINE__, ##__VA_ARGS__);\
+        }\
+    }while(0);
+
+
+#define PAGE_CACHE_MIN_FRAMES   16      // 最少的缓存帧数量
+#define PAGE_CACHE_MAX_IOV      64      // 一次向量读最多合并的块数，不超过系统的 IOV_MAX
+
+typedef struct _page_cache_frame
+{
+    long block;     // 缓存的块序号，-1 表示空闲
+    int pin_cnt;    // 固定计数，> 0 时不能淘汰
+    bool ref;       // CLOCK 引用位，命中时置位，淘汰扫描时清除
+    bool loading;   // 正在从文件读取，其他线程需等待
+    int next;       // 哈希链中的下一个帧，-1 表示结束
+}page_cache_frame_t;
+
+typedef struct _page_cache_private
+{
+    int m_fd;                       // 文件描述符
+    off_t m_base;                   // 第一个块在文件中的偏移量
+    int m_block_size;               // 块大小
+    int m_frame_cnt;                // 缓存帧数量
+    char *m_data;                   // 全部缓存帧的数据，第 i 帧从 m_data + i * m_block_size 开始
+    page_cache_frame_t *m_frames;   // 缓存帧
+    int *m_buckets;                 // 块序号到缓存帧的哈希表，链表头
+    int m_bucket_mask;              // 哈希表长度减一，长度为 2 的幂
+    int m_hand;                     // CLOCK 指针
+    pthread_mutex_t m_mutex;        // 保护全部缓存帧与哈希表
+    pthread_cond_t m_load_cond;     // 块读取完成时通知等待的线程
+}page_cache_private_t;
+
+/*
+    批量读取中的一个请求
+*/
+typedef struct _page_cache_request
+{
+    long block;     // 块序号
+    int index;      // 在输入中的序号
+    int frame;      // 固定的缓存帧，-1 需要单独 pin，-2 读取失败
+    bool miss;      // 该缓存帧由本次批量读取从文件读入
+}page_cache_request_t;
+
+
+static page_cache_private_t* get_private_member(page_cache_t *cache)
+{
+    if(NULL == cache) return NULL;
+
+    return (page_cache_private_t*)cache->_private_;
+}
+
+/*
+@func:
+    块序号对应的哈希桶
+
+@para:
+    _this : 私有成员
+    block : 块序号
+
+@return:
+    int : 哈希桶下标
+*/
+static int page_cache_bucket(page_cache_private_t *_this, long block)
+{
+    return (int)(((unsigned long)block * 2654435761UL) & (unsigned long)_this->m_bucket_mask);
+}
+
+/*
+@func:
+    查找 / 插入 / 移除 块对应的缓存帧
+
+@para:
+    _this : 私有成员
+    block : 块序号
+    frame : 缓存帧下标
+
+@return:
+    page_cache_find : < 0 : 未缓存， other ： 缓存帧下标
+
+@note:
+    调用者需持有锁
+*/
+static int page_cache_find(page_cache_private_t *_this, long block)
+{
+    int f = _this->m_buckets[page_cache_bucket(_this, block)];
+    while(f >= 0 && _this->m_frames[f].block != block)
+        f = _this->m_frames[f].next;
+    return f;
+}
+
+static void page_cache_insert(page_cache_private_t *_this, int frame)
+{
+    int bucket = page_cache_bucket(_this, _this->m_frames[frame].block);
+    _this->m_frames[frame].next = _this->m_buckets[bucket];
+    _this->m_buckets[bucket] = frame;
+}
+
+static void page_cache_remove(page_cache_private_t *_this, int frame)
+{
+    int *p = &_this->m_buckets[page_cache_bucket(_this, _this->m_frames[frame].block)];
+    while(*p != frame)
+        p = &_this->m_frames[*p].next;
+    *p = _this->m_frames[frame].next;
+    _this->m_frames[frame].block = -1;
+    _this->m_frames[frame].next = -1;
+}
+
+/*
+@func:
+    按 CLOCK 算法选择被淘汰的缓存帧
+
+@para:
+    _this : 私有成员
+
+@return:
+    int : < 0 : 全部缓存帧都被固定， other ： 缓存帧下标
+
+@note:
+    调用者需持有锁；最多扫描两圈，第一圈清除引用位
+*/
+static int page_cache_victim(page_cache_private_t *_this)
+{
+    for(int i = 0; i < 2 * _this->m_frame_cnt; ++i)
+    {
+        page_cache_frame_t *frame = &_this->m_frames[_this->m_hand];
+        int f = _this->m_hand;
+        _this->m_hand = (_this->m_hand + 1) % _this->m_frame_cnt;
+
+        if(frame->pin_cnt > 0 || frame->loading) continue;
+        if(frame->ref)
+        {
+            frame->ref = false;
+            continue;
+        }
+        return f;
+    }
+    return -1;
+}
+
+/*
+@func:
+    从文件读取一个块，超出文件末尾的部分填 0
+
+@para:
+    _this : 私有成员
+    buf : 输出的块数据
+    block : 块序号
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+*/
+static int page_cache_read(page_cache_private_t *_this, char *buf, long block)
+{
+    size_t len = _this->m_block_size;
+    off_t offset = _this->m_base + (off_t)block * _this->m_block_size;
+
+    while(len > 0)
+    {
+        ssize_t n = pread(_this->m_fd, buf, len, offset);
+        if(n < 0)
+        {
+            if(EINTR == errno) continue;
+            PAGE_CACHE_LOG_DEBUG("pread error, offset %ld, errno %d", (long)offset, errno);
+            return -1;
+        }
+        if(0 == n)
+        {
+            memset(buf, 0, len);
+            break;
+        }
+        buf += n;
+        offset += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/*
+@func:
+    读取并固定偏移量所在的块
+
+@para:
+    _this : 私有成员
+    offset : 文件偏移量，>= base
+    full : 输出全部缓存帧都被固定时为 true，否则不修改
+
+@return:
+    void* : NULL 失败， other 偏移量处数据在缓存中的指针
+
+@note:
+    读文件时不持有锁，其他块的命中不受影响；同一块的并发未命中只读取一次
+*/
+static void* page_cache_pin_block(page_cache_private_t *_this, off_t offset, bool *full)
+{
+    long block = (long)((offset - _this->m_base) / _this->m_block_size);
+    int in_block = (int)((offset - _this->m_base) % _this->m_block_size);
+
+    pthread_mutex_lock(&_this->m_mutex);
+    int f = page_cache_find(_this, block);
+    while(f >= 0 && _this->m_frames[f].loading)
+    {
+        pthread_cond_wait(&_this->m_load_cond, &_this->m_mutex);
+        f = page_cache_find(_this, block);
+    }
+    if(f >= 0)
+    {
+        _this->m_frames[f].pin_cnt++;
+        _this->m_frames[f].ref = true;
+        pthread_mutex_unlock(&_this->m_mutex);
+        return _this->m_data + (size_t)f * _this->m_block_size + in_block;
+    }
+
+    f = page_cache_victim(_this);
+    if(f < 0)
+    {
+        PAGE_CACHE_LOG_DEBUG("all frames pinned");
+        *full = true;
+        pthread_mutex_unlock(&_this->m_mutex);
+        return NULL;
+    }
+    page_cache_frame_t *frame = &_this->m_frames[f];
+    if(frame->block >= 0)
+        page_cache_remove(_this, f);
+    frame->block = block;
+    frame->pin_cnt = 1;
+    frame->ref = true;
+    frame->loading = true;
+    page_cache_insert(_this, f);
+    pthread_mutex_unlock(&_this->m_mutex);
+
+    char *data = _this->m_data + (size_t)f * _this->m_block_size;
+    int res = page_cache_read(_this, data, block);
+
+    pthread_mutex_lock(&_this->m_mutex);
+    frame->loading = false;
+    if(0 != res)
+    {
+        page_cache_remove(_this, f);
+        frame->pin_cnt = 0;
+        frame->ref = false;
+    }
+    pthread_cond_broadcast(&_this->m_load_cond);
+    pthread_mutex_unlock(&_this->m_mutex);
+
+    return 0 == res ? data + in_block : NULL;
+}
+
+/*
+@func:
+    读取并固定偏移量所在的块
+
+@para:
+    cache : 缓存指针
+    offset : 文件偏移量
+
+@return:
+    void* : NULL 失败， other 偏移量处数据在缓存中的指针
+*/
+static void* page_cache_pin(page_cache_t *cache, off_t offset)
+{
+    page_cache_private_t *_this = get_private_member(cache);
+    if(NULL == _this || offset < _this->m_base) return NULL;
+
+    bool full = false;
+    return page_cache_pin_block(_this, offset, &full);
+}
+
+/*
+@func:
+    解除对块的固定
+
+@para:
+    cache : 缓存指针
+    ptr : pin 返回的指针
+
+@return:
+    None.
+*/
+static void page_cache_unpin(page_cache_t *cache, const void *ptr)
+{
+    page_cache_private_t *_this = get_private_member(cache);
+    if(NULL == _this || NULL == ptr) return;
+
+    int f = (int)(((const char *)ptr - _this->m_data) / _this->m_block_size);
+    if(f < 0 || f >= _this->m_frame_cnt) return;
+
+    pthread_mutex_lock(&_this->m_mutex);
+    if(_this->m_frames[f].pin_cnt > 0)
+        _this->m_frames[f].pin_cnt--;
+    pthread_mutex_unlock(&_this->m_mutex);
+}
+
+/*
+@func:
+    批量读取时按块序号排序的比较函数
+
+@para:
+    a, b : 两个 page_cache_request_t
+
+@return:
+    int : 比较结果
+*/
+static int page_cache_request_cmp(const void *a, const void *b)
+{
+    long x = ((const page_cache_request_t *)a)->block;
+    long y = ((const page_cache_request_t *)b)->block;
+    return (x > y) - (x < y);
+}
+
+/*
+@func:
+    把连续的多个块读入各自的缓存帧
+
+@para:
+    _this : 私有成员
+    reqs : 按块序号排序的请求，从 begin 到 end 的请求块序号连续且互不相同
+    begin : 第一个请求
+    end : 最后一个请求之后
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    一次 preadv 读完整段；读到文件末尾或被信号中断等不完整的情况逐块重新读取
+*/
+static int page_cache_read_run(page_cache_private_t *_this, const page_cache_request_t *reqs, int begin, int end)
+{
+    if(end <= begin) return 0;
+
+    struct iovec iov[PAGE_CACHE_MAX_IOV];
+    for(int i = begin; i < end; ++i)
+    {
+        iov[i - begin].iov_base = _this->m_data + (size_t)reqs[i].frame * _this->m_block_size;
+        iov[i - begin].iov_len = _this->m_block_size;
+    }
+    off_t offset = _this->m_base + (off_t)reqs[begin].block * _this->m_block_size;
+    ssize_t n = preadv(_this->m_fd, iov, end - begin, offset);
+    if(n == (ssize_t)(end - begin) * _this->m_block_size)
+        return 0;
+
+    for(int i = begin; i < end; ++i)
+    {
+        if(0 != page_cache_read(_this, iov[i - begin].iov_base, reqs[i].block))
+            return -1;
+    }
+    return 0;
+}
+
+/*
+@func:
+    批量读取并固定偏移量所在的块
+
+@para:
+    cache : 缓存指针
+    offsets : 文件偏移量数组
+    cnt : 偏移量个数
+    ptrs : 输出每个偏移量处数据在缓存中的指针，失败时为 NULL
+
+@return:
+    int : -1 : 参数错误，-2 : 缓存帧不足， other ： 成功固定的个数
+
+@note:
+    按块序号排序后在一次加锁中固定命中的块，并为未命中的块占用缓存帧（标记为正在读取）；
+    释放锁后按连续的块分段向量读，再加锁一次结束读取状态。
+    其他线程正在读取的块在最后逐个 pin，与单个 pin 一样等待其完成。
+    结果同时固定，不同的块多于空闲的缓存帧时返回 -2，已固定的块全部解除，ptrs 全部为 NULL
+*/
+static int page_cache_pin_batch(page_cache_t *cache, const off_t *offsets, int cnt, void **ptrs)
+{
+    page_cache_private_t *_this = get_private_member(cache);
+    if(NULL == _this || NULL == offsets || NULL == ptrs || cnt < 0) return -1;
+
+    int pinned = 0;
+    bool full = false;
+    page_cache_request_t *reqs = (page_cache_request_t *)malloc(sizeof(page_cache_request_t) * 2 * (cnt > 0 ? cnt : 1));
+    if(NULL == reqs)
+    {
+        for(int i = 0; i < cnt; ++i)
+        {
+            ptrs[i] = !full && offsets[i] >= _this->m_base ? page_cache_pin_block(_this, offsets[i], &full) : NULL;
+            pinned += (NULL != ptrs[i]);
+        }
+        goto PIN_END;
+    }
+    page_cache_request_t *miss = reqs + (cnt > 0 ? cnt : 1);
+
+    int req_cnt = 0;
+    for(int i = 0; i < cnt; ++i)
+    {
+        ptrs[i] = NULL;
+        if(offsets[i] < _this->m_base) continue;
+        reqs[req_cnt].block = (long)((offsets[i] - _this->m_base) / _this->m_block_size);
+        reqs[req_cnt].index = i;
+        reqs[req_cnt].frame = -1;
+        reqs[req_cnt].miss = false;
+        req_cnt++;
+    }
+    qsort(reqs, req_cnt, sizeof(page_cache_request_t), page_cache_request_cmp);
+
+    pthread_mutex_lock(&_this->m_mutex);
+    for(int i = 0; i < req_cnt; ++i)
+    {
+        page_cache_request_t *req = &reqs[i];
+        // 同一块的请求相邻，共用前一个请求的缓存帧
+        if(i > 0 && reqs[i - 1].block == req->block)
+        {
+            req->frame = reqs[i - 1].frame;
+            req->miss = reqs[i - 1].miss;
+            if(req->frame >= 0)
+                _this->m_frames[req->frame].pin_cnt++;
+            continue;
+        }
+        int f = page_cache_find(_this, req->block);
+        if(f >= 0 && _this->m_frames[f].loading) continue;
+        if(f < 0)
+        {
+            f = page_cache_victim(_this);
+            if(f < 0)
+            {
+                full = true;
+                continue;
+            }
+            if(_this->m_frames[f].block >= 0)
+                page_cache_remove(_this, f);
+            _this->m_frames[f].block = req->block;
+            _this->m_frames[f].pin_cnt = 0;
+            _this->m_frames[f].loading = true;
+            page_cache_insert(_this, f);
+            req->miss = true;
+        }
+        _this->m_frames[f].pin_cnt++;
+        _this->m_frames[f].ref = true;
+        req->frame = f;
+    }
+    pthread_mutex_unlock(&_this->m_mutex);
+
+    int miss_cnt = 0;
+    for(int i = 0; i < req_cnt; ++i)
+    {
+        if(reqs[i].miss && !(i > 0 && reqs[i - 1].block == reqs[i].block))
+            miss[miss_cnt++] = reqs[i];
+    }
+    for(int begin = 0, end = 0; begin < miss_cnt; begin = end)
+    {
+        for(end = begin + 1; end < miss_cnt && end - begin < PAGE_CACHE_MAX_IOV && miss[end].block == miss[end - 1].block + 1; ++end);
+        if(0 != page_cache_read_run(_this, miss, begin, end))
+        {
+            for(int i = begin; i < end; ++i)
+                miss[i].miss = false;
+        }
+    }
+
+    // 读取失败的缓存帧放回空闲状态，引用它的请求全部失败
+    pthread_mutex_lock(&_this->m_mutex);
+    for(int i = 0; i < miss_cnt; ++i)
+    {
+        page_cache_frame_t *frame = &_this->m_frames[miss[i].frame];
+        frame->loading = false;
+        if(!miss[i].miss)
+        {
+            PAGE_CACHE_LOG_DEBUG("read block %ld error", miss[i].block);
+            page_cache_remove(_this, miss[i].frame);
+            frame->pin_cnt = 0;
+            frame->ref = false;
+        }
+    }
+    for(int i = 0; i < req_cnt; ++i)
+    {
+        if(reqs[i].miss && _this->m_frames[reqs[i].frame].block != reqs[i].block)
+            reqs[i].frame = -2;
+    }
+    pthread_cond_broadcast(&_this->m_load_cond);
+    pthread_mutex_unlock(&_this->m_mutex);
+
+    for(int i = 0; i < req_cnt; ++i)
+    {
+        int index = reqs[i].index;
+        if(reqs[i].frame >= 0)
+        {
+            int in_block = (int)((offsets[index] - _this->m_base) % _this->m_block_size);
+            ptrs[index] = _this->m_data + (size_t)reqs[i].frame * _this->m_block_size + in_block;
+        }
+        else if(-1 == reqs[i].frame && !full)
+            ptrs[index] = page_cache_pin_block(_this, offsets[index], &full);
+        pinned += (NULL != ptrs[index]);
+    }
+    free(reqs);
+
+PIN_END:
+    // 缓存帧不足时部分结果无法固定，整批失败，调用者减少每批的键值个数后重试
+    if(full)
+    {
+        PAGE_CACHE_LOG_DEBUG("batch of %d needs more frames than %d", cnt, _this->m_frame_cnt);
+        for(int i = 0; i < cnt; ++i)
+        {
+            page_cache_unpin(cache, ptrs[i]);
+            ptrs[i] = NULL;
+        }
+        return -2;
+    }
+    return pinned;
+}
+
+/*
+@func:
+    写入文件后同步已缓存的块
+
+@para:
+    cache : 缓存指针
+    buf : 写入的数据
+    len : 数据长度
+    offset : 文件偏移量
+
+@return:
+    None.
+
+@note:
+    只拷贝与已缓存块重叠的部分，base 之前的部分忽略
+*/
+static void page_cache_update(page_cache_t *cache, const void *buf, int len, off_t offset)
+{
+    page_cache_private_t *_this = get_private_member(cache);
+    if(NULL == _this || NULL == buf || len <= 0) return;
+
+    const char *src = (const char *)buf;
+    off_t end = offset + len;
+    if(offset < _this->m_base)
+    {
+        if(end <= _this->m_base) return;
+        src += _this->m_base - offset;
+        offset = _this->m_base;
+    }
+
+    pthread_mutex_lock(&_this->m_mutex);
+    while(offset < end)
+    {
+        long block = (long)((offset - _this->m_base) / _this->m_block_size);
+        int in_block = (int)((offset - _this->m_base) % _this->m_block_size);
+        int n = _this->m_block_size - in_block;
+        if((off_t)n > end - offset)
+            n = (int)(end - offset);
+
+        int f = page_cache_find(_this, block);
+        while(f >= 0 && _this->m_frames[f].loading)
+        {
+            pthread_cond_wait(&_this->m_load_cond, &_this->m_mutex);
+            f = page_cache_find(_this, block);
+        }
+        if(f >= 0)
+            memcpy(_this->m_data + (size_t)f * _this->m_block_size + in_block, src, n);
+
+        src += n;
+        offset += n;
+    }
+    pthread_mutex_unlock(&_this->m_mutex);
+}
+
+/*
+@func:
+    丢弃全部缓存的块，之后从新的文件读取
+
+@para:
+    cache : 缓存指针
+    fd : 文件描述符
+
+@return:
+    None.
+*/
+static void page_cache_reset(page_cache_t *cache, int fd)
+{
+    page_cache_private_t *_this = get_private_member(cache);
+    if(NULL == _this) return;
+
+    pthread_mutex_lock(&_this->m_mutex);
+    for(int i = 0; i < _this->m_frame_cnt; ++i)
+    {
+        while(_this->m_frames[i].loading)
+            pthread_cond_wait(&_this->m_load_cond, &_this->m_mutex);
+        if(_this->m_frames[i].block >= 0)
+            page_cache_remove(_this, i);
+        _this->m_frames[i].ref = false;
+    }
+    _this->m_fd = fd;
+    pthread_mutex_unlock(&_this->m_mutex);
+}
+
+/*
+@func:
+    销毁缓存
+
+@para:
+    cache : 缓存指针
+
+@return:
+    None.
+*/
+static void page_cache_destory(page_cache_t **cache)
+{
+    if(NULL == cache || NULL == *cache) return;
+
+    page_cache_private_t *_this = get_private_member(*cache);
+    pthread_mutex_destroy(&_this->m_mutex);
+    pthread_cond_destroy(&_this->m_load_cond);
+    free(_this->m_buckets);
+    free(_this->m_frames);
+    free(_this->m_data);
+    free(_this);
+    free(*cache);
+    *cache = NULL;
+}
+
+/*
+@func:
+    创建页缓存
+
+@para:
+    fd : 文件描述符
+    base : 第一个块在文件中的偏移量
+    block_size : 块大小（字节）
+    cache_size : 缓存的总大小（字节）
+
+@return:
+    page_cache_t* : NULL 失败， other 缓存指针
+*/
+page_cache_t* page_cache_create(int fd, off_t base, int block_size, long cache_size)
+{
+    if(fd < 0 || base < 0 || block_size <= 0) return NULL;
+
+    page_cache_t *cache = (page_cache_t *)malloc(sizeof(page_cache_t));
+    page_cache_private_t *_this = (page_cache_private_t *)malloc(sizeof(page_cache_private_t));
+    if(NULL == cache || NULL == _this)
+    {
+        free(cache);
+        free(_this);
+        return NULL;
+    }
+    memset(cache, 0, sizeof(page_cache_t));
+    memset(_this, 0, sizeof(page_cache_private_t));
+
+    long frame_cnt = cache_size / block_size;
+    if(frame_cnt < PAGE_CACHE_MIN_FRAMES)
+        frame_cnt = PAGE_CACHE_MIN_FRAMES;
+    int bucket_cnt = 1;
+    while(bucket_cnt < frame_cnt)
+        bucket_cnt *= 2;
+
+    _this->m_fd = fd;
+    _this->m_base = base;
+    _this->m_block_size = block_size;
+    _this->m_frame_cnt = (int)frame_cnt;
+    _this->m_bucket_mask = bucket_cnt - 1;
+    _this->m_data = (char *)malloc((size_t)frame_cnt * block_size);
+    _this->m_frames = (page_cache_frame_t *)malloc(sizeof(page_cache_frame_t) * frame_cnt);
+    _this->m_buckets = (int *)malloc(sizeof(int) * bucket_cnt);
+    if(NULL == _this->m_data || NULL == _this->m_frames || NULL == _this->m_buckets)
+    {
+        PAGE_CACHE_LOG_DEBUG("alloc cache error");
+        free(_this->m_buckets);
+        free(_this->m_frames);
+        free(_this->m_data);
+        free(_this);
+        free(cache);
+        return NULL;
+    }
+    for(int i = 0; i < _this->m_frame_cnt; ++i)
+    {
+        _this->m_frames[i].block = -1;
+        _this->m_frames[i].pin_cnt = 0;
+        _this->m_frames[i].ref = false;
+        _this->m_frames[i].loading = false;
+        _this->m_frames[i].next = -1;
+    }
+    for(int i = 0; i < bucket_cnt; ++i)
+        _this->m_buckets[i] = -1;
+
+    pthread_mutex_init(&_this->m_mutex, NULL);
+    pthread_cond_init(&_this->m_load_cond, NULL);
+
+    cache->_this = cache;
+    cache->_private_ = (void *)_this;
+    cache->pin = page_cache_pin;
+    cache->pin_batch = page_cache_pin_batch;
+    cache->unpin = page_cache_unpin;
+    cache->update = page_cache_update;
+    cache->reset = page_cache_reset;
+    cache->destory = page_cache_destory;
+
+    return cache;
+}
@@ -0,0 +1,145 @@
+/*
+** File : PageCache.h
+** Author : Saury
+** Date : 2020-09-12
+*/
+
+#ifndef _PAGE_CACHE_H_
+#define _PAGE_CACHE_H_
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+typedef struct _page_cache page_cache_t;
+
+/*
+    页缓存：把文件中从 base 开始的内容按固定大小分块，在固定数量的缓存帧中缓存最近访问的块，
+    缓存满时按 CLOCK 算法淘汰未被固定的块，内存占用与文件大小无关。
+    pin 返回的指针在 unpin 之前有效，被固定的块不会被淘汰
+*/
+
+struct _page_cache
+{
+    page_cache_t *_this;
+    void *_private_;    // 私有成员
+
+/*
+@func:
+    读取并固定偏移量所在的块
+
+@para:
+    cache : 缓存指针
+    offset : 文件偏移量，>= base
+
+@return:
+    void* : NULL 失败， other 偏移量处数据在缓存中的指针
+
+@note:
+    未命中时从文件读取整块，超出文件末尾的部分填 0；全部缓存帧都被固定时返回 NULL。
+    调用者需保证访问的数据不跨越块的边界
+*/
+    void* (*pin)(page_cache_t *cache, off_t offset);
+
+/*
+@func:
+    批量读取并固定偏移量所在的块
+
+@para:
+    cache : 缓存指针
+    offsets : 文件偏移量数组，每个 >= base
+    cnt : 偏移量个数
+    ptrs : 输出每个偏移量处数据在缓存中的指针，失败时为 NULL
+
+@return:
+    int : -1 : 参数错误，-2 : 缓存帧不足， other ： 成功固定的个数
+
+@note:
+    与逐个 pin 的结果相同，每个成功的指针都需要一次 unpin；
+    命中的块在一次加锁中全部固定，未命中的块按块序号排序后，文件中相邻的块合并为一次向量读。
+    全部结果同时固定，涉及的不同块多于未被固定的缓存帧时返回 -2，不固定任何块
+*/
+    int (*pin_batch)(page_cache_t *cache, const off_t *offsets, int cnt, void **ptrs);
+
+/*
+@func:
+    解除 pin 对块的固定
+
+@para:
+    cache : 缓存指针
+    ptr : pin 返回的指针
+
+@return:
+    None.
+
+@note:
+    每次 pin 对应一次 unpin
+*/
+    void (*unpin)(page_cache_t *cache, const void *ptr);
+
+/*
+@func:
+    写入文件后同步已缓存的块
+
+@para:
+    cache : 缓存指针
+    buf : 写入的数据
+    len : 数据长度
+    offset : 文件偏移量
+
+@return:
+    None.
+
+@note:
+    未缓存的块不需要处理，之后从文件读取
+*/
+    void (*update)(page_cache_t *cache, const void *buf, int len, off_t offset);
+
+/*
+@func:
+    丢弃全部缓存的块，之后从新的文件读取
+
+@para:
+    cache : 缓存指针
+    fd : 文件描述符
+
+@return:
+    None.
+
+@note:
+    被固定的块在 unpin 之前仍然可以访问，但不会再被 pin 命中
+*/
+    void (*reset)(page_cache_t *cache, int fd);
+
+/*
+@func:
+    销毁缓存
+
+@para:
+    cache : 缓存指针
+
+@return:
+    None.
+
+@note:
+    调用前需解除全部固定
+*/
+    void (*destory)(page_cache_t **cache);
+};
+
+
+/*
+@func:
+    创建页缓存
+
+@para:
+    fd : 文件描述符
+    base : 第一个块在文件中的偏移量
+    block_size : 块大小（字节）
+    cache_size : 缓存的总大小（字节），至少缓存 16 个块
+
+@return:
+    page_cache_t* : NULL 失败， other 缓存指针
+*/
+extern page_cache_t* page_cache_create(int fd, off_t base, int block_size, long cache_size);
+
+#endif /* end #ifndef _PAGE_CACHE_H_ */
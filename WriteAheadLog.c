@@ -0,0 +1,915 @@
+/*
+** File : WriteAheadLog.c
+** Author : Saury
+** Date : 2020-09-12
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include "WriteAheadLog.h"
+
+
+#define DEBUG_LOG 0
+
+#define WAL_LOG_DEBUG(fmt, ...) \
+    do{ \
+        if(DEBUG_LOG) \
+        {\
+            printf("%s at %d " fmt "\r\n", __FILE__, __LINE__, ##__VA_ARGS__);\
+        }\
+    }while(0);
+
+
+#define WAL_SEG_MAGIC "FDBWAL01"
+#define WAL_OP_MAGIC  0x57414C4FU
+
+#define WAL_ENTRY_WRITE    1  // 写入数据
+#define WAL_ENTRY_TRUNCATE 2  // 截断文件
+
+#define WAL_DEFAULT_CHECKPOINT_SIZE (16L * 1024 * 1024)
+
+#define WAL_SEG_CNT 2
+
+typedef struct _wal_seg_head
+{
+    char magic[8];      // 段标识
+    int64_t base_lsn;   // 本段第一个操作的日志序号
+}wal_seg_head_t;
+
+typedef struct _wal_op_head
+{
+    uint32_t magic;     // 操作标识
+    uint32_t len;       // 操作内全部写入项的字节数
+    int64_t lsn;        // 日志序号
+    uint32_t crc;       // 写入项的校验值
+    uint32_t cnt;       // 写入项数量
+}wal_op_head_t;
+
+typedef struct _wal_entry_head
+{
+    int64_t offset;     // 数据文件偏移量，截断时为截断后的长度
+    int32_t len;        // 数据长度
+    int32_t type;       // 写入项类型
+}wal_entry_head_t;
+
+typedef struct _wal_private
+{
+    char m_seg_path[WAL_SEG_CNT][160];  // 日志段文件路径
+    int m_seg_fd[WAL_SEG_CNT];          // 日志段文件描述符
+    off_t m_seg_size[WAL_SEG_CNT];      // 日志段已写入的长度
+    int m_active;                       // 当前追加写入的日志段
+    int m_data_fd;                      // 数据文件描述符
+    bool m_sync_on_commit;              // 提交后是否需要 fdatasync
+    long m_checkpoint_size;             // 触发检查点的日志段大小
+
+    // 当前操作暂存区，由调用者保证串行访问
+    char *m_op_buf;
+    size_t m_op_len;
+    size_t m_op_cap;
+    uint32_t m_op_cnt;
+
+    // 日志缓冲区，提交的操作先进入 m_buf，由组提交的领导者一次写入日志段
+    pthread_mutex_t m_mutex;
+    pthread_cond_t m_flush_cond;
+    char *m_buf;
+    size_t m_buf_len;
+    size_t m_buf_cap;
+    char *m_flush_buf;
+    size_t m_flush_cap;
+    int64_t m_next_lsn;     // 最后分配的日志序号
+    int64_t m_buf_lsn;      // 缓冲区内最后一个操作的日志序号
+    int64_t m_written_lsn;  // 已写入日志段的日志序号
+    int64_t m_durable_lsn;  // 已落盘的日志序号
+    bool m_flushing;        // 是否有领导者正在写日志
+    int m_error;
+
+    // 检查点
+    pthread_mutex_t m_ckpt_mutex;   // 串行化检查点
+    pthread_cond_t m_ckpt_cond;
+    pthread_t m_ckpt_thread;
+    bool m_ckpt_request;
+    bool m_stop;
+}wal_private_t;
+
+
+static wal_private_t* get_private_member(wal_t *wal)
+{
+    if(NULL == wal) return NULL;
+
+    return (wal_private_t*)wal->_private_;
+}
+
+/*
+@func:
+    计算 CRC32 校验值
+
+@para:
+    buf : 数据
+    len : 数据长度
+
+@return:
+    uint32_t : 校验值
+*/
+static uint32_t wal_crc_table[256];
+static pthread_once_t wal_crc_once = PTHREAD_ONCE_INIT;
+
+static void wal_crc_init(void)
+{
+    for(uint32_t i = 0; i < 256; ++i)
+    {
+        uint32_t c = i;
+        for(int k = 0; k < 8; ++k)
+            c = (c & 1) ? (0xEDB88320U ^ (c >> 1)) : (c >> 1);
+        wal_crc_table[i] = c;
+    }
+}
+
+static uint32_t wal_crc32(const void *buf, size_t len)
+{
+    const unsigned char *p = (const unsigned char *)buf;
+    uint32_t c = 0xFFFFFFFFU;
+
+    pthread_once(&wal_crc_once, wal_crc_init);
+    while(len--)
+        c = wal_crc_table[(c ^ *p++) & 0xFF] ^ (c >> 8);
+
+    return c ^ 0xFFFFFFFFU;
+}
+
+/*
+@func:
+    在指定偏移量处 写入/读取 完整的数据
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+*/
+static int wal_pwrite(int fd, const void *buf, size_t len, off_t offset)
+{
+    const char *p = (const char *)buf;
+    while(len > 0)
+    {
+        ssize_t n = pwrite(fd, p, len, offset);
+        if(n < 0)
+        {
+            if(EINTR == errno) continue;
+            return -1;
+        }
+        p += n;
+        offset += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static int wal_pread(int fd, void *buf, size_t len, off_t offset)
+{
+    char *p = (char *)buf;
+    while(len > 0)
+    {
+        ssize_t n = pread(fd, p, len, offset);
+        if(n < 0)
+        {
+            if(EINTR == errno) continue;
+            return -1;
+        }
+        if(0 == n) return -2;
+        p += n;
+        offset += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/*
+@func:
+    确保缓冲区至少能容纳 need 字节
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+*/
+static int wal_reserve(char **buf, size_t *cap, size_t need)
+{
+    if(need <= *cap) return 0;
+
+    size_t new_cap = *cap > 0 ? *cap : 4096;
+    while(new_cap < need)
+        new_cap *= 2;
+
+    char *p = (char *)realloc(*buf, new_cap);
+    if(NULL == p) return -1;
+
+    *buf = p;
+    *cap = new_cap;
+    return 0;
+}
+
+/*
+@func:
+    把一个日志段中的操作重放到数据文件中
+
+@para:
+    _this : 私有成员
+    seg : 日志段序号
+    max_lsn : 输出重放过的最大日志序号
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    遇到不完整或校验失败的操作时停止，其后的内容视为未提交
+*/
+static int wal_replay_segment(wal_private_t *_this, int seg, int64_t *max_lsn)
+{
+    off_t size = _this->m_seg_size[seg];
+    if(size <= (off_t)sizeof(wal_seg_head_t)) return 0;
+
+    char *buf = (char *)malloc(size);
+    if(NULL == buf) return -1;
+
+    if(0 != wal_pread(_this->m_seg_fd[seg], buf, size, 0))
+    {
+        free(buf);
+        return -2;
+    }
+
+    off_t pos = sizeof(wal_seg_head_t);
+    while(pos + (off_t)sizeof(wal_op_head_t) <= size)
+    {
+        wal_op_head_t op;
+        memcpy(&op, buf + pos, sizeof(op));
+        if(WAL_OP_MAGIC != op.magic || pos + (off_t)sizeof(op) + op.len > size)
+            break;
+
+        char *payload = buf + pos + sizeof(op);
+        if(op.crc != wal_crc32(payload, op.len))
+        {
+            WAL_LOG_DEBUG("op crc error, lsn %lld", (long long)op.lsn);
+            break;
+        }
+
+        size_t entry_pos = 0;
+        for(uint32_t i = 0; i < op.cnt && entry_pos + sizeof(wal_entry_head_t) <= op.len; ++i)
+        {
+            wal_entry_head_t entry;
+            memcpy(&entry, payload + entry_pos, sizeof(entry));
+            entry_pos += sizeof(entry);
+
+            if(WAL_ENTRY_WRITE == entry.type)
+            {
+                if(0 != wal_pwrite(_this->m_data_fd, payload + entry_pos, entry.len, entry.offset))
+                {
+                    free(buf);
+                    return -3;
+                }
+                entry_pos += entry.len;
+            }
+            else if(WAL_ENTRY_TRUNCATE == entry.type)
+            {
+                if(0 != ftruncate(_this->m_data_fd, entry.offset))
+                {
+                    free(buf);
+                    return -4;
+                }
+            }
+        }
+
+        if(op.lsn > *max_lsn)
+            *max_lsn = op.lsn;
+        pos += sizeof(op) + op.len;
+    }
+
+    free(buf);
+    return 0;
+}
+
+/*
+@func:
+    在日志段开头写入段头
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+*/
+static int wal_write_seg_head(wal_private_t *_this, int seg, int64_t base_lsn)
+{
+    wal_seg_head_t head;
+    memcpy(head.magic, WAL_SEG_MAGIC, sizeof(head.magic));
+    head.base_lsn = base_lsn;
+
+    if(0 != wal_pwrite(_this->m_seg_fd[seg], &head, sizeof(head), 0))
+        return -1;
+
+    _this->m_seg_size[seg] = sizeof(head);
+    return 0;
+}
+
+/*
+@func:
+    领导者把日志缓冲区写入当前日志段
+
+@para:
+    _this : 私有成员
+    do_sync : 写入后是否 fdatasync
+
+@return:
+    None.
+
+@note:
+    调用时需持有 m_mutex，写日志期间会释放锁，其他提交者可以继续向新的缓冲区追加操作
+*/
+static void wal_flush_locked(wal_private_t *_this, bool do_sync)
+{
+    _this->m_flushing = true;
+
+    char *buf = _this->m_buf;
+    size_t len = _this->m_buf_len;
+    size_t cap = _this->m_buf_cap;
+    int64_t target = _this->m_buf_lsn;
+    int seg = _this->m_active;
+    off_t pos = _this->m_seg_size[seg];
+
+    _this->m_buf = _this->m_flush_buf;
+    _this->m_buf_cap = _this->m_flush_cap;
+    _this->m_buf_len = 0;
+
+    pthread_mutex_unlock(&_this->m_mutex);
+
+    int res = 0;
+    if(len > 0)
+        res = wal_pwrite(_this->m_seg_fd[seg], buf, len, pos);
+    if(0 == res && do_sync)
+        res = fdatasync(_this->m_seg_fd[seg]);
+
+    pthread_mutex_lock(&_this->m_mutex);
+
+    _this->m_flush_buf = buf;
+    _this->m_flush_cap = cap;
+    if(0 != res)
+    {
+        WAL_LOG_DEBUG("flush wal error, errno %d", errno);
+        _this->m_error = -1;
+    }
+    else
+    {
+        _this->m_seg_size[seg] += len;
+        _this->m_written_lsn = target;
+        if(do_sync && target > _this->m_durable_lsn)
+            _this->m_durable_lsn = target;
+    }
+    _this->m_flushing = false;
+    pthread_cond_broadcast(&_this->m_flush_cond);
+
+    if(_this->m_seg_size[seg] >= _this->m_checkpoint_size && !_this->m_ckpt_request)
+    {
+        _this->m_ckpt_request = true;
+        pthread_cond_signal(&_this->m_ckpt_cond);
+    }
+}
+
+/*
+@func:
+    暂存一次对数据文件的写入
+
+@para:
+    wal : 日志指针
+    buf : 写入的数据
+    len : 数据长度
+    offset : 数据文件中的偏移量
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+*/
+static int wal_write(wal_t *wal, const void *buf, int len, off_t offset)
+{
+    wal_private_t *_this = get_private_member(wal);
+    if(NULL == _this || NULL == buf || len < 0) return -1;
+
+    if(0 == _this->m_op_len)
+        _this->m_op_len = sizeof(wal_op_head_t);
+
+    if(0 != wal_reserve(&_this->m_op_buf, &_this->m_op_cap, _this->m_op_len + sizeof(wal_entry_head_t) + len))
+        return -2;
+
+    wal_entry_head_t entry;
+    entry.offset = offset;
+    entry.len = len;
+    entry.type = WAL_ENTRY_WRITE;
+    memcpy(_this->m_op_buf + _this->m_op_len, &entry, sizeof(entry));
+    memcpy(_this->m_op_buf + _this->m_op_len + sizeof(entry), buf, len);
+    _this->m_op_len += sizeof(entry) + len;
+    _this->m_op_cnt++;
+    return 0;
+}
+
+/*
+@func:
+    暂存一次对数据文件的截断
+
+@para:
+    wal : 日志指针
+    length : 截断后的文件长度
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+*/
+static int wal_truncate(wal_t *wal, off_t length)
+{
+    wal_private_t *_this = get_private_member(wal);
+    if(NULL == _this) return -1;
+
+    if(0 == _this->m_op_len)
+        _this->m_op_len = sizeof(wal_op_head_t);
+
+    if(0 != wal_reserve(&_this->m_op_buf, &_this->m_op_cap, _this->m_op_len + sizeof(wal_entry_head_t)))
+        return -2;
+
+    wal_entry_head_t entry;
+    entry.offset = length;
+    entry.len = 0;
+    entry.type = WAL_ENTRY_TRUNCATE;
+    memcpy(_this->m_op_buf + _this->m_op_len, &entry, sizeof(entry));
+    _this->m_op_len += sizeof(entry);
+    _this->m_op_cnt++;
+    return 0;
+}
+
+/*
+@func:
+    丢弃当前操作暂存的全部写入
+
+@para:
+    wal : 日志指针
+
+@return:
+    None.
+*/
+static void wal_rollback(wal_t *wal)
+{
+    wal_private_t *_this = get_private_member(wal);
+    if(NULL == _this) return;
+
+    _this->m_op_len = 0;
+    _this->m_op_cnt = 0;
+}
+
+/*
+@func:
+    提交当前操作
+
+@para:
+    wal : 日志指针
+
+@return:
+    long long : < 0 : 失败， other ： 该操作的日志序号，没有暂存写入时返回 0
+*/
+static long long wal_commit(wal_t *wal)
+{
+    wal_private_t *_this = get_private_member(wal);
+    if(NULL == _this) return -1;
+
+    if(0 == _this->m_op_cnt) return 0;
+
+    wal_op_head_t op;
+    op.magic = WAL_OP_MAGIC;
+    op.len = _this->m_op_len - sizeof(op);
+    op.crc = wal_crc32(_this->m_op_buf + sizeof(op), op.len);
+    op.cnt = _this->m_op_cnt;
+
+    pthread_mutex_lock(&_this->m_mutex);
+    if(0 != wal_reserve(&_this->m_buf, &_this->m_buf_cap, _this->m_buf_len + _this->m_op_len))
+    {
+        pthread_mutex_unlock(&_this->m_mutex);
+        wal_rollback(wal);
+        return -2;
+    }
+    op.lsn = ++_this->m_next_lsn;
+    memcpy(_this->m_op_buf, &op, sizeof(op));
+    memcpy(_this->m_buf + _this->m_buf_len, _this->m_op_buf, _this->m_op_len);
+    _this->m_buf_len += _this->m_op_len;
+    _this->m_buf_lsn = op.lsn;
+    pthread_mutex_unlock(&_this->m_mutex);
+
+    wal_rollback(wal);
+    return op.lsn;
+}
+
+/*
+@func:
+    等待指定序号的操作写入日志，需要时等待落盘
+
+@para:
+    wal : 日志指针
+    lsn : commit 返回的日志序号
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    第一个发现缓冲区未写入的调用者成为领导者，把缓冲区中所有操作一次写入并同步；
+    其余调用者等待领导者完成，若自己的操作不在本批次中则成为下一批次的领导者
+*/
+static int wal_sync(wal_t *wal, long long lsn)
+{
+    wal_private_t *_this = get_private_member(wal);
+    if(NULL == _this) return -1;
+    if(lsn <= 0) return 0;
+
+    pthread_mutex_lock(&_this->m_mutex);
+    while(0 == _this->m_error &&
+          (_this->m_written_lsn < lsn || (_this->m_sync_on_commit && _this->m_durable_lsn < lsn)))
+    {
+        if(_this->m_flushing)
+            pthread_cond_wait(&_this->m_flush_cond, &_this->m_mutex);
+        else
+            wal_flush_locked(_this, _this->m_sync_on_commit);
+    }
+    int res = _this->m_error;
+    pthread_mutex_unlock(&_this->m_mutex);
+    return res;
+}
+
+/*
+@func:
+    把已提交的全部操作写入日志并落盘
+
+@para:
+    wal : 日志指针
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    与组提交共用领导者机制，正在写日志时等待其完成后再判断是否已经落盘
+*/
+static int wal_sync_all(wal_t *wal)
+{
+    wal_private_t *_this = get_private_member(wal);
+    if(NULL == _this) return -1;
+
+    pthread_mutex_lock(&_this->m_mutex);
+    int64_t target = _this->m_buf_lsn;
+    while(0 == _this->m_error && _this->m_durable_lsn < target)
+    {
+        if(_this->m_flushing)
+            pthread_cond_wait(&_this->m_flush_cond, &_this->m_mutex);
+        else
+            wal_flush_locked(_this, true);
+    }
+    int res = _this->m_error;
+    pthread_mutex_unlock(&_this->m_mutex);
+    return res;
+}
+
+/*
+@func:
+    执行检查点
+
+@para:
+    wal : 日志指针
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    先把缓冲区写入当前日志段并切换到另一个空的日志段，之后前台提交写入新日志段，
+    旧日志段中的操作写入数据文件并同步后再清空
+*/
+static int wal_checkpoint(wal_t *wal)
+{
+    wal_private_t *_this = get_private_member(wal);
+    if(NULL == _this) return -1;
+
+    pthread_mutex_lock(&_this->m_ckpt_mutex);
+    pthread_mutex_lock(&_this->m_mutex);
+    while(_this->m_flushing)
+        pthread_cond_wait(&_this->m_flush_cond, &_this->m_mutex);
+
+    if(_this->m_buf_len > 0)
+        wal_flush_locked(_this, false);
+
+    int old = _this->m_active;
+    int64_t switch_lsn = _this->m_written_lsn;
+    if(_this->m_seg_size[old] <= (off_t)sizeof(wal_seg_head_t) || 0 != _this->m_error)
+    {
+        int res = _this->m_error;
+        _this->m_ckpt_request = false;
+        pthread_mutex_unlock(&_this->m_mutex);
+        pthread_mutex_unlock(&_this->m_ckpt_mutex);
+        return res;
+    }
+
+    int next = (old + 1) % WAL_SEG_CNT;
+    if(0 != wal_write_seg_head(_this, next, _this->m_next_lsn + 1))
+    {
+        pthread_mutex_unlock(&_this->m_mutex);
+        pthread_mutex_unlock(&_this->m_ckpt_mutex);
+        return -2;
+    }
+    _this->m_active = next;
+    _this->m_ckpt_request = false;
+    pthread_mutex_unlock(&_this->m_mutex);
+
+    int64_t max_lsn = 0;
+    int res = wal_replay_segment(_this, old, &max_lsn);
+    if(0 == res)
+        res = fdatasync(_this->m_data_fd);
+
+    pthread_mutex_lock(&_this->m_mutex);
+    if(0 == res)
+    {
+        if(switch_lsn > _this->m_durable_lsn)
+            _this->m_durable_lsn = switch_lsn;
+        pthread_cond_broadcast(&_this->m_flush_cond);
+
+        if(0 == ftruncate(_this->m_seg_fd[old], 0))
+            _this->m_seg_size[old] = 0;
+    }
+    else
+    {
+        WAL_LOG_DEBUG("checkpoint error %d", res);
+        _this->m_error = -3;
+    }
+    pthread_mutex_unlock(&_this->m_mutex);
+    pthread_mutex_unlock(&_this->m_ckpt_mutex);
+    return 0 == res ? 0 : -3;
+}
+
+/*
+@func:
+    执行检查点后把日志切换到新的数据文件
+
+@para:
+    wal : 日志指针
+    data_fd : 新数据文件的文件描述符
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    调用者必须保证期间没有新的提交；
+    旧数据文件对应的日志段在切换前被写入旧数据文件并持久地清空，崩溃后不会被重放到新数据文件中
+*/
+static int wal_switch_data_file(wal_t *wal, int data_fd)
+{
+    wal_private_t *_this = get_private_member(wal);
+    if(NULL == _this || data_fd < 0) return -1;
+
+    int res = wal_checkpoint(wal);
+    if(0 != res) return res;
+
+    pthread_mutex_lock(&_this->m_ckpt_mutex);
+    for(int i = 0; i < WAL_SEG_CNT && 0 == res; ++i)
+    {
+        if(i != _this->m_active && 0 != fdatasync(_this->m_seg_fd[i]))
+            res = -2;
+    }
+    if(0 == res)
+        _this->m_data_fd = data_fd;
+    pthread_mutex_unlock(&_this->m_ckpt_mutex);
+    return res;
+}
+
+/*
+@func:
+    后台检查点线程
+
+@para:
+    arg : 私有成员
+
+@return:
+    None.
+*/
+static void* wal_checkpoint_thread(void *arg)
+{
+    wal_t *wal = (wal_t *)arg;
+    wal_private_t *_this = get_private_member(wal);
+
+    pthread_mutex_lock(&_this->m_mutex);
+    while(!_this->m_stop)
+    {
+        if(!_this->m_ckpt_request)
+        {
+            pthread_cond_wait(&_this->m_ckpt_cond, &_this->m_mutex);
+            continue;
+        }
+        pthread_mutex_unlock(&_this->m_mutex);
+        wal_checkpoint(wal);
+        pthread_mutex_lock(&_this->m_mutex);
+    }
+    pthread_mutex_unlock(&_this->m_mutex);
+    return NULL;
+}
+
+/*
+@func:
+    执行最后一次检查点并销毁日志
+
+@para:
+    wal : 日志指针
+
+@return:
+    None.
+*/
+static void wal_destory(wal_t **wal)
+{
+    if(NULL == wal || NULL == *wal) return;
+
+    wal_t *log = *wal;
+    wal_private_t *_this = get_private_member(log);
+
+    pthread_mutex_lock(&_this->m_mutex);
+    _this->m_stop = true;
+    pthread_cond_signal(&_this->m_ckpt_cond);
+    pthread_mutex_unlock(&_this->m_mutex);
+    pthread_join(_this->m_ckpt_thread, NULL);
+
+    wal_checkpoint(log);
+
+    for(int i = 0; i < WAL_SEG_CNT; ++i)
+    {
+        if(_this->m_seg_fd[i] >= 0)
+            close(_this->m_seg_fd[i]);
+    }
+
+    pthread_mutex_destroy(&_this->m_mutex);
+    pthread_mutex_destroy(&_this->m_ckpt_mutex);
+    pthread_cond_destroy(&_this->m_flush_cond);
+    pthread_cond_destroy(&_this->m_ckpt_cond);
+
+    free(_this->m_op_buf);
+    free(_this->m_buf);
+    free(_this->m_flush_buf);
+    free(_this);
+    free(log);
+    *wal = NULL;
+}
+
+/*
+@func:
+    打开日志段文件并把未写入数据文件的操作重放到数据文件中
+
+@para:
+    _this : 私有成员
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    两个日志段按段头中的起始日志序号先后重放，重放是幂等的，重复重放已写入数据文件的日志段不影响结果
+*/
+static int wal_recover(wal_private_t *_this)
+{
+    int64_t base_lsn[WAL_SEG_CNT];
+
+    for(int i = 0; i < WAL_SEG_CNT; ++i)
+    {
+        _this->m_seg_fd[i] = open(_this->m_seg_path[i], O_RDWR | O_CREAT, 0666);
+        if(_this->m_seg_fd[i] < 0)
+            return -1;
+
+        _this->m_seg_size[i] = lseek(_this->m_seg_fd[i], 0, SEEK_END);
+        base_lsn[i] = -1;
+
+        wal_seg_head_t head;
+        if(_this->m_seg_size[i] >= (off_t)sizeof(head) && 0 == wal_pread(_this->m_seg_fd[i], &head, sizeof(head), 0)
+            && 0 == memcmp(head.magic, WAL_SEG_MAGIC, sizeof(head.magic)))
+        {
+            base_lsn[i] = head.base_lsn;
+        }
+    }
+
+    int first = (base_lsn[0] >= 0 && (base_lsn[1] < 0 || base_lsn[0] <= base_lsn[1])) ? 0 : 1;
+    int64_t max_lsn = 0;
+    bool replayed = false;
+    for(int n = 0; n < WAL_SEG_CNT; ++n)
+    {
+        int seg = (first + n) % WAL_SEG_CNT;
+        if(base_lsn[seg] < 0) continue;
+
+        if(base_lsn[seg] - 1 > max_lsn)
+            max_lsn = base_lsn[seg] - 1;
+        if(0 != wal_replay_segment(_this, seg, &max_lsn))
+            return -2;
+        replayed = true;
+    }
+
+    if(replayed && 0 != fdatasync(_this->m_data_fd))
+        return -3;
+
+    for(int i = 0; i < WAL_SEG_CNT; ++i)
+    {
+        if(0 != ftruncate(_this->m_seg_fd[i], 0))
+            return -4;
+        _this->m_seg_size[i] = 0;
+    }
+
+    _this->m_next_lsn = max_lsn;
+    _this->m_buf_lsn = max_lsn;
+    _this->m_written_lsn = max_lsn;
+    _this->m_durable_lsn = max_lsn;
+    _this->m_active = 0;
+
+    return wal_write_seg_head(_this, 0, max_lsn + 1);
+}
+
+/*
+@func:
+    删除数据文件对应的日志段文件
+
+@para:
+    path : 数据文件路径
+
+@return:
+    None.
+*/
+void wal_remove(const char *path)
+{
+    char seg_path[160];
+
+    if(NULL == path) return;
+
+    for(int i = 0; i < WAL_SEG_CNT; ++i)
+    {
+        snprintf(seg_path, sizeof(seg_path), "%s.wal%d", path, i);
+        unlink(seg_path);
+    }
+}
+
+/*
+@func:
+    打开数据文件对应的预写日志
+
+@para:
+    path : 数据文件路径，日志段文件为 path.wal0 与 path.wal1
+    data_fd : 数据文件描述符
+    sync_on_commit : true 提交后等待组提交落盘， false 仅写入日志文件不主动同步
+    checkpoint_size : 日志段超过该大小（字节）时触发检查点，<= 0 使用默认值
+
+@return:
+    wal_t* : NULL 失败， other 日志指针
+*/
+wal_t* wal_create(const char *path, int data_fd, bool sync_on_commit, long checkpoint_size)
+{
+    if(NULL == path || data_fd < 0) return NULL;
+
+    wal_t *wal = (wal_t *)malloc(sizeof(wal_t));
+    wal_private_t *_this = (wal_private_t *)malloc(sizeof(wal_private_t));
+    if(NULL == wal || NULL == _this)
+    {
+        free(wal);
+        free(_this);
+        return NULL;
+    }
+    memset(wal, 0, sizeof(wal_t));
+    memset(_this, 0, sizeof(wal_private_t));
+
+    for(int i = 0; i < WAL_SEG_CNT; ++i)
+    {
+        snprintf(_this->m_seg_path[i], sizeof(_this->m_seg_path[i]), "%s.wal%d", path, i);
+        _this->m_seg_fd[i] = -1;
+    }
+    _this->m_data_fd = data_fd;
+    _this->m_sync_on_commit = sync_on_commit;
+    _this->m_checkpoint_size = checkpoint_size > 0 ? checkpoint_size : WAL_DEFAULT_CHECKPOINT_SIZE;
+
+    pthread_mutex_init(&_this->m_mutex, NULL);
+    pthread_mutex_init(&_this->m_ckpt_mutex, NULL);
+    pthread_cond_init(&_this->m_flush_cond, NULL);
+    pthread_cond_init(&_this->m_ckpt_cond, NULL);
+
+    wal->_this = wal;
+    wal->_private_ = (void *)_this;
+    wal->write = wal_write;
+    wal->truncate = wal_truncate;
+    wal->commit = wal_commit;
+    wal->rollback = wal_rollback;
+    wal->sync = wal_sync;
+    wal->sync_all = wal_sync_all;
+    wal->checkpoint = wal_checkpoint;
+    wal->switch_data_file = wal_switch_data_file;
+    wal->destory = wal_destory;
+
+    if(0 != wal_recover(_this) || 0 != pthread_create(&_this->m_ckpt_thread, NULL, wal_checkpoint_thread, wal))
+    {
+        WAL_LOG_DEBUG("wal recover error");
+        for(int i = 0; i < WAL_SEG_CNT; ++i)
+        {
+            if(_this->m_seg_fd[i] >= 0)
+                close(_this->m_seg_fd[i]);
+        }
+        pthread_mutex_destroy(&_this->m_mutex);
+        pthread_mutex_destroy(&_this->m_ckpt_mutex);
+        pthread_cond_destroy(&_this->m_flush_cond);
+        pthread_cond_destroy(&_this->m_ckpt_cond);
+        free(_this);
+        free(wal);
+        return NULL;
+    }
+
+    return wal;
+}
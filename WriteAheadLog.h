@@ -0,0 +1,199 @@
+/*
+** File : WriteAheadLog.h
+** Author : Saury
+** Date : 2020-09-12
+*/
+
+#ifndef _WRITE_AHEAD_LOG_H_
+#define _WRITE_AHEAD_LOG_H_
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+typedef struct _wal wal_t;
+
+/*
+    日志文件结构（两个日志段 path.wal0 / path.wal1 交替使用）：
+    +--------+-------+----------+----------+-------+
+    |  段头  | 操作1 | 写入项1  | 写入项2  |  ...  |
+    +--------+-------+----------+----------+-------+
+
+    每个操作由一次修改产生的全部物理写入组成，带有校验值，重放时以操作为单位保证原子性
+*/
+
+struct _wal
+{
+    wal_t *_this;
+    void *_private_;    // 私有成员
+
+/*
+@func:
+    暂存一次对数据文件的写入，属于当前未提交的操作
+
+@para:
+    wal : 日志指针
+    buf : 写入的数据
+    len : 数据长度
+    offset : 数据文件中的偏移量
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    write / truncate / commit / rollback 需由调用者保证串行调用
+*/
+    int (*write)(wal_t *wal, const void *buf, int len, off_t offset);
+
+/*
+@func:
+    暂存一次对数据文件的截断，属于当前未提交的操作
+
+@para:
+    wal : 日志指针
+    length : 截断后的文件长度
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    None.
+*/
+    int (*truncate)(wal_t *wal, off_t length);
+
+/*
+@func:
+    提交当前操作，将暂存的写入作为一个整体追加到日志缓冲区
+
+@para:
+    wal : 日志指针
+
+@return:
+    long long : < 0 : 失败， other ： 该操作的日志序号，用于 sync
+
+@note:
+    None.
+*/
+    long long (*commit)(wal_t *wal);
+
+/*
+@func:
+    丢弃当前操作暂存的全部写入
+
+@para:
+    wal : 日志指针
+
+@return:
+    None.
+
+@note:
+    None.
+*/
+    void (*rollback)(wal_t *wal);
+
+/*
+@func:
+    按照持久化策略等待指定序号的操作落盘
+
+@para:
+    wal : 日志指针
+    lsn : commit 返回的日志序号
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    组提交模式下，并发调用者会被合并为一次写入和一次 fdatasync
+*/
+    int (*sync)(wal_t *wal, long long lsn);
+
+/*
+@func:
+    把已提交的全部操作写入日志并落盘
+
+@para:
+    wal : 日志指针
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    与持久化策略无关，总是 fdatasync；上次落盘之后没有新的提交时直接返回。用于定时同步
+*/
+    int (*sync_all)(wal_t *wal);
+
+/*
+@func:
+    执行检查点，把日志中的操作写入数据文件并清空日志
+
+@para:
+    wal : 日志指针
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    日志超过检查点大小时后台线程会自动执行，一般无需手动调用
+*/
+    int (*checkpoint)(wal_t *wal);
+
+/*
+@func:
+    执行检查点后把日志切换到新的数据文件
+
+@para:
+    wal : 日志指针
+    data_fd : 新数据文件的文件描述符
+
+@return:
+    int : < 0 : 失败， 0 ： 成功
+
+@note:
+    用于整理后替换数据文件，调用期间不能有新的提交
+*/
+    int (*switch_data_file)(wal_t *wal, int data_fd);
+
+/*
+@func:
+    执行最后一次检查点并销毁日志
+
+@para:
+    wal : 日志指针
+
+@return:
+    None.
+
+@note:
+    None.
+*/
+    void (*destory)(wal_t **wal);
+};
+
+
+/*
+@func:
+    打开数据文件对应的预写日志，并把上次未写入数据文件的操作重放到数据文件中
+
+@para:
+    path : 数据文件路径，日志段文件为 path.wal0 与 path.wal1
+    data_fd : 数据文件描述符，检查点与重放都写入该文件
+    group_commit : true 提交后等待组提交落盘， false 仅写入日志文件不主动同步
+    checkpoint_size : 日志段超过该大小（字节）时触发检查点，<= 0 使用默认值
+
+@return:
+    wal_t* : NULL 失败， other 日志指针
+*/
+extern wal_t* wal_create(const char *path, int data_fd, bool group_commit, long checkpoint_size);
+
+/*
+@func:
+    删除数据文件对应的日志段文件
+
+@para:
+    path : 数据文件路径
+
+@return:
+    None.
+*/
+extern void wal_remove(const char *path);
+
+#endif /* end #ifndef _WRITE_AHEAD_LOG_H_ */
@@ -0,0 +1,449 @@
+/*
+** File : bench.c
+** Author : Saury
+** Date : 2020-09-12
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include "FileDatabase.h"
+#include "AVLTree.h"
+#include "BPlusTree.h"
+#include "HashIndex.h"
+#include "DenseIndex.h"
+#include "FrozenIndex.h"
+
+/*
+    性能测试：bench [用例] [元素个数]，不指定用例时运行全部用例
+    query : 多个线程并发查询，以及同时有一个线程在修改时的查询吞吐量
+    index : 各索引引擎的插入、按键值查找与按顺序扫描的耗时
+    io : pwrite 与 io_uring 写入方式下每个操作的耗时与系统调用次数，
+         系统调用次数需要链接时使用 --wrap 替换 pwrite / ftruncate / syscall（定义 BENCH_COUNT_SYSCALLS）
+    数据库文件 bench.db 建立在当前目录下，测试结束后删除
+*/
+
+#define BENCH_FILE_DB "bench.db"
+#define BENCH_DEFAULT_CNT 200000
+#define BENCH_MAX_THREADS 8
+
+typedef struct _bench_data
+{
+    int key;
+    char value[60];
+}bench_data_t;
+
+static int get_key(void *ele)
+{
+    return ((bench_data_t*)ele)->key;
+}
+
+static double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+@func:
+    打开空的测试数据库并批量写入 0 ... cnt - 1 共 cnt 个元素
+
+@para:
+    cnt : 元素个数
+    option : 打开选项，NULL 时使用默认选项
+
+@return:
+    file_db_t* : NULL 失败， other 文件数据库指针
+*/
+static file_db_t* bench_open(int cnt, const file_db_option_t* option)
+{
+    int head = 1;
+    unlink(BENCH_FILE_DB);
+    file_db_t* db = file_db_init_ex(BENCH_FILE_DB, sizeof(head), sizeof(bench_data_t), get_key, &head, option);
+    bench_data_t* eles = (bench_data_t*)calloc(cnt > 0 ? cnt : 1, sizeof(bench_data_t));
+    if(NULL == db || NULL == eles)
+    {
+        printf("open bench db error\r\n");
+        free(eles);
+        if(NULL != db)
+            db->destory(db);
+        return NULL;
+    }
+    for(int i = 0; i < cnt; ++i)
+        eles[i].key = i;
+    if(cnt != db->add_batch(db, eles, cnt, NULL))
+    {
+        printf("add bench data error\r\n");
+        free(eles);
+        db->destory(db);
+        return NULL;
+    }
+    free(eles);
+    return db;
+}
+
+typedef struct _bench_query_arg
+{
+    file_db_t* db;
+    int cnt;                // 元素个数
+    int ops;                // 每个线程的查询次数
+    unsigned seed;
+    int* stop;              // 修改线程的结束标志
+}bench_query_arg_t;
+
+static void* bench_query_thread(void* arg)
+{
+    bench_query_arg_t* query = (bench_query_arg_t*)arg;
+    for(int i = 0; i < query->ops; ++i)
+    {
+        if(NULL == query->db->query(query->db, rand_r(&query->seed) % query->cnt))
+            printf("query error\r\n");
+    }
+    return NULL;
+}
+
+static void* bench_edit_thread(void* arg)
+{
+    bench_query_arg_t* edit = (bench_query_arg_t*)arg;
+    bench_data_t ele;
+    memset(&ele, 0, sizeof(ele));
+    while(!__atomic_load_n(edit->stop, __ATOMIC_RELAXED))
+    {
+        ele.key = rand_r(&edit->seed) % edit->cnt;
+        edit->db->edit(edit->db, ele.key, &ele);
+    }
+    return NULL;
+}
+
+/*
+    1 ... BENCH_MAX_THREADS 个线程共执行 cnt * 5 次随机查询；第二轮测试中另有一个线程不停地编辑元素
+*/
+static int bench_query(int cnt)
+{
+    file_db_t* db = bench_open(cnt, NULL);
+    if(NULL == db)
+        return -1;
+
+    printf("query: %d elements, %ld cpus\r\n", cnt, sysconf(_SC_NPROCESSORS_ONLN));
+    for(int writer = 0; writer < 2; ++writer)
+    {
+        for(int threads = 1; threads <= BENCH_MAX_THREADS; threads *= 2)
+        {
+            pthread_t tids[BENCH_MAX_THREADS + 1];
+            bench_query_arg_t args[BENCH_MAX_THREADS + 1];
+            int stop = 0;
+            int ops = cnt * 5 / threads;
+            for(int i = 0; i <= threads; ++i)
+            {
+                args[i].db = db;
+                args[i].cnt = cnt;
+                args[i].ops = ops;
+                args[i].seed = i + 1;
+                args[i].stop = &stop;
+            }
+
+            if(writer)
+                pthread_create(&tids[threads], NULL, bench_edit_thread, &args[threads]);
+            double begin = bench_now();
+            for(int i = 0; i < threads; ++i)
+                pthread_create(&tids[i], NULL, bench_query_thread, &args[i]);
+            for(int i = 0; i < threads; ++i)
+                pthread_join(tids[i], NULL);
+            double elapsed = bench_now() - begin;
+            __atomic_store_n(&stop, 1, __ATOMIC_RELAXED);
+            if(writer)
+                pthread_join(tids[threads], NULL);
+
+            printf("  readers %d%s: %8.0f queries/s\r\n", threads, writer ? " + 1 writer" : "", (double)ops * threads / elapsed);
+        }
+    }
+
+    db->destory(db);
+    return 0;
+}
+
+/*
+    索引中的记录与文件数据库中的相同：数据文件中的偏移量加上键值
+*/
+typedef struct _bench_record
+{
+    long long offset;
+    int key;
+    int pad;
+}bench_record_t;
+
+static int get_record_key(void *ele)
+{
+    return ((bench_record_t*)ele)->key;
+}
+
+static bool bench_scan_visit(void* ele, void* arg)
+{
+    *(long long*)arg += ((bench_record_t*)ele)->key;
+    return true;
+}
+
+// 与文件数据库相同，avl 树的节点内嵌元素
+static avl_tree_t* bench_avl_create(int element_size, int (*pf_hash_func)(void *), int (*pf_free_element_func)(void *), bool thread_safe)
+{
+    return avl_tree_create_ex(element_size, pf_hash_func, pf_free_element_func, thread_safe, true);
+}
+
+static void bench_shuffle(int* keys, int cnt, unsigned* seed)
+{
+    for(int i = cnt - 1; i > 0; --i)
+    {
+        int j = rand_r(seed) % (i + 1);
+        int tmp = keys[i];
+        keys[i] = keys[j];
+        keys[j] = tmp;
+    }
+}
+
+/*
+    键值为 0 ... cnt - 1 的随机排列；冻结索引只能一次构建，插入时间为 build_sorted 的耗时；
+    哈希索引不支持按顺序扫描
+*/
+static int bench_index(int cnt)
+{
+    const char* names[] = {"avl", "bplus", "hash", "dense", "frozen"};
+    avl_tree_t* (*creates[])(int, int (*)(void *), int (*)(void *), bool) = {
+        bench_avl_create, bplus_tree_create, hash_index_create, dense_index_create, frozen_index_create};
+    const int scan_rounds = 5;
+
+    int* keys = (int*)malloc(sizeof(int) * cnt);
+    bench_record_t* records = (bench_record_t*)calloc(cnt, sizeof(bench_record_t));
+    if(NULL == keys || NULL == records)
+    {
+        free(keys);
+        free(records);
+        return -1;
+    }
+    for(int i = 0; i < cnt; ++i)
+    {
+        keys[i] = i;
+        records[i].key = i;
+    }
+
+    printf("index: %d elements\r\n", cnt);
+    for(int e = 0; e < (int)(sizeof(names) / sizeof(names[0])); ++e)
+    {
+        avl_tree_t* tree = creates[e](sizeof(bench_record_t), get_record_key, NULL, false);
+        if(NULL == tree)
+        {
+            printf("create %s index error\r\n", names[e]);
+            continue;
+        }
+
+        unsigned seed = 1;
+        bench_shuffle(keys, cnt, &seed);
+        double begin = bench_now();
+        if(0 == strcmp(names[e], "frozen"))
+        {
+            tree->build_sorted(tree, records, cnt);
+        }
+        else
+        {
+            bench_record_t record;
+            memset(&record, 0, sizeof(record));
+            for(int i = 0; i < cnt; ++i)
+            {
+                record.key = keys[i];
+                tree->add(tree, &record);
+            }
+        }
+        double insert = bench_now() - begin;
+
+        bench_shuffle(keys, cnt, &seed);
+        long long sum = 0;
+        begin = bench_now();
+        for(int i = 0; i < cnt; ++i)
+        {
+            bench_record_t* record = (bench_record_t*)tree->query_by_key(tree, keys[i]);
+            sum += NULL != record ? record->offset : -1;
+        }
+        double lookup = bench_now() - begin;
+
+        begin = bench_now();
+        int scan_res = 0;
+        for(int i = 0; i < scan_rounds && scan_res >= 0; ++i)
+            scan_res = tree->range(tree, 0, cnt, bench_scan_visit, &sum);
+        double scan = bench_now() - begin;
+
+        if(scan_res >= 0)
+            printf("  %-6s insert %6.0f ns/op  lookup %6.0f ns/op  scan %6.1f ns/elem\r\n", names[e],
+                insert * 1e9 / cnt, lookup * 1e9 / cnt, scan * 1e9 / ((double)scan_rounds * cnt));
+        else
+            printf("  %-6s insert %6.0f ns/op  lookup %6.0f ns/op  scan      - \r\n", names[e],
+                insert * 1e9 / cnt, lookup * 1e9 / cnt);
+        if(sum < 0)
+            printf("  %s lookup miss\r\n", names[e]);
+        tree->destory(&tree);
+    }
+
+    free(records);
+    free(keys);
+    return 0;
+}
+
+static long bench_pwrite_cnt;
+static long bench_truncate_cnt;
+static long bench_enter_cnt;
+
+#ifdef BENCH_COUNT_SYSCALLS
+ssize_t __real_pwrite(int fd, const void* buf, size_t len, off_t offset);
+int __real_ftruncate(int fd, off_t length);
+long __real_syscall(long number, ...);
+
+ssize_t __wrap_pwrite(int fd, const void* buf, size_t len, off_t offset)
+{
+    __atomic_add_fetch(&bench_pwrite_cnt, 1, __ATOMIC_RELAXED);
+    return __real_pwrite(fd, buf, len, offset);
+}
+
+int __wrap_ftruncate(int fd, off_t length)
+{
+    __atomic_add_fetch(&bench_truncate_cnt, 1, __ATOMIC_RELAXED);
+    return __real_ftruncate(fd, length);
+}
+
+// io_uring 的系统调用都不超过 6 个参数
+long __wrap_syscall(long number, ...)
+{
+    long args[6];
+    va_list ap;
+    va_start(ap, number);
+    for(int i = 0; i < 6; ++i)
+        args[i] = va_arg(ap, long);
+    va_end(ap);
+
+    if(__NR_io_uring_enter == number)
+        __atomic_add_fetch(&bench_enter_cnt, 1, __ATOMIC_RELAXED);
+    return __real_syscall(number, args[0], args[1], args[2], args[3], args[4], args[5]);
+}
+#endif /* end #ifdef BENCH_COUNT_SYSCALLS */
+
+static void bench_io_report(const char* name, int cnt, double begin)
+{
+    double elapsed = bench_now() - begin;
+#ifdef BENCH_COUNT_SYSCALLS
+    printf("    %-10s %7.0f ns/op  syscalls/op %.3f (pwrite %.3f, ftruncate %.3f, io_uring_enter %.3f)\r\n", name, elapsed * 1e9 / cnt,
+        (double)(bench_pwrite_cnt + bench_truncate_cnt + bench_enter_cnt) / cnt,
+        (double)bench_pwrite_cnt / cnt, (double)bench_truncate_cnt / cnt, (double)bench_enter_cnt / cnt);
+#else
+    printf("    %-10s %7.0f ns/op\r\n", name, elapsed * 1e9 / cnt);
+#endif
+    bench_pwrite_cnt = bench_truncate_cnt = bench_enter_cnt = 0;
+}
+
+/*
+    默认模式与空闲列表模式下分别用两种写入方式逐个添加、编辑、批量添加与逐个删除 cnt 个元素；
+    内核不支持 io_uring 时数据库退回 pwrite，两行结果相同
+*/
+static int bench_io(int cnt)
+{
+    const int batch = 1000;
+    bench_data_t* eles = (bench_data_t*)calloc(batch, sizeof(bench_data_t));
+    if(NULL == eles)
+        return -1;
+
+    printf("io: %d elements\r\n", cnt);
+    for(int free_list = 0; free_list < 2; ++free_list)
+    {
+        for(int io = FILE_DB_IO_PWRITE; io <= FILE_DB_IO_URING; ++io)
+        {
+            file_db_option_t option;
+            memset(&option, 0, sizeof(option));
+            option.free_list = free_list;
+            option.io = (file_db_io_t)io;
+            file_db_t* db = bench_open(0, &option);
+            if(NULL == db)
+            {
+                free(eles);
+                return -1;
+            }
+            printf("  %s, %s\r\n", FILE_DB_IO_URING == io ? "io_uring" : "pwrite", free_list ? "free list" : "default");
+
+            bench_data_t ele;
+            memset(&ele, 0, sizeof(ele));
+            // 不统计打开数据库时的系统调用
+            bench_pwrite_cnt = bench_truncate_cnt = bench_enter_cnt = 0;
+            double begin = bench_now();
+            for(int i = 0; i < cnt; ++i)
+            {
+                ele.key = i;
+                db->add(db, &ele);
+            }
+            bench_io_report("add", cnt, begin);
+
+            begin = bench_now();
+            for(int i = 0; i < cnt; ++i)
+            {
+                ele.key = i;
+                ele.value[0] = 1;
+                db->edit(db, i, &ele);
+            }
+            bench_io_report("edit", cnt, begin);
+
+            int batch_cnt = 0;
+            begin = bench_now();
+            for(int i = 0; i < cnt; i += batch, batch_cnt += batch)
+            {
+                for(int j = 0; j < batch; ++j)
+                    eles[j].key = cnt + i + j;
+                db->add_batch(db, eles, batch, NULL);
+            }
+            bench_io_report("add_batch", batch_cnt, begin);
+
+            begin = bench_now();
+            for(int i = 0; i < cnt; ++i)
+                db->del(db, i);
+            bench_io_report("del", cnt, begin);
+
+            db->destory(db);
+        }
+    }
+
+    free(eles);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    const char* name = argc > 1 ? argv[1] : "all";
+    int cnt = argc > 2 ? atoi(argv[2]) : BENCH_DEFAULT_CNT;
+    if(cnt <= 0)
+        cnt = BENCH_DEFAULT_CNT;
+
+    int res = 0;
+    bool all = 0 == strcmp(name, "all");
+    bool found = all;
+    if(all || 0 == strcmp(name, "query"))
+    {
+        found = true;
+        res |= bench_query(cnt);
+    }
+    if(all || 0 == strcmp(name, "index"))
+    {
+        found = true;
+        res |= bench_index(cnt);
+    }
+    if(all || 0 == strcmp(name, "io"))
+    {
+        found = true;
+        res |= bench_io(cnt);
+    }
+
+    if(!found)
+    {
+        printf("usage: %s [all|query|index|io] [count]\r\n", argv[0]);
+        return -1;
+    }
+    return res;
+}
@@ -0,0 +1,347 @@
+/*
+** File : test_background_load.c
+** Author : Saury
+** Date : 2020-09-12
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "FileDatabase.h"
+#include "FileDatabaseShard.h"
+#include "test_util.h"
+
+/*
+    后台加载：加载期间的查询直接探测数据文件，结果需与加载完成后一致；
+    加载时删除重复记录不能与探测同时进行；加载失败后修改操作返回 -11
+*/
+
+#define TEST_FILE_DB "test_background_load.db"
+#define TEST_CNT 50000
+#define TEST_KEY_RANGE (2 * TEST_CNT)
+#define TEST_READERS 3
+
+static file_db_t* test_db;
+static char test_ref[TEST_KEY_RANGE];   // 键值是否存在
+static int test_lazy;
+static int test_slow;                   // 加载时放慢获取键值，让查询有机会在加载期间执行
+static int test_probe_cnt;              // 加载期间执行的查询次数
+
+static pthread_mutex_t test_ready_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int test_ready_cnt;
+static int test_ready_res;
+static file_db_t* test_ready_db;
+
+static int test_slow_get_key(void *ele)
+{
+    if(__atomic_load_n(&test_slow, __ATOMIC_RELAXED))
+    {
+        for(volatile int i = 0; i < 100; ++i);
+    }
+    return ((test_data_t*)ele)->key;
+}
+
+static void test_on_ready(file_db_t* db, int res, void* arg)
+{
+    TEST_CHECK(arg == (void*)&test_ready_cnt);
+    pthread_mutex_lock(&test_ready_mutex);
+    test_ready_cnt++;
+    test_ready_res = res;
+    test_ready_db = db;
+    pthread_mutex_unlock(&test_ready_mutex);
+}
+
+static void test_check_ele(test_data_t* ele, int key)
+{
+    if(test_ref[key])
+    {
+        TEST_CHECK(NULL != ele && key == ele->key && (char)key == ele->value[0]);
+        if(test_lazy)
+            test_db->unpin(test_db, ele);
+    }
+    else
+    {
+        TEST_CHECK(NULL == ele);
+    }
+}
+
+static void* test_reader(void* arg)
+{
+    unsigned seed = (unsigned)(long)arg;
+    int keys[8];
+    void* eles[8];
+    for(int i = 0; i < 300; ++i)
+    {
+        bool loading = 1 == test_db->ready(test_db);
+        if(i % 2)
+        {
+            int key = rand_r(&seed) % TEST_KEY_RANGE;
+            void* ele = test_lazy ? test_db->pin(test_db, key) : test_db->query(test_db, key);
+            test_check_ele((test_data_t*)ele, key);
+        }
+        else
+        {
+            // 批量查询中包含重复的键值
+            int cnt = rand_r(&seed) % 8;
+            int expect = 0;
+            for(int j = 0; j < cnt; ++j)
+            {
+                keys[j] = (j > 0 && 0 == rand_r(&seed) % 4) ? keys[0] : rand_r(&seed) % TEST_KEY_RANGE;
+                expect += test_ref[keys[j]];
+            }
+            int found = test_lazy ? test_db->pin_batch(test_db, keys, cnt, eles) : test_db->query_batch(test_db, keys, cnt, eles);
+            TEST_CHECK(expect == found);
+            for(int j = 0; j < cnt; ++j)
+                test_check_ele((test_data_t*)eles[j], keys[j]);
+        }
+        if(loading)
+            __atomic_add_fetch(&test_probe_cnt, 1, __ATOMIC_RELAXED);
+    }
+    return NULL;
+}
+
+static file_db_t* test_open(bool shard, const file_db_option_t* option)
+{
+    int head = 1;
+    if(shard)
+        return file_db_shard_init(TEST_FILE_DB, 4, sizeof(head), sizeof(test_data_t), test_slow_get_key, &head, option);
+    return file_db_init_ex(TEST_FILE_DB, sizeof(head), sizeof(test_data_t), test_slow_get_key, &head, option);
+}
+
+/*
+    写入并删除部分元素后以后台加载方式重新打开，加载期间多个线程并发查询
+*/
+static void test_probe(const char* name, bool shard, file_db_option_t option)
+{
+    test_remove_files(TEST_FILE_DB);
+    test_lazy = option.lazy;
+    test_db = test_open(shard, &option);
+    TEST_CHECK(NULL != test_db);
+
+    memset(test_ref, 0, sizeof(test_ref));
+    test_data_t* eles = (test_data_t*)calloc(TEST_CNT, sizeof(test_data_t));
+    TEST_CHECK(NULL != eles);
+    for(int i = 0; i < TEST_CNT; ++i)
+    {
+        eles[i].key = (int)((long long)i * 7919 % TEST_KEY_RANGE);
+        eles[i].value[0] = (char)eles[i].key;
+        test_ref[eles[i].key] = 1;
+    }
+    TEST_CHECK(TEST_CNT == test_db->add_batch(test_db, eles, TEST_CNT, NULL));
+    free(eles);
+    srand(1);
+    for(int i = 0; i < TEST_CNT / 4; ++i)
+    {
+        int key = rand() % TEST_KEY_RANGE;
+        if(test_ref[key])
+        {
+            TEST_CHECK(0 == test_db->del(test_db, key));
+            test_ref[key] = 0;
+        }
+    }
+    int cnt = 0;
+    for(int i = 0; i < TEST_KEY_RANGE; ++i)
+        cnt += test_ref[i];
+    TEST_CHECK(0 == test_db->ready(test_db) && 0 == test_db->wait_ready(test_db));
+    test_db->free(test_db);
+
+    option.background_load = true;
+    option.on_ready = test_on_ready;
+    option.on_ready_arg = &test_ready_cnt;
+    test_ready_cnt = 0;
+    test_probe_cnt = 0;
+    __atomic_store_n(&test_slow, 1, __ATOMIC_RELAXED);
+    test_db = test_open(shard, &option);
+    TEST_CHECK(NULL != test_db);
+
+    pthread_t readers[TEST_READERS];
+    for(long i = 0; i < TEST_READERS; ++i)
+        pthread_create(&readers[i], NULL, test_reader, (void*)(i + 1));
+    for(int i = 0; i < TEST_READERS; ++i)
+        pthread_join(readers[i], NULL);
+    TEST_CHECK(0 == test_db->wait_ready(test_db));
+    __atomic_store_n(&test_slow, 0, __ATOMIC_RELAXED);
+
+    // 回调在加载线程释放写锁后调用，可能晚于 wait_ready 返回
+    test_data_t ele;
+    memset(&ele, 0, sizeof(ele));
+    ele.key = TEST_KEY_RANGE + 1;
+    TEST_CHECK(0 == test_db->add(test_db, &ele));
+    TEST_CHECK(cnt + 1 == test_db->size(test_db));
+    test_db->free(test_db);
+    pthread_mutex_lock(&test_ready_mutex);
+    TEST_CHECK(1 == test_ready_cnt && 0 == test_ready_res && test_ready_db == test_db);
+    pthread_mutex_unlock(&test_ready_mutex);
+
+    // 加载期间直接释放
+    __atomic_store_n(&test_slow, 1, __ATOMIC_RELAXED);
+    test_db = test_open(shard, &option);
+    TEST_CHECK(NULL != test_db);
+    test_db->destory(test_db);
+    __atomic_store_n(&test_slow, 0, __ATOMIC_RELAXED);
+
+    printf("%s ok, %d lookups during load\r\n", name, test_probe_cnt);
+}
+
+static void* test_dedup_reader(void* arg)
+{
+    unsigned seed = (unsigned)(long)arg;
+    while(1 == test_db->ready(test_db))
+    {
+        int key = rand_r(&seed) % TEST_CNT;
+        if(key % 2)
+        {
+            // read 在探测注销之前完成拷贝
+            test_data_t copy;
+            TEST_CHECK(0 == test_db->read(test_db, key, &copy) && key == copy.key && key == atoi(copy.value));
+            continue;
+        }
+        test_data_t* ele = test_lazy ? test_db->pin(test_db, key) : test_db->query(test_db, key);
+        TEST_CHECK(NULL != ele && key == ele->key && key == atoi(ele->value));
+        if(test_lazy)
+            test_db->unpin(test_db, ele);
+    }
+    return NULL;
+}
+
+/*
+    在文件末尾追加重复的记录，加载时删除这些记录，同时有查询在探测数据文件
+*/
+static void test_dedup(const char* name, file_db_option_t option)
+{
+    const int dup_cnt = TEST_CNT / 10;
+    int head = 1;
+    test_remove_files(TEST_FILE_DB);
+    test_lazy = option.lazy;
+    test_db = file_db_init_ex(TEST_FILE_DB, sizeof(head), sizeof(test_data_t), test_get_key, &head, &option);
+    TEST_CHECK(NULL != test_db);
+    test_data_t* eles = (test_data_t*)calloc(TEST_CNT, sizeof(test_data_t));
+    TEST_CHECK(NULL != eles);
+    for(int i = 0; i < TEST_CNT; ++i)
+    {
+        eles[i].key = i;
+        snprintf(eles[i].value, sizeof(eles[i].value), "%d", i);
+    }
+    TEST_CHECK(TEST_CNT == test_db->add_batch(test_db, eles, TEST_CNT, NULL));
+    test_db->free(test_db);
+
+    // 数据文件：文件头、记录数量、记录依次存放
+    int fd = open(TEST_FILE_DB, O_RDWR);
+    TEST_CHECK(fd >= 0);
+    for(int i = 0; i < dup_cnt; ++i)
+    {
+        test_data_t dup = eles[i * 7];
+        strcpy(dup.value, "dup");
+        off_t offset = sizeof(head) + sizeof(int) + (off_t)(TEST_CNT + i) * sizeof(test_data_t);
+        TEST_CHECK((ssize_t)sizeof(dup) == pwrite(fd, &dup, sizeof(dup), offset));
+    }
+    int cnt = TEST_CNT + dup_cnt;
+    TEST_CHECK((ssize_t)sizeof(cnt) == pwrite(fd, &cnt, sizeof(cnt), sizeof(head)));
+    close(fd);
+    free(eles);
+
+    option.background_load = true;
+    test_db = file_db_init_ex(TEST_FILE_DB, sizeof(head), sizeof(test_data_t), test_get_key, &head, &option);
+    TEST_CHECK(NULL != test_db);
+    pthread_t readers[TEST_READERS];
+    for(long i = 0; i < TEST_READERS; ++i)
+        pthread_create(&readers[i], NULL, test_dedup_reader, (void*)(i + 1));
+    for(int i = 0; i < TEST_READERS; ++i)
+        pthread_join(readers[i], NULL);
+    TEST_CHECK(0 == test_db->wait_ready(test_db));
+    TEST_CHECK(TEST_CNT == test_db->size(test_db));
+    for(int i = 0; i < TEST_CNT; ++i)
+    {
+        test_data_t ele;
+        TEST_CHECK(0 == test_db->read(test_db, i, &ele) && i == atoi(ele.value));
+    }
+    test_db->destory(test_db);
+    printf("%s ok\r\n", name);
+}
+
+/*
+    破坏空闲列表模式下的状态标记，后台加载失败后修改操作返回 -11，之后同步打开也失败
+*/
+static void test_load_fail(void)
+{
+    file_db_option_t option;
+    memset(&option, 0, sizeof(option));
+    option.free_list = true;
+    int head = 1;
+    test_remove_files(TEST_FILE_DB);
+    file_db_t* db = file_db_init_ex(TEST_FILE_DB, sizeof(head), sizeof(test_data_t), test_get_key, &head, &option);
+    TEST_CHECK(NULL != db);
+    test_data_t ele;
+    memset(&ele, 0, sizeof(ele));
+    for(int i = 0; i < 100; ++i)
+    {
+        ele.key = i;
+        TEST_CHECK(0 == db->add(db, &ele));
+    }
+    db->free(db);
+
+    // 空闲列表模式下每个记录前有 4 字节的状态标记
+    int fd = open(TEST_FILE_DB, O_RDWR);
+    TEST_CHECK(fd >= 0);
+    int bad_tag = 7;
+    off_t offset = sizeof(head) + sizeof(int) + 50 * (off_t)(sizeof(int32_t) + sizeof(test_data_t));
+    TEST_CHECK((ssize_t)sizeof(bad_tag) == pwrite(fd, &bad_tag, sizeof(bad_tag), offset));
+    close(fd);
+
+    option.background_load = true;
+    option.on_ready = test_on_ready;
+    option.on_ready_arg = &test_ready_cnt;
+    test_ready_cnt = 0;
+    db = file_db_init_ex(TEST_FILE_DB, sizeof(head), sizeof(test_data_t), test_get_key, &head, &option);
+    TEST_CHECK(NULL != db);
+    int res = db->wait_ready(db);
+    TEST_CHECK(res < 0 && res == db->ready(db));
+    ele.key = 1000;
+    TEST_CHECK(-11 == db->add(db, &ele));
+    TEST_CHECK(-11 == db->add_batch(db, &ele, 1, NULL));
+    TEST_CHECK(-11 == db->clear(db));
+    TEST_CHECK(0 == db->size(db) && NULL == db->query(db, 3));
+    db->free(db);
+    pthread_mutex_lock(&test_ready_mutex);
+    TEST_CHECK(1 == test_ready_cnt && res == test_ready_res);
+    pthread_mutex_unlock(&test_ready_mutex);
+
+    option.background_load = false;
+    option.on_ready = NULL;
+    TEST_CHECK(NULL == file_db_init_ex(TEST_FILE_DB, sizeof(head), sizeof(test_data_t), test_get_key, &head, &option));
+    test_remove_files(TEST_FILE_DB);
+    printf("load fail ok\r\n");
+}
+
+int main(void)
+{
+    file_db_option_t option;
+
+    memset(&option, 0, sizeof(option));
+    option.lazy = true;
+    test_probe("lazy", false, option);
+    test_probe("lazy shard", true, option);
+    test_dedup("lazy dedup", option);
+
+    memset(&option, 0, sizeof(option));
+    option.mmap = true;
+    test_probe("mmap", false, option);
+    test_dedup("mmap dedup", option);
+
+    memset(&option, 0, sizeof(option));
+    option.lazy = true;
+    option.free_list = true;
+    test_probe("lazy free list", false, option);
+
+    memset(&option, 0, sizeof(option));
+    option.mmap = true;
+    option.free_list = true;
+    option.compact = true;
+    test_probe("mmap free list compact", false, option);
+
+    test_load_fail();
+    return 0;
+}
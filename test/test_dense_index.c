@@ -0,0 +1,93 @@
+/*
+** File : test_dense_index.c
+** Author : Saury
+** Date : 2020-09-12
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <limits.h>
+#include "FileDatabase.h"
+#include "test_util.h"
+
+/*
+    稠密索引：键值跨度过大的添加失败时不能在数据文件中留下记录，重新打开后内容不变；
+    打开键值稀疏的已有文件时直接失败，不申请巨大的数组
+*/
+
+#define TEST_FILE_DB "test_dense_index.db"
+
+static file_db_t* test_open(file_db_index_t index, bool free_list)
+{
+    file_db_option_t option;
+    memset(&option, 0, sizeof(option));
+    option.index = index;
+    option.free_list = free_list;
+    int head = 1;
+    return file_db_init_ex(TEST_FILE_DB, sizeof(head), sizeof(test_data_t), test_get_key, &head, &option);
+}
+
+static void test_add_fail(bool free_list)
+{
+    test_remove_files(TEST_FILE_DB);
+    file_db_t* db = test_open(FILE_DB_INDEX_DENSE, free_list);
+    TEST_CHECK(NULL != db);
+    test_data_t ele;
+    memset(&ele, 0, sizeof(ele));
+    for(int key = 1; key <= 4; ++key)
+    {
+        ele.key = key;
+        TEST_CHECK(0 == db->add(db, &ele));
+    }
+    // 空闲列表模式下失败的添加复用被删除的位置
+    TEST_CHECK(0 == db->del(db, 2));
+
+    ele.key = INT_MAX;
+    TEST_CHECK(-3 == db->add(db, &ele));
+    TEST_CHECK(3 == db->size(db) && NULL == db->query(db, INT_MAX));
+    int status[2];
+    test_data_t eles[2];
+    memset(eles, 0, sizeof(eles));
+    eles[0].key = 5;
+    eles[1].key = INT_MIN;
+    TEST_CHECK(1 == db->add_batch(db, eles, 2, status) && 0 == status[0] && -3 == status[1]);
+    ele.key = 6;
+    TEST_CHECK(0 == db->add(db, &ele));
+    TEST_CHECK(5 == db->size(db));
+    db->free(db);
+
+    db = test_open(FILE_DB_INDEX_DENSE, free_list);
+    TEST_CHECK(NULL != db && 5 == db->size(db));
+    TEST_CHECK(NULL != db->query(db, 6) && NULL == db->query(db, 2) && NULL == db->query(db, INT_MAX));
+    db->destory(db);
+}
+
+static void test_sparse_open(void)
+{
+    test_remove_files(TEST_FILE_DB);
+    file_db_t* db = test_open(FILE_DB_INDEX_AVL, false);
+    TEST_CHECK(NULL != db);
+    test_data_t ele;
+    memset(&ele, 0, sizeof(ele));
+    ele.key = 1;
+    TEST_CHECK(0 == db->add(db, &ele));
+    ele.key = INT_MAX;
+    TEST_CHECK(0 == db->add(db, &ele));
+    db->free(db);
+
+    TEST_CHECK(NULL == test_open(FILE_DB_INDEX_DENSE, false));
+    db = test_open(FILE_DB_INDEX_AVL, false);
+    TEST_CHECK(NULL != db && 2 == db->size(db));
+    db->destory(db);
+}
+
+int main(void)
+{
+    test_add_fail(false);
+    test_add_fail(true);
+    printf("add fail ok\r\n");
+    test_sparse_open();
+    printf("sparse open ok\r\n");
+    return 0;
+}
@@ -0,0 +1,176 @@
+/*
+** File : test_io_ring.c
+** Author : Saury
+** Date : 2020-09-12
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "FileDatabase.h"
+#include "test_util.h"
+
+/*
+    io_uring 写入：同一组随机操作分别使用 pwrite、io_uring 以及 io_uring 不可用时退回的 pwrite，
+    产生的数据文件必须逐字节相同
+*/
+
+#define TEST_FILE_PWRITE "test_io_ring_pwrite.db"
+#define TEST_FILE_URING "test_io_ring_uring.db"
+#define TEST_FILE_FALLBACK "test_io_ring_fallback.db"
+#define TEST_OPS 20000
+#define TEST_KEY_RANGE 5000
+#define TEST_BATCH 300
+
+/*
+    返回当前可用的最小文件描述符
+*/
+static int test_lowest_fd(void)
+{
+    int fd = open("/dev/null", O_RDONLY);
+    TEST_CHECK(fd >= 0);
+    close(fd);
+    return fd;
+}
+
+/*
+@func:
+    执行固定的随机操作序列：单个与批量的添加、删除、修改，最后修改文件头
+
+@para:
+    path : 数据库文件路径
+    io : 写入方式
+    free_list : 是否使用空闲列表模式
+    lazy : 是否使用懒加载模式
+    fallback : 打开时只留一个可用的文件描述符，数据文件打开后 io_uring 无法创建，数据库退回 pwrite
+
+@return:
+    int : 操作结束后的元素个数
+*/
+static int test_run(const char* path, file_db_io_t io, bool free_list, bool lazy, bool fallback)
+{
+    file_db_option_t option;
+    memset(&option, 0, sizeof(option));
+    option.io = io;
+    option.free_list = free_list;
+    option.lazy = lazy;
+    option.cache_size = 64 * 1024;
+    int head = 7;
+    test_remove_files(path);
+
+    struct rlimit old_limit, limit;
+    if(fallback)
+    {
+        TEST_CHECK(0 == getrlimit(RLIMIT_NOFILE, &old_limit));
+        limit = old_limit;
+        limit.rlim_cur = test_lowest_fd() + 1;
+        TEST_CHECK(0 == setrlimit(RLIMIT_NOFILE, &limit));
+    }
+    int fd_base = test_lowest_fd();
+    file_db_t* db = file_db_init_ex(path, sizeof(head), sizeof(test_data_t), test_get_key, &head, &option);
+    TEST_CHECK(NULL != db);
+    if(fallback)
+    {
+        // 只有数据文件占用了文件描述符
+        TEST_CHECK(0 == setrlimit(RLIMIT_NOFILE, &old_limit));
+        TEST_CHECK(fd_base + 1 == test_lowest_fd());
+    }
+    else if(FILE_DB_IO_URING == io && fd_base + 1 == test_lowest_fd())
+    {
+        // 内核不支持 io_uring 时两种方式都走 pwrite，比较仍然成立
+        printf("io_uring unavailable, compare pwrite only\r\n");
+    }
+
+    test_data_t ele, batch[TEST_BATCH];
+    int keys[TEST_BATCH], status[TEST_BATCH];
+    memset(&ele, 0, sizeof(ele));
+    memset(batch, 0, sizeof(batch));
+    srand(42);
+    for(int i = 0; i < TEST_OPS; ++i)
+    {
+        int key = rand() % TEST_KEY_RANGE;
+        int op = rand() % 10;
+        ele.key = key;
+        snprintf(ele.value, sizeof(ele.value), "%d_%d", key, i);
+        if(op < 4)
+        {
+            db->add(db, &ele);
+        }
+        else if(op < 6)
+        {
+            db->del(db, key);
+        }
+        else if(op < 8)
+        {
+            db->edit(db, key, &ele);
+        }
+        else if(8 == op)
+        {
+            int cnt = rand() % TEST_BATCH;
+            for(int j = 0; j < cnt; ++j)
+            {
+                batch[j].key = rand() % TEST_KEY_RANGE;
+                snprintf(batch[j].value, sizeof(batch[j].value), "b%d", i);
+            }
+            TEST_CHECK(db->add_batch(db, batch, cnt, status) >= 0);
+        }
+        else
+        {
+            int cnt = rand() % 50;
+            for(int j = 0; j < cnt; ++j)
+                keys[j] = rand() % TEST_KEY_RANGE;
+            TEST_CHECK(db->del_batch(db, keys, cnt, status) >= 0);
+        }
+    }
+    head = 9;
+    TEST_CHECK(0 == db->write_head(db, &head));
+    int size = db->size(db);
+    db->free(db);
+
+    // 重新打开后内容完整
+    option.io = FILE_DB_IO_PWRITE;
+    db = file_db_init_ex(path, sizeof(head), sizeof(test_data_t), test_get_key, &head, &option);
+    TEST_CHECK(NULL != db && 9 == head && size == db->size(db));
+    db->free(db);
+    return size;
+}
+
+static void test_compare_file(const char* a, const char* b)
+{
+    char buf_a[65536], buf_b[65536];
+    int fd_a = open(a, O_RDONLY);
+    int fd_b = open(b, O_RDONLY);
+    TEST_CHECK(fd_a >= 0 && fd_b >= 0);
+    ssize_t len_a, len_b;
+    do
+    {
+        len_a = read(fd_a, buf_a, sizeof(buf_a));
+        len_b = read(fd_b, buf_b, sizeof(buf_b));
+        TEST_CHECK(len_a == len_b && 0 == memcmp(buf_a, buf_b, len_a));
+    }while(len_a > 0);
+    close(fd_a);
+    close(fd_b);
+}
+
+int main(void)
+{
+    for(int free_list = 0; free_list < 2; ++free_list)
+    {
+        for(int lazy = 0; lazy < 2; ++lazy)
+        {
+            int size = test_run(TEST_FILE_PWRITE, FILE_DB_IO_PWRITE, free_list, lazy, false);
+            TEST_CHECK(size == test_run(TEST_FILE_URING, FILE_DB_IO_URING, free_list, lazy, false));
+            test_compare_file(TEST_FILE_PWRITE, TEST_FILE_URING);
+            TEST_CHECK(size == test_run(TEST_FILE_FALLBACK, FILE_DB_IO_URING, free_list, lazy, true));
+            test_compare_file(TEST_FILE_PWRITE, TEST_FILE_FALLBACK);
+            printf("free list %d lazy %d ok, size %d\r\n", free_list, lazy, size);
+        }
+    }
+    test_remove_files(TEST_FILE_PWRITE);
+    test_remove_files(TEST_FILE_URING);
+    test_remove_files(TEST_FILE_FALLBACK);
+    return 0;
+}
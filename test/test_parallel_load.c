@@ -0,0 +1,264 @@
+/*
+** File : test_parallel_load.c
+** Author : Saury
+** Date : 2020-09-12
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "FileDatabase.h"
+#include "test_util.h"
+
+/*
+    多线程加载：同一个数据文件以不同的线程数打开，索引内容、遍历顺序以及之后修改产生的文件必须完全相同
+*/
+
+#define TEST_FILE_DB "test_parallel_load.db"
+#define TEST_CNT 100000
+#define TEST_KEY_RANGE (2 * TEST_CNT)
+#define TEST_PIN_STEP 97
+#define TEST_PIN_CNT (TEST_KEY_RANGE / TEST_PIN_STEP + 1)
+#define TEST_CACHE_BLOCKS 16     // 懒加载模式的页缓存只有最少的 16 个块
+
+typedef enum _test_mode
+{
+    TEST_MODE_DEFAULT = 0,     // 默认模式，加载前在文件中制造重复的记录
+    TEST_MODE_LAZY,
+    TEST_MODE_MMAP,
+    TEST_MODE_FREE_LIST,
+    TEST_MODE_LAZY_FREE_LIST,
+    TEST_MODE_INDEX_FILE,
+    TEST_MODE_MMAP_FREE_LIST,
+    TEST_MODE_FROZEN,
+    TEST_MODE_CNT
+}test_mode_t;
+
+static const char* test_mode_names[TEST_MODE_CNT] = {"default", "lazy", "mmap", "free list", "lazy free list", "index file", "mmap free list", "frozen"};
+
+static int test_keys[TEST_CNT];
+static int test_key_cnt;
+
+static void test_visit(void* ele)
+{
+    TEST_CHECK(test_key_cnt < TEST_CNT);
+    test_keys[test_key_cnt++] = ((test_data_t*)ele)->key;
+}
+
+static file_db_option_t test_option(test_mode_t mode, int threads)
+{
+    file_db_option_t option;
+    memset(&option, 0, sizeof(option));
+    option.lazy = TEST_MODE_LAZY == mode || TEST_MODE_LAZY_FREE_LIST == mode;
+    option.mmap = TEST_MODE_MMAP == mode || TEST_MODE_MMAP_FREE_LIST == mode;
+    option.free_list = TEST_MODE_FREE_LIST == mode || TEST_MODE_LAZY_FREE_LIST == mode || TEST_MODE_MMAP_FREE_LIST == mode;
+    option.index_file = TEST_MODE_INDEX_FILE == mode;
+    option.frozen = TEST_MODE_FROZEN == mode;
+    option.load_threads = threads;
+    option.cache_size = option.lazy ? TEST_CACHE_BLOCKS * 4096 : 0;
+    return option;
+}
+
+static void test_copy_file(const char* from, const char* to)
+{
+    char buf[65536];
+    unlink(to);
+    int in = open(from, O_RDONLY);
+    if(in < 0)
+        return;
+    int out = open(to, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    TEST_CHECK(out >= 0);
+    ssize_t len;
+    while((len = read(in, buf, sizeof(buf))) > 0)
+        TEST_CHECK(len == write(out, buf, len));
+    close(in);
+    close(out);
+}
+
+static void test_compare_file(const char* a, const char* b)
+{
+    char buf_a[65536], buf_b[65536];
+    int fd_a = open(a, O_RDONLY);
+    int fd_b = open(b, O_RDONLY);
+    TEST_CHECK(fd_a >= 0 && fd_b >= 0);
+    ssize_t len_a, len_b;
+    do
+    {
+        len_a = read(fd_a, buf_a, sizeof(buf_a));
+        len_b = read(fd_b, buf_b, sizeof(buf_b));
+        TEST_CHECK(len_a == len_b && 0 == memcmp(buf_a, buf_b, len_a));
+    }while(len_a > 0);
+    close(fd_a);
+    close(fd_b);
+}
+
+/*
+    写入并删除部分元素，生成各线程数共用的数据文件
+*/
+static void test_prepare(test_mode_t mode)
+{
+    file_db_option_t option = test_option(mode, 1);
+    option.lazy = false;
+    option.frozen = false;
+    option.index_file = false;
+    int head = 1;
+    test_remove_files(TEST_FILE_DB);
+    file_db_t* db = file_db_init_ex(TEST_FILE_DB, sizeof(head), sizeof(test_data_t), test_get_key, &head, &option);
+    TEST_CHECK(NULL != db);
+    test_data_t* eles = (test_data_t*)calloc(TEST_CNT, sizeof(test_data_t));
+    TEST_CHECK(NULL != eles);
+    for(int i = 0; i < TEST_CNT; ++i)
+    {
+        eles[i].key = (int)((unsigned)i * 2654435761u % TEST_KEY_RANGE);
+        eles[i].value[0] = (char)eles[i].key;
+    }
+    // 键值可能重复，重复的元素添加失败
+    TEST_CHECK(db->add_batch(db, eles, TEST_CNT, NULL) > 0);
+    srand(mode);
+    for(int i = 0; i < TEST_CNT / 3; ++i)
+        db->del(db, eles[rand() % TEST_CNT].key);
+    db->free(db);
+    free(eles);
+
+    if(TEST_MODE_DEFAULT == mode)
+    {
+        // 数据文件：文件头、记录数量、记录依次存放；把第 10 个记录复制到其它位置，加载时只保留第一个
+        char buf[sizeof(test_data_t)];
+        off_t base = sizeof(head) + sizeof(int);
+        int fd = open(TEST_FILE_DB, O_RDWR);
+        TEST_CHECK(fd >= 0);
+        TEST_CHECK((ssize_t)sizeof(buf) == pread(fd, buf, sizeof(buf), base + 10 * (off_t)sizeof(buf)));
+        TEST_CHECK((ssize_t)sizeof(buf) == pwrite(fd, buf, sizeof(buf), base + 20 * (off_t)sizeof(buf)));
+        TEST_CHECK((ssize_t)sizeof(buf) == pwrite(fd, buf, sizeof(buf), base + 5000 * (off_t)sizeof(buf)));
+        TEST_CHECK((ssize_t)sizeof(buf) == pwrite(fd, buf, sizeof(buf), base + 50000 * (off_t)sizeof(buf)));
+        close(fd);
+    }
+    else if(TEST_MODE_INDEX_FILE == mode)
+    {
+        // 先生成索引文件，之后的打开直接加载索引
+        option = test_option(mode, 1);
+        db = file_db_init_ex(TEST_FILE_DB, sizeof(head), sizeof(test_data_t), test_get_key, &head, &option);
+        TEST_CHECK(NULL != db);
+        db->free(db);
+    }
+}
+
+/*
+    以指定线程数打开副本，记录遍历结果，再执行相同的修改序列
+*/
+static int test_open(const char* path, test_mode_t mode, int threads)
+{
+    file_db_option_t option = test_option(mode, threads);
+    int head = 1;
+    file_db_t* db = file_db_init_ex(path, sizeof(head), sizeof(test_data_t), test_get_key, &head, &option);
+    TEST_CHECK(NULL != db);
+    test_key_cnt = 0;
+    if(!option.lazy)
+        TEST_CHECK(0 == db->traverse(db, test_visit));
+    int size = db->size(db);
+
+    test_data_t ele;
+    memset(&ele, 0, sizeof(ele));
+    srand(99);
+    if(!option.frozen)
+    {
+        for(int i = 0; i < 2000; ++i)
+        {
+            int key = rand() % TEST_KEY_RANGE;
+            if(rand() % 2)
+            {
+                ele.key = key;
+                ele.value[0] = (char)key;
+                db->add(db, &ele);
+            }
+            else
+            {
+                db->del(db, key);
+            }
+        }
+    }
+    if(option.lazy)
+    {
+        static int pin_keys[TEST_PIN_CNT];
+        static void* pin_eles[TEST_PIN_CNT];
+        int pin_cnt = 0, pin_found = 0;
+        for(int key = 0; key < TEST_KEY_RANGE; key += TEST_PIN_STEP)
+        {
+            pin_keys[pin_cnt++] = key;
+            test_data_t* found = (test_data_t*)db->pin(db, key);
+            if(NULL != found)
+            {
+                TEST_CHECK(key == found->key && (char)key == found->value[0]);
+                db->unpin(db, found);
+                pin_found++;
+            }
+        }
+        // 整批涉及的块多于页缓存时失败且不固定任何元素；每批不超过块数时与逐个 pin 相同
+        TEST_CHECK(-4 == db->pin_batch(db, pin_keys, pin_cnt, pin_eles));
+        for(int i = 0; i < pin_cnt; ++i)
+            TEST_CHECK(NULL == pin_eles[i]);
+        int batch_found = 0;
+        for(int i = 0; i < pin_cnt; i += TEST_CACHE_BLOCKS)
+        {
+            int cnt = pin_cnt - i < TEST_CACHE_BLOCKS ? pin_cnt - i : TEST_CACHE_BLOCKS;
+            int n = db->pin_batch(db, pin_keys + i, cnt, pin_eles);
+            TEST_CHECK(n >= 0);
+            batch_found += n;
+            for(int j = 0; j < cnt; ++j)
+            {
+                test_data_t* found = (test_data_t*)pin_eles[j];
+                if(NULL == found) continue;
+                TEST_CHECK(pin_keys[i + j] == found->key);
+                db->unpin(db, found);
+            }
+        }
+        TEST_CHECK(pin_found == batch_found);
+    }
+    db->free(db);
+    return size;
+}
+
+int main(void)
+{
+    static int ref_keys[TEST_CNT];
+    const int threads[] = {3, 7};
+    char path[64], index_from[96], index_to[96];
+
+    for(int mode = 0; mode < TEST_MODE_CNT; ++mode)
+    {
+        test_prepare((test_mode_t)mode);
+        snprintf(index_from, sizeof(index_from), "%s.idx", TEST_FILE_DB);
+
+        // 单线程加载的结果作为参照
+        snprintf(path, sizeof(path), "%s.1", TEST_FILE_DB);
+        test_copy_file(TEST_FILE_DB, path);
+        snprintf(index_to, sizeof(index_to), "%s.idx", path);
+        test_copy_file(index_from, index_to);
+        int ref_size = test_open(path, (test_mode_t)mode, 1);
+        int ref_cnt = test_key_cnt;
+        memcpy(ref_keys, test_keys, sizeof(int) * ref_cnt);
+        TEST_CHECK(ref_size > 0);
+
+        for(int i = 0; i < (int)(sizeof(threads) / sizeof(threads[0])); ++i)
+        {
+            char ref_path[64];
+            snprintf(path, sizeof(path), "%s.%d", TEST_FILE_DB, threads[i]);
+            test_copy_file(TEST_FILE_DB, path);
+            snprintf(index_to, sizeof(index_to), "%s.idx", path);
+            test_copy_file(index_from, index_to);
+            TEST_CHECK(ref_size == test_open(path, (test_mode_t)mode, threads[i]));
+            TEST_CHECK(ref_cnt == test_key_cnt && 0 == memcmp(ref_keys, test_keys, sizeof(int) * ref_cnt));
+            snprintf(ref_path, sizeof(ref_path), "%s.1", TEST_FILE_DB);
+            test_compare_file(ref_path, path);
+            unlink(index_to);
+        }
+        printf("%s ok, size %d\r\n", test_mode_names[mode], ref_size);
+    }
+
+    snprintf(path, sizeof(path), "%s.1.idx", TEST_FILE_DB);
+    unlink(path);
+    test_remove_files(TEST_FILE_DB);
+    return 0;
+}
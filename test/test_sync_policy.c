@@ -0,0 +1,173 @@
+/*
+** File : test_sync_policy.c
+** Author : Saury
+** Date : 2020-09-12
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "FileDatabase.h"
+#include "test_util.h"
+
+/*
+    持久化策略：直接写入、预写日志与内存映射模式下，各策略在并发修改与后台整理时结果正确，重新打开后内容完整；
+    链接时使用 --wrap 替换 fdatasync / msync（定义 TEST_COUNT_SYNCS）时还检查同步次数：
+    NONE 不同步，EVERY 每次修改同步一次，GROUP 不多于修改次数，INTERVAL 只由后台线程定时同步且空闲时跳过
+*/
+
+#define TEST_FILE_DB "test_sync_policy.db"
+#define TEST_WRITERS 4
+#define TEST_ADDS 150
+#define TEST_INTERVAL_MS 20
+#define TEST_WAIT_ROUNDS 250     // 等待后台同步时最多轮询的间隔数
+
+typedef enum _test_mode
+{
+    TEST_MODE_DIRECT = 0,
+    TEST_MODE_WAL,
+    TEST_MODE_MMAP,
+    TEST_MODE_CNT
+}test_mode_t;
+
+static const char* test_mode_names[TEST_MODE_CNT] = {"direct", "wal", "mmap"};
+static const char* test_sync_names[] = {"none", "group", "every", "interval"};
+
+static file_db_t* test_db;
+static long test_sync_cnt;
+
+#ifdef TEST_COUNT_SYNCS
+int __real_fdatasync(int fd);
+int __real_msync(void* addr, size_t len, int flags);
+
+int __wrap_fdatasync(int fd)
+{
+    __atomic_add_fetch(&test_sync_cnt, 1, __ATOMIC_RELAXED);
+    return __real_fdatasync(fd);
+}
+
+int __wrap_msync(void* addr, size_t len, int flags)
+{
+    __atomic_add_fetch(&test_sync_cnt, 1, __ATOMIC_RELAXED);
+    return __real_msync(addr, len, flags);
+}
+#endif /* end #ifdef TEST_COUNT_SYNCS */
+
+static long test_syncs(void)
+{
+    return __atomic_load_n(&test_sync_cnt, __ATOMIC_RELAXED);
+}
+
+/*
+    每个线程添加 TEST_ADDS 个元素，并删除其中三分之一
+*/
+static void* test_writer(void* arg)
+{
+    long id = (long)arg;
+    test_data_t ele;
+    memset(&ele, 0, sizeof(ele));
+    for(int i = 0; i < TEST_ADDS; ++i)
+    {
+        ele.key = (int)(id * 100000 + i);
+        TEST_CHECK(0 == test_db->add(test_db, &ele));
+        if(0 == i % 3)
+            TEST_CHECK(0 == test_db->del(test_db, ele.key));
+        usleep(500);
+    }
+    return NULL;
+}
+
+static void test_policy(test_mode_t mode, file_db_sync_t sync)
+{
+    const int ops = TEST_WRITERS * (TEST_ADDS + TEST_ADDS / 3);
+    const int size = TEST_WRITERS * (TEST_ADDS - TEST_ADDS / 3);
+    file_db_option_t option;
+    memset(&option, 0, sizeof(option));
+    option.sync = sync;
+    option.sync_interval = TEST_INTERVAL_MS;
+    option.wal = TEST_MODE_WAL == mode;
+    option.mmap = TEST_MODE_MMAP == mode;
+    option.compact = true;
+    option.compact_ratio = 5;
+    int head = 7;
+    test_remove_files(TEST_FILE_DB);
+    test_db = file_db_init_ex(TEST_FILE_DB, sizeof(head), sizeof(test_data_t), test_get_key, &head, &option);
+    TEST_CHECK(NULL != test_db);
+
+    __atomic_store_n(&test_sync_cnt, 0, __ATOMIC_RELAXED);
+    pthread_t writers[TEST_WRITERS];
+    for(long i = 0; i < TEST_WRITERS; ++i)
+        pthread_create(&writers[i], NULL, test_writer, (void*)i);
+    for(int i = 0; i < TEST_WRITERS; ++i)
+        pthread_join(writers[i], NULL);
+    long syncs = test_syncs();
+    TEST_CHECK(size == test_db->size(test_db));
+
+#ifdef TEST_COUNT_SYNCS
+    if(FILE_DB_SYNC_NONE == sync)
+        TEST_CHECK(0 == syncs);
+    else if(FILE_DB_SYNC_GROUP == sync || (FILE_DB_SYNC_EVERY == sync && TEST_MODE_WAL == mode))
+        TEST_CHECK(syncs > 0 && syncs <= ops);
+    else if(FILE_DB_SYNC_EVERY == sync)
+        TEST_CHECK(syncs >= ops);
+    else
+        TEST_CHECK(syncs > 0 && syncs < ops / 4);
+#endif
+
+    if(FILE_DB_SYNC_INTERVAL == sync)
+    {
+        // 等待后台整理与最后一次定时同步结束，空闲的数据库连续 5 个间隔不再同步；
+        // 轮询有上限，机器繁忙时线程调度延迟不会导致误判
+        long idle = test_syncs();
+        int stable = 0;
+        for(int i = 0; i < TEST_WAIT_ROUNDS && stable < 5; ++i)
+        {
+            usleep(TEST_INTERVAL_MS * 1000);
+            long now = test_syncs();
+            stable = now == idle ? stable + 1 : 0;
+            idle = now;
+        }
+        TEST_CHECK(5 == stable);
+
+        // 单个修改不等待落盘，由后台线程在之后的间隔内同步
+        test_data_t ele;
+        memset(&ele, 0, sizeof(ele));
+        ele.key = -1;
+        TEST_CHECK(0 == test_db->add(test_db, &ele));
+        TEST_CHECK(0 == test_db->del(test_db, ele.key));
+#ifdef TEST_COUNT_SYNCS
+        for(int i = 0; i < TEST_WAIT_ROUNDS && test_syncs() == idle; ++i)
+            usleep(TEST_INTERVAL_MS * 1000);
+        TEST_CHECK(test_syncs() > idle);
+#endif
+    }
+    test_db->free(test_db);
+
+    test_db = file_db_init_ex(TEST_FILE_DB, sizeof(head), sizeof(test_data_t), test_get_key, &head, NULL);
+    TEST_CHECK(NULL != test_db && 7 == head && size == test_db->size(test_db));
+    test_data_t ele;
+    for(long i = 0; i < TEST_WRITERS; ++i)
+    {
+        for(int j = 0; j < TEST_ADDS; ++j)
+        {
+            int key = (int)(i * 100000 + j);
+            TEST_CHECK((0 == j % 3) == (0 != test_db->read(test_db, key, &ele)));
+        }
+    }
+    test_db->destory(test_db);
+    printf("%s %s ok, %ld syncs for %d ops\r\n", test_mode_names[mode], test_sync_names[sync], syncs, ops);
+}
+
+int main(void)
+{
+    for(int mode = 0; mode < TEST_MODE_CNT; ++mode)
+    {
+        test_policy((test_mode_t)mode, FILE_DB_SYNC_NONE);
+        test_policy((test_mode_t)mode, FILE_DB_SYNC_GROUP);
+        test_policy((test_mode_t)mode, FILE_DB_SYNC_EVERY);
+        test_policy((test_mode_t)mode, FILE_DB_SYNC_INTERVAL);
+    }
+    return 0;
+}
@@ -0,0 +1,64 @@
+/*
+** File : test_util.h
+** Author : Saury
+** Date : 2020-09-12
+*/
+
+#ifndef _TEST_UTIL_H_
+#define _TEST_UTIL_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/*
+    测试用例共用的元素类型与检查宏：检查失败时打印位置并以非 0 退出，由 ctest 记为失败
+*/
+
+typedef struct _test_data
+{
+    int key;
+    char value[60];
+}test_data_t;
+
+#define TEST_CHECK(cond) \
+    do{ \
+        if(!(cond)) \
+        {\
+            printf("%s at %d check failed: %s\r\n", __FILE__, __LINE__, #cond);\
+            exit(1);\
+        }\
+    }while(0)
+
+static inline int test_get_key(void *ele)
+{
+    return ((test_data_t*)ele)->key;
+}
+
+/*
+@func:
+    删除数据库文件以及索引、日志、整理与分片产生的文件，保证每个用例从空的数据库开始
+
+@para:
+    path : 数据库文件路径
+
+@return:
+    None.
+*/
+static inline void test_remove_files(const char* path)
+{
+    const char* suffixes[] = {"", ".idx", ".wal0", ".wal1", ".compact", ".shards"};
+    char file[256];
+    for(int i = 0; i < (int)(sizeof(suffixes) / sizeof(suffixes[0])); ++i)
+    {
+        snprintf(file, sizeof(file), "%s%s", path, suffixes[i]);
+        unlink(file);
+    }
+    for(int i = 0; i < 8; ++i)
+    {
+        snprintf(file, sizeof(file), "%s.%d", path, i);
+        unlink(file);
+    }
+}
+
+#endif /* end #ifndef _TEST_UTIL_H_ */